@@ -89,9 +89,13 @@
 #include "periph/periph.h"
 #include "snd/snd.h"
 #include "serializer/serializer.h"
+#include "serializer/snapshot.h"
 #include "ay8910.h"
 
 LOCAL  uint_32 ay8910_calc_sound(ay8910_t *ay8910, uint_64 until);
+LOCAL  uint_32 ay8910_calc_state(ay8910_t *ay8910, uint_64 until);
+
+#define AY8910_STATE_TICK (14934)   /* Tick rate when not making sound.     */
 
 /*
  * ============================================================================
@@ -188,7 +192,9 @@ void ay8910_write
     /* -------------------------------------------------------------------- */
     if (write_time > ay8910->sound_current + ay8910->accutick)
     {
-        ay8910->unaccounted += ay8910_calc_sound(ay8910, write_time);
+        ay8910->unaccounted += ay8910->rate
+                             ? ay8910_calc_sound(ay8910, write_time)
+                             : ay8910_calc_state(ay8910, write_time);
 
         if (write_time > (ay8910->sound_current + 4))
         {
@@ -354,7 +360,8 @@ uint_32 ay8910_tick
     ay8910->unaccounted = 0;
 
     if (bus->now + len > ay8910->sound_current)
-        elapsed += ay8910_calc_sound(ay8910, bus->now + len);
+        elapsed += ay8910->rate ? ay8910_calc_sound(ay8910, bus->now + len)
+                                : ay8910_calc_state(ay8910, bus->now + len);
 
     if (ay8910->sound_current >= bus->now)
         return elapsed;
@@ -366,10 +373,18 @@ LOCAL const int ay8910_eshift[4] = { 31, 2, 1, 0 };
 
 /*
  * ============================================================================
- *  AY8910_CALC_SOUND    -- The device.
+ *  AY8910_CALC          -- The device.  With 'state_only' set, this steps
+ *                          the counters, envelope and noise generator from
+ *                          one event to the next, but skips all the work
+ *                          of generating samples in between.
  * ============================================================================
  */
-LOCAL uint_32 ay8910_calc_sound(ay8910_t *psg, uint_64 until)
+LOCAL INLINE uint_32 ay8910_calc
+(
+    ay8910_t        *psg,
+    uint_64         until,
+    const int       state_only
+)
 {
     /* -------------------------------------------------------------------- */
     /*  This is a rather inefficient implementation that is striving for    */
@@ -397,7 +412,7 @@ LOCAL uint_32 ay8910_calc_sound(ay8910_t *psg, uint_64 until)
     /*  If we don't have a current buffer, see if we can get a clean one.   */
     /*  If not, then we can't process any data, and time doesn't advance.   */
     /* -------------------------------------------------------------------- */
-    if (!psg->cur_buf)
+    if (!state_only && !psg->cur_buf)
     {
         if (psg->snd_buf.num_clean)
         {
@@ -442,7 +457,10 @@ LOCAL uint_32 ay8910_calc_sound(ay8910_t *psg, uint_64 until)
     while ((psg->sound_current + 3) < until)
     {
         max_step = (until - psg->sound_current) >> 2;
-        max_step = max_step > 256 ? 256 : max_step;
+        if (!state_only)
+            max_step = max_step > 256 ? 256 : max_step;
+        else
+            max_step = max_step > 0x40000000 ? 0x40000000 : max_step;
         step = cnt0 < cnt1          ? cnt0 : cnt1;
         step = step < cnt2          ? step : cnt2;
         step = step < cntN          ? step : cntN;
@@ -524,6 +542,17 @@ LOCAL uint_32 ay8910_calc_sound(ay8910_t *psg, uint_64 until)
             env_vol = ay8910_vol[env_idx & 15];
         }
 
+        /* ---------------------------------------------------------------- */
+        /*  In state-only mode, that's all.  Just flip the channel bits.    */
+        /* ---------------------------------------------------------------- */
+        if (state_only)
+        {
+            chn_a ^= hit_a;
+            chn_b ^= hit_b;
+            chn_c ^= hit_c;
+            continue;
+        }
+
         /* ---------------------------------------------------------------- */
         /*  Recalculate sample.                                             */
         /* ---------------------------------------------------------------- */
@@ -628,6 +657,24 @@ no_buffer:
     return elapsed;
 }
 
+/*
+ * ============================================================================
+ *  AY8910_CALC_SOUND    -- Advance the PSG, generating sound.
+ *  AY8910_CALC_STATE    -- Advance the PSG's state only.  Used when sound
+ *                          is off, so that the PSG's state still matches
+ *                          what it would have been with sound on.
+ * ============================================================================
+ */
+LOCAL uint_32 ay8910_calc_sound(ay8910_t *psg, uint_64 until)
+{
+    return ay8910_calc(psg, until, 0);
+}
+
+LOCAL uint_32 ay8910_calc_state(ay8910_t *psg, uint_64 until)
+{
+    return ay8910_calc(psg, until, 1);
+}
+
 /*
  * ============================================================================
  *  AY8910_RESET     -- Reset the PSG
@@ -662,30 +709,6 @@ LOCAL void ay8910_reset
 }
 
 
-/*
- * ============================================================================
- *  AY8910_D_WR      -- Dummy write to PSG
- * ============================================================================
- */
-LOCAL void ay8910_d_wr  
-(
-    periph_p        bus,        /*  Peripheral bus being written.       */
-    periph_p        req,        /*  Peripheral requesting write.        */
-    uint_32         addr,       /*  Address being written.              */
-    uint_32         data        /*  Data being written.                 */
-)
-{
-    ay8910_t *ay8910 = (ay8910_t *)bus;
-
-    UNUSED(req);
-
-    addr &= 15;
-
-    if (addr < 14) ay8910->reg[addr] = data & 0xFF;
-}
-
-
-
 /*
  * ============================================================================
  *  AY8910_SER_INIT      -- Registers the PSG w/ the serializer.
@@ -693,10 +716,8 @@ LOCAL void ay8910_d_wr
  */
 LOCAL void ay8910_ser_init(periph_p p)
 {
-#ifdef NO_SERIALIZER
-    UNUSED(p);
-#else
     ay8910_t *psg = (ay8910_t *)p;
+#ifndef NO_SERIALIZER
     ser_hier_t *hier, *phier;
 
     hier = ser_new_hierarchy(NULL, p->name);
@@ -715,6 +736,14 @@ LOCAL void ay8910_ser_init(periph_p p)
 
     periph_ser_register(p, phier);
 #endif
+
+    /* -------------------------------------------------------------------- */
+    /*  Snapshots take the registers, counters, envelope and noise state,   */
+    /*  and how far along the sound is.  The sound buffers stay put.        */
+    /* -------------------------------------------------------------------- */
+    SNAP_FIELDS(p->name, psg, ay8910_t, reg,        cnt);
+    SNAP_FIELDS(p->name, psg, ay8910_t, noise_rng,  chan);
+    SNAP_FIELDS(p->name, psg, ay8910_t, sample_frc, unaccounted);
 }
 
 
@@ -786,10 +815,10 @@ int ay8910_init
     /*  Set up the peripheral.                                              */
     /* -------------------------------------------------------------------- */
     ay8910->periph.read      = ay8910_read;
-    ay8910->periph.write     = rate ? ay8910_write : ay8910_d_wr;
+    ay8910->periph.write     = ay8910_write;
     ay8910->periph.peek      = ay8910_read;
-    ay8910->periph.poke      = rate ? ay8910_write : ay8910_d_wr;
-    ay8910->periph.tick      = rate ? ay8910_tick  : NULL;
+    ay8910->periph.poke      = ay8910_write;
+    ay8910->periph.tick      = ay8910_tick;
     ay8910->periph.reset     = ay8910_reset;
     ay8910->periph.min_tick  = snd->buf_size;
     ay8910->periph.max_tick  = snd->buf_size * 3 / 2;
@@ -798,7 +827,25 @@ int ay8910_init
     ay8910->periph.ser_init  = ay8910_ser_init;
     ay8910->periph.dtor      = ay8910_dtor;
 
-    if (!rate) return 0;  /* return if no actual sound. */
+    /* -------------------------------------------------------------------- */
+    /*  With no sound, run in state-only mode.  Writes and ticks keep the   */
+    /*  PSG's internal state exact, but no samples are generated and we     */
+    /*  don't register with the sound device.                               */
+    /* -------------------------------------------------------------------- */
+    if (!rate)
+    {
+        ay8910->sys_clock       = sys_clock;
+        ay8910->time_scale      = time_scale;
+        ay8910->accutick        = accutick;
+        ay8910->noise_rng       = 1;
+        ay8910->periph.min_tick = AY8910_STATE_TICK;
+        ay8910->periph.max_tick = AY8910_STATE_TICK;
+
+        for (i = 0; i < 14; i++)
+            ay8910->periph.write((periph_p)ay8910, (periph_p)ay8910, i, 0);
+
+        return 0;
+    }
 
     /* -------------------------------------------------------------------- */
     /*  If wind == -1, calculate a window size based on the ratio of our    */
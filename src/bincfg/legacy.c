@@ -19,6 +19,7 @@
 #include "cp1600/cp1600.h"
 #include "bincfg.h"
 #include "legacy.h"
+#include "serializer/snapshot.h"
 
 #ifdef GCWZERO
 #include "name/name.h"
@@ -62,6 +63,7 @@ void  legacy_write(periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
     {
         mask = ~(~0 << l->loc[addr].width);
         l->loc[addr].data = data & mask;
+        SNAP_DIRTY(l->dirty, addr);
     }
 }
 
@@ -78,6 +80,7 @@ void legacy_poke (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
 
     mask = ~(~0 << l->loc[addr].width);
     l->loc[addr].data = data & mask;
+    SNAP_DIRTY(l->dirty, addr);
 }
 
 
@@ -770,6 +773,14 @@ int legacy_register
         /* ---------------------------------------------------------------- */
         cp1600_cacheable(cp, span->s_addr, span->e_addr,
                          (span->flags & BC_SPAN_W) != 0);
+
+        /* ---------------------------------------------------------------- */
+        /*  Writable spans are cartridge RAM, which goes in snapshots.      */
+        /* ---------------------------------------------------------------- */
+        if (span->flags & BC_SPAN_W)
+            snap_track("Legacy RAM", l->loc, span->s_addr,
+                       span->e_addr - span->s_addr + 1,
+                       sizeof(legacy_loc_t), l->dirty);
     }
     /* -------------------------------------------------------------------- */
     /*  Handle ECS-style pages differently.                                 */
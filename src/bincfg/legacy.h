@@ -32,6 +32,7 @@ typedef struct legacy_t
     mem_t       *pg_rom;    /* any paged ROMs that were in the CFG are here */
     int         npg_rom;    /* number of paged ROMs.                        */
     bc_cfgfile_t *bc;       /* config file.  Valid between read & register  */
+    uint_32     dirty[8];   /* RAM pages written since last snapshot.       */
 } legacy_t;
 
 #define LOC_MAPPED (0x80)   /* flag not used by bc_cfgfile_t.               */
@@ -39,6 +39,10 @@
 #include "event/event.h"
 #include "joy/joy.h"
 #include "serializer/serializer.h"
+#include "serializer/rewind.h"
+#include "serializer/inpmov.h"
+#include "serializer/inplog.h"
+#include "serializer/autosave.h"
 #include "plat/plat_lib.h"
 #include "misc/file_crc32.h"
 #include "name/name.h"
@@ -377,6 +381,7 @@ struct option cfg_longopt[] =
     {   "audiomintick", 1,      NULL,       'M'     },
     {   "voice",        2,      NULL,       'v'     },
     {   "voicewindow",  2,      NULL,       'W'     },
+    {   "voicetaps",    1,      NULL,       24      },
     {   "voicefiles",   2,      NULL,       'V'     },
     {   "i2pc0",        2,      NULL,       'i'     },
     {   "i2pc1",        2,      NULL,       'I'     },
@@ -438,6 +443,19 @@ struct option cfg_longopt[] =
 
     {   "enable-mouse", 0,      NULL,       22      },
     {   "prescale",     1,      NULL,       23      },
+    {   "rewind",       1,      NULL,       25      },
+    {   "rewind-secs",  1,      NULL,       26      },
+    {   "record-input", 1,      NULL,       27      },
+    {   "replay-input", 1,      NULL,       28      },
+    {   "input-check",  1,      NULL,       29      },
+    {   "headless",     0,      NULL,       30      },
+    {   "demo-flush",   1,      NULL,       31      },
+    {   "demo-lzo",     0,      NULL,       32      },
+    {   "autosave",     1,      NULL,       33      },
+    {   "autosave-secs",1,      NULL,       34      },
+    {   "gdb-port",     1,      NULL,       35      },
+    {   "heatmap",      1,      NULL,       36      },
+    {   "budget",       1,      NULL,       37      },
 
 //gcw    {   "locutus",      0,      NULL,       127     },  // for testing
 
@@ -487,6 +505,17 @@ void cfg_init(cfg_t *cfg, int argc, char * argv[])
     char       *disp_res = NULL;
     const char *err_msg  = NULL;
     int locutus        = 0;
+    char *inpmov_file  = NULL;
+    char *autosave_file= NULL;
+    int inpmov_mode    = INPMOV_OFF;
+    int inpmov_check   = 60;
+    int headless       = 0;
+    int demo_flush     = DEMO_FLUSH_FRAMES;
+    int demo_lzo       = 0;
+    int gdb_port       = 0;
+    char *heat_base    = NULL;
+    char *budget_file  = NULL;
+    uint_32 seed;
 #ifndef NO_SERIALIZER
     ser_hier_t *ser_cfg;
 #endif
@@ -512,6 +541,7 @@ void cfg_init(cfg_t *cfg, int argc, char * argv[])
     cfg->ecs_enable = -1;           /* Automatic (dflt: ECS off)            */
     cfg->ivc_enable = -1;           /* Automatic (dflt: Intellivoice off.   */
     cfg->ivc_window = -1;           /* Automatic window setting.            */
+    cfg->ivc_taps   = -1;           /* Default resampler length.            */
     cfg->gfx_flags  = 0             /* Windowed, single buf, hardware surf  */
 #if 0
                     | GFX_DRECTS    /* Dirty rectangle update               */
@@ -531,6 +561,9 @@ void cfg_init(cfg_t *cfg, int argc, char * argv[])
     cfg->accutick   = 1;            /* fully accurate audio.                */
     cfg->binding    = cfg_key_bind; /* default key bindings.                */
     cfg->start_dly  = -1;           /* No startup delay by default.         */
+    cfg->rewind_mb  = 0;            /* No rewind buffer.                    */
+    cfg->rewind_secs= 30;           /* 30 seconds of rewind when enabled.   */
+    cfg->autosave_secs = 60;        /* Autosave once a minute when enabled. */
 
 #ifdef GCWZERO
     cfg->fn_exec    = strdup("/media/data/local/home/.jzintellivision/bios/exec.bin");   /* Default name to look for     */
@@ -670,6 +703,23 @@ void cfg_init(cfg_t *cfg, int argc, char * argv[])
                                                                        
             case 22:  enable_mouse = 1;                                 break;
             case 23:  cfg->prescale = value;                            break;
+            case 24:  cfg->ivc_taps   = value;                          break;
+            case 25:  cfg->rewind_mb  = value;                          break;
+            case 26:  cfg->rewind_secs= value;                          break;
+            case 27:  STR_REPLACE(inpmov_file     , optarg);           
+                      inpmov_mode = INPMOV_RECORD;                      break;
+            case 28:  STR_REPLACE(inpmov_file     , optarg);           
+                      inpmov_mode = INPMOV_PLAY;                        break;
+            case 29:  inpmov_check    = value;                          break;
+            case 30:  headless        = 1;                              break;
+            case 31:  demo_flush      = value;                          break;
+            case 32:  demo_lzo        = 1;                              break;
+            case 33:  STR_REPLACE(autosave_file   , optarg);            break;
+            case 34:  cfg->autosave_secs = value;                       break;
+            case 35:  gdb_port        = value;
+                      cfg->debugging  = 1;                              break;
+            case 36:  STR_REPLACE(heat_base       , optarg);            break;
+            case 37:  STR_REPLACE(budget_file     , optarg);            break;
 
             case 'c': 
             {
@@ -813,6 +863,14 @@ void cfg_init(cfg_t *cfg, int argc, char * argv[])
         exit(1);
     }
 
+    /* -------------------------------------------------------------------- */
+    /*  Input movies run with sound off:  the sound path waits on the host  */
+    /*  for buffers, so its timing isn't repeatable.  Headless runs have    */
+    /*  no one listening anyway.                                            */
+    /* -------------------------------------------------------------------- */
+    if (inpmov_mode != INPMOV_OFF || headless)
+        cfg->audio_rate = 0;
+
     /* -------------------------------------------------------------------- */
     /*  Delay starting emulation if full-screen is specified and no other   */
     /*  start delay is specified.                                           */
@@ -998,6 +1056,7 @@ cfgreset:
         uint_32 crc32;
         int     default_ecs = -1, default_ivc = -1;
         crc32 = file_crc32(cfg->fn_game);
+        cfg->rom_crc = crc32;
         if ((cfg->cart_name = find_cart_name(crc32, 
                                              &cfg->cart_year,
                                              &default_ecs,
@@ -1096,7 +1155,8 @@ locutus_loaded:
 
     if (demofile &&
         demo_init(&cfg->demo, demofile, &cfg->psg0, 
-                  cfg->ecs_enable > 0 ? &cfg->psg1 : 0))
+                  cfg->ecs_enable > 0 ? &cfg->psg1 : 0,
+                  demo_flush, demo_lzo))
     {
         fprintf(stderr, "ERROR:  Failed to initialize demo recorder\n");
         exit(1);
@@ -1221,6 +1281,7 @@ locutus_loaded:
         fprintf(stderr, "ERROR:  Failed to initialize rate control.\n");
         exit(1);
     }
+    cfg->speed.unthrottled = headless;
 
     if (cfg->debugging && 
         debug_init(&cfg->debug, &cfg->cp1600,
@@ -1233,6 +1294,9 @@ locutus_loaded:
         exit(1);
     }
 
+    if (gdb_port && debug_gdb_start(gdb_port))
+        fprintf(stderr, "Continuing without the GDB stub.\n");
+
     if (joy_init(1, joy_cfg))
     {
         fprintf(stderr, "ERROR:  Failed to initialize joystick subsystem.\n");
@@ -1244,6 +1308,22 @@ locutus_loaded:
         fprintf(stderr, "ERROR:  Failed to initialize event subsystem.\n");
         exit(1);
     }
+
+    if (inpmov_mode != INPMOV_OFF &&
+        inpmov_init(&cfg->inpmov, inpmov_file, inpmov_mode, inpmov_check,
+                    &cfg->pad0, &cfg->pad1, &cfg->do_exit))
+    {
+        fprintf(stderr, "ERROR:  Failed to open input movie\n");
+        exit(1);
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  The debugger replays from the rewind buffer when it runs backwards, */
+    /*  and needs the input that goes with it.  Movies bring their own.     */
+    /* -------------------------------------------------------------------- */
+    if (cfg->debugging && cfg->rewind_mb > 0 && inpmov_mode == INPMOV_OFF &&
+        inplog_init(&cfg->inplog, &cfg->pad0, &cfg->pad1))
+        fprintf(stderr, "Continuing without running backwards.\n");
     
     if (cfg_setbind(cfg, kbdhackfile))
     {
@@ -1251,14 +1331,18 @@ locutus_loaded:
         exit(1);
     }
 
-    if (cfg->ivc_enable > 0 && cfg->audio_rate > 0 &&
+    if (cfg->ivc_enable > 0 &&
         ivoice_init(&cfg->ivoice, 0x80, &cfg->snd, 
-                    cfg->audio_rate, cfg->ivc_window, cfg->ivc_tname))
+                    cfg->audio_rate, cfg->ivc_window, cfg->ivc_taps,
+                    cfg->ivc_tname))
     {
         fprintf(stderr, "ERROR:  Failed to initialize Intellivoice\n");
         exit(1);
     }
 
+    if (cfg->ivc_enable > 0 && demofile)
+        cfg->ivoice.demo = &cfg->demo;
+
     /* -------------------------------------------------------------------- */
     /*  Note:  We handle the EXEC ROM specially, since it's weird on        */
     /*  the Intellivision 2.                                                */
@@ -1291,7 +1375,7 @@ locutus_loaded:
     if (cfg->ecs_enable > 0)
         periph_register(P(psg1           ),  0x00F0, 0x00FF, "PSG1 AY8914" );
 
-    if (cfg->ivc_enable > 0 && cfg->audio_rate)
+    if (cfg->ivc_enable > 0)
         periph_register(P(ivoice         ),  0x0080, 0x0081, "Int. Voice"  );
 
     periph_register    (P(gfx            ),  0x0000, 0x0000, "[Graphics]"  );
@@ -1344,6 +1428,10 @@ locutus_loaded:
     periph_register    (P(stic.snoop_gram),  0x3000, 0x3FFF, "STIC (GRAM)" );
 
     periph_register    (P(event          ),  0x0000, 0x0000, "[Event]"     );
+    if (inpmov_mode != INPMOV_OFF)
+        periph_register(P(inpmov         ),  0x0000, 0x0000, "[Input Movie]");
+    if (cfg->inplog.mode != INPLOG_OFF)
+        periph_register(P(inplog         ),  0x0000, 0x0000, "[Input Log]" );
 
     if (cfg->rate_ctl > 0.0)
         periph_register(P(speed          ),  0x0000, 0x0000, "[Rate Ctrl]" );
@@ -1385,6 +1473,39 @@ locutus_loaded:
     if (cfg->debugging)
         periph_register(P(debug          ),  0x0000, 0xFFFF, "[Debugger]"  );
 
+    /* -------------------------------------------------------------------- */
+    /*  Set up the rewind buffer.  Everything has registered its state by   */
+    /*  now, so this comes after the last periph_register.                  */
+    /* -------------------------------------------------------------------- */
+    if (cfg->rewind_mb > 0)
+    {
+        cfg->rewind = rewind_create(cfg->rewind_mb, cfg->rewind_secs);
+        if (!cfg->rewind)
+            fprintf(stderr, "Continuing without rewind.\n");
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Likewise the autosave writer.                                       */
+    /* -------------------------------------------------------------------- */
+    if (autosave_file)
+    {
+        cfg->autosave = autosave_create(autosave_file, cfg->autosave_secs);
+        if (!cfg->autosave)
+            fprintf(stderr, "Continuing without autosave.\n");
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  The frame budget is cheap enough to keep always, so the overlay     */
+    /*  can be turned on at any time.  It's only written out if asked.      */
+    /* -------------------------------------------------------------------- */
+    if (!(cfg->budget = budget_create(budget_file)) && budget_file)
+    {
+        fprintf(stderr, "Continuing without writing the frame budget.\n");
+        cfg->budget = budget_create(NULL);
+    }
+    cfg->cp1600.budget = cfg->budget;
+    cfg->stic.budget   = cfg->budget;
+
 #if 0
     {
         f = fopen("ser.txt", "w");
@@ -1394,16 +1515,27 @@ locutus_loaded:
 #endif
 
     /* -------------------------------------------------------------------- */
-    /*  Load the source mapping if given one.                               */
+    /*  Load the source mapping if given one.  The coverage report wants    */
+    /*  it too, debugger or no.                                             */
     /* -------------------------------------------------------------------- */
-    if (cfg->debugging && debug_srcmap)
+    if ((cfg->debugging || heat_base) && debug_srcmap)
         process_source_map(debug_srcmap);
 
+    if (heat_base && debug_heat_start(&cfg->cp1600, heat_base, debug_symtbl))
+        fprintf(stderr, "Continuing without the heatmap.\n");
+
     /* -------------------------------------------------------------------- */
     /*  Initialize random number generator.  Do this last in case the rest  */
-    /*  of initialization takes a random amount of time.                    */
+    /*  of initialization takes a random amount of time.  An input movie    */
+    /*  records the seed, or replays the one it recorded.                   */
     /* -------------------------------------------------------------------- */
-    srand_jz(time(0) + (uint_32)(~0U * get_time()));
+    seed = time(0) + (uint_32)(~0U * get_time());
+
+    if (inpmov_mode != INPMOV_OFF &&
+        inpmov_start(&cfg->inpmov, cfg->rom_crc, &seed))
+        exit(1);
+
+    srand_jz(seed);
 
     /* -------------------------------------------------------------------- */
     /*  Free up all of our temporary variables.                             */
@@ -1415,6 +1547,10 @@ locutus_loaded:
     CONDFREE(debug_symtbl);
     CONDFREE(debug_srcmap);
     CONDFREE(elfi_prefix); 
+    CONDFREE(inpmov_file);
+    CONDFREE(autosave_file);
+    CONDFREE(heat_base);
+    CONDFREE(budget_file);
     return 1;
 }
 
@@ -1423,7 +1559,13 @@ locutus_loaded:
 /* ======================================================================== */
 void cfg_dtor(cfg_t *cfg)
 {
+    debug_heat_finish();
+    cfg->cp1600.budget = NULL;
+    cfg->stic.budget   = NULL;
+    budget_destroy(cfg->budget);
     periph_delete(cfg->intv);
+    rewind_destroy(cfg->rewind);
+    autosave_destroy(cfg->autosave);
     CONDFREE(cfg->ivc_tname);
     CONDFREE(cfg->cgc0_dev);
     CONDFREE(cfg->cgc1_dev);
@@ -90,6 +90,7 @@ typedef struct cfg_t
     int         ecs_enable;     /* ECS enable/disable flag.                 */
     int         ivc_enable;     /* Ivoice enable/disable flag.              */
     int         ivc_window;     /* Window size for Ivoice sliding window.   */
+    int         ivc_taps;       /* Taps/phase for Ivoice resampler, or 0.   */
     char       *ivc_tname;      /* Intellivoice sample file name template.  */
     int         gfx_flags;      /* SDL mode flags (fullsc/windowed, etc)    */
     uint_32     i2pc0_port;     /* INTV2PC #0 I/O address.                  */
@@ -117,6 +118,8 @@ typedef struct cfg_t
     v_uint_32   do_pause;       /* Signal that we are paused.               */
     v_uint_32   do_dump;        /* Signal that we'd like to save a game     */
     v_uint_32   do_load;        /* Signal that we'd like to load a game     */
+    v_uint_32   do_rewind;      /* 1: step back one frame.  2: rewinding.   */
+    v_uint_32   do_budget;      /* Toggle the frame budget overlay.         */
 
     /* -------------------------------------------------------------------- */
     /*  Key bindings                                                        */
@@ -128,11 +131,40 @@ typedef struct cfg_t
     /* -------------------------------------------------------------------- */
     demo_t      demo;
 
+    /* -------------------------------------------------------------------- */
+    /*  Rewind buffer.                                                      */
+    /* -------------------------------------------------------------------- */
+    int         rewind_mb;      /* Rewind ring size in MB.  0 disables.     */
+    int         rewind_secs;    /* Seconds of history to keep.              */
+    rewind_t   *rewind;         /* The rewind buffer, if enabled.           */
+
+    /* -------------------------------------------------------------------- */
+    /*  Autosave.                                                           */
+    /* -------------------------------------------------------------------- */
+    int         autosave_secs;  /* Seconds between autosaves.               */
+    autosave_t *autosave;       /* The autosave writer, if enabled.         */
+
+    /* -------------------------------------------------------------------- */
+    /*  Frame budget.                                                       */
+    /* -------------------------------------------------------------------- */
+    budget_t   *budget;         /* Per-frame CPU accounting.  Always kept.  */
+
+    /* -------------------------------------------------------------------- */
+    /*  Input movie recording and playback.                                 */
+    /* -------------------------------------------------------------------- */
+    inpmov_t    inpmov;         /* Mode is INPMOV_OFF if there's no movie.  */
+
+    /* -------------------------------------------------------------------- */
+    /*  Input log, so the debugger can replay from the rewind buffer.       */
+    /* -------------------------------------------------------------------- */
+    inplog_t    inplog;         /* Mode is INPLOG_OFF if there's no log.    */
+
     /* -------------------------------------------------------------------- */
     /*  Other misc details about the game                                   */
     /* -------------------------------------------------------------------- */
     const char *cart_name;
     int         cart_year;
+    uint_32     rom_crc;        /* CRC-32 of the game image.                */
 } cfg_t;
 
 extern cfg_t intv;
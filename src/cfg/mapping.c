@@ -31,6 +31,10 @@
 #include "event/event.h"
 #include "joy/joy.h"
 #include "serializer/serializer.h"
+#include "serializer/rewind.h"
+#include "serializer/inpmov.h"
+#include "serializer/inplog.h"
+#include "serializer/autosave.h"
 #include "locutus/locutus_adapt.h"
 #include "mapping.h"
 #include "cfg.h"
@@ -78,10 +82,13 @@ cfg_evtact_t  cfg_event_action[] =
 #endif
     { "DUMP",       V(do_dump           ),  { ~0U, 0   },   { 0,   1   } },
     { "LOAD",       V(do_load           ),  { ~0U, 0   },   { 0,   1   } },
+    { "REWIND",     V(do_rewind         ),  { ~2U, ~0U },   { 0,   2   } },
+    { "RWSTEP",     V(do_rewind         ),  { ~0U, ~0U },   { 0,   1   } },
     { "MOVIE",      V(gfx.scrshot       ),  { ~0U, ~0U },   { GFX_MVTOG, 0} },
     { "SHOT",       V(gfx.scrshot       ),  { ~0U, ~0U },   { GFX_SHOT,  0} },
     { "HIDE",       V(gfx.hidden        ),  { 0,   1   },   { 0,   1   } },
     { "WTOG",       V(gfx.toggle        ),  { ~0U, ~0U },   { 1,   0   } },
+    { "BUDGET",     V(do_budget         ),  { ~0U, ~0U },   { 1,   0   } },
     { "BREAK",      V(debug.step_count  ),  { ~0U, 0   },   { 0,   0   } },
     { "KBD0",       V(event.change_kbd  ),  { ~0U, 0   },   { 0,   1   } },
     { "KBD1",       V(event.change_kbd  ),  { ~0U, 0   },   { 0,   2   } },
@@ -546,6 +553,8 @@ cfg_kbd_t  cfg_key_bind[] =
 //{ "F2",     {   "HIDE",         "HIDE",         "HIDE",         "HIDE"      }},
 { "F2",     {   "DUMP",         "DUMP",         "DUMP",         "DUMP"      }},
 { "F3",     {   "LOAD",         "LOAD",         "LOAD",         "LOAD"      }},
+{ "DELETE", {   "REWIND",       "REWIND",       "REWIND",       "REWIND"    }},
+{ "END",    {   "RWSTEP",       "RWSTEP",       "RWSTEP",       "RWSTEP"    }},
 { "F4",     {   "BREAK",        "BREAK",        "BREAK",        "BREAK"     }},
 { "F5",     {   "KBD0",         "KBD0",         "KBD0",         "KBD0"      }},
 { "F6",     {   "KBD1",         "KBD1",         "KBD1",         "KBD1"      }},
@@ -654,7 +663,7 @@ bits |   0       1    2  3  4    5        6      7
 /*  ECS Keyboard remaining keys.                                            */
 /* ------------------------------------------------------------------------ */
 { "Q",      {   "NA",           "NA",           "KEYB_Q",       "QUIT"      }},
-{ "T",      {   "NA",           "NA",           "KEYB_T",       "NA"        }},
+{ "T",      {   "NA",           "NA",           "KEYB_T",       "BUDGET"    }},
 { "Y",      {   "NA",           "NA",           "KEYB_Y",       "NA"        }},
 { "P",      {   "NA",           "NA",           "KEYB_P",       "PAUSE"     }},
                                                                 
@@ -59,6 +59,8 @@ void usage(void)
 "    -s#     --ecs=#               ECS.           0: Disable, 1: Enable"    "\n"
 "    -v#     --voice=#             Intellivoice.  0: Disable, 1: Enable"    "\n"
 "    -W#     --voicewindow=#       Sets averaging window for voice filter." "\n"
+"            --voicetaps=#         Taps per phase for voice resampler."     "\n"
+"                                  0 selects the averaging window instead." "\n"
 "    -Vname  --voicefiles=name     Saves voice WAV files to name####.wav."  "\n"
                                                                             "\n"
 "Video and Sound Flags:"                                                    "\n"
@@ -95,6 +97,34 @@ void usage(void)
 "    -M#     --audiomintick=#      Minimum Intellivision cycles between"    "\n"
 "                                  explicit calls to snd_tick()."           "\n"
                                                                             "\n"
+"Rewind Flags:"                                                             "\n"
+"            --rewind=#            Keep a rewind buffer of # megabytes."    "\n"
+"                                  0 disables rewind (the default)."        "\n"
+"            --rewind-secs=#       Seconds of play to keep.  Default: 30."  "\n"
+                                                                            "\n"
+"Autosave Flags:"                                                           "\n"
+"            --autosave=file       Save the game to file every so often,"   "\n"
+"                                  and resume from it at startup."          "\n"
+"            --autosave-secs=#     Seconds between saves.  Default: 60."    "\n"
+                                                                            "\n"
+"Input Movie Flags:"                                                        "\n"
+"            --record-input=file   Record all inputs from power-on."        "\n"
+"            --replay-input=file   Play back inputs recorded in file, and"  "\n"
+"                                  exit with an error if the machine state" "\n"
+"                                  ever differs from the recording."        "\n"
+"            --input-check=#       When recording, store a machine state"   "\n"
+"                                  checkpoint every # frames (default 60)." "\n"
+"            --headless            No display or sound; run at full speed." "\n"
+"    Movies always run with sound off.  Record and replay with the same"    "\n"
+"    game and flags, or the movie will be refused."                         "\n"
+                                                                            "\n"
+"Demo Recorder Flags:"                                                      "\n"
+"    -Dfile  --demofile=file       Record GRAM, BACKTAB, PSG and voice"     "\n"
+"                                  updates to file, for a demo player."     "\n"
+"            --demo-flush=#        Write the recording every # frames."     "\n"
+"                                  Default: 60."                            "\n"
+"            --demo-lzo            Compress the recording with LZO."        "\n"
+                                                                            "\n"
 "Input Configuration Flags:"                                                "\n"
 "    Currently, jzIntv does not offer a flexible method to re-bind keys."   "\n"
 "    The kbdhackfile does allow you to crudely specify key bindings."       "\n"
@@ -155,6 +185,15 @@ void usage(void)
 "            --sym-file=path       Load symbol table from 'path'."          "\n"
 "            --src-map=path        Load source/listing map from 'path'."    "\n"
 "            --script=path         Execute debug commands from 'path'."     "\n"
+"            --gdb-port=#          Let GDB drive the debugger over TCP on"  "\n"
+"                                  127.0.0.1, port #.  Implies -d."         "\n"
+"            --heatmap=path        Count executes, reads and writes per"    "\n"
+"                                  address; write them to path.heat and"    "\n"
+"                                  code coverage to path.cov on exit."      "\n"
+"            --budget=path         Write per-frame ISR and BUSRQ cycles,"   "\n"
+"                                  interrupt latency and STIC drops to"     "\n"
+"                                  path as CSV, or JSON if it ends in"      "\n"
+"                                  .json.  Hotkey F8+T shows them live."    "\n"
 "            --rand-mem            Randomize memories on startup"           "\n"
                                                                             "\n"
 "Misc Flags:"                                                               "\n"
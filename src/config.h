@@ -216,6 +216,8 @@ typedef volatile sint_64    v_sint_64;
 # define DEFAULT_ROM_PATH ".:=../rom:/usr/local/share/jzintv/rom"
 #endif
 # define HAS_LINK
+# define HAS_FORK
+# define HAS_SOCKETS
 # define DEFAULT_AUDIO_HZ     (48000)
 # define SND_BUF_SIZE_DEFAULT (2048)
 # define SND_BUF_CNT_DEFAULT  (3)
@@ -231,6 +233,7 @@ typedef volatile sint_64    v_sint_64;
 # define USE_STRCASECMP
 # define DEFAULT_ROM_PATH ".:=../rom:/usr/local/share/jzintv/rom"
 # define HAS_LINK
+# define HAS_FORK
 # define CAN_TIOCGWINSZ
 # define CAN_SIGWINCH
 #endif
@@ -280,6 +283,8 @@ typedef volatile sint_64    v_sint_64;
 # define USE_STRCASECMP /* ? */
 # define DEFAULT_ROM_PATH ".:=../rom"
 # define HAS_LINK
+# define HAS_FORK
+# define HAS_SOCKETS
 # define DEFAULT_AUDIO_HZ (48000)
 # define CAN_TIOCGWINSZ
 # define CAN_SIGWINCH
@@ -291,6 +296,8 @@ typedef volatile sint_64    v_sint_64;
 # define USE_STRCASECMP
 # define DEFAULT_ROM_PATH ".:=../rom:/usr/local/share/jzintv/rom"
 # define HAS_LINK
+# define HAS_FORK
+# define HAS_SOCKETS
 # define CAN_TIOCGWINSZ
 # define CAN_SIGWINCH
 # define USE_SYS_IOCTL
@@ -414,6 +421,7 @@ typedef volatile sint_64    v_sint_64;
  */
 
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -509,9 +517,15 @@ typedef volatile sint_64    v_sint_64;
  * ============================================================================
  */
 extern void dump_state(void);
+extern int  rewind_request(int frames);
+extern int  rewind_to(uint_64 when, uint_64 *stamp);
+extern void rewind_to_done(void);
 #define CONDFREE(x) do { if (x) free((void*)x); (x) = NULL; } while (0)
 
-#define NO_SERIALIZER
+/* The serializer isn't hooked up yet.  ser_test builds it on its own.     */
+#ifndef WANT_SERIALIZER
+# define NO_SERIALIZER
+#endif
 
 /*
  * ============================================================================
@@ -0,0 +1,247 @@
+/*
+ * ============================================================================
+ *  Title:    Frame Budget
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See budget.h.
+ * ============================================================================
+ */
+
+#include "config.h"
+#include "cp1600/budget.h"
+
+#define BUDGET_W        (160)       /* Display width.                       */
+#define BUDGET_ROW      (196)       /* First row of the overlay.            */
+#define BUDGET_ROWS     (4)         /* Rows in the overlay.                 */
+
+#define BUDGET_C_ISR    (2)         /* Red                                  */
+#define BUDGET_C_BUSRQ  (1)         /* Blue                                 */
+#define BUDGET_C_MAIN   (5)         /* Green                                */
+#define BUDGET_C_DROP   (6)         /* Yellow                               */
+#define BUDGET_C_INTAK  (7)         /* White                                */
+
+/* ======================================================================== */
+/*  BUDGET_CREATE    -- Start keeping the budget.                           */
+/* ======================================================================== */
+budget_t *budget_create(const char *fname)
+{
+    budget_t *budget = CALLOC(budget_t, 1);
+    size_t   len;
+
+    if (!budget)
+    {
+        fprintf(stderr, "budget:  Out of memory\n");
+        return NULL;
+    }
+
+    budget->cur.int_lat = -1;
+    budget->isr_sp      = -1;
+
+    if (!fname)
+        return budget;
+
+    if (!(budget->f = fopen(fname, "w")))
+    {
+        fprintf(stderr, "budget:  Could not open '%s'\n", fname);
+        free(budget);
+        return NULL;
+    }
+
+    len = strlen(fname);
+    budget->json = len >= 5 && !strcmp(fname + len - 5, ".json");
+
+    if (budget->json)
+        fputc('[', budget->f);
+    else
+        fprintf(budget->f,
+                "frame,cycles,isr,busrq,main,int_lat,rd_drop,wr_drop\n");
+
+    return budget;
+}
+
+/* ======================================================================== */
+/*  BUDGET_ISR_COUNT -- Count the handler's time from isr_start to 'now',   */
+/*                      less the stalls in that time.                       */
+/* ======================================================================== */
+LOCAL void budget_isr_count(budget_t *budget, uint_64 now)
+{
+    uint_64 len;
+
+    /* The CPU and STIC don't run in lockstep; don't count backwards. */
+    if (now <= budget->isr_start)
+        return;
+
+    len = now - budget->isr_start;
+    if (len > budget->isr_bus)
+        budget->cur.isr += len - budget->isr_bus;
+
+    budget->isr_start = now;
+    budget->isr_bus   = 0;
+}
+
+/* ======================================================================== */
+/*  BUDGET_INTAK     -- The CPU took an interrupt.                          */
+/* ======================================================================== */
+void budget_intak(budget_t *budget, uint_64 now, uint_32 sp)
+{
+    /* -------------------------------------------------------------------- */
+    /*  The 12 cycles to take the interrupt count toward the handler.  If   */
+    /*  the last handler never returned, it ends here.                      */
+    /* -------------------------------------------------------------------- */
+    if (budget->isr_sp >= 0)
+        budget_isr_count(budget, now - 12);
+
+    budget->isr_start = now - 12;
+    budget->isr_bus   = 0;
+    budget->isr_sp    = sp;
+
+    if (budget->cur.int_lat < 0 && now >= budget->start)
+        budget->cur.int_lat = now - budget->start;
+}
+
+/* ======================================================================== */
+/*  BUDGET_ISR_END   -- The interrupt handler returned.                     */
+/* ======================================================================== */
+void budget_isr_end(budget_t *budget, uint_64 now)
+{
+    budget_isr_count(budget, now);
+    budget->isr_sp = -1;
+}
+
+/* ======================================================================== */
+/*  BUDGET_BUSAK     -- The CPU gave up the bus.                            */
+/* ======================================================================== */
+void budget_busak(budget_t *budget, uint_32 cycles)
+{
+    budget->cur.busrq += cycles;
+
+    if (budget->isr_sp >= 0)
+        budget->isr_bus += cycles;
+}
+
+/* ======================================================================== */
+/*  BUDGET_WRITE     -- Write the last frame to the file.                   */
+/* ======================================================================== */
+LOCAL void budget_write(budget_t *budget)
+{
+    const budget_frame_t *fr = &budget->last;
+    uint_32 used = fr->isr + fr->busrq;
+    uint_32 rest = fr->cycles > used ? fr->cycles - used : 0;
+
+    if (budget->json)
+        fprintf(budget->f, "%s\n{\"frame\":%u,\"cycles\":%u,\"isr\":%u,"
+                "\"busrq\":%u,\"main\":%u,\"int_lat\":%d,"
+                "\"rd_drop\":%u,\"wr_drop\":%u}",
+                fr->frame ? "," : "", fr->frame, fr->cycles, fr->isr,
+                fr->busrq, rest, fr->int_lat, fr->rd_drop, fr->wr_drop);
+    else
+        fprintf(budget->f, "%u,%u,%u,%u,%u,%d,%u,%u\n",
+                fr->frame, fr->cycles, fr->isr, fr->busrq, rest,
+                fr->int_lat, fr->rd_drop, fr->wr_drop);
+}
+
+/* ======================================================================== */
+/*  BUDGET_FRAME     -- Close out the frame in progress.                    */
+/* ======================================================================== */
+void budget_frame(budget_t *budget, uint_64 when)
+{
+    /* -------------------------------------------------------------------- */
+    /*  A handler still running is split between this frame and the next.  */
+    /* -------------------------------------------------------------------- */
+    if (budget->isr_sp >= 0)
+        budget_isr_count(budget, when);
+
+    budget->cur.cycles = when > budget->start ? when - budget->start : 0;
+    budget->last       = budget->cur;
+
+    if (budget->f)
+        budget_write(budget);
+
+    memset(&budget->cur, 0, sizeof(budget->cur));
+    budget->cur.frame   = budget->last.frame + 1;
+    budget->cur.int_lat = -1;
+    budget->start       = when;
+}
+
+/* ======================================================================== */
+/*  BUDGET_SCALE     -- Scale 'val' cycles of the last frame to pixels.     */
+/* ======================================================================== */
+LOCAL int budget_scale(const budget_t *budget, uint_32 val)
+{
+    uint_32 cycles = budget->last.cycles;
+
+    if (val >= cycles)
+        return BUDGET_W;
+
+    return (int)((uint_64)val * BUDGET_W / cycles);
+}
+
+/* ======================================================================== */
+/*  BUDGET_DRAW      -- Draw the last frame over the display.               */
+/* ======================================================================== */
+void budget_draw(const budget_t *budget, uint_8 *vid)
+{
+    const budget_frame_t *fr = &budget->last;
+    uint_8 row[BUDGET_W];
+    int    isr, bus, y;
+
+    if (!fr->cycles)
+        return;
+
+    isr = budget_scale(budget, fr->isr);
+    bus = budget_scale(budget, fr->isr + fr->busrq);
+
+    memset(row,       BUDGET_C_ISR,   isr);
+    memset(row + isr, BUDGET_C_BUSRQ, bus - isr);
+    memset(row + bus, BUDGET_C_MAIN,  BUDGET_W - bus);
+
+    if (fr->int_lat >= 0)
+    {
+        int x = budget_scale(budget, fr->int_lat);
+        row[x < BUDGET_W ? x : BUDGET_W - 1] = BUDGET_C_INTAK;
+    }
+
+    if (fr->rd_drop || fr->wr_drop)
+        memset(row + BUDGET_W - 4, BUDGET_C_DROP, 4);
+
+    for (y = BUDGET_ROW; y < BUDGET_ROW + BUDGET_ROWS; y++)
+        memcpy(vid + y * BUDGET_W, row, BUDGET_W);
+}
+
+/* ======================================================================== */
+/*  BUDGET_DESTROY   -- Finish the file, if any, and free the budget.       */
+/* ======================================================================== */
+void budget_destroy(budget_t *budget)
+{
+    if (!budget)
+        return;
+
+    if (budget->f)
+    {
+        if (budget->json)
+            fprintf(budget->f, "\n]\n");
+
+        if (fclose(budget->f))
+            fprintf(stderr, "budget:  Error writing frame budget\n");
+    }
+
+    free(budget);
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
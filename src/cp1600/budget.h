@@ -0,0 +1,124 @@
+/*
+ * ============================================================================
+ *  Title:    Frame Budget
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Keeps a running account of where each frame's CPU time goes, so that
+ *  game code can be tuned against it.  A frame runs from one assertion
+ *  of INTRQ by the STIC to the next.  For each frame, it records:
+ *
+ *      cycles      How long the frame was.
+ *      isr         Cycles the CPU spent in the interrupt handler.
+ *      busrq       Cycles the CPU sat stalled while the STIC had the bus.
+ *      main        Everything else:  cycles - isr - busrq.
+ *      int_lat     Cycles from INTRQ to INTAK, or -1 if the CPU never
+ *                  took the interrupt.
+ *      rd_drop     Reads of the STIC or graphics memory that missed their
+ *      wr_drop     access window, and writes likewise.
+ *
+ *  The interrupt handler starts when the CPU takes the interrupt, and ends
+ *  when the stack pointer drops back to where it was before the CPU pushed
+ *  the return address.  Stalls during the handler count as busrq, not isr.
+ *
+ *  The CPU and STIC update the budget where they already handle these
+ *  events.  The only cost per instruction is one compare in the CPU loop.
+ *
+ *  Each frame may be written to a file as it finishes, as CSV or, if the
+ *  file name ends in ".json", as a JSON array.  The last frame may also
+ *  be drawn over the bottom four rows of the display:  from the left, the
+ *  interrupt handler in red, the BUSRQ stalls in blue and the rest in
+ *  green, with a white mark where the CPU took the interrupt, and a yellow
+ *  block at the right end if any STIC accesses were dropped.
+ *
+ *  BUDGET_CREATE    -- Start keeping the budget.
+ *  BUDGET_INTAK     -- The CPU took an interrupt.
+ *  BUDGET_ISR_END   -- The interrupt handler returned.
+ *  BUDGET_BUSAK     -- The CPU gave up the bus.
+ *  BUDGET_FRAME     -- The STIC asserted INTRQ; close out the frame.
+ *  BUDGET_DRAW      -- Draw the last frame over the display.
+ *  BUDGET_DESTROY   -- Finish the file, if any, and free the budget.
+ * ============================================================================
+ */
+#ifndef BUDGET_H_
+#define BUDGET_H_
+
+typedef struct budget_frame_t
+{
+    uint_32     frame;      /* Frame number, counting from 0.               */
+    uint_32     cycles;     /* Length of the frame.                         */
+    uint_32     isr;        /* Cycles in the interrupt handler.             */
+    uint_32     busrq;      /* Cycles stalled by BUSRQ.                     */
+    sint_32     int_lat;    /* INTRQ to INTAK, or -1 if not taken.          */
+    uint_32     rd_drop;    /* STIC reads outside the access window.        */
+    uint_32     wr_drop;    /* STIC writes outside the access window.       */
+} budget_frame_t;
+
+typedef struct budget_t
+{
+    budget_frame_t  cur;        /* The frame in progress.                   */
+    budget_frame_t  last;       /* The last frame to finish.                */
+    uint_64         start;      /* When the frame in progress started.      */
+    uint_64         isr_start;  /* Start of ISR time not yet counted.       */
+    uint_32         isr_bus;    /* BUSRQ cycles since isr_start.            */
+    sint_32         isr_sp;     /* SP before the interrupt, or -1.          */
+    int             overlay;    /* Draw the last frame over the display.    */
+    int             json;       /* Write JSON instead of CSV.               */
+    FILE            *f;         /* Where frames are written, or NULL.       */
+} budget_t;
+
+/* ======================================================================== */
+/*  BUDGET_CREATE    -- Start keeping the budget.  If 'fname' isn't NULL,   */
+/*                      write each frame to it.  Returns NULL on failure.   */
+/* ======================================================================== */
+budget_t *budget_create(const char *fname);
+
+/* ======================================================================== */
+/*  BUDGET_INTAK     -- The CPU took an interrupt, finishing at 'now'.      */
+/*                      'sp' is the stack pointer before it pushed the PC.  */
+/* ======================================================================== */
+void budget_intak(budget_t *budget, uint_64 now, uint_32 sp);
+
+/* ======================================================================== */
+/*  BUDGET_ISR_END   -- The interrupt handler returned at 'now'.            */
+/* ======================================================================== */
+void budget_isr_end(budget_t *budget, uint_64 now);
+
+/* ======================================================================== */
+/*  BUDGET_BUSAK     -- The CPU gave up the bus for 'cycles'.               */
+/* ======================================================================== */
+void budget_busak(budget_t *budget, uint_32 cycles);
+
+/* ======================================================================== */
+/*  BUDGET_FRAME     -- The STIC asserted INTRQ at 'when'.  Close out the   */
+/*                      frame in progress and start the next.               */
+/* ======================================================================== */
+void budget_frame(budget_t *budget, uint_64 when);
+
+/* ======================================================================== */
+/*  BUDGET_DRAW      -- Draw the last frame over the 160x200 display 'vid'. */
+/* ======================================================================== */
+void budget_draw(const budget_t *budget, uint_8 *vid);
+
+/* ======================================================================== */
+/*  BUDGET_DESTROY   -- Finish the file, if any, and free the budget.       */
+/* ======================================================================== */
+void budget_destroy(budget_t *budget);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -42,9 +42,11 @@
 #include "op_decode.h"
 #include "op_exec.h"
 #include "emu_link.h"
+#include "serializer/snapshot.h"
 #include <limits.h>
 
 
+LOCAL void cp1600_ser_init(periph_p p);
 LOCAL void cp1600_dtor(periph_p p);
 
 /*
@@ -118,6 +120,7 @@ cp1600_init
     cp1600->periph.poke     = NULL;
     cp1600->periph.reset    = cp1600_reset;
     cp1600->periph.tick     = cp1600_run;
+    cp1600->periph.ser_init = cp1600_ser_init;
     cp1600->periph.min_tick = 1;
     cp1600->periph.max_tick = 1000000;
 /*  cp1600->periph.max_tick = 4; */
@@ -191,6 +194,9 @@ cp1600_run
     cp1600_ins_t execute;
     periph_tick_t instr_tick = cp1600->instr_tick;
     instr_t  *instr;
+    uint_32  *exec_cnt = cp1600->exec_cnt;
+    budget_t *budget   = cp1600->budget;
+    sint_32  isr_sp;
 
     start  = cp1600->periph.now;
     now    = start;
@@ -264,6 +270,9 @@ cp1600_run
                 cp1600->req_bus.intak = now;
                 cp1600->periph.now    = now;
 
+                if (budget)
+                    budget_intak(budget, now, cp1600->r[6] - 1);
+
                 goto tick;
             }
         }
@@ -287,6 +296,9 @@ cp1600_run
                 now    = cp1600->req_bus.busrq_until;
                 cp1600->periph.now = now;
 
+                if (budget)
+                    budget_busak(budget, cycles);
+
                 goto tick;
             } else
             {
@@ -326,6 +338,12 @@ cp1600_run
         if (step < 1)
             continue;
 
+        /* ---------------------------------------------------------------- */
+        /*  If we're in the interrupt handler, watch for SP to drop back    */
+        /*  to where it was before the interrupt.  -1 never matches.        */
+        /* ---------------------------------------------------------------- */
+        isr_sp = budget ? budget->isr_sp : -1;
+
         while (step > 0)
         {
             /* ------------------------------------------------------------ */
@@ -335,6 +353,9 @@ cp1600_run
             execute       = cp1600->execute[pc];
             instr         = cp1600->instr[pc];
 
+            if (exec_cnt)
+                exec_cnt[pc]++;
+
             /* ------------------------------------------------------------ */
             /*  The flag cp1600->intr is our interruptibility state. It is  */
             /*  set equal to our interrupt enable bit, and is cleared by    */
@@ -358,6 +379,12 @@ cp1600_run
             cp1600->periph.now = now += cycles;
             step -= cycles;
             instrs++;
+
+            if (cp1600->r[6] <= isr_sp)
+            {
+                budget_isr_end(budget, now);
+                isr_sp = -1;
+            }
         }
 
         if (cycles == CYC_MAX)
@@ -366,6 +393,10 @@ cp1600_run
             next -= step + CYC_MAX;
             instrs--;
             cycles = -1;
+
+            /* A breakpoint stopped it; it'll be counted when it runs.      */
+            if (exec_cnt)
+                exec_cnt[cp1600->oldpc]--;
         }
             
         /* ---------------------------------------------------------------- */
@@ -471,8 +502,17 @@ cp1600_invalidate
     {
         if (cp1600->execute[addr] != fn_breakpt)
             cp1600->execute[addr] = fn_decode;
-        cp1600->disasm [addr] = NULL;
     }
+
+    /* -------------------------------------------------------------------- */
+    /*  Count a change to each page in the range, and to the page holding   */
+    /*  any instruction that reaches into it.                               */
+    /* -------------------------------------------------------------------- */
+    cp1600->code_gen[((addr_lo - 2) & 0xFFFF) >> CP1600_DECODE_PAGE]++;
+
+    for (addr = addr_lo >> CP1600_DECODE_PAGE;
+         addr <= addr_hi >> CP1600_DECODE_PAGE; addr++)
+        cp1600->code_gen[addr]++;
 }
 
 /*
@@ -499,9 +539,12 @@ cp1600_write
     if (cp1600->execute[a1] != fn_breakpt) cp1600->execute[a1] = fn_decode;
     if (cp1600->execute[a2] != fn_breakpt) cp1600->execute[a2] = fn_decode;
 
-    cp1600->disasm[a0] = NULL;
-    cp1600->disasm[a1] = NULL;
-    cp1600->disasm[a2] = NULL;
+    /* -------------------------------------------------------------------- */
+    /*  Count a change to the pages holding those addresses.                */
+    /* -------------------------------------------------------------------- */
+    cp1600->code_gen[a0 >> CP1600_DECODE_PAGE]++;
+    if ((a2 >> CP1600_DECODE_PAGE) != (a0 >> CP1600_DECODE_PAGE))
+        cp1600->code_gen[a2 >> CP1600_DECODE_PAGE]++;
 
     /* -------------------------------------------------------------------- */
     /*  Unused.                                                             */
@@ -586,6 +629,26 @@ cp1600_clr_breakpt
         cp1600->execute[addr] = fn_decode;
 }
 
+/*
+ * ============================================================================
+ *  CP1600_SER_INIT      -- Registers the CPU's state for snapshots.  The
+ *                          decode cache isn't included; whoever restores a
+ *                          snapshot must invalidate it.  Neither is the
+ *                          instruction tick period:  it belongs to the
+ *                          debugger, and it isn't machine state.
+ * ============================================================================
+ */
+LOCAL void cp1600_ser_init(periph_p p)
+{
+    cp1600_t *cp1600 = (cp1600_t *)p;
+
+    SNAP_FIELDS(p->name, cp1600, cp1600_t, r,         intr);
+    SNAP_FIELDS(p->name, cp1600, cp1600_t, req_bus.intrq_until,
+                                           req_bus.intrq);
+    SNAP_FIELDS(p->name, cp1600, cp1600_t, cacheable, cacheable);
+    SNAP_FIELDS(p->name, cp1600, cp1600_t, tot_cycle, tot_noncache);
+}
+
 /*
  * ============================================================================
  *  CP1600_CLR_BREAKPT   -- Clears a breakpoint at a given address.
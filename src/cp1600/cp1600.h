@@ -25,6 +25,7 @@
 #define _CP_1600_H
 
 #include "cp1600/req_bus.h"
+#include "cp1600/budget.h"
 
 /*
  * ============================================================================
@@ -70,7 +71,7 @@ typedef struct cp1600_t
     uint_32         cacheable [1 << (CP1600_MEMSIZE-CP1600_DECODE_PAGE-5)];
     cp1600_ins_t    execute   [1 << CP1600_MEMSIZE];  /* Decoded instrs     */
     instr_p         instr     [1 << CP1600_MEMSIZE];  /* Decoded instrs     */
-    char *          disasm    [1 << CP1600_MEMSIZE];  /* Disassembled instrs*/
+    uint_32         code_gen  [1 << (CP1600_MEMSIZE-CP1600_DECODE_PAGE)];
 
 #ifdef DEBUG_DECODE_CACHE
     int             decoded   [1 <<  CP1600_MEMSIZE];
@@ -79,6 +80,8 @@ typedef struct cp1600_t
     periph_tick_t   instr_tick;         /* Per-instruction external ticker  */
     periph_p        instr_tick_periph;  /* Periph ptr to pass along.        */
     uint_32         instr_tick_per;     /* Tick-period divisor.             */
+    uint_32         *exec_cnt;          /* Per-address execute counts.      */
+    budget_t        *budget;            /* Frame budget, if kept.           */
 
     uint_64         tot_cycle;
     uint_64         tot_instr;
@@ -232,6 +235,7 @@ cp1600_clr_breakpt
 
 #define CP1600_BKPT      (1)
 #define CP1600_BKPT_ONCE (2)
+#define CP1600_BKPT_GDB  (4)    /* Set by the GDB stub, apart from ours.   */
 
 #endif
 
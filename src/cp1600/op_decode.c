@@ -492,9 +492,8 @@ fn_decode
     if (!(instr = cp1600->instr[pc])) 
         instr = get_instr();
 
-    instr->address     = pc;
-    cp1600->instr [pc] = instr;
-    cp1600->disasm[pc] = NULL;
+    instr->address    = pc;
+    cp1600->instr[pc] = instr;
 
     /* -------------------------------------------------------------------- */
     /*  Read the first word of the instruction, so that we can determine    */
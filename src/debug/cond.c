@@ -0,0 +1,377 @@
+/*
+ * ============================================================================
+ *  Title:    Breakpoint Conditions
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See cond.h.
+ *
+ *  The program is an array of words, each an opcode, some followed by an
+ *  operand.  Every operand is pushed on a small stack, and each operator
+ *  pops its operands and pushes its result.  The compiler tracks how deep
+ *  the stack gets, so the evaluator needn't check.
+ * ============================================================================
+ */
+
+#include "config.h"
+#include "periph/periph.h"
+#include "cp1600/cp1600.h"
+#include "debug/cond.h"
+
+#define COND_STACK  (32)        /* Deepest the stack may get.               */
+
+enum
+{
+    COND_END,
+    COND_NUM,   COND_REG,   COND_FLAG,  /* These take an operand.           */
+    COND_ADDR,  COND_VAL,   COND_PEEK,
+    COND_NEG,   COND_NOT,   COND_INV,
+    COND_MUL,   COND_ADD,   COND_SUB,   COND_SHL,   COND_SHR,
+    COND_LT,    COND_LE,    COND_GT,    COND_GE,    COND_EQ,    COND_NE,
+    COND_AND,   COND_XOR,   COND_OR,    COND_LAND,  COND_LOR
+};
+
+struct cond_t
+{
+    uint_32     *code;
+};
+
+/* ------------------------------------------------------------------------ */
+/*  Binary operators, loosest binding first.  Where one is a prefix of      */
+/*  another, the longer one has to come first.                              */
+/* ------------------------------------------------------------------------ */
+typedef struct cond_binop_t
+{
+    const char  *tok;
+    int         prec;
+    int         op;
+} cond_binop_t;
+
+LOCAL const cond_binop_t cond_binop[] =
+{
+    { "||", 1, COND_LOR  },     { "&&", 2, COND_LAND },
+    { "==", 6, COND_EQ   },     { "!=", 6, COND_NE   },
+    { "<=", 7, COND_LE   },     { ">=", 7, COND_GE   },
+    { "<<", 8, COND_SHL  },     { ">>", 8, COND_SHR  },
+    { "|",  3, COND_OR   },     { "^",  4, COND_XOR  },
+    { "&",  5, COND_AND  },     { "<",  7, COND_LT   },
+    { ">",  7, COND_GT   },     { "+",  9, COND_ADD  },
+    { "-",  9, COND_SUB  },     { "*", 10, COND_MUL  },
+    { NULL, 0, COND_END  }
+};
+
+typedef struct cond_ps_t
+{
+    const char  *s;         /* Where we are in the expression.              */
+    const char  *err;       /* What went wrong, if anything.                */
+    const char  *err_at;    /* ...and where.                                */
+    uint_32     *code;      /* Program so far.                              */
+    int         len, alloc;
+    int         depth;      /* Stack depth at this point in the program.    */
+    cond_sym_t  sym;
+} cond_ps_t;
+
+/* ======================================================================== */
+/*  COND_FAIL        -- Note a compile error, unless there's one already.   */
+/*  COND_EMIT        -- Add a word to the program, tracking stack depth.    */
+/* ======================================================================== */
+LOCAL int cond_fail(cond_ps_t *ps, const char *err)
+{
+    if (!ps->err)
+    {
+        ps->err    = err;
+        ps->err_at = ps->s;
+    }
+    return -1;
+}
+
+LOCAL int cond_emit(cond_ps_t *ps, uint_32 word, int push)
+{
+    if (ps->len == ps->alloc)
+    {
+        uint_32 *code = REALLOC(ps->code, uint_32, ps->alloc * 2);
+
+        if (!code)
+            return cond_fail(ps, "out of memory");
+
+        ps->code   = code;
+        ps->alloc *= 2;
+    }
+
+    ps->code[ps->len++] = word;
+    ps->depth += push;
+
+    if (ps->depth > COND_STACK)
+        return cond_fail(ps, "too complicated");
+
+    return 0;
+}
+
+LOCAL void cond_skip_ws(cond_ps_t *ps)
+{
+    while (isspace(*ps->s))
+        ps->s++;
+}
+
+/* ======================================================================== */
+/*  COND_NAME        -- Compile a register, flag or symbol name.            */
+/* ======================================================================== */
+LOCAL int cond_name(cond_ps_t *ps, const char *name, int len)
+{
+    static const char flags[] = "SZOCID";
+    char    buf[64];
+    int     c0 = toupper(name[0]), c1 = len > 1 ? toupper(name[1]) : 0;
+    uint_32 val;
+
+    if (len == 2 && c0 == 'R' && c1 >= '0' && c1 <= '7')
+        return cond_emit(ps, COND_REG, 1) || cond_emit(ps, c1 - '0', 0);
+
+    if (len == 2 && ((c0 == 'P' && c1 == 'C') || (c0 == 'S' && c1 == 'P')))
+        return cond_emit(ps, COND_REG, 1) || cond_emit(ps, 6 + (c0=='P'), 0);
+
+    if (len == 1 && strchr(flags, c0))
+        return cond_emit(ps, COND_FLAG, 1) ||
+               cond_emit(ps, strchr(flags, c0) - flags, 0);
+
+    if (len == 1 && (c0 == 'A' || c0 == 'V'))
+        return cond_emit(ps, c0 == 'A' ? COND_ADDR : COND_VAL, 1);
+
+    ps->s = name;           /* Point any error at the start of the name. */
+
+    if (len >= (int)sizeof(buf))
+        return cond_fail(ps, "name too long");
+
+    memcpy(buf, name, len);
+    buf[len] = 0;
+
+    if (!ps->sym || ps->sym(buf, &val))
+        return cond_fail(ps, "unknown name");
+
+    ps->s = name + len;
+
+    return cond_emit(ps, COND_NUM, 1) || cond_emit(ps, val, 0);
+}
+
+/* ======================================================================== */
+/*  COND_EXPR        -- Compile an expression whose operators all bind at   */
+/*                      least as tightly as 'prec'.                         */
+/*  COND_UNARY       -- Compile a unary expression.                         */
+/* ======================================================================== */
+LOCAL int cond_expr(cond_ps_t *ps, int prec);
+
+LOCAL int cond_unary(cond_ps_t *ps)
+{
+    const char *s;
+    char *end;
+    uint_32 val;
+    int op;
+
+    cond_skip_ws(ps);
+    s = ps->s;
+
+    switch (*s)
+    {
+        case '!': op = COND_NOT; break;
+        case '~': op = COND_INV; break;
+        case '-': op = COND_NEG; break;
+        default:  op = COND_END; break;
+    }
+
+    if (op != COND_END)
+    {
+        ps->s++;
+        return cond_unary(ps) || cond_emit(ps, op, 0);
+    }
+
+    if (*s == '(' || *s == '[')
+    {
+        ps->s++;
+        if (cond_expr(ps, 1))
+            return -1;
+
+        cond_skip_ws(ps);
+        if (*ps->s != (*s == '(' ? ')' : ']'))
+            return cond_fail(ps, *s == '(' ? "expected ')'" : "expected ']'");
+        ps->s++;
+
+        return *s == '[' ? cond_emit(ps, COND_PEEK, 0) : 0;
+    }
+
+    if (*s == '$' || isdigit(*s))
+    {
+        val = strtoul(s + (*s == '$'), &end, *s == '$' ? 16 : 10);
+        if (end == s + 1 && *s == '$')
+            return cond_fail(ps, "expected a hex number");
+
+        ps->s = end;
+        return cond_emit(ps, COND_NUM, 1) || cond_emit(ps, val, 0);
+    }
+
+    if (isalpha(*s) || *s == '_' || *s == '.')
+    {
+        while (isalnum(*ps->s) || *ps->s == '_' || *ps->s == '.')
+            ps->s++;
+
+        return cond_name(ps, s, ps->s - s);
+    }
+
+    return cond_fail(ps, *s ? "expected a value" : "unexpected end");
+}
+
+LOCAL int cond_expr(cond_ps_t *ps, int prec)
+{
+    const cond_binop_t *b;
+
+    if (cond_unary(ps))
+        return -1;
+
+    for (;;)
+    {
+        cond_skip_ws(ps);
+
+        for (b = cond_binop; b->tok; b++)
+            if (!strncmp(ps->s, b->tok, strlen(b->tok)))
+                break;
+
+        if (!b->tok || b->prec < prec)
+            return 0;
+
+        ps->s += strlen(b->tok);
+
+        if (cond_expr(ps, b->prec + 1) || cond_emit(ps, b->op, -1))
+            return -1;
+    }
+}
+
+/* ======================================================================== */
+/*  COND_COMPILE     -- Compile a condition.                                */
+/* ======================================================================== */
+cond_t *cond_compile(const char *expr, cond_sym_t sym,
+                     const char **err, int *pos)
+{
+    cond_ps_t ps;
+    cond_t   *cond = NULL;
+
+    memset(&ps, 0, sizeof(ps));
+    ps.s     = expr;
+    ps.sym   = sym;
+    ps.alloc = 16;
+
+    if (!(ps.code = CALLOC(uint_32, ps.alloc)))
+        cond_fail(&ps, "out of memory");
+    else if (!cond_expr(&ps, 1))
+    {
+        cond_skip_ws(&ps);
+        if (*ps.s)
+            cond_fail(&ps, "unexpected text");
+        else
+            cond_emit(&ps, COND_END, 0);
+    }
+
+    if (!ps.err && !(cond = CALLOC(cond_t, 1)))
+        cond_fail(&ps, "out of memory");
+
+    if (ps.err)
+    {
+        *err = ps.err;
+        *pos = ps.err_at - expr;
+        CONDFREE(ps.code);
+        return NULL;
+    }
+
+    cond->code = ps.code;
+    return cond;
+}
+
+/* ======================================================================== */
+/*  COND_EVAL        -- Check a condition.                                  */
+/* ======================================================================== */
+int cond_eval(const cond_t *cond, cp1600_t *cp, uint_32 addr, uint_32 val)
+{
+    sint_32 stk[COND_STACK + 1], *sp = stk, a;
+    const uint_32 *pc = cond->code;
+
+    for (;;)
+    {
+        switch (*pc++)
+        {
+            case COND_NUM:  *++sp = (sint_32)*pc++;                 break;
+            case COND_REG:  *++sp = cp->r[*pc++];                   break;
+            case COND_ADDR: *++sp = addr;                           break;
+            case COND_VAL:  *++sp = val;                            break;
+            case COND_FLAG:
+                switch (*pc++)
+                {
+                    case 0:  a = cp->S; break;
+                    case 1:  a = cp->Z; break;
+                    case 2:  a = cp->O; break;
+                    case 3:  a = cp->C; break;
+                    case 4:  a = cp->I; break;
+                    default: a = cp->D; break;
+                }
+                *++sp = a != 0;
+                break;
+
+            case COND_PEEK: *sp = CP1600_PK(cp, *sp & 0xFFFF) & 0xFFFF; break;
+            case COND_NEG:  *sp = (sint_32)(0u - (uint_32)*sp);     break;
+            case COND_NOT:  *sp = !*sp;                             break;
+            case COND_INV:  *sp = ~*sp;                             break;
+
+            case COND_END:
+                return *sp != 0;
+
+            default:
+                a = *sp--;
+                switch (pc[-1])
+                {
+                    case COND_MUL:  *sp = (sint_32)((uint_32)*sp * a);  break;
+                    case COND_ADD:  *sp = (sint_32)((uint_32)*sp + a);  break;
+                    case COND_SUB:  *sp = (sint_32)((uint_32)*sp - a);  break;
+                    case COND_SHL:  *sp = (sint_32)((uint_32)*sp << (a & 31));
+                                    break;
+                    case COND_SHR:  *sp = *sp >> (a & 31);              break;
+                    case COND_LT:   *sp = *sp <  a;                     break;
+                    case COND_LE:   *sp = *sp <= a;                     break;
+                    case COND_GT:   *sp = *sp >  a;                     break;
+                    case COND_GE:   *sp = *sp >= a;                     break;
+                    case COND_EQ:   *sp = *sp == a;                     break;
+                    case COND_NE:   *sp = *sp != a;                     break;
+                    case COND_AND:  *sp = *sp &  a;                     break;
+                    case COND_XOR:  *sp = *sp ^  a;                     break;
+                    case COND_OR:   *sp = *sp |  a;                     break;
+                    case COND_LAND: *sp = *sp && a;                     break;
+                    case COND_LOR:  *sp = *sp || a;                     break;
+                }
+                break;
+        }
+    }
+}
+
+/* ======================================================================== */
+/*  COND_DESTROY     -- Free a compiled condition.                          */
+/* ======================================================================== */
+void cond_destroy(cond_t *cond)
+{
+    if (!cond)
+        return;
+
+    free(cond->code);
+    free(cond);
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
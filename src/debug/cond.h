@@ -0,0 +1,81 @@
+/*
+ * ============================================================================
+ *  Title:    Breakpoint Conditions
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Compiles a condition such as "R3 == $10 && [$102] > 5" once, when the
+ *  breakpoint is set, into a little stack machine program.  Checking it
+ *  when the breakpoint is hit is then a short loop with no parsing or
+ *  symbol lookups in it.
+ *
+ *  The language is C's integer expressions, less assignment, division
+ *  and the ?: operator:
+ *
+ *      R0 - R7, PC, SP     Registers.  PC is R7, SP is R6.
+ *      S Z O C I D         Flags, as 0 or 1.  D is set after SDBD.
+ *      A, V                For watches:  the address being accessed and
+ *                          the value being written, or the value at the
+ *                          address for reads.
+ *      [expr]              The word of memory at 'expr', read without
+ *                          side effects.
+ *      $1F, 31             Numbers.  '$' marks hex; others are decimal.
+ *      name                Any other name is looked up as a symbol.
+ *
+ *      ( )  ! ~ -  * + -  << >>  < <= > >=  == !=  &  ^  |  &&  ||
+ *
+ *  Names of registers and flags may be in either case.  The arithmetic is
+ *  done on 32-bit signed numbers.  The result is true if it's nonzero.
+ *
+ *  COND_COMPILE     -- Compile a condition.
+ *  COND_EVAL        -- Check a condition.
+ *  COND_DESTROY     -- Free a compiled condition.
+ * ============================================================================
+ */
+#ifndef COND_H_
+#define COND_H_
+
+typedef struct cond_t cond_t;
+
+/* ======================================================================== */
+/*  COND_SYM_T       -- Looks up a symbol.  Returns 0 and sets 'val' if it  */
+/*                      finds it, or -1 if not.                             */
+/* ======================================================================== */
+typedef int (*cond_sym_t)(const char *name, uint_32 *val);
+
+/* ======================================================================== */
+/*  COND_COMPILE     -- Compile 'expr'.  On failure, returns NULL and sets  */
+/*                      'err' to say why and 'pos' to where in 'expr'.      */
+/* ======================================================================== */
+cond_t *cond_compile(const char *expr, cond_sym_t sym,
+                     const char **err, int *pos);
+
+/* ======================================================================== */
+/*  COND_EVAL        -- Evaluate the condition on the CPU as it stands.     */
+/*                      'addr' and 'val' are what A and V read as.          */
+/*                      Returns nonzero if it holds.                        */
+/* ======================================================================== */
+int cond_eval(const cond_t *cond, cp1600_t *cp, uint_32 addr, uint_32 val);
+
+/* ======================================================================== */
+/*  COND_DESTROY     -- Free a compiled condition.                          */
+/* ======================================================================== */
+void cond_destroy(cond_t *cond);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
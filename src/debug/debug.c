@@ -4,8 +4,15 @@
  *  Author:   J. Zbiciak
  * ============================================================================
  *  This module will implement the debugger as a combination of interactive
- *  interface and a peripheral which maps into the entire address space
- *  which allows capturing memory events.
+ *  interface and a peripheral which maps into the address space to
+ *  capture memory events.
+ *
+ *  The debugger only sits on the bus where it has to, as every page it is
+ *  mapped into costs a call on every access to that page.  Normally that's
+ *  just the pages with watched reads or writes, plus the return windows of
+ *  JSRs being stepped over.  Showing every access, the memory attribute
+ *  map and stack tracing still map it everywhere.  Code breakpoints don't
+ *  need the bus at all; they're the CPU's own.
  * ============================================================================
  */
 
@@ -27,6 +34,12 @@
 #include "debug_tag.h"
 #include "debug_dasm1600.h"
 #include "debug/source.h"
+#include "debug/profile.h"
+#include "debug/trace.h"
+#include "debug/trace_fmt.h"
+#include "debug/gdbstub.h"
+#include "debug/heat.h"
+#include "debug/cond.h"
 
 #define HISTSIZE (0x10000)
 #define HISTMASK (HISTSIZE-1)
@@ -39,7 +52,6 @@ LOCAL void debug_disasm_cache_inval(void);
 LOCAL void debug_print_reghist(int count, int offset);
 
 LOCAL int dc_hits = 0, dc_miss = 0, dc_nocache = 0; 
-LOCAL int dc_unhook_ok = 0, dc_unhook_odd = 0;
 
 LOCAL uint_16 *debug_reghist = NULL;
 LOCAL uint_32 *debug_profile = NULL;
@@ -55,6 +67,104 @@ LOCAL uint_32 debug_watch_w[0x10000 >> 5];
 LOCAL uint_32 debug_watch_r[0x10000 >> 5];
 #define WATCHING(x,y) ((int)((debug_watch_##y[(x) >> 5] >> ((x) & 31)) & 1))
 #define WATCHTOG(x,y) ((debug_watch_##y[(x) >> 5] ^= 1 << ((x) & 31)))
+#define WATCHSET(x,y) ((debug_watch_##y[(x) >> 5] |= 1u << ((x) & 31)))
+#define WATCHCLR(x,y) ((debug_watch_##y[(x) >> 5] &= ~(1u << ((x) & 31))))
+
+LOCAL int debug_remap_due = 0;      /* Bus mapping needs a DEBUG_REMAP.     */
+
+LOCAL prof_t *debug_prof = NULL;    /* Call-graph profiler, if it's on.     */
+LOCAL trace_t *debug_trace = NULL;  /* Instruction trace file, if it's on.  */
+LOCAL trace_pr_t *debug_tpr = NULL; /* Prints the trace off on its thread.  */
+LOCAL trace_fmt_t debug_tfmt;       /* ...or formats it here, without one.  */
+LOCAL periph_t *debug_req[TRACE_NAMES]; /* Requestors named in the trace.   */
+LOCAL int      debug_reqs = 0;
+LOCAL gdb_t   *debug_gdb   = NULL;  /* GDB stub, if there is one.           */
+LOCAL int      debug_gdb_watches = 0;   /* Watches GDB has set.             */
+LOCAL int      debug_gdb_wait    = 0;   /* Wait for GDB at the next stop.   */
+LOCAL heat_t  *debug_heat  = NULL;  /* Access counts, if they're on.        */
+LOCAL char    *debug_heat_base = NULL;  /* ...and where they're going.      */
+
+/* ------------------------------------------------------------------------ */
+/*  GDB's watches, and the bitmaps they add up to.  GDB's breakpoints have  */
+/*  their own CPU flag.  Keeping them apart means GDB removing one of its   */
+/*  own never clears one of ours, or another of its own on the same spot.   */
+/* ------------------------------------------------------------------------ */
+typedef struct debug_gdb_wp_t
+{
+    int         type;       /* GDB_WATCH_WR, _RD or _ACC.                   */
+    uint_32     lo, hi;     /* Range it covers.                             */
+} debug_gdb_wp_t;
+
+LOCAL debug_gdb_wp_t *debug_gdb_wp = NULL;  /* debug_gdb_watches of them.  */
+LOCAL uint_32 debug_watch_gdb_w[0x10000 >> 5];
+LOCAL uint_32 debug_watch_gdb_r[0x10000 >> 5];
+LOCAL int debug_gdb_bkpt_at(const cp1600_t *cp, uint_32 addr);
+
+/* ------------------------------------------------------------------------ */
+/*  Breakpoints set with 'b', and watches that stop the CPU, along with     */
+/*  their conditions and counts.  The CPU only hands a breakpoint to us     */
+/*  when it reaches one, and the bus only hands over watched pages, so a    */
+/*  condition is only ever checked at the address it's for.                 */
+/* ------------------------------------------------------------------------ */
+#define BK_EXEC     (0)
+#define BK_RD       (1)
+#define BK_WR       (2)
+
+typedef struct debug_bk_t
+{
+    int         kind;       /* BK_EXEC, BK_RD or BK_WR.                     */
+    uint_32     lo, hi;     /* Address, or the range a watch covers.        */
+    cond_t      *cond;      /* Condition, or NULL to always stop.           */
+    char        *text;      /* ...as it was typed.                          */
+    uint_32     hits;       /* Times it was reached with the condition met. */
+    uint_32     ignore;     /* Hits still to pass over.                     */
+} debug_bk_t;
+
+LOCAL debug_bk_t *debug_bk = NULL;
+LOCAL int      debug_bks        = 0;
+LOCAL int      debug_bk_watches = 0;    /* How many of them are watches.    */
+
+/* History, tracing and profiling need a look at every instruction.  So do  */
+/* GDB's watches and our stopping ones, to stop right after the access.     */
+#define DEBUG_PER_INSTR() \
+    (debug_rh_ptr >= 0 || debug_trace != NULL || debug_prof != NULL || \
+     debug_gdb_watches > 0 || debug_bk_watches > 0)
+
+/* ------------------------------------------------------------------------ */
+/*  Running backwards.  See DEBUG_REV_TK.                                   */
+/* ------------------------------------------------------------------------ */
+#define REV_OFF     (0)
+#define REV_STEP    (1)     /* Back <#> instructions.                       */
+#define REV_BKPT    (2)     /* Back to the <#>th latest breakpoint hit.     */
+#define REV_WRITE   (3)     /* Back to the latest write to a range.         */
+
+#define REV_WAIT    (0)     /* Running out the tick for a REWIND_TO.        */
+#define REV_SCAN    (1)     /* Replaying a stretch, noting the matches.     */
+#define REV_SEEK    (2)     /* Replaying up to the match we want.           */
+
+typedef struct debug_rev_t
+{
+    int         mode;       /* REV_STEP, REV_BKPT, REV_WRITE or REV_OFF.    */
+    int         state;      /* REV_WAIT, REV_SCAN or REV_SEEK.              */
+    int         next;       /* State to go to once the restore is done.     */
+    uint_32     lo, hi;     /* REV_WRITE range.  lo > hi means the watches. */
+    int         want;       /* Matches still to go back through.            */
+    int         hits, head; /* Matches in this stretch, and ring position.  */
+    uint_64     *hit;       /* Ring of the latest 'want' matches.           */
+    uint_64     from;       /* Cycle the stretch being replayed starts at.  */
+    uint_64     until;      /* ...and the cycle it ends before.             */
+    uint_64     last;       /* Cycle of the last match.                     */
+    uint_64     oldest;     /* Earliest match in any stretch so far.        */
+    int         found;      /* Nonzero once 'oldest' is valid.              */
+    int         ran_out;    /* Nonzero if the history ran out first.        */
+    uint_64     target;     /* REV_SEEK:  Stop here.                        */
+    int         at_hit;     /* REV_SEEK:  'target' is a match.              */
+    double      start;      /* When the command was given.                  */
+    uint_8      unthrottled;/* Speed setting to put back afterwards.        */
+} debug_rev_t;
+
+LOCAL debug_rev_t debug_rev;
+int debug_rewound = 0;
 
 /* JSR table:  The first address is the address of the JSR and the second is 
  * the return address.  JSR_RET_WINDOW is the lookahead window for watching
@@ -107,7 +217,21 @@ LOCAL void debug_print_usage(void)
 "   z           Toggle showing timestamps during 'step'\n"
 "   x           Toggle showing CPU reads and writes during 'step'\n"
 "   b<#>        Set a 'B'reakpoint at <#>.  <#> defaults to the current PC.\n"
+"               Add \"ignore <#2>\" to pass over the next <#2> hits, and\n"
+"               \"if <cond>\" to stop only when <cond> holds.  For example,\n"
+"               b $5123 if R3 == $10 && [$102] > 5\n"
+"   b?          List breakpoints and stopping watches, with hit counts\n"
 "   n<#>        u'N'set a breakpoint at <#>.  <#> defaults to the current PC \n"
+"               This also removes stopping watches that cover <#>\n"
+"   j<#>        'J'ump back <#> frames in the rewind buffer.  With no <#>,\n"
+"               show how much history there is.  Needs --rewind.\n"
+"   -s<#>       Step back <#> instructions.  <#> defaults to 1.\n"
+"   -r<#>       Run backwards to the <#>th most recent breakpoint hit.\n"
+"               <#> defaults to 1.\n"
+"   -w<#1> <#2> Run backwards to just before the last write to <#1>\n"
+"               through <#2>.  With no range, to the last write to any\n"
+"               location being write-watched.  The '-' commands need\n"
+"               --rewind, and replay from the rewind buffer.\n"
 "\n"
 ">> Note:  Pressing the BREAK key while running or stepping will drop jzIntv\n"
 ">>        back to the debugger prompt.  BREAK is usually bound to F4.\n"
@@ -130,6 +254,9 @@ LOCAL void debug_print_usage(void)
 "   @<#1> <#2>  Toggle read watching on range from <#1> through <#2>,\n"
 "               inclusive.  If <#2> is omitted, it toggles the watch flag for\n"
 "               a single location\n"
+"   w<#1> <#2> if <cond>, @<#1> <#2> if <cond>\n"
+"               Stop the CPU on a write or read in the range when <cond>\n"
+"               holds.  \"ignore <#>\" works as for 'b'\n"
 "\n"
 "STIC Specific\n"
 "   ^           Toggle displaying dropped writes to STIC registers or GRAM\n"
@@ -143,13 +270,21 @@ LOCAL void debug_print_usage(void)
 "\n"
 "Statistics / History tracking:\n"
 "   d           Dump CPU and memory state to a series of files.  Requires\n"
-"               history or attribute logging to be enabled.\n"
+"               history or attribute logging to be enabled.  With\n"
+"               --heatmap, also writes \"dump.heat\" and \"dump.cov\"\n"
 "   h           Toggle history logging.  Use \"d\" to dump to \"dump.hst\"\n"
 "               and \"dump.cpu\"\n"
 "   a           Toggle memory attribute logging.  Use \"d\" to dump to \n"
 "               \"dump.atr\"\n"
 "   !<#1> <#2>  Print the last <#1> instructions that ran, ending <#2>\n"
 "               cycles back. <#1> defaults to 40, <#2> defaults to 0.\n"
+"   i<path>     Toggle call-graph profiling.  Turning it off writes\n"
+"               cycles per call stack to <path>.fold for flame graph tools,\n"
+"               per function to <path>.func, and per frame to\n"
+"               <path>.frame.  <path> defaults to \"prof\"\n"
+"   y<path>     Toggle writing every instruction to the compressed trace\n"
+"               file <path>, for as long as it runs.  Read it back with\n"
+"               jztrace.  <path> defaults to \"dump.jzt\"\n"
 "\n"
 "Miscellaneous commands:\n"
 "   l<path>     Load symbol table from <path>.  Format must be same as that\n"
@@ -175,6 +310,10 @@ LOCAL void debug_print_usage(void)
 ">> symbol table into jzIntv with the --sym-file=<path> command line flag or\n"
 ">> with the 'L'oad command shown above\n"
 "\n"
+">> Conditions are C expressions of R0 - R7, PC, SP, the flags S Z O C I D,\n"
+">> symbols, numbers ($hex or decimal) and [<addr>] for memory.  In a watch,\n"
+">> A is the address and V the value written or read\n"
+"\n"
 );
 }
 
@@ -193,6 +332,7 @@ void debug_tag_range(uint_32 lo, uint_32 hi, uint_32 flags)
             CONDFREE(debug_mempc  );
             return;
         }
+        debug_remap_due = 1;
     }
     if (debug_memattr)
     {
@@ -261,6 +401,9 @@ LOCAL void debug_read_symtbl(const char *fname)
     }
 
     lzoe_fclose(f);
+
+    /* New labels change the disassembly. */
+    debug_disasm_cache_inval();
 }
 
 /* ======================================================================== */
@@ -303,68 +446,102 @@ got_it:
     return (int)val;
 }
 
+/* ======================================================================== */
+/*  DEBUG_PROF_NAME  -- Names functions for the profiler, and segments for  */
+/*                      the coverage report.                                */
+/* ======================================================================== */
+LOCAL const char *debug_prof_name(uint_32 addr, char *buf)
+{
+    const char *sym;
+
+    if (debug_symtab && (sym = symtab_getsym(debug_symtab, addr, 0, 0)))
+        return sym;
+
+    sprintf(buf, "$%.4X", addr);
+    return buf;
+}
+
 /* ======================================================================== */
 /*  DEBUG_SYMB_FOR_ADDR  -- Return a parenthesized string associated with   */
 /*                          an address, if any, else an empty string.       */
 /* ======================================================================== */
 LOCAL char *debug_symb_for_addr(debug_t *debug, uint_32 addr, char *s4a_buf)
 {
-    const char *symb;
-    const char *temp;
-    int which;
-    int fmt = debug->symb_addr_format;
-    int len;
+    return trace_fmt_addr(debug_symtab, debug->symb_addr_format, addr,
+                          s4a_buf);
+}
 
-    if (!debug_symtab || !(symb = symtab_getsym(debug_symtab, addr, 0, 0)))
-    {
-        fmt = 3;
-        len = 0;
-    } else
-    {
-        len = strlen(symb);
-    }
+/* ======================================================================== */
+/*  DEBUG_TR_SYNC    -- Let the printer catch up before we print anything   */
+/*                      ourselves, so the output stays in order.            */
+/* ======================================================================== */
+void debug_tr_sync(void)
+{
+    if (debug_tpr)
+        trace_pr_sync(debug_tpr);
+}
 
-    if (fmt < 3)
-    {
-        /* Skip symbol names that start with "." if there are alternatives. */
-        which = 1;
-        while (symb[0] == '.' && 
-               (temp = symtab_getsym(debug_symtab, addr, 0, which)) != NULL)
-        {
-            symb = temp;
-            which++;
-        }
-    }
-    
-    switch (fmt)
-    {
-        case 0:
-            if (len > 27)
-                len = 27;
+/* ======================================================================== */
+/*  DEBUG_TR_SETUP   -- Set the formatter up to print the way we would.     */
+/*                      Only call this while the printer is synced.         */
+/* ======================================================================== */
+LOCAL void debug_tr_setup(debug_t *debug, int show_time)
+{
+    trace_fmt_t *fmt = debug_tpr ? trace_pr_fmt(debug_tpr) : &debug_tfmt;
+    int width = get_disp_width() - (show_time ? 60 : 51);
+
+    fmt->symtab    = debug_symtab;
+    fmt->symb_fmt  = debug->symb_addr_format;
+    fmt->width     = width < 20 ? -1 : width;
+    fmt->show_time = show_time;
+    fmt->src_mode  = disasm_mode;
+    fmt->src       = source_for_addr;
+}
 
-            sprintf(s4a_buf, "%*s ($%.4X)", len, symb, addr);
-            break;
+/* ======================================================================== */
+/*  DEBUG_TR_PUT     -- Put a record in the trace file, if it's on, and     */
+/*                      print it.                                           */
+/* ======================================================================== */
+LOCAL void debug_tr_put(const uint_16 *rec)
+{
+    char text[TRACE_FMT_MAX];
 
-        case 1:
-            if (len > 35)
-                len = 35;
+    if (debug_trace)
+        trace_put(debug_trace, rec);
 
-            sprintf(s4a_buf, "%*s", len, symb);
-            break;
+    if (debug_tpr)
+        trace_pr_put(debug_tpr, rec);
+    else if (trace_fmt(&debug_tfmt, rec, text) > 0)
+        jzp_printf("%s", text);
+}
 
-        case 2:
-            if (len > 27)
-                len = 27;
+/* ======================================================================== */
+/*  DEBUG_TR_ACCESS  -- Trace a read or write, naming its requestor first   */
+/*                      if this is the first the trace has seen of it.      */
+/* ======================================================================== */
+LOCAL void debug_tr_access(int kind, uint_32 a, uint_32 d, uint_32 pc,
+                           periph_t *req, uint_64 now)
+{
+    uint_16 rec[TRACE_REC_WORDS];
+    int i;
 
-            sprintf(s4a_buf, "$%.4X (%*s)", addr, len, symb);
+    for (i = 0; i < debug_reqs; i++)
+        if (debug_req[i] == req)
             break;
 
-        case 3:
-            sprintf(s4a_buf, "$%.4X", addr);
-            break;
+    if (i == debug_reqs)
+    {
+        /* Out of numbers?  Start over; the names go out again as needed. */
+        if (debug_reqs == TRACE_NAMES)
+            debug_reqs = i = 0;
+
+        debug_req[debug_reqs++] = req;
+        trace_mk_name(rec, i, req->name, now);
+        debug_tr_put(rec);
     }
 
-    return s4a_buf;
+    trace_mk_access(rec, kind, a, d, pc, i, now);
+    debug_tr_put(rec);
 }
 
 /* ======================================================================== */
@@ -447,6 +624,7 @@ LOCAL uint_32 debug_get_jsr_addr(uint_32 ret_addr)
                 debug_jsrs[i][1] = debug_jsrs[j][1];
             }
             debug_num_jsrs--;
+            debug_remap_due = 1;
         }
     }
 
@@ -467,6 +645,7 @@ LOCAL void debug_set_jsr_ret(uint_32 jsr_addr, uint_32 ret_addr)
         {
             debug_jsrs[i][0] = jsr_addr;
             debug_jsrs[i][1] = ret_addr;
+            debug_remap_due  = 1;
             return;
         }
 
@@ -477,6 +656,348 @@ LOCAL void debug_set_jsr_ret(uint_32 jsr_addr, uint_32 ret_addr)
     debug_jsrs[debug_num_jsrs][0] = jsr_addr;
     debug_jsrs[debug_num_jsrs][1] = ret_addr;
     debug_num_jsrs++;
+    debug_remap_due = 1;
+}
+
+/* ======================================================================== */
+/*  DEBUG_MAP_JSR_RET -- Map the debugger's reads over a JSR's return       */
+/*                       window, so DEBUG_CHK_JSR_RET sees reads there.     */
+/*                       Only adds to the bus, so it's safe mid-access.     */
+/* ======================================================================== */
+LOCAL void debug_map_jsr_ret(debug_t *debug, uint_32 ret_addr)
+{
+    uint_32 i;
+
+    for (i = 0; i <= JSR_RET_WINDOW; i++)
+        periph_map(debug->periph.bus, (periph_p)debug,
+                   (ret_addr + i) & 0xFFFF, (ret_addr + i) & 0xFFFF,
+                   PERIPH_RD);
+}
+
+/* ======================================================================== */
+/*  DEBUG_BK_SYM     -- Looks up symbols for conditions.                    */
+/* ======================================================================== */
+LOCAL int debug_bk_sym(const char *name, uint_32 *val)
+{
+    return debug_symtab && symtab_getaddr(debug_symtab, name, val) == 0
+           ? 0 : -1;
+}
+
+/* ======================================================================== */
+/*  DEBUG_BK_ADD     -- Add a breakpoint or stopping watch, replacing any   */
+/*                      on the same range.  Returns -1 if the condition     */
+/*                      doesn't compile.                                    */
+/*  DEBUG_BK_DEL     -- Remove the breakpoint at 'addr', and the stopping   */
+/*                      watches that cover it.                              */
+/* ======================================================================== */
+LOCAL void debug_bk_free(debug_bk_t *bk)
+{
+    cond_destroy(bk->cond);
+    CONDFREE(bk->text);
+}
+
+LOCAL int debug_bk_add(cp1600_t *cp, int kind, uint_32 lo, uint_32 hi,
+                       const char *text, uint_32 ignore)
+{
+    debug_bk_t *bk;
+    cond_t     *cond = NULL;
+    const char *err;
+    int         i, pos;
+
+    if (text && !(cond = cond_compile(text, debug_bk_sym, &err, &pos)))
+    {
+        jzp_printf("Error in condition:  %s\n    %s\n    %*s^\n",
+                   err, text, pos, "");
+        return -1;
+    }
+
+    for (i = 0; i < debug_bks; i++)
+        if (debug_bk[i].kind == kind && debug_bk[i].lo == lo &&
+            debug_bk[i].hi == hi)
+            break;
+
+    if (i == debug_bks)
+    {
+        if (!(bk = REALLOC(debug_bk, debug_bk_t, debug_bks + 1)))
+        {
+            cond_destroy(cond);
+            jzp_printf("Out of memory\n");
+            return -1;
+        }
+        debug_bk = bk;
+        debug_bks++;
+        debug_bk_watches += kind != BK_EXEC;
+    } else
+        debug_bk_free(&debug_bk[i]);
+
+    bk = &debug_bk[i];
+    bk->kind   = kind;
+    bk->lo     = lo;
+    bk->hi     = hi;
+    bk->cond   = cond;
+    bk->text   = text ? strdup(text) : NULL;
+    bk->hits   = 0;
+    bk->ignore = ignore;
+
+    if (kind != BK_EXEC)
+    {
+        debug_remap_due    = 1;
+        cp->instr_tick_per = 1;
+    }
+    return 0;
+}
+
+LOCAL void debug_bk_del(cp1600_t *cp, uint_32 addr)
+{
+    int i, j;
+
+    for (i = j = 0; i < debug_bks; i++)
+    {
+        if (addr >= debug_bk[i].lo && addr <= debug_bk[i].hi)
+        {
+            debug_bk_watches -= debug_bk[i].kind != BK_EXEC;
+            debug_bk_free(&debug_bk[i]);
+        } else
+            debug_bk[j++] = debug_bk[i];
+    }
+
+    if (j != debug_bks)
+    {
+        debug_bks       = j;
+        debug_remap_due = 1;
+        cp->instr_tick_per = DEBUG_PER_INSTR() ? 1 : 0;
+    }
+}
+
+/* ======================================================================== */
+/*  DEBUG_BK_FIND    -- Find the breakpoint at 'addr', if it has an entry.  */
+/*  DEBUG_BK_HOLDS   -- Does its condition hold?  Watches may peek at the   */
+/*                      bus in the middle of an access, so put the bus      */
+/*                      back the way it was afterwards.                     */
+/*  DEBUG_BK_STOP    -- Count a hit if the condition holds, and say if we   */
+/*                      should stop for it.                                 */
+/* ======================================================================== */
+LOCAL debug_bk_t *debug_bk_find(uint_32 addr)
+{
+    int i;
+
+    for (i = 0; i < debug_bks; i++)
+        if (debug_bk[i].kind == BK_EXEC && debug_bk[i].lo == addr)
+            return &debug_bk[i];
+
+    return NULL;
+}
+
+LOCAL int debug_bk_holds(const debug_bk_t *bk, cp1600_t *cp, uint_32 addr,
+                         uint_32 val)
+{
+    periph_p bus  = (periph_p)cp->periph.bus;
+    periph_p req  = bus->req;
+    int      busy = bus->busy, ret;
+
+    if (!bk->cond)
+        return 1;
+
+    if (bk->kind == BK_RD)
+        val = CP1600_PK(cp, addr);
+
+    ret = cond_eval(bk->cond, cp, addr, val);
+
+    bus->req  = req;
+    bus->busy = busy;
+    return ret;
+}
+
+LOCAL int debug_bk_stop(debug_bk_t *bk, cp1600_t *cp, uint_32 addr,
+                        uint_32 val)
+{
+    if (!debug_bk_holds(bk, cp, addr, val))
+        return 0;
+
+    bk->hits++;
+    if (bk->ignore)
+    {
+        bk->ignore--;
+        return 0;
+    }
+    return 1;
+}
+
+/* ======================================================================== */
+/*  DEBUG_BK_WATCH   -- Check the stopping watches for an access by the     */
+/*                      CPU, and stop if one fires.                         */
+/* ======================================================================== */
+LOCAL void debug_bk_watch(debug_t *debug, int kind, uint_32 addr,
+                          uint_32 val)
+{
+    cp1600_t *cp = debug->cp1600;
+    char addrbuf[36], pcbuf[36];
+    int i;
+
+    for (i = 0; i < debug_bks; i++)
+    {
+        debug_bk_t *bk = &debug_bk[i];
+
+        if (bk->kind != kind || addr < bk->lo || addr > bk->hi ||
+            !debug_bk_stop(bk, cp, addr, val))
+            continue;
+
+        debug_tr_sync();
+        jzp_printf("Watch hit:  %s a=%s (PC = %s) t=%llu\n",
+                   kind == BK_RD ? "RD" : "WR",
+                   debug_symb_for_addr(debug, addr, addrbuf),
+                   debug_symb_for_addr(debug, cp->oldpc, pcbuf),
+                   cp->periph.now);
+        debug->step_count = 0;
+        return;
+    }
+}
+
+/* ======================================================================== */
+/*  DEBUG_BK_LIST    -- List the breakpoints and stopping watches.          */
+/* ======================================================================== */
+LOCAL void debug_bk_list(void)
+{
+    static const char *const kind[3] = { "Break", "Read ", "Write" };
+    int i;
+
+    if (!debug_bks)
+        jzp_printf("No breakpoints or stopping watches set with 'b', "
+                   "'w' or '@'\n");
+
+    for (i = 0; i < debug_bks; i++)
+    {
+        const debug_bk_t *bk = &debug_bk[i];
+
+        jzp_printf("%s $%.4X", kind[bk->kind], bk->lo);
+        if (bk->hi != bk->lo)
+            jzp_printf("-$%.4X", bk->hi);
+        jzp_printf("  hits %u", bk->hits);
+        if (bk->ignore)
+            jzp_printf(", ignoring %u more", bk->ignore);
+        if (bk->text)
+            jzp_printf("  if %s", bk->text);
+        jzp_printf("\n");
+    }
+}
+
+/* ======================================================================== */
+/*  DEBUG_BK_ARGS    -- Split "if <cond>" and then "ignore <#>" off the end */
+/*                      of a 'b', 'w' or '@' command.  Returns -1 if they   */
+/*                      don't make sense.                                   */
+/* ======================================================================== */
+LOCAL char *debug_bk_kw(char *s, const char *kw)
+{
+    char *k;
+    int i;
+
+    for (k = s; *k; k++)
+    {
+        if (k != s && !isspace(k[-1]))
+            continue;
+
+        for (i = 0; kw[i] && toupper(k[i]) == toupper(kw[i]); i++)
+            ;
+
+        if (!kw[i] && (!k[i] || isspace(k[i])))
+            return k;
+    }
+
+    return NULL;
+}
+
+LOCAL int debug_bk_args(char *s, char **cond, int *ignore)
+{
+    char *k;
+
+    *cond   = NULL;
+    *ignore = -1;
+
+    if ((k = debug_bk_kw(s, "if")) != NULL)
+    {
+        *k = 0;
+        for (k += 2; isspace(*k); k++)
+            ;
+        if (!*k)
+        {
+            jzp_printf("Missing condition after 'if'\n");
+            return -1;
+        }
+        *cond = k;
+    }
+
+    if ((k = debug_bk_kw(s, "ignore")) != NULL)
+    {
+        *k = 0;
+        if (sscanf(k + 6, "%d", ignore) != 1 || *ignore < 0)
+        {
+            jzp_printf("Expected a count after 'ignore'\n");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  DEBUG_REMAP      -- Map the debugger into exactly the pages it needs    */
+/*                      right now, and out of the rest.  This rewrites the  */
+/*                      bus decode tables, so only call it from DEBUG_TK.   */
+/* ======================================================================== */
+LOCAL void debug_remap(debug_t *debug)
+{
+    periph_bus_p bus = debug->periph.bus;
+    uint_32 lo, hi, addr, page;
+    int all_rd, all_wr, want_rd, want_wr, i, ret;
+
+    if (!bus)
+        return;
+
+    debug_remap_due = 0;
+
+    all_rd = debug->show_rd || debug_memattr != NULL;
+    all_wr = debug->show_wr || debug_memattr != NULL;
+#ifdef STK_TRC
+    all_rd |= stk_trc != NULL;
+    all_wr |= stk_trc != NULL;
+#endif
+
+    page = 1u << bus->decode_shift;
+
+    for (lo = 0; lo < 0x10000; lo += page)
+    {
+        hi      = lo + page - 1;
+        want_rd = all_rd;
+        want_wr = all_wr;
+
+        for (addr = lo; addr <= hi && !(want_rd && want_wr); addr++)
+        {
+            want_rd |= WATCHING(addr, r) | WATCHING(addr, gdb_r);
+            want_wr |= WATCHING(addr, w) | WATCHING(addr, gdb_w);
+        }
+
+        for (i = 0; i < debug_bks; i++)
+        {
+            if (debug_bk[i].lo > hi || debug_bk[i].hi < lo)
+                continue;
+            if (debug_bk[i].kind == BK_RD) want_rd = 1;
+            if (debug_bk[i].kind == BK_WR) want_wr = 1;
+        }
+
+        if (debug_rev.mode == REV_WRITE && debug_rev.lo <= debug_rev.hi)
+            want_wr |= lo <= debug_rev.hi && hi >= debug_rev.lo;
+
+        if (want_rd) periph_map  (bus, (periph_p)debug, lo, hi, PERIPH_RD);
+        else         periph_unmap(bus, (periph_p)debug, lo, hi, PERIPH_RD);
+        if (want_wr) periph_map  (bus, (periph_p)debug, lo, hi, PERIPH_WR);
+        else         periph_unmap(bus, (periph_p)debug, lo, hi, PERIPH_WR);
+    }
+
+    for (i = 0; i < debug_num_jsrs; i++)
+        debug_map_jsr_ret(debug, debug_jsrs[i][1]);
+
+    for (i = 0; debug_prof && (ret = prof_ret_addr(debug_prof, i)) >= 0; i++)
+        debug_map_jsr_ret(debug, ret);
 }
 
 /* ======================================================================== */
@@ -484,8 +1005,9 @@ LOCAL void debug_set_jsr_ret(uint_32 jsr_addr, uint_32 ret_addr)
 /*                       them forward if they're seen.  This is intended to */
 /*                       catch functions that have arguments after the JSR  */
 /* ======================================================================== */
-LOCAL void debug_chk_jsr_ret(cp1600_t *cp, uint_32 read_addr)
+LOCAL void debug_chk_jsr_ret(debug_t *debug, uint_32 read_addr)
 {
+    cp1600_t *cp = debug->cp1600;
     int i;
 
     /* -------------------------------------------------------------------- */
@@ -511,6 +1033,8 @@ LOCAL void debug_chk_jsr_ret(cp1600_t *cp, uint_32 read_addr)
             cp1600_clr_breakpt(cp, debug_jsrs[i][1], CP1600_BKPT_ONCE);
             cp1600_set_breakpt(cp, read_addr + 1,    CP1600_BKPT_ONCE);
             debug_jsrs[i][1] = read_addr + 1;
+            debug_map_jsr_ret(debug, read_addr + 1);
+            debug_remap_due = 1;
             return;
         }
     }
@@ -519,17 +1043,30 @@ LOCAL void debug_chk_jsr_ret(cp1600_t *cp, uint_32 read_addr)
 }
 
 /* ======================================================================== */
-/*  DEBUG_FIND_JSRS  -- If we're stepping over JSRs, handle any JSR at the  */
-/*                      current PC.                                         */
+/*  DEBUG_JSR_TARGET -- If there's a JSR at 'pc', return where it goes.     */
+/*                      Otherwise, return -1.                               */
 /* ======================================================================== */
-LOCAL int debug_find_jsrs(periph_t *p, cp1600_t *cp, uint_32 pc)
+LOCAL int debug_jsr_target(periph_t *p, uint_32 pc)
 {
-    uint_16 n1, n2;
+    uint_16 n1, n2, n3;
 
     /* Is this a JUMP family instruction? */
     n1 = periph_peek((periph_t*)p->bus, p, (pc + 0) & 0xFFFF, ~0) & 0x3FF;
     n2 = periph_peek((periph_t*)p->bus, p, (pc + 1) & 0xFFFF, ~0) & 0x3FF;
-    if (n1 == 0x0004 && (n2 & 0x300) != 0x300)
+    if (n1 != 0x0004 || (n2 & 0x300) == 0x300)
+        return -1;
+
+    n3 = periph_peek((periph_t*)p->bus, p, (pc + 2) & 0xFFFF, ~0) & 0x3FF;
+    return ((n2 & 0xFC) << 8) | n3;
+}
+
+/* ======================================================================== */
+/*  DEBUG_FIND_JSRS  -- If we're stepping over JSRs, handle any JSR at the  */
+/*                      current PC.                                         */
+/* ======================================================================== */
+LOCAL int debug_find_jsrs(periph_t *p, cp1600_t *cp, uint_32 pc)
+{
+    if (debug_jsr_target(p, pc) >= 0)
     {
         cp1600_set_breakpt(cp, pc + 3, CP1600_BKPT_ONCE);
         debug_set_jsr_ret(pc, pc + 3);
@@ -603,6 +1140,38 @@ LOCAL uint_16 debug_infer_stack(cp1600_t *cp)
 }
 #endif
 
+/* ======================================================================== */
+/*  DEBUG_REV_HIT    -- Note a match while replaying a stretch.  Matches    */
+/*                      at the very start belong to the stretch before.     */
+/* ======================================================================== */
+LOCAL void debug_rev_hit(uint_64 when)
+{
+    debug_rev_t *rv = &debug_rev;
+
+    if (when <= rv->from || when >= rv->until ||
+        (rv->hits && when == rv->last))
+        return;
+
+    rv->hit[rv->head] = when;
+    rv->head = (rv->head + 1) % rv->want;
+    rv->hits++;
+    rv->last = when;
+}
+
+/* ======================================================================== */
+/*  DEBUG_REV_RESUMED -- See if the REWIND_TO we're waiting on is done.     */
+/* ======================================================================== */
+LOCAL int debug_rev_resumed(void)
+{
+    if (debug_rev.state == REV_WAIT && debug_rewound)
+    {
+        debug_rewound   = 0;
+        debug_rev.state = debug_rev.next;
+    }
+
+    return debug_rev.state != REV_WAIT;
+}
+
 /*
  * ============================================================================
  *  DEBUG_RD         -- Capture/print a read event.
@@ -615,22 +1184,32 @@ uint_32 debug_rd(periph_t *p, periph_t *r, uint_32 a, uint_32 d)
 {
     debug_t *debug = (debug_t*)p;
     cp1600_t *cp = debug->cp1600;
-    char addrbuf[36], pcbuf[36];
+    int ret;
 
     if (p == r->req)
         return ~0;
 
-    debug_chk_jsr_ret(cp, a);
+    debug_chk_jsr_ret(debug, a);
 
-    if (debug->show_rd || WATCHING(a,r))
+    if (debug_prof && r->req == (periph_p)cp && cp->r[7] != a &&
+        (ret = prof_read(debug_prof, a)) >= 0)
+        debug_map_jsr_ret(debug, ret);
+
+    if (debug_gdb && !debug_rev.mode && r->req == (periph_p)cp &&
+        cp->r[7] != a && WATCHING(a,gdb_r) && gdb_attached(debug_gdb))
     {
-        jzp_printf(" RD a=%s d=%.4X %-16s (PC = %s) t=%llu\n", 
-                debug_symb_for_addr(debug, a, addrbuf),
-                d, r==(periph_p)p->bus ? r->req->name:r->name, 
-                debug_symb_for_addr(debug, cp->oldpc, pcbuf),
-                cp->periph.now);
+        gdb_watch_hit(debug_gdb, GDB_WATCH_RD, a);
+        debug->step_count = 0;
     }
 
+    if (debug_bk_watches && !debug_rev.mode && r->req == (periph_p)cp &&
+        cp->r[7] != a)
+        debug_bk_watch(debug, BK_RD, a, 0);
+
+    if (!debug_rev.mode && (debug->show_rd || WATCHING(a,r)))
+        debug_tr_access(TRACE_RD, a, d, cp->oldpc,
+                        r == (periph_p)p->bus ? r->req : r, cp->periph.now);
+
     if (debug_memattr)
     {
         if (cp->r[7] == a) 
@@ -662,59 +1241,578 @@ uint_32 debug_rd(periph_t *p, periph_t *r, uint_32 a, uint_32 d)
     }
 #endif
 
-    return ~0U;
+    return ~0U;
+}
+
+void    debug_wr(periph_t *p, periph_t *r, uint_32 a, uint_32 d)
+{
+    debug_t *debug = (debug_t*)p;
+    cp1600_t *cp = debug->cp1600;
+
+    if (p == r->req)
+        return;
+
+    if (debug_rev.mode == REV_WRITE && r->req == (periph_p)cp &&
+        debug_rev_resumed() && debug_rev.state == REV_SCAN &&
+        (debug_rev.lo > debug_rev.hi ? WATCHING(a,w)
+                                     : a >= debug_rev.lo && a <= debug_rev.hi))
+        debug_rev_hit(cp->periph.now);
+
+    if (debug_gdb && !debug_rev.mode && r->req == (periph_p)cp &&
+        WATCHING(a,gdb_w) && gdb_attached(debug_gdb))
+    {
+        gdb_watch_hit(debug_gdb, GDB_WATCH_WR, a);
+        debug->step_count = 0;
+    }
+
+    if (debug_bk_watches && !debug_rev.mode && r->req == (periph_p)cp)
+        debug_bk_watch(debug, BK_WR, a, d);
+
+    if (!debug_rev.mode && (debug->show_wr || WATCHING(a,w)))
+        debug_tr_access(TRACE_WR, a, d, cp->oldpc,
+                        r == (periph_p)p->bus ? r->req : r, cp->periph.now);
+
+    if (debug_memattr)
+    {
+        debug_memattr[a] |= DEBUG_MA_DATA | DEBUG_MA_WRITE;
+        debug_mempc  [a]  = cp->r[7];
+    }
+
+#ifdef STK_TRC
+    if (stk_trc && a >= stk_base && a < stk_base + MAX_STK && a == cp->r[6])
+    {
+        stk_wr = a;
+        stk_pc[a - stk_base] = cp->oldpc;
+    }
+#endif
+}
+
+LOCAL uint_32 debug_peek(periph_t *p, periph_t *r, uint_32 a, uint_32 d)
+{
+    UNUSED(p);
+    UNUSED(r);
+    UNUSED(a);
+    UNUSED(d);
+    return ~0U;
+}
+
+LOCAL void debug_poke(periph_t *p, periph_t *r, uint_32 a, uint_32 d)
+{
+    UNUSED(p);
+    UNUSED(r);
+    UNUSED(a);
+    UNUSED(d);
+}
+
+/* ======================================================================== */
+/*  DEBUG_FILL_REC   -- Fill in a register history record for the machine   */
+/*                      as it stands.  The trace file uses these too.       */
+/* ======================================================================== */
+LOCAL void debug_fill_rec(uint_16 *rec, periph_t *p, const cp1600_t *cp,
+                          int intrq, uint_64 now)
+{
+    int i;
+
+    memcpy(rec, cp->r, 16);
+
+    rec[8] = 1 + ((!!cp->S    ) << 1) +
+                 ((!!cp->C    ) << 2) +
+                 ((!!cp->O    ) << 3) +
+                 ((!!cp->Z    ) << 4) +
+                 ((!!cp->I    ) << 5) +
+                 ((!!cp->D    ) << 6) +
+                 ((!!cp->intr ) << 7) +
+                 ((intrq      ) << 8);
+
+    for (i = 0; i < 3; i++)
+        rec[9 + i] = periph_peek((periph_t*)p->bus, p, cp->r[7] + i, ~0);
+
+    rec[12] = (now    ) & 0xFFFF;
+    rec[13] = (now>>16) & 0xFFFF;
+    rec[14] = (now>>32) & 0xFFFF;
+    rec[15] = (now>>48) & 0xFFFF;
+}
+
+/*
+ * ============================================================================
+ *  Running backwards
+ *
+ *  The CPU can't run backwards, but the rewind buffer holds the machine
+ *  state every frame, and replaying forward from one of those is exact:
+ *  the input log feeds the controllers what they saw the first time.
+ *  So to go back, we restore the last frame before where we are and
+ *  replay that stretch one instruction at a time, noting each match:
+ *  every instruction for a step back, breakpoint hits, or writes to the
+ *  range asked about.  If the stretch has enough of them, we restore the
+ *  same frame again and replay up to the one we want.  If not, we do the
+ *  same for the stretch before it, and so on back.
+ *
+ *  Restores happen between ticks, in the main loop, so each one is a
+ *  REWIND_TO request and a wait while the CPU runs out the current tick.
+ *  DEBUG_REV_TK drives all this from the top of DEBUG_TK, and keeps the
+ *  debugger quiet until we get where we're going.
+ *
+ *  DEBUG_REV_START  -- Begin going back, or say why we can't.
+ *  DEBUG_REV_END    -- Put everything back the way it was.
+ *  DEBUG_REV_SEEK   -- Replay to a match, or to the start of a stretch.
+ *  DEBUG_REV_NEXT   -- Decide what to do at the end of a stretch.
+ *  DEBUG_REV_TK     -- Called each tick.  Nonzero means not to stop yet.
+ * ============================================================================
+ */
+LOCAL int debug_rev_start(debug_t *debug, int mode, int count,
+                          uint_32 lo, uint_32 hi, uint_64 now)
+{
+    debug_rev_t *rv = &debug_rev;
+    int i;
+
+    if (mode == REV_WRITE && lo > hi)
+    {
+        for (i = 0; i < (0x10000 >> 5) && !debug_watch_w[i]; i++)
+            ;
+
+        if (i == (0x10000 >> 5))
+        {
+            jzp_printf("No locations are write-watched.  Give an "
+                       "address range.\n");
+            return -1;
+        }
+    }
+
+    if (count < 1)        count = 1;
+    if (count > HISTSIZE) count = HISTSIZE;
+
+    if (!(rv->hit = CALLOC(uint_64, count)))
+    {
+        jzp_printf("Out of memory\n");
+        return -1;
+    }
+
+    if (rewind_to(now, &rv->from))
+    {
+        jzp_printf("No rewind history before this point.  Running "
+                   "backwards needs --rewind=<MB>.\n");
+        CONDFREE(rv->hit);
+        return -1;
+    }
+
+    rv->mode    = mode;
+    rv->state   = REV_WAIT;
+    rv->next    = REV_SCAN;
+    rv->lo      = lo;
+    rv->hi      = hi;
+    rv->want    = count;
+    rv->hits    = 0;
+    rv->head    = 0;
+    rv->until   = now;
+    rv->found   = 0;
+    rv->ran_out = 0;
+    rv->start   = get_time();
+
+    /* Replay flat out.  Nobody wants to watch it. */
+    if (debug->speed)
+    {
+        rv->unthrottled = debug->speed->unthrottled;
+        debug->speed->unthrottled = 1;
+    }
+
+    return 0;
+}
+
+LOCAL void debug_rev_end(debug_t *debug)
+{
+    debug_rev_t *rv = &debug_rev;
+
+    CONDFREE(rv->hit);
+    rv->mode      = REV_OFF;
+    debug_rewound = 0;
+    rewind_to_done();
+
+    if (debug->speed)
+        debug->speed->unthrottled = rv->unthrottled;
+
+    debug->cp1600->instr_tick_per = DEBUG_PER_INSTR() ? 1 : 0;
+    debug->step_count = 0;
+    debug_remap_due   = 1;
+}
+
+LOCAL int debug_rev_seek(uint_64 target, int at_hit)
+{
+    debug_rev_t *rv = &debug_rev;
+
+    rv->target = target;
+    rv->at_hit = at_hit;
+    rv->state  = REV_WAIT;
+    rv->next   = REV_SEEK;
+
+    /* Without a match, stop at the first step of the stretch. */
+    return rewind_to(at_hit ? target : rv->from + 1, &rv->from);
+}
+
+LOCAL int debug_rev_next(void)
+{
+    debug_rev_t *rv = &debug_rev;
+
+    /* -------------------------------------------------------------------- */
+    /*  The ring holds the last 'want' matches, so once it's full, the      */
+    /*  oldest one in it is the one we're after.                            */
+    /* -------------------------------------------------------------------- */
+    if (rv->hits)
+    {
+        rv->oldest = rv->hits >= rv->want ? rv->hit[rv->head] : rv->hit[0];
+        rv->found  = 1;
+
+        if (rv->hits >= rv->want)
+            return debug_rev_seek(rv->oldest, 1);
+
+        rv->want -= rv->hits;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Not enough here.  Try the stretch before this one.                  */
+    /* -------------------------------------------------------------------- */
+    rv->hits  = 0;
+    rv->head  = 0;
+    rv->until = rv->from + 1;
+    rv->state = REV_WAIT;
+    rv->next  = REV_SCAN;
+
+    if (rewind_to(rv->from, &rv->from) == 0)
+        return 0;
+
+    /* -------------------------------------------------------------------- */
+    /*  Out of history.  Settle for the earliest match, or the start.       */
+    /* -------------------------------------------------------------------- */
+    rv->ran_out = 1;
+    return rv->found ? debug_rev_seek(rv->oldest, 1) : debug_rev_seek(0, 0);
+}
+
+LOCAL int debug_rev_tk(debug_t *debug, sint_32 slen, uint_64 now)
+{
+    debug_rev_t *rv = &debug_rev;
+    cp1600_t *cp = debug->cp1600;
+
+    if (slen == -CYC_MAX || debug_fault_detected)
+    {
+        debug_tr_sync();
+        jzp_printf("Stopped running backwards.\n");
+        debug_rev_end(debug);
+        return 0;
+    }
+
+    if (!debug_rev_resumed())
+        return 1;
+
+    if (rv->state == REV_SCAN)
+    {
+        if (now < rv->until)
+        {
+            debug_bk_t *bk;
+
+            if (rv->mode == REV_STEP ||
+                (rv->mode == REV_BKPT && slen < 0 && cp->hit_bkpt == 1 &&
+                 (!(bk = debug_bk_find(cp->r[7])) ||
+                  debug_bk_holds(bk, cp, cp->r[7], 0) ||
+                  debug_gdb_bkpt_at(cp, cp->r[7]))))
+                debug_rev_hit(now);
+            return 1;
+        }
+
+        if (debug_rev_next() == 0)
+            return 1;
+
+        debug_tr_sync();
+        jzp_printf("Lost the rewind history.\n");
+        debug_rev_end(debug);
+        return 0;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Seeking.  A breakpoint hit comes on its own tick, right after the   */
+    /*  one that ended the instruction before it, at the same cycle.        */
+    /* -------------------------------------------------------------------- */
+    if (now < rv->target ||
+        (rv->at_hit && rv->mode == REV_BKPT && slen >= 0 && now == rv->target))
+        return 1;
+
+    debug_tr_sync();
+    if (rv->ran_out)
+        jzp_printf("Reached the start of the rewind history.\n");
+    jzp_printf("Went back to cycle %llu in %.1f ms.\n", now,
+               (get_time() - rv->start) * 1000.0);
+
+    debug_rev_end(debug);
+    return 0;
+}
+
+/* ======================================================================== */
+/*  GDB stub target:  Registers, memory, breakpoints and watches.           */
+/* ======================================================================== */
+LOCAL uint_32 debug_gdb_get_reg(void *opaque, int reg)
+{
+    const cp1600_t *cp = ((debug_t *)opaque)->cp1600;
+
+    if (reg != GDB_REG_FLAGS)
+        return cp->r[reg];
+
+    return (!!cp->S << 7) | (!!cp->Z << 6) | (!!cp->O << 5) |
+           (!!cp->C << 4) | (!!cp->I << 1) | (!!cp->D);
+}
+
+LOCAL void debug_gdb_set_reg(void *opaque, int reg, uint_32 val)
+{
+    cp1600_t *cp = ((debug_t *)opaque)->cp1600;
+
+    if (reg != GDB_REG_FLAGS)
+    {
+        cp->r[reg] = val;
+        return;
+    }
+
+    cp->S = (val >> 7) & 1;
+    cp->Z = (val >> 6) & 1;
+    cp->O = (val >> 5) & 1;
+    cp->C = (val >> 4) & 1;
+    cp->I = (val >> 1) & 1;
+    cp->D =  val       & 1;
+}
+
+LOCAL uint_32 debug_gdb_peek(void *opaque, uint_32 addr)
+{
+    cp1600_t *cp = ((debug_t *)opaque)->cp1600;
+
+    return periph_peek((periph_p)cp->periph.bus, (periph_p)cp, addr, ~0);
+}
+
+LOCAL void debug_gdb_poke(void *opaque, uint_32 addr, uint_32 val)
+{
+    cp1600_t *cp = ((debug_t *)opaque)->cp1600;
+
+    periph_poke((periph_p)cp->periph.bus, (periph_p)cp, addr, val);
+    cp1600_invalidate(cp, addr, addr);
+}
+
+/* ======================================================================== */
+/*  DEBUG_GDB_WATCH_MAP -- Rebuild GDB's watch bitmaps from its watches.    */
+/* ======================================================================== */
+LOCAL void debug_gdb_watch_map(void)
+{
+    uint_32 a;
+    int i;
+
+    memset(debug_watch_gdb_r, 0, sizeof(debug_watch_gdb_r));
+    memset(debug_watch_gdb_w, 0, sizeof(debug_watch_gdb_w));
+
+    for (i = 0; i < debug_gdb_watches; i++)
+        for (a = debug_gdb_wp[i].lo; a <= debug_gdb_wp[i].hi; a++)
+        {
+            if (debug_gdb_wp[i].type != GDB_WATCH_RD) WATCHSET(a,gdb_w);
+            if (debug_gdb_wp[i].type != GDB_WATCH_WR) WATCHSET(a,gdb_r);
+        }
+
+    debug_remap_due = 1;
+}
+
+LOCAL int debug_gdb_bkpt(void *opaque, int type, uint_32 lo, uint_32 hi,
+                         int set)
+{
+    cp1600_t *cp = ((debug_t *)opaque)->cp1600;
+    debug_gdb_wp_t *wp;
+    int i;
+
+    if (type < GDB_WATCH_WR)
+    {
+        if (set) cp1600_set_breakpt(cp, lo, CP1600_BKPT_GDB);
+        else     cp1600_clr_breakpt(cp, lo, CP1600_BKPT_GDB);
+        return 0;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  GDB removes a watch with the same packet it set it with.            */
+    /* -------------------------------------------------------------------- */
+    for (i = 0; i < debug_gdb_watches; i++)
+        if (debug_gdb_wp[i].type == type &&
+            debug_gdb_wp[i].lo == lo && debug_gdb_wp[i].hi == hi)
+            break;
+
+    if (!set)
+    {
+        if (i == debug_gdb_watches)
+            return 0;
+
+        debug_gdb_wp[i] = debug_gdb_wp[--debug_gdb_watches];
+        debug_gdb_watch_map();
+        return 0;
+    }
+
+    if (!(wp = REALLOC(debug_gdb_wp, debug_gdb_wp_t, debug_gdb_watches + 1)))
+        return -1;
+
+    debug_gdb_wp = wp;
+    wp = &debug_gdb_wp[debug_gdb_watches++];
+    wp->type = type;
+    wp->lo   = lo;
+    wp->hi   = hi;
+
+    debug_gdb_watch_map();
+    return 0;
+}
+
+/* ======================================================================== */
+/*  DEBUG_GDB_BKPT_AT -- Is there one of GDB's breakpoints at 'addr'?  GDB  */
+/*                       stops there whatever our conditions say.           */
+/* ======================================================================== */
+LOCAL int debug_gdb_bkpt_at(const cp1600_t *cp, uint_32 addr)
+{
+    return cp->instr[addr] &&
+           (cp->instr[addr]->opcode.breakpt.flags & CP1600_BKPT_GDB) != 0;
+}
+
+/* ======================================================================== */
+/*  DEBUG_GDB_DROP   -- The client left.  Drop what it set and didn't take  */
+/*                      back, or it'd stop us with nobody to tell.          */
+/* ======================================================================== */
+LOCAL void debug_gdb_drop(cp1600_t *cp)
+{
+    uint_32 a;
+
+    for (a = 0; a < 0x10000; a++)
+        cp1600_clr_breakpt(cp, a, CP1600_BKPT_GDB);
+
+    CONDFREE(debug_gdb_wp);
+    debug_gdb_watches = 0;
+    debug_gdb_watch_map();
+}
+
+/* ======================================================================== */
+/*  DEBUG_EXIT       -- Finish the reports still being gathered, and exit.  */
+/*                      Quitting from here skips the dtors that would.      */
+/* ======================================================================== */
+LOCAL void debug_exit(void)
+{
+    debug_heat_finish();
+
+    if (debug_prof)
+        prof_destroy(debug_prof);
+    debug_prof = NULL;
+
+    if (debug_trace)
+        trace_destroy(debug_trace);
+    debug_trace = NULL;
+
+    exit(0);
 }
 
-void    debug_wr(periph_t *p, periph_t *r, uint_32 a, uint_32 d)
+/* ======================================================================== */
+/*  DEBUG_GDB_SERVE  -- Hand a stop to GDB, and set up to run however it    */
+/*                      asks.  Returns -1 if there's no GDB to hand it to.  */
+/* ======================================================================== */
+LOCAL int debug_gdb_serve(debug_t *debug)
 {
-    debug_t *debug = (debug_t*)p;
     cp1600_t *cp = debug->cp1600;
-    char addrbuf[36], pcbuf[36];
+    gdb_target_t tgt;
+    int act;
+
+    tgt.opaque  = (void *)debug;
+    tgt.get_reg = debug_gdb_get_reg;
+    tgt.set_reg = debug_gdb_set_reg;
+    tgt.peek    = debug_gdb_peek;
+    tgt.poke    = debug_gdb_poke;
+    tgt.bkpt    = debug_gdb_bkpt;
+
+    act = gdb_serve(debug_gdb, &tgt, debug_gdb_wait);
+    debug_gdb_wait = 0;
+
+    if (act == GDB_GONE || act == GDB_DETACH)
+        debug_gdb_drop(cp);
+    if (act == GDB_GONE)
+        return -1;
+    if (act == GDB_KILL)
+        debug_exit();
 
-    if (p == r->req)
-        return;
+    debug->step_over = 0;
+    debug->show_ins  = 0;
+    debug->show_rd   = 0;
+    debug->show_wr   = 0;
 
-    if (debug->show_wr || WATCHING(a,w))
+    if (act == GDB_STEP)
     {
-        jzp_printf(" WR a=%s d=%.4X %-16s (PC = %s) t=%llu\n", 
-                debug_symb_for_addr(debug, a, addrbuf),
-                d, r==(periph_p)p->bus ? r->req->name:r->name, 
-                debug_symb_for_addr(debug, cp->oldpc, pcbuf),
-                cp->periph.now);
-    }
-
-    if (debug_memattr)
+        debug->step_count  = 1;
+        cp->instr_tick_per = 1;
+    } else
     {
-        debug_memattr[a] |= DEBUG_MA_DATA | DEBUG_MA_WRITE;
-        debug_mempc  [a]  = cp->r[7];
+        debug->step_count  = -1;
+        cp->instr_tick_per = DEBUG_PER_INSTR() ? 1 : 0;
     }
 
-#ifdef STK_TRC
-    if (stk_trc && a >= stk_base && a < stk_base + MAX_STK && a == cp->r[6])
-    {
-        stk_wr = a;
-        stk_pc[a - stk_base] = cp->oldpc;
-    }
-#endif
+    return 0;
 }
 
-LOCAL uint_32 debug_peek(periph_t *p, periph_t *r, uint_32 a, uint_32 d)
+/* ======================================================================== */
+/*  DEBUG_GDB_START  -- Start the GDB stub.                                 */
+/* ======================================================================== */
+int debug_gdb_start(int port)
 {
-    UNUSED(p);
-    UNUSED(r);
-    UNUSED(a);
-    UNUSED(d);
-    return ~0U;
+    if (!debug_gdb && !(debug_gdb = gdb_create(port)))
+        return -1;
+
+    debug_gdb_wait = 1;
+    return 0;
 }
 
-LOCAL void debug_poke(periph_t *p, periph_t *r, uint_32 a, uint_32 d)
+/* ======================================================================== */
+/*  DEBUG_HEAT_WRITE -- Write the heatmap and coverage report.              */
+/* ======================================================================== */
+LOCAL void debug_heat_write(const char *base)
 {
-    UNUSED(p);
-    UNUSED(r);
-    UNUSED(a);
-    UNUSED(d);
+    char *fname = CALLOC(char, strlen(base) + 8);
+
+    if (!fname)
+        return;
+
+    sprintf(fname, "%s.heat", base);
+    heat_write_map(debug_heat, fname);
+    sprintf(fname, "%s.cov", base);
+    heat_write_cov(debug_heat, fname, debug_prof_name);
+    free(fname);
+}
+
+/* ======================================================================== */
+/*  DEBUG_HEAT_START -- Start counting accesses.                            */
+/* ======================================================================== */
+int debug_heat_start(cp1600_t *cp, const char *base, const char *symtbl)
+{
+    if (debug_heat)
+        return 0;
+
+    if (!(debug_heat_base = strdup(base)) || !(debug_heat = heat_create(cp)))
+    {
+        CONDFREE(debug_heat_base);
+        return -1;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  The coverage report names things from the symbol table, which we    */
+    /*  won't have yet if the debugger's not on.                            */
+    /* -------------------------------------------------------------------- */
+    if (symtbl && !debug_symtab)
+        debug_read_symtbl(symtbl);
+
+    return 0;
 }
 
+/* ======================================================================== */
+/*  DEBUG_HEAT_FINISH    -- Write out the counts and stop counting.         */
+/* ======================================================================== */
+void debug_heat_finish(void)
+{
+    if (!debug_heat)
+        return;
+
+    debug_heat_write(debug_heat_base);
+    heat_destroy(debug_heat);
+    CONDFREE(debug_heat_base);
+    debug_heat = NULL;
+}
 
 uint_32 debug_tk(periph_t *p, uint_32 len)
 {
@@ -731,6 +1829,10 @@ uint_32 debug_tk(periph_t *p, uint_32 len)
     static  uint_32 fast_fwd  = 0, ff_bkpt = 0; 
     static  uint_64 prev_rh_now   = 0;
     static  int     prev_rh_intrq = 0;
+    static  uint_64 prev_tr_now   = 0;
+    static  int     prev_tr_intrq = 0;
+    static  uint_64 prof_now      = 0;
+    static  uint_32 prof_pc       = 0;
     sint_32 slen = (sint_32)len;
     uint_64 instrs = cp->tot_instr - debug->tot_instr;
     uint_64 now = cp->periph.now;
@@ -741,6 +1843,16 @@ uint_32 debug_tk(periph_t *p, uint_32 len)
 
     debug->tot_instr = cp->tot_instr;
 
+    if (debug_remap_due)
+        debug_remap(debug);
+
+    /* -------------------------------------------------------------------- */
+    /*  While running backwards, the replay drives everything until it      */
+    /*  gets where it's going.                                              */
+    /* -------------------------------------------------------------------- */
+    if (debug_rev.mode && debug_rev_tk(debug, slen, now))
+        return len;
+
     /* get current INTRM, BUSRQ */
     intrq = (cp->req_bus.intrq & 1);
     busrq = (cp->req_bus.intrq & 2) >> 1;
@@ -780,13 +1892,28 @@ uint_32 debug_tk(periph_t *p, uint_32 len)
 
 
 /*jzp_printf("%15llu %15llu %15llu %d\n", now, cp->req_bus.intak, cp->req_bus.busak, intrq);*/
+    /* -------------------------------------------------------------------- */
+    /*  If we're writing a trace file, add this step to it.                 */
+    /* -------------------------------------------------------------------- */
+    if (debug_trace && (now != prev_tr_now || intrq != prev_tr_intrq))
+    {
+        uint_16 rec[RH_RECSIZE];
+
+        prev_tr_now   = now;
+        prev_tr_intrq = intrq;
+
+        debug_fill_rec(rec, p, cp, intrq, now);
+        trace_put(debug_trace, rec);
+    }
+
+    if (debug_tpr)
+        trace_pr_tick(debug_tpr, now);
+
     /* -------------------------------------------------------------------- */
     /*  If we're keeping a trace history, update it now.                    */
     /* -------------------------------------------------------------------- */
     if (debug_rh_ptr >= 0 && (now != prev_rh_now || intrq != prev_rh_intrq))
     {
-        int i;
-
         prev_rh_now   = now;
         prev_rh_intrq = intrq;
 
@@ -798,6 +1925,7 @@ uint_32 debug_tk(periph_t *p, uint_32 len)
             if (*debug->vid_enable && non_int >= 43)
             {  
                 char pcbuf[36];
+                debug_tr_sync();
                 jzp_printf("NON_INT = %d at PC = %s\n", non_int, 
                         debug_symb_for_addr(debug, pc, pcbuf));
             }
@@ -805,27 +1933,8 @@ uint_32 debug_tk(periph_t *p, uint_32 len)
             non_int = 0;
         }
 
-        memcpy(debug_reghist + debug_rh_ptr * RH_RECSIZE, cp->r, 16);
-
-
-        debug_reghist[debug_rh_ptr * RH_RECSIZE + 8] = 1 +
-                                              ((!!cp->S    ) << 1) + 
-                                              ((!!cp->C    ) << 2) +
-                                              ((!!cp->O    ) << 3) +
-                                              ((!!cp->Z    ) << 4) +
-                                              ((!!cp->I    ) << 5) +
-                                              ((!!cp->D    ) << 6) +
-                                              ((!!cp->intr ) << 7) +
-                                              ((intrq      ) << 8);
-
-        for (i = 0; i < 3; i++)
-            debug_reghist[debug_rh_ptr * RH_RECSIZE + 9 + i] = 
-                periph_peek((periph_t*)p->bus, p, pc + i, ~0);
-
-        debug_reghist[debug_rh_ptr * RH_RECSIZE + 12] = (now    ) & 0xFFFF;
-        debug_reghist[debug_rh_ptr * RH_RECSIZE + 13] = (now>>16) & 0xFFFF;
-        debug_reghist[debug_rh_ptr * RH_RECSIZE + 14] = (now>>32) & 0xFFFF;
-        debug_reghist[debug_rh_ptr * RH_RECSIZE + 15] = (now>>48) & 0xFFFF;
+        debug_fill_rec(debug_reghist + debug_rh_ptr * RH_RECSIZE, p, cp,
+                       intrq, now);
 
         debug_rh_ptr = (debug_rh_ptr + 1) & HISTMASK;
 
@@ -837,11 +1946,33 @@ uint_32 debug_tk(periph_t *p, uint_32 len)
     }
     prev_pc = pc;
 
+    /* -------------------------------------------------------------------- */
+    /*  If we're profiling, charge the time since the last step, and tell   */
+    /*  the profiler if that step was a call or an interrupt.               */
+    /* -------------------------------------------------------------------- */
+    if (debug_prof && now != prof_now)
+    {
+        if (intrq == 4)
+        {
+            prof_step(debug_prof, now, pc, cp->r[6] - 1, PROF_INTR, prof_pc);
+        } else if (debug_jsr_target(p, prof_pc) == (int)pc)
+        {
+            prof_step(debug_prof, now, pc, cp->r[6], PROF_CALL, prof_pc + 3);
+            debug_map_jsr_ret(debug, prof_pc + 3);
+        } else
+        {
+            prof_step(debug_prof, now, pc, cp->r[6], PROF_NONE, 0);
+        }
+    }
+    prof_now = now;
+    prof_pc  = pc;
+
     /* -------------------------------------------------------------------- */
     /*  If slen == -CYC_MAX, we're crashing.                                */
     /* -------------------------------------------------------------------- */
     if (slen == -CYC_MAX || debug_fault_detected)
     {   
+        debug_tr_sync();
         if ( debug_fault_detected == DEBUG_CRASHING )
         {
             if (debug_rh_ptr >= 0)  debug_write_reghist("dump.hst", p, cp);
@@ -864,6 +1995,19 @@ uint_32 debug_tk(periph_t *p, uint_32 len)
         slen = -CYC_MAX;
     }
 
+    /* -------------------------------------------------------------------- */
+    /*  If GDB has interrupted us, stop here.  Say who came and went, once  */
+    /*  the trace has caught up.                                            */
+    /* -------------------------------------------------------------------- */
+    if (debug_gdb && gdb_news(debug_gdb))
+    {
+        debug_tr_sync();
+        gdb_report(debug_gdb);
+    }
+
+    if (debug_gdb && gdb_stop_wanted(debug_gdb))
+        debug->step_count = 0;
+
     /* -------------------------------------------------------------------- */
     /*  Short-circuit the debugger if we're not doing anything interesting  */
     /* -------------------------------------------------------------------- */
@@ -907,7 +2051,23 @@ uint_32 debug_tk(periph_t *p, uint_32 len)
     if (slen < 0)
     {
         uint_32 jsr_addr = 0;
+        debug_bk_t *bk;
+        int pass = 0;
+
+        debug_tr_sync();
 
+        /* ---------------------------------------------------------------- */
+        /*  A breakpoint whose condition doesn't hold, or whose hits are    */
+        /*  still being ignored, is no reason to stop.                      */
+        /* ---------------------------------------------------------------- */
+        if (cp->hit_bkpt == 1 && !fast_fwd &&
+            (bk = debug_bk_find(pc)) != NULL && !debug_bk_stop(bk, cp, pc, 0)
+            && !debug_gdb_bkpt_at(cp, pc))
+        {
+            if (debug->step_count != 0)
+                return len;
+            pass = 1;
+        }
 
         /* ---------------------------------------------------------------- */
         /*  If we hit a tracepoint (ie. the return from a JSR), then don't  */
@@ -932,7 +2092,7 @@ uint_32 debug_tk(periph_t *p, uint_32 len)
         /*  drop into the debugger.  In the case of a breakpoint, let the   */
         /*  user know that we hit a breakpoint.                             */
         /* ---------------------------------------------------------------- */
-        if (cp->hit_bkpt == 1)
+        if (cp->hit_bkpt == 1 && !pass)
             jzp_printf(fast_fwd ? "Fast forwarded to $%.4X\n" :
                                   "Hit breakpoint at $%.4X\n", pc);
         if (cp->hit_bkpt != 2)
@@ -969,14 +2129,27 @@ uint_32 debug_tk(periph_t *p, uint_32 len)
 
     /* -------------------------------------------------------------------- */
     /*  If we're in sync with the CPU, then grab the current PC and words   */
-    /*  at that location, disassemble and display.                          */
+    /*  at that location, disassemble and display.  GDB has its own view.   */
+    /*  While we're running with the trace showing, we only take a record,  */
+    /*  and leave the rest to the printer's thread.                         */
     /* -------------------------------------------------------------------- */
-    if (debug->show_ins || !debug->step_count || show_once /*|| !len*/)
+    if (debug_tpr && debug->show_ins && debug->step_count != 0 &&
+        !show_once && !(debug_gdb && gdb_attached(debug_gdb)))
+    {
+        uint_16 rec[RH_RECSIZE];
+
+        debug_fill_rec(rec, p, cp, intrq, now);
+        trace_pr_put(debug_tpr, rec);
+
+        if (debug->speed) speed_resync(debug->speed);
+    } else if ((debug->show_ins || !debug->step_count || show_once) &&
+               !(debug_gdb && gdb_attached(debug_gdb)))
     {
         const char *dis, *symb;
         int disasm_width;
 
         show_once = 0;
+        debug_tr_sync();
 
 show_disassem:
         disasm_width = get_disp_width() - (show_time ? 60 : 51);
@@ -1030,10 +2203,19 @@ show_disassem:
     /* -------------------------------------------------------------------- */
     if (debug->step_count == 0 /*|| !len*/)
     {
-        int cmd = 0, c, arg = -1, arg2 = -1;
-        char argstr[100], argstr2[100];
+        int cmd = 0, c, arg = -1, arg2 = -1, rev = REV_OFF;
+        char argstr[100], argstr2[100], *bk_cond = NULL;
+        int bk_ignore = -1;
         static int over = 0;
 
+        debug_tr_sync();
+
+        /* ---------------------------------------------------------------- */
+        /*  If GDB's connected, it drives instead of the prompt.            */
+        /* ---------------------------------------------------------------- */
+        if (debug_gdb && debug_gdb_serve(debug) == 0)
+            goto resume;
+
         wind = gfx_force_windowed(debug->gfx, 1);
 
 next_cmd:
@@ -1130,6 +2312,10 @@ next_cmd:
             if (c == '>') cmd = 30; /* Set window width */
             if (c == 'V') cmd = 31; /* Print source for vicinity */
             if (c == '#') cmd = 32; /* Breakpoint on screen blank */
+            if (c == 'J') cmd = 33; /* Jump back through rewind buffer */
+            if (c == 'I') cmd = 34; /* toggle call-graph profiling */
+            if (c == 'Y') cmd = 35; /* toggle instruction trace file */
+            if (c == '-') cmd = 36; /* step or run backwards */
 
             if (cmd == -1)
             {
@@ -1138,6 +2324,16 @@ next_cmd:
                 goto next_cmd;
             }
 
+            if (cmd == 5 && *s == '?')
+            {
+                debug_bk_list();
+                goto next_cmd;
+            }
+
+            if ((cmd == 5 || cmd == 12 || cmd == 17) &&
+                debug_bk_args(s, &bk_cond, &bk_ignore))
+                goto next_cmd;
+
             if (cmd == 1)
             {
                 if (sscanf(s, "%d", &arg) != 1) 
@@ -1218,7 +2414,7 @@ next_cmd:
                     arg = -2;
 
                 if (args != 2 || arg < 0x0000 || arg > 0xFFFF) arg = -2;
-            } else if (cmd == 27 || cmd == 30)
+            } else if (cmd == 27 || cmd == 30 || cmd == 33)
             {
                 if (sscanf(s, "%d", &arg) != 1) 
                     arg = 0;
@@ -1227,6 +2423,40 @@ next_cmd:
                 int args = sscanf(s, "%d %d", &arg, &arg2);
                 if (args != 2)              arg2 = 0;
                 if (args != 1 && args != 2) arg = 40;
+            } else if (cmd == 36)
+            {
+                c   = toupper(*s++);
+                rev = c == 'S' ? REV_STEP :
+                      c == 'R' ? REV_BKPT :
+                      c == 'W' ? REV_WRITE : REV_OFF;
+
+                if (rev == REV_OFF)
+                {
+                    jzp_printf("Did not understand command '%s'.  "
+                                "Type '?' for help\n", buf);
+                    goto next_cmd;
+                }
+
+                if (rev != REV_WRITE)
+                {
+                    if (sscanf(s, "%d", &arg) != 1)
+                        arg = 1;
+                } else
+                {
+                    int args = sscanf(s, "%100s %100s", argstr, argstr2);
+
+                    if (args >= 1) arg  = debug_decode_val(argstr,  0xFFFF);
+                    if (args >= 2) arg2 = debug_decode_val(argstr2, 0xFFFF);
+
+                    if ((args >= 1 && arg  == -1) ||
+                        (args >= 2 && arg2 == -1))
+                        goto next_cmd;
+
+                    if (args < 1)   { arg = 1; arg2 = 0; }
+                    if (args == 1)  arg2 = arg;
+                    if (args >= 1 && arg2 < arg)
+                        { int tmp = arg2; arg2 = arg; arg = tmp; }
+                }
             } else 
                 arg=0;
         } while (!cmd || arg < -1);
@@ -1255,7 +2485,7 @@ next_cmd:
                 debug->step_count = arg;
                 debug->show_ins   = cmd == 1;
                 debug->show_rd = debug->show_wr = cmd == 1 ? show_rdwr : 0;
-                if (debug_rh_ptr < 0)
+                if (!DEBUG_PER_INSTR())
                     cp->instr_tick_per = cmd == 1 ? 1 : arg > 0 ? arg : 0;
                     
                 break;
@@ -1270,7 +2500,7 @@ next_cmd:
                     debug->show_ins    = 0;
                     debug->show_rd     = 0;
                     debug->show_wr     = 0;
-                    if (debug_rh_ptr < 0)
+                    if (!DEBUG_PER_INSTR())
                         cp->instr_tick_per = 0;
                     ff_bkpt = cp1600_set_breakpt(cp, arg, CP1600_BKPT);
                 }
@@ -1282,19 +2512,28 @@ next_cmd:
                     debug_write_reghist("dump.hst", p, cp);
                 if (debug_memattr)
                     debug_write_memattr("dump.atr");
+                if (debug_heat)
+                    debug_heat_write("dump");
                 goto next_cmd;
                 break;
             case 4:
-                exit(0);
+                debug_exit();
                 break;
             case 5:
             case 10:
             {
                 int set = cmd == 5;
                 if (set)
+                {
+                    if (debug_bk_add(cp, BK_EXEC, arg, arg, bk_cond,
+                                     bk_ignore > 0 ? bk_ignore : 0))
+                        goto next_cmd;
                     cp1600_set_breakpt(cp, arg, CP1600_BKPT);
-                else
+                } else
+                {
                     cp1600_clr_breakpt(cp, arg, CP1600_BKPT);
+                    debug_bk_del(cp, arg);
+                }
                 jzp_printf("%s breakpoint at $%.4X\n", set ? "Set" : "Unset", arg);
                 goto next_cmd;
                 break;
@@ -1308,9 +2547,8 @@ next_cmd:
                 goto next_cmd;
                 break;
             case 8:
-                jzp_printf("dc hits: %6d  misses: %6d  nocache: %6d  "
-                       "unhook: %6d vs %6d\n", dc_hits, dc_miss, dc_nocache,
-                       dc_unhook_ok, dc_unhook_odd);
+                jzp_printf("dc hits: %6d  misses: %6d  nocache: %6d\n",
+                       dc_hits, dc_miss, dc_nocache);
                 goto next_cmd;
                 break;
             case 9:
@@ -1344,12 +2582,20 @@ next_cmd:
                                RH_RECSIZE*sizeof(uint_16)*HISTSIZE);
                         memset(debug_profile, 0, 0x10000 * sizeof(uint_32));
                     }
-                    cp->instr_tick_per = debug_rh_ptr ? 0 : 1;
+                    cp->instr_tick_per = DEBUG_PER_INSTR() ? 1 : 0;
                 }
                 jzp_flush();
                 goto next_cmd;
                 break;
             case 12:
+                if (bk_cond || bk_ignore >= 0)
+                {
+                    if (!debug_bk_add(cp, BK_WR, arg, arg2, bk_cond,
+                                      bk_ignore > 0 ? bk_ignore : 0))
+                        jzp_printf("Stopping on writes to $%.4X through "
+                                   "$%.4X\n", arg, arg2);
+                    goto next_cmd;
+                }
                 {
                     int i, watch;
 
@@ -1377,6 +2623,14 @@ next_cmd:
                 goto next_cmd;
                 break;
             case 17:
+                if (bk_cond || bk_ignore >= 0)
+                {
+                    if (!debug_bk_add(cp, BK_RD, arg, arg2, bk_cond,
+                                      bk_ignore > 0 ? bk_ignore : 0))
+                        jzp_printf("Stopping on reads of $%.4X through "
+                                   "$%.4X\n", arg, arg2);
+                    goto next_cmd;
+                }
                 {
                     int i, watch;
 
@@ -1573,12 +2827,123 @@ next_cmd:
                 debug_show_vicinity(arg, arg2);
                 goto next_cmd;
             }
+            case 33:
+            {
+                if (rewind_request(arg) < 0)
+                {
+                    jzp_printf("Rewind is off.  Use --rewind=<MB> to "
+                               "turn it on.\n");
+                    goto next_cmd;
+                }
+
+                if (arg <= 0)
+                    goto next_cmd;
+
+                /* -------------------------------------------------------- */
+                /*  We can't restore state from inside the CPU's tick.      */
+                /*  Run out this tick; the main loop steps back and then    */
+                /*  halts us right back here.                               */
+                /* -------------------------------------------------------- */
+                debug->step_over  = 0;
+                debug->step_count = -1;
+                debug->show_ins   = 0;
+                debug->show_rd    = 0;
+                debug->show_wr    = 0;
+                if (!DEBUG_PER_INSTR())
+                    cp->instr_tick_per = 0;
+                break;
+            }
+            case 34:
+            {
+                if (!debug_prof)
+                {
+                    const char *base = *s ? s : "prof";
+
+                    if ((debug_prof = prof_create(base, now,
+                                                  debug_prof_name)) != NULL)
+                    {
+                        prof_now = now;
+                        prof_pc  = pc;
+                        jzp_printf("Call-graph profiling is On.  Writing "
+                                   "'%s.frame'\n", base);
+                    } else
+                        jzp_printf("Couldn't start call-graph profiling\n");
+                } else
+                {
+                    jzp_printf("Call-graph profiling is Off.  Writing "
+                               "reports...  ");
+                    jzp_flush();
+                    jzp_printf(prof_destroy(debug_prof) ? "Failed.\n"
+                                                        : "Done.\n");
+                    debug_prof = NULL;
+                }
+                cp->instr_tick_per = DEBUG_PER_INSTR() ? 1 : 0;
+                jzp_flush();
+                goto next_cmd;
+            }
+            case 35:
+            {
+                if (!debug_trace)
+                {
+                    const char *fname = *s ? s : "dump.jzt";
+
+                    if ((debug_trace = trace_create(fname)) != NULL)
+                    {
+                        prev_tr_now = ~0ULL;
+                        debug_reqs  = 0;    /* Name them in the file too. */
+                        jzp_printf("Instruction trace is On.  Writing "
+                                   "'%s'\n", fname);
+                    } else
+                        jzp_printf("Couldn't start instruction trace\n");
+                } else
+                {
+                    jzp_printf("Instruction trace is Off.  Finishing "
+                               "file...  ");
+                    jzp_flush();
+                    jzp_printf(trace_destroy(debug_trace) ? "Failed.\n"
+                                                          : "Done.\n");
+                    debug_trace = NULL;
+                }
+                cp->instr_tick_per = DEBUG_PER_INSTR() ? 1 : 0;
+                jzp_flush();
+                goto next_cmd;
+            }
+            case 36:
+            {
+                if (debug_rev_start(debug, rev, rev == REV_WRITE ? 1 : arg,
+                                    arg, arg2, now))
+                    goto next_cmd;
+
+                /* -------------------------------------------------------- */
+                /*  Like 'j', run out this tick and let the main loop do    */
+                /*  the restore.  DEBUG_REV_TK takes over from there.       */
+                /* -------------------------------------------------------- */
+                debug->step_over  = 0;
+                debug->step_count = -1;
+                debug->show_ins   = 0;
+                debug->show_rd    = 0;
+                debug->show_wr    = 0;
+                if (!DEBUG_PER_INSTR())
+                    cp->instr_tick_per = 0;
+                break;
+            }
         }
 
+resume:
+        debug_tr_setup(debug, show_time);
         if (debug->speed) speed_resync(debug->speed);
         if (wind)         gfx_toggle_windowed(debug->gfx, 1);
+
+        debug_remap_due = 1;
     }
 
+    /* -------------------------------------------------------------------- */
+    /*  Before we go back to running, make sure we're on the bus wherever   */
+    /*  we now need to be, and only there.                                  */
+    /* -------------------------------------------------------------------- */
+    if (debug_remap_due)
+        debug_remap(debug);
+
     return len;
 }
 
@@ -1588,22 +2953,43 @@ next_cmd:
  * ============================================================================
  *  Instruction Disassembly Cache
  *
- *  This holds a cache of disassembled instructions.  The cache is maintained
- *  as an LRU list of entries.  We place an upper bound on the number of 
- *  entries just so we don't totally thrash through memory.
+ *  This holds disassembled instructions, direct mapped by address.  Each
+ *  entry remembers the words it was made from, and entries made from
+ *  memory also remember the CPU's change count for the page they're on.
+ *  The CPU bumps that count whenever it sees a write near the page, or
+ *  has the page invalidated (eg. on a bank switch or a restore).  While
+ *  the count holds, the entry is good without even reading the memory.
+ *  We only trust the count on pages the CPU caches decodes for, since
+ *  those are the only ones it hears about.  Elsewhere, and for the
+ *  register history, entries match by their words instead.
+ *
+ *  Changing the symbols or the label format changes the text of every
+ *  entry, so that bumps 'dc_epoch' to throw them all out at once.
  * ============================================================================
  */
-#define DISASM_CACHE (64)      /* Cache size. */
+#define DISASM_CACHE (1024)     /* Cache size.  Must be a power of 2.   */
+
+#define DC_EMPTY    (0)
+#define DC_WORDS    (1)         /* Matches by its words only.           */
+#define DC_MEM      (2)         /* ...or by the page's change count.    */
 
 typedef struct disasm_cache_t
 {
-    char                    disasm[64];
-    uint_32                 len;
-    struct disasm_cache_t   *next,*prev;
-    char                    **hook;
+    char        disasm[128];    /* Text, from DASM1600's 18th char on.  */
+    uint_32     gen;            /* Page change count it was made under. */
+    uint_32     epoch;          /* 'dc_epoch' it was made under.        */
+    uint_16     addr, w[3];     /* Where, and the words it came from.   */
+    uint_8      dbd, len;       /* SDBD in effect, and length in words. */
+    uint_8      valid;          /* DC_EMPTY, DC_WORDS or DC_MEM.        */
 } disasm_cache_t;
 
-disasm_cache_t *disasm_cache = NULL;
+LOCAL disasm_cache_t *disasm_cache = NULL;
+LOCAL uint_32 dc_epoch = 0;
+
+#define DC_SLOT(a)  (&disasm_cache[(a) & (DISASM_CACHE - 1)])
+#define DC_CACHEABLE(c,a) \
+    (1 & ((c)->cacheable[(a) >> (CP1600_DECODE_PAGE + 5)] >>  \
+                        (((a) >> CP1600_DECODE_PAGE) & 31)))
 
 /*
  * ============================================================================
@@ -1612,19 +2998,77 @@ disasm_cache_t *disasm_cache = NULL;
  */
 LOCAL void debug_disasm_cache_inval(void)
 {
-    disasm_cache_t *dc = disasm_cache;
+    dc_epoch++;
+}
 
-    /* -------------------------------------------------------------------- */
-    /*  Go through the entire disassembly cache and unhook all cached       */
-    /*  disassemblies.                                                      */
-    /* -------------------------------------------------------------------- */
-    do
+/*
+ * ============================================================================
+ *  DEBUG_DISASM_PUT  -- Disassemble an instruction and keep it in the cache.
+ *                       Returns the text, which stays in the cache unless
+ *                       it's too long to fit.
+ * ============================================================================
+ */
+LOCAL char *debug_disasm_put(uint_16 pc, int dbd, const uint_16 *w,
+                             uint_32 gen, int valid, uint_32 *len)
+{
+    static char buf[1024];
+    disasm_cache_t *dc;
+    int instr_len;
+
+    instr_len = dasm1600(buf, pc, dbd, w[0], w[1], w[2], debug_symtab);
+    dc_miss++;
+
+    if (len)
+        *len = instr_len;
+
+    if (!disasm_cache || strlen(buf + 17) >= sizeof(dc->disasm))
+    {
+        dc_nocache++;
+        return buf + 17;
+    }
+
+    dc = DC_SLOT(pc);
+    strcpy(dc->disasm, buf + 17);
+    dc->gen   = gen;
+    dc->epoch = dc_epoch;
+    dc->addr  = pc;
+    dc->w[0]  = w[0];
+    dc->w[1]  = w[1];
+    dc->w[2]  = w[2];
+    dc->dbd   = dbd;
+    dc->len   = instr_len;
+    dc->valid = valid;
+
+    return dc->disasm;
+}
+
+/*
+ * ============================================================================
+ *  DEBUG_DISASM_WORDS -- Disassembles one instruction from the words given
+ *                        rather than from memory.  Uses the cache if the
+ *                        words match.
+ * ============================================================================
+ */
+LOCAL char *debug_disasm_words(uint_16 pc, int dbd, const uint_16 *w)
+{
+    disasm_cache_t *dc;
+
+    dbd = !!dbd;
+
+    if (disasm_cache)
     {
-        if (dc->hook && *dc->hook == (char*)dc) /* Unhook it if we're hooked */
-            *dc->hook = NULL;
+        dc = DC_SLOT(pc);
+
+        if (dc->valid != DC_EMPTY && dc->addr == pc && dc->dbd == dbd &&
+            dc->epoch == dc_epoch && dc->w[0] == w[0] &&
+            dc->w[1] == w[1] && dc->w[2] == w[2])
+        {
+            dc_hits++;
+            return dc->disasm;
+        }
+    }
 
-        dc = dc->next;
-    } while (dc && dc != disasm_cache);
+    return debug_disasm_put(pc, dbd, w, 0, DC_WORDS, NULL);
 }
 
 /*
@@ -1638,9 +3082,10 @@ char * debug_disasm(periph_t *p, cp1600_t *cp, uint_16 addr,
                     uint_32 *len, int dbd)
 {
     static char buf[1024];
-    uint_16 w1, w2, w3, pc = addr;
-    disasm_cache_t *disasm = NULL;
-    int instr_len;
+    uint_16 w[3], w1, pc = addr, pc2 = addr + 2;
+    disasm_cache_t *dc;
+    uint_32 gen;
+    int i;
 
     /* -------------------------------------------------------------------- */
     /*  If memory attribute tracking is enabled and this looks like data,   */
@@ -1667,95 +3112,38 @@ char * debug_disasm(periph_t *p, cp1600_t *cp, uint_16 addr,
         return buf;
     }
 
-#if 1
+    dbd = !!dbd;
+    gen = cp->code_gen[pc >> CP1600_DECODE_PAGE];
+
     /* -------------------------------------------------------------------- */
-    /*  If we can't cache this disassembly, or if it's not disassembled     */
-    /*  yet, go do the disassembly.  Also force disassembly if DBD is set   */
-    /*  since we might have seen this instr before w/out DBD set.           */
+    /*  If the page hasn't changed since we disassembled this, we're done.  */
     /* -------------------------------------------------------------------- */
-    if (!cp->disasm[pc] || dbd)
+    if (disasm_cache)
     {
-        w1 = periph_read((periph_t*)p->bus, p, pc    , ~0);
-        w2 = periph_read((periph_t*)p->bus, p, pc + 1, ~0);
-        w3 = periph_read((periph_t*)p->bus, p, pc + 2, ~0);
+        dc = DC_SLOT(pc);
 
-        instr_len = dasm1600(buf, pc, dbd, w1, w2, w3, debug_symtab);
-
-        dc_miss++;
-        dc_hits--;            /* compensate for dc_hits++ in LRU update */
-
-        /* ------------------------------------------------------------ */
-        /*  If DBD is set, or if this instruction hasn't been decoded   */
-        /*  yet, don't cache this instruction.                          */
-        /* ------------------------------------------------------------ */
-        if (dbd || !cp->instr[pc])
+        if (dc->valid == DC_MEM && dc->addr == pc && dc->dbd == dbd &&
+            dc->gen == gen && dc->epoch == dc_epoch)
         {
-            if (len) *len = instr_len;
-            return buf + 17;
+            dc_hits++;
+            if (len) *len = dc->len;
+            return dc->disasm;
         }
-
-        /* ------------------------------------------------------------ */
-        /*  Allocate a new disassembly record by evicting the LRU.      */
-        /* ------------------------------------------------------------ */
-        disasm = disasm_cache->prev;        /* Tail of LRU list.        */
-
-        if (disasm->hook &&                 /* Is this already hooked?  */
-            *disasm->hook == (char*)disasm) /* Unhook it.               */
-        {
-            dc_unhook_ok++;
-            *disasm->hook = NULL;
-        } else
-            dc_unhook_odd++;
-
-        /* ------------------------------------------------------------ */
-        /*  Hook this disassembly to the instruction record.            */
-        /* ------------------------------------------------------------ */
-        disasm->hook   = &cp->disasm[pc];
-        cp->disasm[pc] = (char*) disasm;
-
-        strncpy(disasm->disasm, buf + 17, sizeof(disasm->disasm));
-        disasm->disasm[sizeof(disasm->disasm) - 1] = 0;
-        disasm->len = instr_len;
-    
     }
 
     /* -------------------------------------------------------------------- */
-    /*  Grab the cached disassembly and update the LRU.                     */
-    /* -------------------------------------------------------------------- */
-    dc_hits++;
-    disasm = (disasm_cache_t *)cp->disasm[pc];
-
-    /* -------------------------------------------------------------------- */
-    /*  Move this disasm record to head of the LRU.  Do this by first       */
-    /*  unhooking it from the doubly-linked list, and then reinserting      */
-    /*  it at the head of the doubly-linked list.                           */
+    /*  Otherwise read the words and go by those.  The instruction can      */
+    /*  run onto the next page, so both pages need to be cacheable for      */
+    /*  the change count to cover it.                                       */
     /* -------------------------------------------------------------------- */
-    disasm->next->prev = disasm->prev;      /* Unhook 'next'.           */
-    disasm->prev->next = disasm->next;      /* Unhook 'prev'.           */
+    for (i = 0; i < 3; i++)
+        w[i] = periph_read((periph_t*)p->bus, p, pc + i, ~0);
 
-    disasm->next = disasm_cache->next;      /* Hook us to new 'next'.   */
-    disasm->prev = disasm_cache;            /* Hook us to new 'prev'.   */
+    if (DC_CACHEABLE(cp, pc) && DC_CACHEABLE(cp, pc2))
+        return debug_disasm_put(pc, dbd, w, gen, DC_MEM, len);
 
-    disasm->next->prev = disasm;            /* Hook new 'next' to us.   */
-    disasm_cache->next = disasm;            /* Hook new 'prev' to us.   */
-
-
-    /* -------------------------------------------------------------------- */
-    /*  Returned cached disassembly.                                        */
-    /* -------------------------------------------------------------------- */
-    if (len) *len = disasm ? disasm->len : 0;
-    return disasm ? disasm->disasm : NULL;
-#else
-    w1 = periph_read((periph_t*)p->bus, p, pc    , ~0);
-    w2 = periph_read((periph_t*)p->bus, p, pc + 1, ~0);
-    w3 = periph_read((periph_t*)p->bus, p, pc + 2, ~0);
-
-    instr_len = dasm1600(buf, pc, cp->D, w1, w2, w3, debug_symtab);
-
-    if (len) *len = instr_len;
-
-    return buf + 17;
-#endif
+    dc_nocache++;
+    return debug_disasm_put(pc, dbd, w, 0, DC_WORDS, len);
 }
 
 /*
@@ -1916,7 +3304,7 @@ void debug_dispmem(periph_t *p, uint_16 addr, uint_16 len)
 LOCAL const char *debug_render_reghist(int ofs, int indent, int disp_width)
 {
     int idx, S, C, O, Z, I, D, intr, irq, nirq, disasm_width;
-    uint_16 pc, flags, r0, r1, r2, r3, r4, r5, r6, w1, w2, w3;
+    uint_16 pc, flags, r0, r1, r2, r3, r4, r5, r6, w1, w2, w3, w[3];
     char *dis, *rslt, *out;
     const char *symb, *src = NULL;
     static char buf[1024];
@@ -1962,10 +3350,13 @@ LOCAL const char *debug_render_reghist(int ofs, int indent, int disp_width)
     nirq = (debug_reghist[idx + 8 + RH_RECSIZE] >> 8) & 7;
 
     /* -------------------------------------------------------------------- */
-    /*  Directly decode exactly what is in memory now, rather than rely     */
-    /*  on the disassembly cache.                                           */
+    /*  Decode exactly the words that were in memory then.  The cache only  */
+    /*  answers for this if it holds those same words.                      */
     /* -------------------------------------------------------------------- */
-    dasm1600(buf, pc, D, w1, w2, w3, debug_symtab);
+    w[0] = w1;
+    w[1] = w2;
+    w[2] = w3;
+    strcpy(buf + 17, debug_disasm_words(pc, D, w));
     dis = buf + 39;
 
     if (nirq == 4 || nirq == 5) /* did this one get stomped? */
@@ -2197,7 +3588,12 @@ LOCAL void debug_dtor(periph_p p)
 
     UNUSED(debug);
 
-    dc_hits = dc_miss = dc_nocache = dc_unhook_ok = dc_unhook_odd = 0;
+    if (debug_tpr)
+        trace_pr_destroy(debug_tpr);
+    debug_tpr  = NULL;
+    debug_reqs = 0;
+
+    dc_hits = dc_miss = dc_nocache = 0;
 
     CONDFREE(disasm_cache );
     CONDFREE(debug_memattr);
@@ -2205,6 +3601,30 @@ LOCAL void debug_dtor(periph_p p)
     CONDFREE(debug_reghist);
     CONDFREE(debug_profile);
 
+    if (debug_prof)
+        prof_destroy(debug_prof);
+    debug_prof = NULL;
+
+    if (debug_trace)
+        trace_destroy(debug_trace);
+    debug_trace = NULL;
+
+    if (debug_gdb)
+        gdb_destroy(debug_gdb);
+    debug_gdb         = NULL;
+    debug_gdb_watches = 0;
+    debug_gdb_wait    = 0;
+    CONDFREE(debug_gdb_wp);
+
+    CONDFREE(debug_rev.hit);
+    debug_rev.mode = REV_OFF;
+    debug_rewound  = 0;
+
+    while (debug_bks > 0)
+        debug_bk_free(&debug_bk[--debug_bks]);
+    CONDFREE(debug_bk);
+    debug_bk_watches = 0;
+
     if (debug_symtab)
         symtab_destroy(debug_symtab);
 
@@ -2272,29 +3692,25 @@ int debug_init(debug_t *debug, cp1600_t *cp1600, speed_t *speed, gfx_t *gfx,
     /* -------------------------------------------------------------------- */
     cp1600_instr_tick(cp1600, debug_tk, (periph_p)debug);
 
+    /* -------------------------------------------------------------------- */
+    /*  Start the trace printer.  If we can't, we print as we go.           */
+    /* -------------------------------------------------------------------- */
+    trace_fmt_init(&debug_tfmt, NULL);
+    debug_tpr = trace_pr_create();
+
     /* -------------------------------------------------------------------- */
     /*  Set up the instruction disassembly cache.                           */
     /* -------------------------------------------------------------------- */
     if (!disasm_cache)
-    {
-        int i;
-
         disasm_cache = CALLOC(disasm_cache_t, DISASM_CACHE);
-        
-        for (i = 0; i < DISASM_CACHE-1; i++)
-        {
-            disasm_cache[i  ].next = &disasm_cache[i+1];
-            disasm_cache[i+1].prev = &disasm_cache[i  ];
-        }
-        disasm_cache[0].prev = &disasm_cache[DISASM_CACHE-1];
-        disasm_cache[DISASM_CACHE-1].next = &disasm_cache[0];
-    }
 
     /* -------------------------------------------------------------------- */
     /*  Clear watch array                                                   */
     /* -------------------------------------------------------------------- */
     memset(debug_watch_r, 0, sizeof(debug_watch_r));
     memset(debug_watch_w, 0, sizeof(debug_watch_w));
+    memset(debug_watch_gdb_r, 0, sizeof(debug_watch_gdb_r));
+    memset(debug_watch_gdb_w, 0, sizeof(debug_watch_gdb_w));
 
     /* -------------------------------------------------------------------- */
     /*  Read symbol table if requested to do so.                            */
@@ -2308,6 +3724,8 @@ int debug_init(debug_t *debug, cp1600_t *cp1600, speed_t *speed, gfx_t *gfx,
     if (script)
         debug_open_script(debug, script);
 
+    debug_tr_setup(debug, 1);
+
     return 0;
 }
 
@@ -91,6 +91,29 @@ int debug_init(debug_t *debug, cp1600_t *cp1600, speed_t *speed, gfx_t *gfx,
                const char *symtbl, uint_8 *vid_enable, uint_32 *stic_dbg_flags,
                const char *script);
 
+/*
+ * ============================================================================
+ *  DEBUG_GDB_START  -- Listen for GDB on 'port', and wait for it to connect
+ *                      the first time the debugger stops.  Returns -1 if
+ *                      the stub couldn't be started.
+ * ============================================================================
+ */
+int debug_gdb_start(int port);
+
+/*
+ * ============================================================================
+ *  DEBUG_HEAT_START     -- Count the CPU's executes, reads and writes at
+ *                          each address, for DEBUG_HEAT_FINISH to write to
+ *                          <base>.heat and <base>.cov.  Works whether or
+ *                          not the debugger's on.  'symtbl' names things
+ *                          in the coverage report, and may be NULL.
+ *                          Returns -1 on failure.
+ *  DEBUG_HEAT_FINISH    -- Write out the counts and stop counting.
+ * ============================================================================
+ */
+int  debug_heat_start(cp1600_t *cp, const char *base, const char *symtbl);
+void debug_heat_finish(void);
+
 #endif
 
 /* ======================================================================== */
@@ -21,5 +21,13 @@
 #define DEBUG_ASYNC_HALT (-1)
 extern        int  debug_fault_detected;
 extern const char *debug_halt_reason;
+extern        int  debug_rewound;       /* Set after a REWIND_TO restore.   */
+
+/* ======================================================================== */
+/*  DEBUG_TR_SYNC    -- Wait for the trace printer to catch up.  Call it    */
+/*                      before printing from outside the debugger, so the   */
+/*                      message lands after the trace that led up to it.    */
+/* ======================================================================== */
+void debug_tr_sync(void);
 
 #endif
@@ -0,0 +1,755 @@
+/*
+ * ============================================================================
+ *  Title:    GDB Remote Serial Protocol Stub
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See gdbstub.h.
+ *
+ *  The socket thread reads packets, checks and acknowledges them, and
+ *  passes each to the emulator through 'req'.  GDB_SERVE answers it in
+ *  'rsp' and the thread sends that on, unless the packet resumed the CPU.
+ *  Then the thread keeps reading, to catch an interrupt, and sends the
+ *  stop reply GDB_SERVE leaves in 'stop_rsp' the next time we stop.
+ *  Everything both sides touch is guarded by 'lock', except 'stop' and
+ *  'attached', which the emulator only peeks at.  The sockets and the
+ *  packet being read belong to the thread.
+ * ============================================================================
+ */
+
+#include "sdl.h"
+#include "config.h"
+#include "plat/plat_lib.h"
+#include "debug/gdbstub.h"
+
+#ifdef HAS_SOCKETS
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL (0)
+#endif
+
+#define GDB_PKT_MAX     (4096)  /* Longest packet, either way.              */
+#define GDB_POLL_MS     (5)     /* How often the thread looks around.       */
+
+struct gdb_t
+{
+    int          port;
+    int          lsock;             /* Listening socket.  Thread only.      */
+    int          csock;             /* The client, or -1.  Thread only.     */
+    int          noack;             /* Client turned off acks.  Ditto.      */
+    int          in_state, in_len;  /* Packet being read.  Ditto.           */
+    int          in_sum, in_chk;
+    char         in[GDB_PKT_MAX + 1];
+
+    char         req[GDB_PKT_MAX + 1];  /* Packet for the emulator.         */
+    char         rsp[GDB_PKT_MAX + 1];  /* ...and its answer.               */
+    int          req_ready;         /* 'req' waiting to be served.          */
+    int          rsp_ready;         /* 'rsp' is ready.                      */
+    int          resumed;           /* ...and the CPU is running again.     */
+    int          running;           /* Client owes a stop reply.            */
+    int          stop_pending;      /* 'stop_rsp' waiting to be sent.       */
+    char         stop_rsp[64];
+    char         last_stop[64];     /* Why we last stopped, for '?'.        */
+    int          watch_kind;        /* Watch that stopped us, or 0.         */
+    uint_32      watch_addr;
+
+    volatile int attached;          /* A client is connected.               */
+    volatile int events;            /* Connects and drops, in turn.         */
+    int          told;              /* ...and how many were reported.       */
+    volatile int stop;              /* Client wants us stopped.             */
+    volatile int quit;              /* Request for thread to exit.          */
+    SDL_mutex    *lock;
+    SDL_cond     *wake;             /* Signals any change of the above.     */
+    SDL_Thread   *thread;
+};
+
+/* ======================================================================== */
+/*  GDB_SEND_PKT     -- Frame and send a packet.  Thread only.  A failure   */
+/*                      shows up as a closed socket on the next read.       */
+/* ======================================================================== */
+LOCAL void gdb_send_pkt(gdb_t *gdb, const char *body)
+{
+    static char buf[GDB_PKT_MAX + 8];
+    uint_8 sum = 0;
+    int    len = 0, n;
+
+    buf[len++] = '$';
+    while (*body && len < GDB_PKT_MAX + 1)
+    {
+        sum += (uint_8)*body;
+        buf[len++] = *body++;
+    }
+    len += sprintf(buf + len, "#%.2x", sum);
+
+    for (n = 0; n < len; )
+    {
+        int sent = send(gdb->csock, buf + n, len - n, MSG_NOSIGNAL);
+        if (sent <= 0)
+            return;
+        n += sent;
+    }
+}
+
+/* ======================================================================== */
+/*  GDB_DROP         -- Let go of the client.  Thread only.                 */
+/* ======================================================================== */
+LOCAL void gdb_drop(gdb_t *gdb)
+{
+    if (gdb->csock < 0)
+        return;
+
+    close(gdb->csock);
+    gdb->csock = -1;
+
+    SDL_LockMutex(gdb->lock);
+    gdb->attached     = 0;
+    gdb->req_ready    = 0;
+    gdb->stop_pending = 0;
+    gdb->events++;
+    SDL_CondBroadcast(gdb->wake);
+    SDL_UnlockMutex(gdb->lock);
+}
+
+/* ======================================================================== */
+/*  GDB_ACCEPT       -- Wait a little while for a client.  Thread only.     */
+/* ======================================================================== */
+LOCAL void gdb_accept(gdb_t *gdb)
+{
+    struct timeval tv;
+    fd_set fds;
+    int    one = 1, s;
+
+    FD_ZERO(&fds);
+    FD_SET(gdb->lsock, &fds);
+    tv.tv_sec  = 0;
+    tv.tv_usec = 100000;
+
+    if (select(gdb->lsock + 1, &fds, NULL, NULL, &tv) <= 0 ||
+        (s = accept(gdb->lsock, NULL, NULL)) < 0)
+        return;
+
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char *)&one, sizeof(one));
+
+    gdb->csock    = s;
+    gdb->noack    = 0;
+    gdb->in_state = 0;
+
+    /* -------------------------------------------------------------------- */
+    /*  GDB expects to find the target stopped when it connects.            */
+    /* -------------------------------------------------------------------- */
+    SDL_LockMutex(gdb->lock);
+    gdb->running      = 0;
+    gdb->stop_pending = 0;
+    gdb->stop         = 1;
+    gdb->attached     = 1;
+    gdb->events++;
+    SDL_CondBroadcast(gdb->wake);
+    SDL_UnlockMutex(gdb->lock);
+}
+
+/* ======================================================================== */
+/*  GDB_PACKET       -- Handle a whole packet.  Thread only.                */
+/* ======================================================================== */
+LOCAL void gdb_packet(gdb_t *gdb, int sum_ok)
+{
+    int reply;
+
+    if (!sum_ok)
+    {
+        send(gdb->csock, "-", 1, MSG_NOSIGNAL);
+        return;
+    }
+    if (!gdb->noack)
+        send(gdb->csock, "+", 1, MSG_NOSIGNAL);
+
+    if (!strcmp(gdb->in, "QStartNoAckMode"))
+    {
+        gdb_send_pkt(gdb, "OK");
+        gdb->noack = 1;
+        return;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Everything else goes to the emulator, which answers it as soon as   */
+    /*  it's stopped.  In all-stop mode, GDB doesn't send anything but an   */
+    /*  interrupt while we're running, so this doesn't wait long.           */
+    /* -------------------------------------------------------------------- */
+    SDL_LockMutex(gdb->lock);
+    strcpy(gdb->req, gdb->in);
+    gdb->req_ready = 1;
+    gdb->rsp_ready = 0;
+    SDL_CondBroadcast(gdb->wake);
+    while (!gdb->rsp_ready && gdb->attached && !gdb->quit)
+        SDL_CondWait(gdb->wake, gdb->lock);
+    reply = gdb->rsp_ready && (!gdb->resumed || gdb->rsp[0]);
+    SDL_UnlockMutex(gdb->lock);
+
+    /* 'rsp' stays put until we hand over another packet. */
+    if (reply)
+        gdb_send_pkt(gdb, gdb->rsp);
+}
+
+/* ======================================================================== */
+/*  GDB_BYTE         -- Take one byte from the client.  Thread only.        */
+/* ======================================================================== */
+LOCAL void gdb_byte(gdb_t *gdb, int c)
+{
+    switch (gdb->in_state)
+    {
+        case 0:                             /* Between packets.             */
+            if (c == '$')
+            {
+                gdb->in_state = 1;
+                gdb->in_len   = 0;
+                gdb->in_sum   = 0;
+                gdb->in_chk   = 0;
+            } else if (c == 0x03)
+            {
+                gdb->stop = 1;
+            }
+            break;                          /* Acks are ignored.            */
+
+        case 1:                             /* In the packet.               */
+            if (c == '#')
+            {
+                gdb->in[gdb->in_len] = 0;
+                gdb->in_state = 2;
+                break;
+            }
+            gdb->in_sum += c;
+            if (gdb->in_len < GDB_PKT_MAX)
+                gdb->in[gdb->in_len++] = c;
+            break;
+
+        case 2:                             /* First checksum digit.        */
+        case 3:                             /* And the second.              */
+            gdb->in_chk = gdb->in_chk << 4 |
+                          (!isxdigit(c) ? 0x100 :
+                           c <= '9'     ? c - '0' : (c | 0x20) - 'a' + 10);
+            if (gdb->in_state++ == 3)
+            {
+                gdb->in_state = 0;
+                gdb_packet(gdb, gdb->in_chk == (gdb->in_sum & 0xFF) &&
+                                gdb->in_len < GDB_PKT_MAX);
+            }
+            break;
+    }
+}
+
+/* ======================================================================== */
+/*  GDB_THREAD       -- Look after the socket until told to quit.           */
+/* ======================================================================== */
+LOCAL int gdb_thread(void *opaque)
+{
+    gdb_t *gdb = (gdb_t *)opaque;
+    char   buf[512], stop_rsp[64];
+
+    while (!gdb->quit)
+    {
+        struct timeval tv;
+        fd_set fds;
+        int    running, stopped, n, i;
+
+        if (gdb->csock < 0)
+        {
+            gdb_accept(gdb);
+            continue;
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  While the CPU runs, wait on the emulator rather than on the     */
+        /*  socket, so a stop reply goes out the moment it's ready.  We     */
+        /*  still look at the socket between waits, for interrupts.         */
+        /* ---------------------------------------------------------------- */
+        SDL_LockMutex(gdb->lock);
+        if (gdb->running && !gdb->stop_pending)
+            SDL_CondWaitTimeout(gdb->wake, gdb->lock, GDB_POLL_MS);
+        if ((stopped = gdb->stop_pending) != 0)
+            strcpy(stop_rsp, gdb->stop_rsp);
+        gdb->stop_pending = 0;
+        running = gdb->running;
+        SDL_UnlockMutex(gdb->lock);
+
+        if (stopped)
+            gdb_send_pkt(gdb, stop_rsp);
+
+        FD_ZERO(&fds);
+        FD_SET(gdb->csock, &fds);
+        tv.tv_sec  = 0;
+        tv.tv_usec = running ? 0 : GDB_POLL_MS * 1000;
+
+        if (select(gdb->csock + 1, &fds, NULL, NULL, &tv) <= 0)
+            continue;
+
+        if ((n = recv(gdb->csock, buf, sizeof(buf), 0)) <= 0)
+        {
+            gdb_drop(gdb);
+            continue;
+        }
+
+        for (i = 0; i < n && gdb->csock >= 0; i++)
+            gdb_byte(gdb, (uint_8)buf[i]);
+    }
+
+    gdb_drop(gdb);
+    return 0;
+}
+
+/* ======================================================================== */
+/*  GDB_CREATE       -- Start listening for GDB.                            */
+/* ======================================================================== */
+gdb_t *gdb_create(int port)
+{
+    gdb_t *gdb = CALLOC(gdb_t, 1);
+    struct sockaddr_in sa;
+    int    one = 1;
+
+    if (!gdb)
+        goto fail;
+
+    gdb->port  = port;
+    gdb->lsock = -1;
+    gdb->csock = -1;
+    gdb->lock  = SDL_CreateMutex();
+    gdb->wake  = SDL_CreateCond();
+    strcpy(gdb->last_stop, "S05");
+
+    if (!gdb->lock || !gdb->wake)
+        goto fail;
+
+    if ((gdb->lsock = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    {
+        perror("socket()");
+        goto fail;
+    }
+
+    setsockopt(gdb->lsock, SOL_SOCKET, SO_REUSEADDR, (char *)&one,
+               sizeof(one));
+
+    /* -------------------------------------------------------------------- */
+    /*  Only listen on the loopback address.  There's no authentication,    */
+    /*  and a client can poke at anything.                                  */
+    /* -------------------------------------------------------------------- */
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family      = AF_INET;
+    sa.sin_port        = htons(port);
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(gdb->lsock, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+    {
+        perror("bind()");
+        goto fail;
+    }
+    if (listen(gdb->lsock, 1) < 0)
+    {
+        perror("listen()");
+        goto fail;
+    }
+
+    if (!(gdb->thread = SDL_CreateThread(gdb_thread, (void *)gdb)))
+        goto fail;
+
+    jzp_printf("gdb:  Listening for GDB on 127.0.0.1:%d\n", port);
+    return gdb;
+
+fail:
+    fprintf(stderr, "gdb:  Could not listen on port %d\n", port);
+    if (gdb)
+    {
+        if (gdb->lsock >= 0) close(gdb->lsock);
+        if (gdb->wake)      SDL_DestroyCond(gdb->wake);
+        if (gdb->lock)      SDL_DestroyMutex(gdb->lock);
+        free(gdb);
+    }
+    return NULL;
+}
+
+/* ======================================================================== */
+/*  GDB_DESTROY      -- Drop any client, stop listening, and free the stub. */
+/* ======================================================================== */
+void gdb_destroy(gdb_t *gdb)
+{
+    SDL_LockMutex(gdb->lock);
+    gdb->quit = 1;
+    SDL_CondBroadcast(gdb->wake);
+    SDL_UnlockMutex(gdb->lock);
+
+    SDL_WaitThread(gdb->thread, NULL);
+
+    close(gdb->lsock);
+    SDL_DestroyCond(gdb->wake);
+    SDL_DestroyMutex(gdb->lock);
+    free(gdb);
+}
+
+/* ======================================================================== */
+/*  GDB_ATTACHED     -- Nonzero if a client is connected.                   */
+/*  GDB_STOP_WANTED  -- Nonzero if the client wants us stopped.             */
+/* ======================================================================== */
+int gdb_attached(const gdb_t *gdb)
+{
+    return gdb->attached;
+}
+
+int gdb_stop_wanted(const gdb_t *gdb)
+{
+    return gdb->stop;
+}
+
+/* ======================================================================== */
+/*  GDB_WATCH_HIT    -- Note the watch that stopped us.                     */
+/* ======================================================================== */
+void gdb_watch_hit(gdb_t *gdb, int kind, uint_32 addr)
+{
+    gdb->watch_kind = kind;
+    gdb->watch_addr = addr;
+}
+
+/* ======================================================================== */
+/*  GDB_NEWS         -- Has a client come or gone since the last report?    */
+/*  GDB_REPORT       -- Say which clients came and went.  There's only one  */
+/*                      client at a time, so the events alternate, and the  */
+/*                      first one is always a connect.                      */
+/* ======================================================================== */
+int gdb_news(const gdb_t *gdb)
+{
+    return gdb->events != gdb->told;
+}
+
+void gdb_report(gdb_t *gdb)
+{
+    int events = gdb->events;
+
+    for (; gdb->told != events; gdb->told++)
+        jzp_printf(gdb->told & 1 ? "gdb:  Client disconnected.\n"
+                                 : "gdb:  Client connected.\n");
+    jzp_flush();
+}
+
+/* ======================================================================== */
+/*  GDB_HEX          -- Read a hex number, and move past it.                */
+/* ======================================================================== */
+LOCAL uint_32 gdb_hex(const char **s, int max_digits)
+{
+    uint_32 v = 0;
+    int     c;
+
+    while (max_digits-- > 0 && isxdigit(c = (uint_8)**s))
+    {
+        v = v << 4 | (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+        (*s)++;
+    }
+
+    return v;
+}
+
+/* ======================================================================== */
+/*  GDB_HANDLE       -- Answer the packet in 'req' into 'rsp'.  Returns     */
+/*                      GDB_STEP, GDB_CONT, GDB_DETACH or GDB_KILL if it    */
+/*                      resumes the CPU, else -1.                           */
+/* ======================================================================== */
+LOCAL int gdb_handle(gdb_t *gdb, const gdb_target_t *tgt)
+{
+    const char *s = gdb->req + 1;
+    char       *r = gdb->rsp;
+    uint_32    addr, len, i;
+    int        type;
+
+    r[0] = 0;
+
+    switch (gdb->req[0])
+    {
+        case '?':
+            strcpy(r, gdb->last_stop);
+            break;
+
+        case 'g':
+            for (i = 0; i < GDB_NUM_REGS; i++)
+                r += sprintf(r, "%.4x", tgt->get_reg(tgt->opaque, i) & 0xFFFF);
+            break;
+
+        case 'G':
+            if (strlen(s) < GDB_NUM_REGS * 4)
+            {
+                strcpy(r, "E01");
+                break;
+            }
+            for (i = 0; i < GDB_NUM_REGS; i++)
+                tgt->set_reg(tgt->opaque, i, gdb_hex(&s, 4));
+            strcpy(r, "OK");
+            break;
+
+        case 'p':
+            if ((i = gdb_hex(&s, 8)) >= GDB_NUM_REGS)
+                strcpy(r, "E01");
+            else
+                sprintf(r, "%.4x", tgt->get_reg(tgt->opaque, i) & 0xFFFF);
+            break;
+
+        case 'P':
+            i = gdb_hex(&s, 8);
+            if (i >= GDB_NUM_REGS || *s++ != '=')
+            {
+                strcpy(r, "E01");
+                break;
+            }
+            tgt->set_reg(tgt->opaque, i, gdb_hex(&s, 4));
+            strcpy(r, "OK");
+            break;
+
+        case 'm':
+            addr = gdb_hex(&s, 8);
+            len  = *s++ == ',' ? gdb_hex(&s, 8) : 0;
+            if (len > GDB_PKT_MAX / 4)
+                len = GDB_PKT_MAX / 4;          /* Short reads are allowed. */
+            for (i = 0; i < len; i++)
+                r += sprintf(r, "%.4x",
+                             tgt->peek(tgt->opaque, (addr + i) & 0xFFFF)
+                                & 0xFFFF);
+            if (!len)
+                strcpy(r, "E01");
+            break;
+
+        case 'M':
+            addr = gdb_hex(&s, 8);
+            len  = *s++ == ',' ? gdb_hex(&s, 8) : 0;
+            if (*s++ != ':' || strlen(s) != len * 4)
+            {
+                strcpy(r, "E01");
+                break;
+            }
+            for (i = 0; i < len; i++)
+                tgt->poke(tgt->opaque, (addr + i) & 0xFFFF, gdb_hex(&s, 4));
+            strcpy(r, "OK");
+            break;
+
+        case 'c':
+        case 's':
+            if (*s)
+                tgt->set_reg(tgt->opaque, 7, gdb_hex(&s, 8));
+            return gdb->req[0] == 's' ? GDB_STEP : GDB_CONT;
+
+        case 'v':
+            if (!strcmp(s, "Cont?"))
+                strcpy(r, "vCont;c;s");
+            else if (!strncmp(s, "Cont;", 5))
+                return s[5] == 's' ? GDB_STEP : GDB_CONT;
+            break;
+
+        case 'Z':
+        case 'z':
+            type = gdb_hex(&s, 1);
+            addr = *s++ == ',' ? gdb_hex(&s, 8) : ~0U;
+            len  = *s++ == ',' ? gdb_hex(&s, 8) : 0;
+            if (type > GDB_WATCH_ACC)
+                break;
+            if (addr > 0xFFFF)
+            {
+                strcpy(r, "E01");
+                break;
+            }
+
+            /* ------------------------------------------------------------ */
+            /*  A breakpoint's "kind" doesn't mean anything to us.  For a   */
+            /*  watch, it's the length in words.                            */
+            /* ------------------------------------------------------------ */
+            if (type < GDB_WATCH_WR || len == 0)
+                len = 1;
+            if (addr + len - 1 > 0xFFFF)
+                len = 0x10000 - addr;
+
+            strcpy(r, tgt->bkpt(tgt->opaque, type, addr, addr + len - 1,
+                                gdb->req[0] == 'Z') ? "E01" : "OK");
+            break;
+
+        case 'k':
+            return GDB_KILL;
+
+        case 'D':
+            strcpy(r, "OK");
+            return GDB_DETACH;
+
+        case 'H':
+        case 'T':
+            strcpy(r, "OK");
+            break;
+
+        case 'q':
+            if (!strncmp(s, "Supported", 9))
+                sprintf(r, "PacketSize=%x;QStartNoAckMode+", GDB_PKT_MAX);
+            else if (!strcmp(s, "Attached"))
+                strcpy(r, "1");
+            else if (!strcmp(s, "C"))
+                strcpy(r, "QC1");
+            else if (!strcmp(s, "fThreadInfo"))
+                strcpy(r, "m1");
+            else if (!strcmp(s, "sThreadInfo"))
+                strcpy(r, "l");
+            break;
+    }
+
+    return -1;
+}
+
+/* ======================================================================== */
+/*  GDB_SERVE        -- Serve the client until it resumes the CPU.          */
+/* ======================================================================== */
+int gdb_serve(gdb_t *gdb, const gdb_target_t *tgt, int wait)
+{
+    int act;
+
+    SDL_LockMutex(gdb->lock);
+
+    if (!gdb->attached && wait)
+    {
+        jzp_printf("gdb:  Waiting for GDB to connect on port %d...\n",
+                   gdb->port);
+        jzp_flush();
+        while (!gdb->attached && !gdb->quit)
+            SDL_CondWait(gdb->wake, gdb->lock);
+    }
+
+    gdb_report(gdb);
+
+    if (!gdb->attached)
+    {
+        gdb->watch_kind = 0;
+        SDL_UnlockMutex(gdb->lock);
+        return GDB_GONE;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Work out why we stopped.  If the client resumed us, it's waiting    */
+    /*  to hear; otherwise it'll ask with '?'.                              */
+    /* -------------------------------------------------------------------- */
+    if (gdb->watch_kind)
+        sprintf(gdb->last_stop, "T05%s:%x;",
+                gdb->watch_kind == GDB_WATCH_WR ? "watch"  :
+                gdb->watch_kind == GDB_WATCH_RD ? "rwatch" : "awatch",
+                gdb->watch_addr);
+    else
+        strcpy(gdb->last_stop, gdb->stop ? "S02" : "S05");
+
+    gdb->watch_kind = 0;
+    gdb->stop       = 0;
+
+    if (gdb->running)
+    {
+        strcpy(gdb->stop_rsp, gdb->last_stop);
+        gdb->stop_pending = 1;
+        gdb->running      = 0;
+        SDL_CondBroadcast(gdb->wake);
+    }
+
+    for (;;)
+    {
+        while (!gdb->req_ready && gdb->attached && !gdb->quit)
+            SDL_CondWait(gdb->wake, gdb->lock);
+
+        if (!gdb->attached || gdb->quit)
+        {
+            SDL_UnlockMutex(gdb->lock);
+            return GDB_GONE;
+        }
+
+        gdb->req_ready = 0;
+        SDL_UnlockMutex(gdb->lock);
+
+        act = gdb_handle(gdb, tgt);
+
+        SDL_LockMutex(gdb->lock);
+        gdb->resumed   = act >= 0;
+        gdb->running   = act == GDB_STEP || act == GDB_CONT;
+        gdb->rsp_ready = 1;
+        SDL_CondBroadcast(gdb->wake);
+
+        if (act >= 0)
+            break;
+    }
+
+    SDL_UnlockMutex(gdb->lock);
+    return act;
+}
+
+#else /* !HAS_SOCKETS */
+
+struct gdb_t
+{
+    int unused;
+};
+
+gdb_t *gdb_create(int port)
+{
+    UNUSED(port);
+    fprintf(stderr, "gdb:  The GDB stub isn't supported on this platform.\n");
+    return NULL;
+}
+
+void gdb_destroy(gdb_t *gdb)
+{
+    UNUSED(gdb);
+}
+
+int gdb_attached(const gdb_t *gdb)
+{
+    UNUSED(gdb);
+    return 0;
+}
+
+int gdb_stop_wanted(const gdb_t *gdb)
+{
+    UNUSED(gdb);
+    return 0;
+}
+
+void gdb_watch_hit(gdb_t *gdb, int kind, uint_32 addr)
+{
+    UNUSED(gdb);
+    UNUSED(kind);
+    UNUSED(addr);
+}
+
+int gdb_news(const gdb_t *gdb)
+{
+    UNUSED(gdb);
+    return 0;
+}
+
+void gdb_report(gdb_t *gdb)
+{
+    UNUSED(gdb);
+}
+
+int gdb_serve(gdb_t *gdb, const gdb_target_t *tgt, int wait)
+{
+    UNUSED(gdb);
+    UNUSED(tgt);
+    UNUSED(wait);
+    return GDB_GONE;
+}
+
+#endif /* HAS_SOCKETS */
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,138 @@
+/*
+ * ============================================================================
+ *  Title:    GDB Remote Serial Protocol Stub
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Lets GDB, or anything else that speaks its remote protocol, drive the
+ *  debugger over a TCP connection on the local machine.  One client may
+ *  be connected at a time.
+ *
+ *  The CP-1600 isn't byte addressed, so neither is the stub.  Addresses
+ *  are word addresses, lengths in 'm' and 'M' count words, and each word
+ *  goes over the wire as four hex digits, most significant first.  The
+ *  registers are the same:  R0 through R7, then the status flags, packed
+ *  as S, Z, O and C in bits 7 - 4 as GSWD would, with I in bit 1 and the
+ *  SDBD state in bit 0.
+ *
+ *  Z0 and Z1 set CPU breakpoints.  Z2, Z3 and Z4 set write, read and
+ *  access watches, the same ones the 'w' and '@' commands toggle.
+ *
+ *  A background thread owns the socket.  It only ever hands over a packet
+ *  while the emulator is stopped in GDB_SERVE, so the emulator never
+ *  waits on the network while it's running.  While running, the only
+ *  thing it need do is look at GDB_STOP_WANTED now and then, to catch
+ *  GDB's interrupt.
+ *
+ *  GDB_CREATE       -- Start listening for GDB.
+ *  GDB_DESTROY      -- Drop any client, stop listening, and free the stub.
+ *  GDB_ATTACHED     -- Is a client connected?
+ *  GDB_STOP_WANTED  -- Has the client asked us to stop?
+ *  GDB_WATCH_HIT    -- Note that a watch stopped us.
+ *  GDB_NEWS         -- Has a client come or gone since the last report?
+ *  GDB_REPORT       -- Say which clients came and went.
+ *  GDB_SERVE        -- Serve the client until it resumes the CPU.
+ * ============================================================================
+ */
+#ifndef GDBSTUB_H_
+#define GDBSTUB_H_
+
+#define GDB_NUM_REGS    (9)     /* R0 - R7, then the flags.                 */
+#define GDB_REG_FLAGS   (8)
+
+/* What GDB_SERVE says the client wants. */
+#define GDB_STEP        (0)     /* Run one instruction.                     */
+#define GDB_CONT        (1)     /* Run until something stops us.            */
+#define GDB_DETACH      (2)     /* Run free; the client is going away.      */
+#define GDB_KILL        (3)     /* Quit.                                    */
+#define GDB_GONE        (4)     /* There's no client.                       */
+
+/* Kinds of watch, numbered as in the Z packets. */
+#define GDB_WATCH_WR    (2)
+#define GDB_WATCH_RD    (3)
+#define GDB_WATCH_ACC   (4)
+
+/* ------------------------------------------------------------------------ */
+/*  GDB_TARGET_T     -- What the stub works on.  GDB_SERVE calls these on   */
+/*                      the emulator's thread, with the CPU stopped.        */
+/*                                                                          */
+/*  BKPT sets ('set' != 0) or clears a breakpoint or watch of the given     */
+/*  Z packet type on 'lo' through 'hi', and returns -1 if it can't.         */
+/* ------------------------------------------------------------------------ */
+typedef struct gdb_target_t
+{
+    void    *opaque;
+    uint_32 (*get_reg)(void *opaque, int reg);
+    void    (*set_reg)(void *opaque, int reg, uint_32 val);
+    uint_32 (*peek)   (void *opaque, uint_32 addr);
+    void    (*poke)   (void *opaque, uint_32 addr, uint_32 val);
+    int     (*bkpt)   (void *opaque, int type, uint_32 lo, uint_32 hi,
+                       int set);
+} gdb_target_t;
+
+typedef struct gdb_t gdb_t;
+
+/* ======================================================================== */
+/*  GDB_CREATE       -- Listen for GDB on 127.0.0.1:'port'.  Returns NULL   */
+/*                      on failure, or where there are no sockets.          */
+/* ======================================================================== */
+gdb_t *gdb_create(int port);
+
+/* ======================================================================== */
+/*  GDB_DESTROY      -- Drop any client, stop listening, and free the stub. */
+/* ======================================================================== */
+void gdb_destroy(gdb_t *gdb);
+
+/* ======================================================================== */
+/*  GDB_ATTACHED     -- Nonzero if a client is connected.                   */
+/* ======================================================================== */
+int gdb_attached(const gdb_t *gdb);
+
+/* ======================================================================== */
+/*  GDB_STOP_WANTED  -- Nonzero if a client has sent an interrupt, or has   */
+/*                      just connected.  Cheap enough to call every tick.   */
+/* ======================================================================== */
+int gdb_stop_wanted(const gdb_t *gdb);
+
+/* ======================================================================== */
+/*  GDB_WATCH_HIT    -- Note that a watch of the given kind fired at        */
+/*                      'addr', so the next stop reply can say so.          */
+/* ======================================================================== */
+void gdb_watch_hit(gdb_t *gdb, int kind, uint_32 addr);
+
+/* ======================================================================== */
+/*  GDB_NEWS         -- Nonzero if a client has connected or dropped since  */
+/*                      the last GDB_REPORT.  Cheap enough for every tick.  */
+/*  GDB_REPORT       -- Print those comings and goings.  The thread only    */
+/*                      counts them, so that the emulator can print them    */
+/*                      where they won't cut into other output.             */
+/* ======================================================================== */
+int  gdb_news  (const gdb_t *gdb);
+void gdb_report(gdb_t *gdb);
+
+/* ======================================================================== */
+/*  GDB_SERVE        -- Tell the client we've stopped, and answer its       */
+/*                      packets until it resumes us.  If no client is       */
+/*                      connected, wait for one if 'wait' is set, else      */
+/*                      return GDB_GONE.  Returns one of GDB_STEP,          */
+/*                      GDB_CONT, GDB_DETACH, GDB_KILL or GDB_GONE.         */
+/* ======================================================================== */
+int gdb_serve(gdb_t *gdb, const gdb_target_t *tgt, int wait);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,300 @@
+/*
+ * ============================================================================
+ *  Title:    Memory Heatmap and Code Coverage
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See heat.h.
+ * ============================================================================
+ */
+
+#include "config.h"
+#include "periph/periph.h"
+#include "cp1600/cp1600.h"
+#include "lzoe/lzoe.h"
+#include "file/file.h"
+#include "debug/source.h"
+#include "debug/heat.h"
+#include "asm/typetags.h"
+
+#define HEAT_MAGIC      "jzIntvHM"
+#define HEAT_HDR_LEN    (16)
+#define HEAT_PAGE       (12)        /* Page size without a source map, log2 */
+
+struct heat_t
+{
+    cp1600_t    *cp;        /* CPU we're counting.                          */
+    periph_bus_p bus;       /* Bus it's on.                                 */
+    uint_32     *exec;      /* Execute counts.                              */
+    uint_32     *rd;        /* Read counts.                                 */
+    uint_32     *wr;        /* Write counts.                                */
+};
+
+/* ======================================================================== */
+/*  HEAT_CREATE      -- Start counting.                                     */
+/* ======================================================================== */
+heat_t *heat_create(cp1600_t *cp)
+{
+    heat_t *heat = CALLOC(heat_t, 1);
+
+    if (!heat || !(heat->exec = CALLOC(uint_32, 3 * HEAT_WORDS)))
+    {
+        fprintf(stderr, "heat:  Out of memory\n");
+        CONDFREE(heat);
+        return NULL;
+    }
+
+    heat->cp  = cp;
+    heat->bus = (periph_bus_p)cp->periph.bus;
+    heat->rd  = heat->exec + HEAT_WORDS;
+    heat->wr  = heat->rd   + HEAT_WORDS;
+
+    cp->exec_cnt      = heat->exec;
+    heat->bus->rd_cnt  = heat->rd;
+    heat->bus->wr_cnt  = heat->wr;
+    heat->bus->cnt_req = (periph_p)cp;
+
+    return heat;
+}
+
+/* ======================================================================== */
+/*  HEAT_CLEAR       -- Zero the counts.                                    */
+/* ======================================================================== */
+void heat_clear(heat_t *heat)
+{
+    memset(heat->exec, 0, 3 * HEAT_WORDS * sizeof(uint_32));
+}
+
+/* ======================================================================== */
+/*  HEAT_WRITE_MAP   -- Write the heatmap.                                  */
+/* ======================================================================== */
+int heat_write_map(const heat_t *heat, const char *fname)
+{
+    uint_8  buf[4 * 1024];
+    FILE    *f;
+    int     i, j, ok;
+
+    if (!(f = fopen(fname, "wb")))
+    {
+        fprintf(stderr, "heat:  Could not open '%s'\n", fname);
+        return -1;
+    }
+
+    memcpy(buf, HEAT_MAGIC, 8);
+    for (j = 0; j < 4; j++)
+    {
+        buf[ 8 + j] = (HEAT_VERSION >> (8 * j)) & 0xFF;
+        buf[12 + j] = (HEAT_WORDS   >> (8 * j)) & 0xFF;
+    }
+    ok = fwrite(buf, 1, HEAT_HDR_LEN, f) == HEAT_HDR_LEN;
+
+    /* -------------------------------------------------------------------- */
+    /*  The three tables are contiguous, so write them out as one.          */
+    /* -------------------------------------------------------------------- */
+    for (i = 0; ok && i < 3 * HEAT_WORDS; i += sizeof(buf) / 4)
+    {
+        for (j = 0; j < (int)sizeof(buf) / 4; j++)
+        {
+            uint_32 v = heat->exec[i + j];
+
+            buf[4*j + 0] = v;
+            buf[4*j + 1] = v >> 8;
+            buf[4*j + 2] = v >> 16;
+            buf[4*j + 3] = v >> 24;
+        }
+        ok = fwrite(buf, 1, sizeof(buf), f) == sizeof(buf);
+    }
+
+    if (fclose(f) || !ok)
+    {
+        fprintf(stderr, "heat:  Error writing '%s'\n", fname);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  HEAT_STMT_RAN    -- Did any address of the statement at 'first' run?    */
+/*                      Sets 'next' to the address just past it.            */
+/* ======================================================================== */
+LOCAL int heat_stmt_ran(const heat_t *heat, uint_32 first, uint_32 *next)
+{
+    uint_32 addr = first, start;
+    int     ran  = 0;
+
+    do
+    {
+        ran |= heat->exec[addr] != 0;
+        addr++;
+    } while (addr < HEAT_WORDS && source_stmt_for_addr(addr, &start) &&
+             start == first);
+
+    *next = addr;
+    return ran;
+}
+
+/* ======================================================================== */
+/*  HEAT_SEG_NAME    -- Name a segment after its first address, and the     */
+/*                      file it starts in.                                  */
+/* ======================================================================== */
+LOCAL void heat_seg_name(FILE *f, uint_32 addr, heat_name_t name)
+{
+    char buf[32];
+    int  file, line;
+
+    fprintf(f, "  %s", name(addr, buf));
+
+    if ((file = file_line_for_addr(addr, &line)) >= 0)
+        fprintf(f, " (%s)", source_file[file].name);
+
+    fputc('\n', f);
+}
+
+/* ======================================================================== */
+/*  HEAT_COV_PAGES   -- Without a source map, count the addresses that ran  */
+/*                      in each 4K page.                                    */
+/* ======================================================================== */
+LOCAL void heat_cov_pages(const heat_t *heat, FILE *f)
+{
+    uint_32 page, addr, ran;
+
+    fprintf(f, "No source map; counting addresses that ran, by page.\n\n"
+               "    Range          Ran\n");
+
+    for (page = 0; page < HEAT_WORDS; page += 1 << HEAT_PAGE)
+    {
+        for (addr = page, ran = 0; addr < page + (1 << HEAT_PAGE); addr++)
+            ran += heat->exec[addr] != 0;
+
+        if (ran)
+            fprintf(f, "    $%.4X-$%.4X %6u\n",
+                    page, page + (1 << HEAT_PAGE) - 1, ran);
+    }
+}
+
+/* ======================================================================== */
+/*  HEAT_WRITE_COV   -- Write the coverage report.                          */
+/* ======================================================================== */
+int heat_write_cov(const heat_t *heat, const char *fname, heat_name_t name)
+{
+    uint_32 addr, next, first, seg = 0, run = 0, tot = 0;
+    uint_32 all_run = 0, all_tot = 0;
+    int     type, in_seg = 0, file, line, pass;
+    const char *src;
+    FILE    *f;
+
+    if (!(f = fopen(fname, "w")))
+    {
+        fprintf(stderr, "heat:  Could not open '%s'\n", fname);
+        return -1;
+    }
+
+    if (!source_files)
+    {
+        heat_cov_pages(heat, f);
+        goto done;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Pass 0 totals up each segment; pass 1 lists what never ran.         */
+    /* -------------------------------------------------------------------- */
+    fprintf(f, "Code statements run, by ROM segment:\n\n"
+               "    Range          Run  Total       %%\n");
+
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (addr = 0; addr <= HEAT_WORDS; addr = next)
+        {
+            next = addr + 1;
+            type = addr < HEAT_WORDS ? source_stmt_for_addr(addr, &first) : 0;
+
+            if (pass == 0 && in_seg && !type)
+            {
+                fprintf(f, "    $%.4X-$%.4X %6u %6u  %5.1f%%",
+                        seg, addr - 1, run, tot,
+                        tot ? 100.0 * run / tot : 100.0);
+                heat_seg_name(f, seg, name);
+                all_run += run;
+                all_tot += tot;
+                in_seg = 0;
+            }
+
+            if (!type)
+                continue;
+
+            if (!in_seg)
+            {
+                seg    = addr;
+                run    = tot = 0;
+                in_seg = 1;
+            }
+
+            if (!(type & TYPE_CODE))
+                continue;
+
+            if (heat_stmt_ran(heat, first, &next))
+            {
+                run++;
+            } else if (pass == 1)
+            {
+                file = file_line_for_addr(first, &line);
+                src  = source_for_addr(first);
+                fprintf(f, "    $%.4X  %s:%d  %s\n", first,
+                        file >= 0 ? source_file[file].name : "?", line + 1,
+                        src ? src : "");
+            }
+            tot++;
+        }
+
+        if (pass == 0)
+            fprintf(f, "\n    Overall     %6u %6u  %5.1f%%\n\n"
+                       "Code statements never run:\n\n",
+                    all_run, all_tot,
+                    all_tot ? 100.0 * all_run / all_tot : 100.0);
+        in_seg = 0;
+    }
+
+done:
+    if (fclose(f))
+    {
+        fprintf(stderr, "heat:  Error writing '%s'\n", fname);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  HEAT_DESTROY     -- Stop counting.                                      */
+/* ======================================================================== */
+void heat_destroy(heat_t *heat)
+{
+    if (!heat)
+        return;
+
+    heat->cp->exec_cnt = NULL;
+    heat->bus->rd_cnt  = NULL;
+    heat->bus->wr_cnt  = NULL;
+    heat->bus->cnt_req = NULL;
+
+    free(heat->exec);
+    free(heat);
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
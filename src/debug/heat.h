@@ -0,0 +1,100 @@
+/*
+ * ============================================================================
+ *  Title:    Memory Heatmap and Code Coverage
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Counts how many times the CPU executes, reads and writes each address,
+ *  and writes the counts out as a heatmap, or as a code coverage report
+ *  against the source map.
+ *
+ *  The counting is done where the accesses already happen, so it costs
+ *  an increment apiece and doesn't need the debugger in the loop:  the
+ *  CPU bumps the execute count as it dispatches each instruction, and
+ *  the bus bumps the read and write counts as it decodes each access the
+ *  CPU makes.  Other bus masters, such as the STIC's DMA, aren't counted.
+ *  The read counts include the fetches the CPU makes when it decodes an
+ *  instruction, which it only does the first time through most code.
+ *
+ *  The heatmap is a binary file:
+ *
+ *      Bytes  0 -  7   "jzIntvHM"
+ *      Bytes  8 - 11   Version, currently 1.
+ *      Bytes 12 - 15   Words of address space, currently 65536.
+ *      Then            The execute, read and write counts, one table
+ *                      after the other, each a 32-bit count per address.
+ *
+ *  All numbers are little endian.
+ *
+ *  The coverage report goes a source statement at a time, a statement
+ *  being the run of addresses the source map ties to one line.  Each run
+ *  of mapped addresses is a ROM segment, and for each the report gives
+ *  how many of its code statements ran.  Then it lists every statement
+ *  that never ran.  Without a source map, it just counts the addresses
+ *  that ran in each 4K page.
+ *
+ *  HEAT_CREATE      -- Start counting.
+ *  HEAT_CLEAR       -- Zero the counts.
+ *  HEAT_WRITE_MAP   -- Write the heatmap.
+ *  HEAT_WRITE_COV   -- Write the coverage report.
+ *  HEAT_DESTROY     -- Stop counting.
+ * ============================================================================
+ */
+#ifndef HEAT_H_
+#define HEAT_H_
+
+#define HEAT_VERSION    (1)
+#define HEAT_WORDS      (65536)
+
+typedef struct heat_t heat_t;
+
+/* ======================================================================== */
+/*  HEAT_NAME_T      -- Names the address 'addr'.  May use 'buf', which     */
+/*                      holds at least 32 characters.                       */
+/* ======================================================================== */
+typedef const char *(*heat_name_t)(uint_32 addr, char *buf);
+
+/* ======================================================================== */
+/*  HEAT_CREATE      -- Start counting the accesses 'cp' makes.  Returns    */
+/*                      NULL on failure.                                    */
+/* ======================================================================== */
+heat_t *heat_create(cp1600_t *cp);
+
+/* ======================================================================== */
+/*  HEAT_CLEAR       -- Zero the counts.                                    */
+/* ======================================================================== */
+void heat_clear(heat_t *heat);
+
+/* ======================================================================== */
+/*  HEAT_WRITE_MAP   -- Write the heatmap to 'fname'.  Returns -1 on error. */
+/* ======================================================================== */
+int heat_write_map(const heat_t *heat, const char *fname);
+
+/* ======================================================================== */
+/*  HEAT_WRITE_COV   -- Write the coverage report to 'fname', using 'name'  */
+/*                      to name the segments.  Returns -1 on error.         */
+/* ======================================================================== */
+int heat_write_cov(const heat_t *heat, const char *fname, heat_name_t name);
+
+/* ======================================================================== */
+/*  HEAT_DESTROY     -- Stop counting and free the counts.                  */
+/* ======================================================================== */
+void heat_destroy(heat_t *heat);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
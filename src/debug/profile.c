@@ -0,0 +1,571 @@
+/*
+ * ============================================================================
+ *  Title:    Call-Graph Profiler
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See profile.h.
+ *
+ *  The call paths form a tree rooted at "[top]", one node per path, so a
+ *  function called from three places has three nodes.  Each node keeps
+ *  only its exclusive cycles; inclusive counts are summed up from the
+ *  tree when reporting.  A function that recurses is only counted once
+ *  toward its own inclusive time.
+ *
+ *  Nodes that ran during the current frame are chained together so the
+ *  frame report only looks at those.
+ * ============================================================================
+ */
+
+#include "config.h"
+#include "debug/profile.h"
+
+#define PROF_MAX_DEPTH  (64)        /* Deepest call stack we follow.        */
+#define PROF_RET_WINDOW (3)         /* How far past its JSR a call returns. */
+#define PROF_FRAME_TOP  (10)        /* Functions listed for each frame.     */
+
+#define PROF_FN_INTR    (0x10000)   /* "Function" for interrupts.           */
+#define PROF_FN_ROOT    (0x10001)   /* "Function" for the top level.        */
+#define PROF_FN_MAX     (0x10002)
+
+typedef struct prof_node_t
+{
+    uint_32     func;       /* Entry address, or PROF_FN_INTR / _ROOT.      */
+    int         parent;     /* Caller's node, or -1 for the root.           */
+    int         child;      /* First callee's node, or -1.                  */
+    int         sibling;    /* Next callee of our caller, or -1.            */
+    uint_32     calls;      /* Times this path was called.                  */
+    uint_64     excl;       /* Cycles spent here, not in callees.           */
+    uint_64     frm_excl;   /* ...during the current frame.                 */
+    int         frm_next;   /* Next node that ran this frame, or -1.        */
+} prof_node_t;
+
+typedef struct prof_stk_t
+{
+    int         node;       /* This call's node.                            */
+    uint_32     ret;        /* Where we expect it to return.                */
+    uint_32     sp;         /* R6 when it was called.                       */
+    int         intr;       /* It's an interrupt.  Returns exactly to ret.  */
+} prof_stk_t;
+
+typedef struct prof_fn_t
+{
+    uint_32     func;
+    uint_32     calls;
+    uint_64     incl;
+    uint_64     excl;
+} prof_fn_t;
+
+struct prof_t
+{
+    char        *base;      /* Report file names start with this.           */
+    prof_name_t name;       /* Names functions for the reports.             */
+    uint_64     now;        /* Time of the last step.                       */
+
+    prof_node_t *node;      /* Call tree.  node[0] is the root.             */
+    int         nodes;
+    int         max_nodes;
+
+    prof_stk_t  stk[PROF_MAX_DEPTH];    /* Shadow call stack.  stk[0] is    */
+    int         depth;                  /* the root, and never returns.     */
+    uint_32     lost;       /* Calls too deep to follow.                    */
+
+    FILE        *frm_f;     /* Frame by frame report.                       */
+    uint_32     frame;      /* Frame number.                                */
+    uint_64     frm_cyc;    /* Cycles so far this frame.                    */
+    int         frm_list;   /* First node that ran this frame, or -1.       */
+
+    int         *fn_idx;    /* Function to slot in fn[], or -1.             */
+    prof_fn_t   *fn;        /* Per-function totals, while reporting.        */
+    int         fns;
+};
+
+/* ======================================================================== */
+/*  PROF_FN_NAME     -- Name a function for the reports.                    */
+/* ======================================================================== */
+LOCAL const char *prof_fn_name(const prof_t *prof, uint_32 func, char *buf)
+{
+    if (func == PROF_FN_ROOT) return "[top]";
+    if (func == PROF_FN_INTR) return "[interrupt]";
+
+    return prof->name(func, buf);
+}
+
+/* ======================================================================== */
+/*  PROF_FN          -- Find or add a function's slot in the totals table.  */
+/*  PROF_FN_CLEAR    -- Empty the totals table.                             */
+/*  PROF_FN_CMP      -- Sort busiest first.                                 */
+/* ======================================================================== */
+LOCAL prof_fn_t *prof_fn(prof_t *prof, uint_32 func)
+{
+    int i = prof->fn_idx[func];
+
+    if (i < 0)
+    {
+        i = prof->fn_idx[func] = prof->fns++;
+        memset(&prof->fn[i], 0, sizeof(prof_fn_t));
+        prof->fn[i].func = func;
+    }
+
+    return &prof->fn[i];
+}
+
+LOCAL void prof_fn_clear(prof_t *prof)
+{
+    int i;
+
+    for (i = 0; i < prof->fns; i++)
+        prof->fn_idx[prof->fn[i].func] = -1;
+
+    prof->fns = 0;
+}
+
+LOCAL int prof_fn_cmp(const void *a, const void *b)
+{
+    const prof_fn_t *fa = (const prof_fn_t *)a;
+    const prof_fn_t *fb = (const prof_fn_t *)b;
+
+    if (fa->incl != fb->incl) return fa->incl < fb->incl ? 1 : -1;
+    if (fa->excl != fb->excl) return fa->excl < fb->excl ? 1 : -1;
+
+    return fa->func < fb->func ? -1 : fa->func > fb->func;
+}
+
+/* ======================================================================== */
+/*  PROF_CHILD       -- Find or add the node for 'func' called from node    */
+/*                      'parent'.  Returns -1 if we're out of memory.       */
+/* ======================================================================== */
+LOCAL int prof_child(prof_t *prof, int parent, uint_32 func)
+{
+    prof_node_t *node;
+    prof_fn_t   *fn;
+    int n;
+
+    for (n = prof->node[parent].child; n >= 0; n = prof->node[n].sibling)
+        if (prof->node[n].func == func)
+            return n;
+
+    /* -------------------------------------------------------------------- */
+    /*  There can't be more functions than nodes, so fn[] grows with them.  */
+    /* -------------------------------------------------------------------- */
+    if (prof->nodes == prof->max_nodes)
+    {
+        if (!(node = REALLOC(prof->node, prof_node_t, prof->max_nodes * 2)))
+            return -1;
+        prof->node = node;
+
+        if (!(fn = REALLOC(prof->fn, prof_fn_t, prof->max_nodes * 2)))
+            return -1;
+        prof->fn = fn;
+
+        prof->max_nodes *= 2;
+    }
+
+    n    = prof->nodes++;
+    node = &prof->node[n];
+
+    memset(node, 0, sizeof(prof_node_t));
+    node->func     = func;
+    node->parent   = parent;
+    node->child    = -1;
+    node->sibling  = prof->node[parent].child;
+    node->frm_next = -1;
+
+    prof->node[parent].child = n;
+
+    return n;
+}
+
+/* ======================================================================== */
+/*  PROF_PUSH        -- Follow a call onto the shadow stack.                */
+/* ======================================================================== */
+LOCAL void prof_push(prof_t *prof, uint_32 func, uint_32 ret, uint_32 sp,
+                     int intr)
+{
+    prof_stk_t *s;
+    int parent = intr ? 0 : prof->stk[prof->depth - 1].node;
+    int n;
+
+    if (prof->depth == PROF_MAX_DEPTH ||
+        (n = prof_child(prof, parent, func)) < 0)
+    {
+        prof->lost++;
+        return;
+    }
+
+    prof->node[n].calls++;
+
+    s = &prof->stk[prof->depth++];
+    s->node = n;
+    s->ret  = ret & 0xFFFF;
+    s->sp   = sp;
+    s->intr = intr;
+}
+
+/* ======================================================================== */
+/*  PROF_FRAME_END   -- Write out the frame that just finished, and start   */
+/*                      the next.                                           */
+/* ======================================================================== */
+LOCAL void prof_frame_end(prof_t *prof)
+{
+    uint_32 seen[PROF_MAX_DEPTH];
+    char buf[32];
+    int n, a, i, j, n_seen;
+
+    if (!prof->frm_cyc)
+        return;
+
+    /* -------------------------------------------------------------------- */
+    /*  Each node's time counts toward every function on its call path,     */
+    /*  but only once toward a function that appears on it twice.         */
+    /* -------------------------------------------------------------------- */
+    for (n = prof->frm_list; n >= 0; n = prof->node[n].frm_next)
+    {
+        uint_64 cyc = prof->node[n].frm_excl;
+
+        prof_fn(prof, prof->node[n].func)->excl += cyc;
+
+        for (a = n, n_seen = 0; a >= 0; a = prof->node[a].parent)
+        {
+            uint_32 func = prof->node[a].func;
+
+            for (j = 0; j < n_seen && seen[j] != func; j++)
+                ;
+
+            if (j < n_seen)
+                continue;
+
+            seen[n_seen++] = func;
+            prof_fn(prof, func)->incl += cyc;
+        }
+    }
+
+    qsort(prof->fn, prof->fns, sizeof(prof_fn_t), prof_fn_cmp);
+
+    fprintf(prof->frm_f, "Frame %u:  %llu cycles\n",
+            prof->frame, prof->frm_cyc);
+
+    for (i = 0; i < prof->fns && i < PROF_FRAME_TOP; i++)
+        fprintf(prof->frm_f, "    %8llu %5.1f%%  %8llu %5.1f%%  %s\n",
+                prof->fn[i].incl, 100.0 * prof->fn[i].incl / prof->frm_cyc,
+                prof->fn[i].excl, 100.0 * prof->fn[i].excl / prof->frm_cyc,
+                prof_fn_name(prof, prof->fn[i].func, buf));
+
+    fputc('\n', prof->frm_f);
+
+    /* -------------------------------------------------------------------- */
+    /*  Start the next frame with a clean slate.                            */
+    /* -------------------------------------------------------------------- */
+    for (n = prof->frm_list; n >= 0; n = a)
+    {
+        a = prof->node[n].frm_next;
+        prof->node[n].frm_excl = 0;
+        prof->node[n].frm_next = -1;
+    }
+
+    prof_fn_clear(prof);
+    prof->frm_list = -1;
+    prof->frm_cyc  = 0;
+    prof->frame++;
+}
+
+/* ======================================================================== */
+/*  PROF_CREATE      -- Start profiling.                                    */
+/* ======================================================================== */
+prof_t *prof_create(const char *base, uint_64 now, prof_name_t name)
+{
+    prof_t *prof = CALLOC(prof_t, 1);
+    char   *fname = NULL;
+    int     i;
+
+    if (!prof)
+        goto fail;
+
+    prof->base      = strdup(base);
+    prof->name      = name;
+    prof->now       = now;
+    prof->max_nodes = 256;
+    prof->node      = CALLOC(prof_node_t, prof->max_nodes);
+    prof->fn        = CALLOC(prof_fn_t,   prof->max_nodes);
+    prof->fn_idx    = CALLOC(int,         PROF_FN_MAX);
+    fname           = CALLOC(char,        strlen(base) + 8);
+
+    if (!prof->base || !prof->node || !prof->fn || !prof->fn_idx || !fname)
+        goto fail;
+
+    sprintf(fname, "%s.frame", base);
+    if (!(prof->frm_f = fopen(fname, "w")))
+    {
+        fprintf(stderr, "Could not open profile file '%s'\n", fname);
+        goto fail;
+    }
+
+    for (i = 0; i < PROF_FN_MAX; i++)
+        prof->fn_idx[i] = -1;
+
+    /* -------------------------------------------------------------------- */
+    /*  The root stands for whatever was running when we started, and for   */
+    /*  anything that runs after returning out of it.                       */
+    /* -------------------------------------------------------------------- */
+    prof->nodes            = 1;
+    prof->node[0].func     = PROF_FN_ROOT;
+    prof->node[0].parent   = -1;
+    prof->node[0].child    = -1;
+    prof->node[0].sibling  = -1;
+    prof->node[0].frm_next = -1;
+    prof->stk[0].node      = 0;
+    prof->depth            = 1;
+    prof->frm_list         = -1;
+
+    free(fname);
+    return prof;
+
+fail:
+    if (prof)
+    {
+        CONDFREE(prof->base);
+        CONDFREE(prof->node);
+        CONDFREE(prof->fn);
+        CONDFREE(prof->fn_idx);
+        free(prof);
+    }
+    CONDFREE(fname);
+    return NULL;
+}
+
+/* ======================================================================== */
+/*  PROF_STEP        -- Account for one step of the CPU.                    */
+/* ======================================================================== */
+void prof_step(prof_t *prof, uint_64 now, uint_32 pc, uint_32 sp,
+               int event, uint_32 ret)
+{
+    int i;
+
+    /* -------------------------------------------------------------------- */
+    /*  Charge the time since the last step to whatever was running.  Time  */
+    /*  can go backwards if the debugger rewinds; just pick up from there.  */
+    /* -------------------------------------------------------------------- */
+    if (now > prof->now)
+    {
+        int          n    = prof->stk[prof->depth - 1].node;
+        prof_node_t *node = &prof->node[n];
+        uint_64      cyc  = now - prof->now;
+
+        if (!node->frm_excl)
+        {
+            node->frm_next = prof->frm_list;
+            prof->frm_list = n;
+        }
+
+        node->excl     += cyc;
+        node->frm_excl += cyc;
+        prof->frm_cyc  += cyc;
+    }
+    prof->now = now;
+
+    if (event == PROF_INTR)
+    {
+        prof_frame_end(prof);
+        prof_push(prof, PROF_FN_INTR, ret, sp, 1);
+        return;
+    }
+
+    if (event == PROF_CALL)
+    {
+        prof_push(prof, pc, ret, sp, 0);
+        return;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Did we just return from something?  Look deeper than the top, in    */
+    /*  case a routine unwound more than one call at once.                  */
+    /* -------------------------------------------------------------------- */
+    for (i = prof->depth - 1; i > 0; i--)
+    {
+        const prof_stk_t *s = &prof->stk[i];
+        uint_32 ofs = (pc - s->ret) & 0xFFFF;
+
+        if (sp <= s->sp && ofs <= (s->intr ? 0 : PROF_RET_WINDOW))
+        {
+            prof->depth = i;
+            return;
+        }
+    }
+}
+
+/* ======================================================================== */
+/*  PROF_READ        -- Note a read that might be data after a JSR.         */
+/* ======================================================================== */
+int prof_read(prof_t *prof, uint_32 addr)
+{
+    int i;
+
+    for (i = prof->depth - 1; i > 0; i--)
+    {
+        prof_stk_t *s = &prof->stk[i];
+
+        if (!s->intr && ((addr - s->ret) & 0xFFFF) <= PROF_RET_WINDOW)
+        {
+            s->ret = (addr + 1) & 0xFFFF;
+            return s->ret;
+        }
+    }
+
+    return -1;
+}
+
+/* ======================================================================== */
+/*  PROF_RET_ADDR    -- Expected return addresses on the shadow stack.      */
+/* ======================================================================== */
+int prof_ret_addr(const prof_t *prof, int i)
+{
+    return i >= 0 && i + 1 < prof->depth ? (int)prof->stk[i + 1].ret : -1;
+}
+
+/* ======================================================================== */
+/*  PROF_TOTAL       -- Add up the tree under node 'n' into the function    */
+/*                      totals.  Returns the node's inclusive cycles.       */
+/*                      'on_path' counts each function on the current path. */
+/* ======================================================================== */
+LOCAL uint_64 prof_total(prof_t *prof, int n, uint_8 *on_path)
+{
+    const prof_node_t *node = &prof->node[n];
+    prof_fn_t *fn;
+    uint_64 incl = node->excl;
+    int c;
+
+    on_path[node->func]++;
+    for (c = node->child; c >= 0; c = prof->node[c].sibling)
+        incl += prof_total(prof, c, on_path);
+    on_path[node->func]--;
+
+    fn = prof_fn(prof, node->func);
+    fn->excl  += node->excl;
+    fn->calls += node->calls;
+    if (!on_path[node->func])
+        fn->incl += incl;
+
+    return incl;
+}
+
+/* ======================================================================== */
+/*  PROF_FOLD        -- Write the collapsed stacks under node 'n'.  'path'  */
+/*                      holds the stack down to the caller, 'len' chars.    */
+/* ======================================================================== */
+LOCAL void prof_fold(const prof_t *prof, FILE *f, int n, char *path, int len)
+{
+    const prof_node_t *node = &prof->node[n];
+    char buf[32];
+    int c;
+
+    len += sprintf(path + len, "%s%.63s", len ? ";" : "",
+                   prof_fn_name(prof, node->func, buf));
+
+    if (node->excl)
+        fprintf(f, "%s %llu\n", path, node->excl);
+
+    for (c = node->child; c >= 0; c = prof->node[c].sibling)
+        prof_fold(prof, f, c, path, len);
+}
+
+/* ======================================================================== */
+/*  PROF_OPEN        -- Open the report file with extension 'ext'.          */
+/* ======================================================================== */
+LOCAL FILE *prof_open(const prof_t *prof, const char *ext)
+{
+    char *fname = CALLOC(char, strlen(prof->base) + strlen(ext) + 1);
+    FILE *f     = NULL;
+
+    if (fname)
+    {
+        sprintf(fname, "%s%s", prof->base, ext);
+        if (!(f = fopen(fname, "w")))
+            fprintf(stderr, "Could not open profile file '%s'\n", fname);
+        free(fname);
+    }
+
+    return f;
+}
+
+/* ======================================================================== */
+/*  PROF_DESTROY     -- Write the reports and stop profiling.               */
+/* ======================================================================== */
+int prof_destroy(prof_t *prof)
+{
+    char    path[PROF_MAX_DEPTH * 64 + 1], buf[32];
+    uint_8  *on_path;
+    uint_64 total;
+    FILE    *f;
+    int     i, ret = 0;
+
+    if (!prof)
+        return 0;
+
+    prof_frame_end(prof);
+    fclose(prof->frm_f);
+
+    /* -------------------------------------------------------------------- */
+    /*  Collapsed stacks, for flame graphs.                                 */
+    /* -------------------------------------------------------------------- */
+    if ((f = prof_open(prof, ".fold")) != NULL)
+    {
+        prof_fold(prof, f, 0, path, 0);
+        ret |= fclose(f) ? -1 : 0;
+    } else
+        ret = -1;
+
+    /* -------------------------------------------------------------------- */
+    /*  Per-function totals.                                                */
+    /* -------------------------------------------------------------------- */
+    if ((on_path = CALLOC(uint_8, PROF_FN_MAX)) != NULL &&
+        (f = prof_open(prof, ".func")) != NULL)
+    {
+        total = prof_total(prof, 0, on_path);
+        qsort(prof->fn, prof->fns, sizeof(prof_fn_t), prof_fn_cmp);
+
+        fprintf(f, "%llu cycles over %u frames\n", total, prof->frame);
+        if (prof->lost)
+            fprintf(f, "%u calls nested too deeply to follow\n", prof->lost);
+
+        fprintf(f, "\n   Inclusive            Exclusive            Calls  "
+                   "Function\n");
+
+        for (i = 0; i < prof->fns; i++)
+            fprintf(f, "%12llu %6.2f%%  %12llu %6.2f%%  %9u  %s\n",
+                    prof->fn[i].incl,
+                    total ? 100.0 * prof->fn[i].incl / total : 0.0,
+                    prof->fn[i].excl,
+                    total ? 100.0 * prof->fn[i].excl / total : 0.0,
+                    prof->fn[i].calls,
+                    prof_fn_name(prof, prof->fn[i].func, buf));
+
+        ret |= fclose(f) ? -1 : 0;
+    } else
+        ret = -1;
+
+    CONDFREE(on_path);
+    free(prof->fn_idx);
+    free(prof->fn);
+    free(prof->node);
+    free(prof->base);
+    free(prof);
+
+    return ret;
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,105 @@
+/*
+ * ============================================================================
+ *  Title:    Call-Graph Profiler
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Attributes every CPU cycle to the function that spent it, and to the
+ *  chain of calls that led there.  The debugger feeds this one step at a
+ *  time, telling it about each JSR and interrupt as it happens.  From
+ *  that it keeps a shadow call stack, and a tree of every call path seen
+ *  with the cycles spent in each.
+ *
+ *  Returns are spotted by the PC landing just past the JSR that made the
+ *  call, with the stack pointer back where it was.  Routines that take
+ *  data after the JSR return further along; the debugger reports their
+ *  reads of that data to PROF_READ, which moves the expected return
+ *  address past it.  An interrupt is treated as a call to "[interrupt]"
+ *  from the top level, whatever it interrupted.  Code outside of any
+ *  call we saw is charged to "[top]".
+ *
+ *  Each interrupt also starts a new video frame, as the STIC interrupts
+ *  at vertical blank.  Three files are written:
+ *
+ *      <base>.fold     Collapsed call stacks with the cycles spent in
+ *                      each, one per line, for flame-graph tools.
+ *      <base>.func     Inclusive and exclusive cycles and call counts
+ *                      for each function over the whole run.
+ *      <base>.frame    The same, frame by frame, busiest functions first.
+ *                      This is written as the frames go by.
+ *
+ *  PROF_CREATE      -- Start profiling.
+ *  PROF_STEP        -- Account for one step of the CPU.
+ *  PROF_READ        -- Note a read that might be data after a JSR.
+ *  PROF_RET_ADDR    -- Expected return addresses on the shadow stack.
+ *  PROF_DESTROY     -- Write the reports and stop profiling.
+ * ============================================================================
+ */
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#define PROF_NONE   (0)         /* Step is an ordinary instruction.         */
+#define PROF_CALL   (1)         /* Step was a JSR to 'pc'.                  */
+#define PROF_INTR   (2)         /* Step was an interrupt.                   */
+
+typedef struct prof_t prof_t;
+
+/* ======================================================================== */
+/*  PROF_NAME_T      -- Names the function at 'addr'.  May use 'buf', which */
+/*                      holds at least 32 characters.                       */
+/* ======================================================================== */
+typedef const char *(*prof_name_t)(uint_32 addr, char *buf);
+
+/* ======================================================================== */
+/*  PROF_CREATE      -- Start profiling at time 'now'.  Reports go to files */
+/*                      named after 'base'.  Returns NULL on failure.       */
+/* ======================================================================== */
+prof_t *prof_create(const char *base, uint_64 now, prof_name_t name);
+
+/* ======================================================================== */
+/*  PROF_STEP        -- The CPU has moved on to 'now'.  Charge the time to  */
+/*                      whatever was running, then follow the call, the     */
+/*                      interrupt or the return that brought us to 'pc'.    */
+/*                      For calls and interrupts, 'ret' is where we expect  */
+/*                      to come back to.  'sp' is the CPU's R6.             */
+/* ======================================================================== */
+void prof_step(prof_t *prof, uint_64 now, uint_32 pc, uint_32 sp,
+               int event, uint_32 ret);
+
+/* ======================================================================== */
+/*  PROF_READ        -- The CPU read 'addr'.  If that's right after a JSR   */
+/*                      on the shadow stack, the call returns past it.      */
+/*                      Returns the new return address, or -1.              */
+/* ======================================================================== */
+int prof_read(prof_t *prof, uint_32 addr);
+
+/* ======================================================================== */
+/*  PROF_RET_ADDR    -- Return address of the 'i'th call on the shadow      */
+/*                      stack, or -1 past the end.  The debugger uses this  */
+/*                      to decide which reads to send us.                   */
+/* ======================================================================== */
+int prof_ret_addr(const prof_t *prof, int i);
+
+/* ======================================================================== */
+/*  PROF_DESTROY     -- Write the reports and free everything.  Returns -1  */
+/*                      if any report couldn't be written.                  */
+/* ======================================================================== */
+int prof_destroy(prof_t *prof);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -331,3 +331,32 @@ const char *source_for_file_line(int file, int line)
 
     return &source_file[file].text->body[source_file[file].text->line[line]];
 }
+
+/* ======================================================================== */
+/*  SOURCE_STMT_FOR_ADDR -- Find the first address of the statement that    */
+/*                          covers this address.  Returns the statement's   */
+/*                          TYPE_xxx flags, or 0 if the map doesn't cover   */
+/*                          the address.                                    */
+/* ======================================================================== */
+int source_stmt_for_addr(uint_32 addr, uint_32 *first)
+{
+    const smapping *s;
+
+    addr &= 0xFFFF;
+    s     = &smap_tbl[addr];
+
+    if (s->file == 0)
+        return 0;
+
+    /* -------------------------------------------------------------------- */
+    /*  A statement is a run of addresses that all map to the same source   */
+    /*  and listing line.  Walk back to the start of the run.               */
+    /* -------------------------------------------------------------------- */
+    while (addr > 0 && smap_tbl[addr - 1].file      == s->file &&
+                       smap_tbl[addr - 1].line      == s->line &&
+                       smap_tbl[addr - 1].list_line == s->list_line)
+        addr--;
+
+    *first = addr;
+    return s->flag & 0xF0;
+}
@@ -55,4 +55,12 @@ int file_line_for_addr(uint_32 addr, int *line);
 /* ======================================================================== */
 const char *source_for_file_line(int file, int line);
 
+/* ======================================================================== */
+/*  SOURCE_STMT_FOR_ADDR -- Find the first address of the statement that    */
+/*                          covers this address.  Returns the statement's   */
+/*                          TYPE_xxx flags, or 0 if the map doesn't cover   */
+/*                          the address.                                    */
+/* ======================================================================== */
+int source_stmt_for_addr(uint_32 addr, uint_32 *first);
+
 #endif
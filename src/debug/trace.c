@@ -0,0 +1,375 @@
+/*
+ * ============================================================================
+ *  Title:    Instruction Trace Files -- Writer
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See trace.h, and trace_.h for the file format.
+ *
+ *  The records are gathered in a ring of TRACE_BUFS chunk buffers.  The
+ *  emulator fills the buffer at 'tail' and hands it over by bumping
+ *  'pending'; the writer thread takes them from 'head', and gives each
+ *  back by dropping 'pending'.  Neither holds the lock while copying,
+ *  encoding, compressing or writing.  The file, the index and the
+ *  encoding buffers belong to the thread until it exits.
+ * ============================================================================
+ */
+
+#include "sdl.h"
+#include "config.h"
+#include "plat/plat_lib.h"
+#include "minilzo/minilzo.h"
+#include "debug/trace.h"
+#include "debug/trace_.h"
+
+struct trace_t
+{
+    char        *fname;
+    FILE        *f;
+    uint_16     *buf[TRACE_BUFS];   /* Chunk buffers.                       */
+    int         len[TRACE_BUFS];    /* Records in each, once it's pending.  */
+    int         tail;               /* Buffer the emulator is filling.      */
+    int         fill;               /* Records in it so far.                */
+    int         head;               /* Next buffer for the writer.  Thread. */
+
+    uint_8      *enc_buf;           /* Encoded chunk.  Thread only.         */
+    uint_8      *lzo_buf;           /* Header and compressed chunk.  Ditto. */
+    uint_8      *lzo_wrk;           /* LZO compressor's work memory.        */
+    uint_8      *index;             /* Index entries so far.  Thread only.  */
+    int         chunks, idx_alloc;
+    uint_64     recs;               /* Records written.  Thread only.       */
+    uint_64     pos;                /* File offset.  Thread only.           */
+    int         failed;             /* A write failed.  Thread only.        */
+
+    int         pending;            /* Buffers handed to the thread.        */
+    int         quit;               /* Request for thread to exit.          */
+    SDL_mutex   *lock;              /* Guards 'pending' and 'quit'.         */
+    SDL_cond    *wake;              /* Signals thread there's work to do.   */
+    SDL_cond    *done;              /* Signals emulator a buffer is free.   */
+    SDL_Thread  *thread;
+};
+
+/* ======================================================================== */
+/*  TRACE_PUT32 / TRACE_PUT64:  Header fields.                              */
+/* ======================================================================== */
+LOCAL void trace_put32(uint_8 *p, uint_32 v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+LOCAL void trace_put64(uint_8 *p, uint_64 v)
+{
+    trace_put32(p,     (uint_32)v);
+    trace_put32(p + 4, (uint_32)(v >> 32));
+}
+
+/* ======================================================================== */
+/*  TRACE_ENCODE     -- Encode 'n' records as differences.  Returns the     */
+/*                      encoded length.                                     */
+/* ======================================================================== */
+LOCAL int trace_encode(const uint_16 *rec, int n, uint_8 *out)
+{
+    uint_16 prev[TRACE_REC_WORDS];
+    uint_8  *o = out, *mask;
+    int     i, j;
+
+    memset(prev, 0, sizeof(prev));
+
+    for (i = 0; i < n; i++, rec += TRACE_REC_WORDS)
+    {
+        uint_32 m = 0;
+
+        mask = o;
+        o   += 2;
+
+        for (j = 0; j < TRACE_REC_WORDS; j++)
+        {
+            uint_16 d = rec[j] - prev[j];
+            uint_32 z;
+
+            if (!d)
+                continue;
+
+            m |= 1 << j;
+            z  = ((uint_32)d << 1 ^ (d & 0x8000 ? 0xFFFF : 0)) & 0xFFFF;
+
+            while (z > 0x7F)
+            {
+                *o++ = 0x80 | (z & 0x7F);
+                z  >>= 7;
+            }
+            *o++ = z;
+
+            prev[j] = rec[j];
+        }
+
+        mask[0] = m;
+        mask[1] = m >> 8;
+    }
+
+    return o - out;
+}
+
+/* ======================================================================== */
+/*  TRACE_WRITE_CHUNK -- Encode, compress and write one chunk, and add it   */
+/*                       to the index.  Runs on the writer thread.          */
+/* ======================================================================== */
+LOCAL void trace_write_chunk(trace_t *trace, const uint_16 *rec, int n)
+{
+    lzo_uint len = 0;
+    uint_64  first_cycle;
+    uint_8   *idx;
+    int      enc_len;
+
+    if (trace->failed || n == 0)
+        return;
+
+    enc_len = trace_encode(rec, n, trace->enc_buf);
+    if (lzo1x_1_compress(trace->enc_buf, enc_len,
+                         trace->lzo_buf + TRACE_CHDR_LEN, &len,
+                         (lzo_voidp)trace->lzo_wrk) != LZO_E_OK)
+        goto fail;
+
+    first_cycle = (uint_64)rec[12]       | (uint_64)rec[13] << 16 |
+                  (uint_64)rec[14] << 32 | (uint_64)rec[15] << 48;
+
+    memcpy(trace->lzo_buf, TRACE_CHUNK_MAGIC, 4);
+    trace_put64(trace->lzo_buf +  4, trace->recs);
+    trace_put64(trace->lzo_buf + 12, first_cycle);
+    trace_put32(trace->lzo_buf + 20, n);
+    trace_put32(trace->lzo_buf + 24, enc_len);
+    trace_put32(trace->lzo_buf + 28, len);
+
+    /* -------------------------------------------------------------------- */
+    /*  Note the chunk in the index before writing it, so the index can't   */
+    /*  be short of memory for a chunk that's on the disk.                  */
+    /* -------------------------------------------------------------------- */
+    if (trace->chunks == trace->idx_alloc)
+    {
+        int new_alloc = trace->idx_alloc ? trace->idx_alloc * 2 : 256;
+        uint_8 *new_idx = REALLOC(trace->index, uint_8,
+                                  new_alloc * TRACE_IDX_LEN);
+        if (!new_idx)
+            goto fail;
+
+        trace->index     = new_idx;
+        trace->idx_alloc = new_alloc;
+    }
+
+    idx = trace->index + trace->chunks * TRACE_IDX_LEN;
+    trace_put64(idx,      trace->recs);
+    trace_put64(idx +  8, first_cycle);
+    trace_put64(idx + 16, trace->pos);
+
+    if (fwrite(trace->lzo_buf, 1, TRACE_CHDR_LEN + len, trace->f)
+            != TRACE_CHDR_LEN + len)
+        goto fail;
+
+    trace->chunks++;
+    trace->recs += n;
+    trace->pos  += TRACE_CHDR_LEN + len;
+    return;
+
+fail:
+    fprintf(stderr, "trace:  Could not write '%s'.  The trace ends at "
+                    "record %llu.\n", trace->fname, trace->recs);
+    trace->failed = 1;
+}
+
+/* ======================================================================== */
+/*  TRACE_THREAD     -- Write each chunk handed to us until told to quit.   */
+/*                      Everything handed over before the quit is written.  */
+/* ======================================================================== */
+LOCAL int trace_thread(void *opaque)
+{
+    trace_t *trace = (trace_t *)opaque;
+
+    SDL_LockMutex(trace->lock);
+    for (;;)
+    {
+        while (!trace->quit && !trace->pending)
+            SDL_CondWait(trace->wake, trace->lock);
+
+        if (!trace->pending)
+            break;
+
+        SDL_UnlockMutex(trace->lock);
+        trace_write_chunk(trace, trace->buf[trace->head],
+                          trace->len[trace->head]);
+        trace->head = (trace->head + 1) % TRACE_BUFS;
+        SDL_LockMutex(trace->lock);
+
+        trace->pending--;
+        SDL_CondSignal(trace->done);
+    }
+    SDL_UnlockMutex(trace->lock);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  TRACE_CREATE     -- Start writing a trace file.                         */
+/* ======================================================================== */
+trace_t *trace_create(const char *fname)
+{
+    trace_t *trace = CALLOC(trace_t, 1);
+    uint_8  hdr[TRACE_HDR_LEN];
+    int     i;
+
+    if (!trace)
+        goto fail;
+
+    for (i = 0; i < TRACE_BUFS; i++)
+        if (!(trace->buf[i] = CALLOC(uint_16, TRACE_CHUNK*TRACE_REC_WORDS)))
+            goto fail;
+
+    trace->fname   = strdup(fname);
+    trace->enc_buf = CALLOC(uint_8, TRACE_ENC_MAX);
+    trace->lzo_buf = CALLOC(uint_8, TRACE_CHDR_LEN + TRACE_LZO_MAX);
+    trace->lzo_wrk = CALLOC(uint_8, LZO1X_1_MEM_COMPRESS);
+    trace->lock    = SDL_CreateMutex();
+    trace->wake    = SDL_CreateCond();
+    trace->done    = SDL_CreateCond();
+
+    if (!trace->fname || !trace->enc_buf || !trace->lzo_buf ||
+        !trace->lzo_wrk || !trace->lock || !trace->wake || !trace->done)
+        goto fail;
+
+    if (!(trace->f = fopen(fname, "wb")))
+    {
+        perror("fopen()");
+        goto fail;
+    }
+
+    memcpy(hdr, TRACE_MAGIC, 8);
+    trace_put32(hdr +  8, TRACE_VERSION);
+    trace_put32(hdr + 12, TRACE_REC_WORDS);
+    if (fwrite(hdr, 1, TRACE_HDR_LEN, trace->f) != TRACE_HDR_LEN)
+        goto fail;
+    trace->pos = TRACE_HDR_LEN;
+
+    if (!(trace->thread = SDL_CreateThread(trace_thread, (void *)trace)))
+        goto fail;
+
+    return trace;
+
+fail:
+    fprintf(stderr, "trace:  Could not start trace '%s'\n", fname);
+    if (trace)
+    {
+        if (trace->f)    fclose(trace->f);
+        if (trace->done) SDL_DestroyCond(trace->done);
+        if (trace->wake) SDL_DestroyCond(trace->wake);
+        if (trace->lock) SDL_DestroyMutex(trace->lock);
+        CONDFREE(trace->lzo_wrk);
+        CONDFREE(trace->lzo_buf);
+        CONDFREE(trace->enc_buf);
+        CONDFREE(trace->fname);
+        for (i = 0; i < TRACE_BUFS; i++)
+            CONDFREE(trace->buf[i]);
+        free(trace);
+    }
+    return NULL;
+}
+
+/* ======================================================================== */
+/*  TRACE_HAND_OFF   -- Give the buffer we're filling to the writer, and    */
+/*                      wait for a free one if it has fallen behind.        */
+/* ======================================================================== */
+LOCAL void trace_hand_off(trace_t *trace)
+{
+    trace->len[trace->tail] = trace->fill;
+
+    SDL_LockMutex(trace->lock);
+    trace->pending++;
+    SDL_CondSignal(trace->wake);
+    while (trace->pending == TRACE_BUFS)
+        SDL_CondWait(trace->done, trace->lock);
+    SDL_UnlockMutex(trace->lock);
+
+    trace->tail = (trace->tail + 1) % TRACE_BUFS;
+    trace->fill = 0;
+}
+
+/* ======================================================================== */
+/*  TRACE_PUT        -- Add one record to the trace.                        */
+/* ======================================================================== */
+void trace_put(trace_t *trace, const uint_16 *rec)
+{
+    memcpy(trace->buf[trace->tail] + trace->fill * TRACE_REC_WORDS, rec,
+           TRACE_REC_WORDS * sizeof(uint_16));
+
+    if (++trace->fill == TRACE_CHUNK)
+        trace_hand_off(trace);
+}
+
+/* ======================================================================== */
+/*  TRACE_DESTROY    -- Finish the trace file and stop.                     */
+/* ======================================================================== */
+int trace_destroy(trace_t *trace)
+{
+    uint_8 ftr[TRACE_FTR_LEN];
+    int    ok, i;
+
+    if (trace->fill)
+        trace_hand_off(trace);
+
+    SDL_LockMutex(trace->lock);
+    trace->quit = 1;
+    SDL_CondSignal(trace->wake);
+    SDL_UnlockMutex(trace->lock);
+
+    SDL_WaitThread(trace->thread, NULL);
+
+    /* -------------------------------------------------------------------- */
+    /*  The thread is gone, so the index is ours.  If a chunk went missing, */
+    /*  leave the index off; the reader will rebuild it from what's there.  */
+    /* -------------------------------------------------------------------- */
+    ok = !trace->failed;
+    if (ok)
+    {
+        trace_put64(ftr,     trace->pos);
+        trace_put32(ftr + 8, trace->chunks);
+        memcpy(ftr + 12, TRACE_FTR_MAGIC, 4);
+
+        ok = fwrite(trace->index, TRACE_IDX_LEN, trace->chunks, trace->f)
+                == (size_t)trace->chunks &&
+             fwrite(ftr, 1, TRACE_FTR_LEN, trace->f) == TRACE_FTR_LEN;
+    }
+    if (fclose(trace->f) != 0)
+        ok = 0;
+
+    SDL_DestroyCond(trace->done);
+    SDL_DestroyCond(trace->wake);
+    SDL_DestroyMutex(trace->lock);
+    CONDFREE(trace->index);
+    free(trace->lzo_wrk);
+    free(trace->lzo_buf);
+    free(trace->enc_buf);
+    free(trace->fname);
+    for (i = 0; i < TRACE_BUFS; i++)
+        free(trace->buf[i]);
+    free(trace);
+
+    return ok ? 0 : -1;
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
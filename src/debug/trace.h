@@ -0,0 +1,152 @@
+/*
+ * ============================================================================
+ *  Title:    Instruction Trace Files
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Streams a record of every instruction to a file for as long as you
+ *  care to run, and reads it back from any point.  The records are the
+ *  same sixteen words the debugger keeps in its register history:
+ *
+ *      Words  0 -  7   R0 through R7, R7 being the PC.
+ *      Word        8   Flags:  bit 0 always set, then S, C, O, Z, I, D
+ *                      and "interruptible" in bits 1 through 7, and the
+ *                      INTRQ/BUSRQ/INTAK/BUSAK state in bits 8 - 10.
+ *      Words  9 - 11   The three words of memory at the PC.
+ *      Words 12 - 15   The cycle count, least significant word first.
+ *
+ *  The debugger can also put the reads and writes it would print into the
+ *  trace.  These records have bit 0 of word 8 clear, and the rest of word
+ *  8 says what they are:
+ *
+ *      TRACE_RD, TRACE_WR
+ *          Words 0 - 3     Address, data, PC of the instruction making the
+ *                          access, and the number of the requestor.
+ *          Words 12 - 15   The cycle count.
+ *
+ *      TRACE_NAME
+ *          Word  0         A requestor's number, from 0 to TRACE_NAMES-1.
+ *          Words 1 - 7     Its name, two characters per word, low byte
+ *          Words 9 - 11    first, padded with NULs.
+ *          Words 12 - 15   The cycle count.
+ *
+ *  A requestor's name comes before any access that gives its number.
+ *
+ *  Successive records differ in only a few words, and by small amounts,
+ *  so each is stored as the differences from the one before it.  These
+ *  are gathered into chunks of TRACE_CHUNK records and compressed with
+ *  LZO, which typically brings a record down to a few bytes.  Each chunk
+ *  starts afresh, so it can be decoded without reading any other, and an
+ *  index of the chunks at the end of the file lets the reader jump to
+ *  any record or cycle with a binary search.
+ *
+ *  Encoding, compression and the file writes all happen on a background
+ *  thread.  The emulator only copies each record into a buffer, and only
+ *  waits if the writer falls TRACE_BUFS chunks behind.
+ *
+ *  TRACE_CREATE     -- Start writing a trace file.
+ *  TRACE_PUT        -- Add one record to the trace.
+ *  TRACE_DESTROY    -- Finish the trace file and stop.
+ *
+ *  TRACE_OPEN       -- Open a trace file for reading.
+ *  TRACE_COUNT      -- Number of records in the trace.
+ *  TRACE_SEEK       -- Move to a record number.
+ *  TRACE_SEEK_CYCLE -- Move to the first record at or after a cycle.
+ *  TRACE_TELL       -- Record number the next TRACE_NEXT will return.
+ *  TRACE_NEXT       -- Read a record.
+ *  TRACE_CLOSE      -- Close a trace file.
+ * ============================================================================
+ */
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#define TRACE_REC_WORDS (16)    /* Words per record.                        */
+#define TRACE_CHUNK     (4096)  /* Records per chunk.                       */
+#define TRACE_BUFS      (4)     /* Chunks the writer may fall behind.       */
+
+/* Word 8 of records that aren't instructions. */
+#define TRACE_RD        (0x0002)
+#define TRACE_WR        (0x0004)
+#define TRACE_NAME      (0x0008)
+
+#define TRACE_NAMES     (16)    /* Requestor numbers.                       */
+#define TRACE_NAME_LEN  (20)    /* Longest requestor name kept.             */
+
+typedef struct trace_t    trace_t;
+typedef struct trace_rd_t trace_rd_t;
+
+/* ======================================================================== */
+/*  TRACE_CREATE     -- Start a trace in 'fname'.  Returns NULL on failure. */
+/* ======================================================================== */
+trace_t *trace_create(const char *fname);
+
+/* ======================================================================== */
+/*  TRACE_PUT        -- Add a record to the end of the trace.               */
+/* ======================================================================== */
+void trace_put(trace_t *trace, const uint_16 *rec);
+
+/* ======================================================================== */
+/*  TRACE_DESTROY    -- Write out everything buffered, then the index, and  */
+/*                      stop.  Returns -1 if any of it couldn't be written. */
+/* ======================================================================== */
+int trace_destroy(trace_t *trace);
+
+/* ======================================================================== */
+/*  TRACE_OPEN       -- Open 'fname' for reading, positioned at the first   */
+/*                      record.  A trace that was never finished is still   */
+/*                      readable, up to its last complete chunk.  Returns   */
+/*                      NULL on failure.                                    */
+/* ======================================================================== */
+trace_rd_t *trace_open(const char *fname);
+
+/* ======================================================================== */
+/*  TRACE_COUNT      -- Number of records in the trace.                     */
+/* ======================================================================== */
+uint_64 trace_count(const trace_rd_t *rd);
+
+/* ======================================================================== */
+/*  TRACE_SEEK       -- Move to record number 'rec', counting from zero.    */
+/*                      Returns -1 if there's no such record.               */
+/* ======================================================================== */
+int trace_seek(trace_rd_t *rd, uint_64 rec);
+
+/* ======================================================================== */
+/*  TRACE_SEEK_CYCLE -- Move to the first record whose cycle count is at    */
+/*                      or after 'cycle'.  Returns -1 if there is none.     */
+/* ======================================================================== */
+int trace_seek_cycle(trace_rd_t *rd, uint_64 cycle);
+
+/* ======================================================================== */
+/*  TRACE_TELL       -- Number of the record TRACE_NEXT will return.        */
+/* ======================================================================== */
+uint_64 trace_tell(const trace_rd_t *rd);
+
+/* ======================================================================== */
+/*  TRACE_NEXT       -- Copy the next record to 'rec' and move past it.     */
+/*                      Returns -1 at the end of the trace, or if the file  */
+/*                      is damaged.                                         */
+/* ======================================================================== */
+int trace_next(trace_rd_t *rd, uint_16 *rec);
+
+/* ======================================================================== */
+/*  TRACE_CLOSE      -- Close the file and free everything.                 */
+/* ======================================================================== */
+void trace_close(trace_rd_t *rd);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,77 @@
+/*
+ * ============================================================================
+ *  Title:    Instruction Trace Files -- File Format
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Shared by the trace writer and reader.  All numbers are little endian.
+ *
+ *  File header:
+ *      8 bytes     "jzIntvTR"
+ *      4 bytes     TRACE_VERSION
+ *      4 bytes     TRACE_REC_WORDS
+ *
+ *  Then the chunks, each of which is:
+ *      4 bytes     "JZTC"
+ *      8 bytes     Number of the chunk's first record
+ *      8 bytes     Cycle count of the chunk's first record
+ *      4 bytes     Records in the chunk
+ *      4 bytes     Length of the encoded records
+ *      4 bytes     Length after LZO compression
+ *      N bytes     Encoded records, LZO compressed
+ *
+ *  Each encoded record is a 16-bit mask of the words that differ from the
+ *  previous record, then for each of those, the difference.  Differences
+ *  are taken modulo 65536, zig-zag folded so that small negative numbers
+ *  become small positive ones, and stored 7 bits per byte, least
+ *  significant first, with the top bit set on all but the last.  The
+ *  record before the first in each chunk is taken to be all zeros.
+ *
+ *  Then the index, one entry per chunk:
+ *      8 bytes     Number of the chunk's first record
+ *      8 bytes     Cycle count of the chunk's first record
+ *      8 bytes     Offset of the chunk in the file
+ *
+ *  And last of all, the footer:
+ *      8 bytes     Offset of the index in the file
+ *      4 bytes     Number of chunks
+ *      4 bytes     "jzTX"
+ *
+ *  A trace that wasn't closed properly has no index or footer.  The
+ *  reader rebuilds the index by walking the chunk headers instead.
+ * ============================================================================
+ */
+#ifndef TRACE__H_
+#define TRACE__H_
+
+#define TRACE_VERSION       (2)     /* 1 had instruction records only.  */
+#define TRACE_HDR_LEN       (16)
+#define TRACE_CHDR_LEN      (32)
+#define TRACE_IDX_LEN       (24)
+#define TRACE_FTR_LEN       (16)
+
+#define TRACE_MAGIC         "jzIntvTR"
+#define TRACE_CHUNK_MAGIC   "JZTC"
+#define TRACE_FTR_MAGIC     "jzTX"
+
+/* Longest a chunk can be, encoded, and after LZO has had its go at it.     */
+#define TRACE_ENC_MAX  (TRACE_CHUNK * (2 + 3 * TRACE_REC_WORDS))
+#define TRACE_LZO_MAX  (TRACE_ENC_MAX + TRACE_ENC_MAX / 16 + 64 + 3)
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
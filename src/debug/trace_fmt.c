@@ -0,0 +1,257 @@
+/*
+ * ============================================================================
+ *  Title:    Trace Formatting
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See trace_fmt.h.  This part has no threads in it, so jztrace can use
+ *  it on its own.
+ * ============================================================================
+ */
+
+#include "config.h"
+#include "util/symtab.h"
+#include "debug/debug_dasm1600.h"
+#include "debug/trace.h"
+#include "debug/trace_fmt.h"
+
+/* ======================================================================== */
+/*  TRACE_FMT_CYCLE  -- The cycle count in words 12 - 15.                   */
+/* ======================================================================== */
+LOCAL uint_64 trace_fmt_cycle(const uint_16 *rec)
+{
+    return (uint_64)rec[12]       | (uint_64)rec[13] << 16 |
+           (uint_64)rec[14] << 32 | (uint_64)rec[15] << 48;
+}
+
+/* ======================================================================== */
+/*  TRACE_FMT_INIT   -- Set up a formatter.                                 */
+/* ======================================================================== */
+void trace_fmt_init(trace_fmt_t *fmt, symtab_t *symtab)
+{
+    memset(fmt, 0, sizeof(trace_fmt_t));
+    fmt->symtab    = symtab;
+    fmt->width     = -1;
+    fmt->show_time = 1;
+    fmt->src_mode  = -1;
+}
+
+/* ======================================================================== */
+/*  TRACE_FMT_ADDR   -- Format an address with its symbol.                  */
+/* ======================================================================== */
+char *trace_fmt_addr(symtab_t *symtab, int symb_fmt, uint_32 addr, char *buf)
+{
+    const char *symb = NULL;
+    const char *temp;
+    int which;
+    int len = 0;
+
+    if (!symtab || !(symb = symtab_getsym(symtab, addr, 0, 0)))
+        symb_fmt = 3;
+    else
+        len = strlen(symb);
+
+    if (symb_fmt < 3)
+    {
+        /* Skip symbol names that start with "." if there are alternatives. */
+        which = 1;
+        while (symb[0] == '.' &&
+               (temp = symtab_getsym(symtab, addr, 0, which)) != NULL)
+        {
+            symb = temp;
+            which++;
+        }
+    }
+
+    switch (symb_fmt)
+    {
+        case 0:
+            if (len > 27)
+                len = 27;
+
+            sprintf(buf, "%*s ($%.4X)", len, symb, addr);
+            break;
+
+        case 1:
+            if (len > 35)
+                len = 35;
+
+            sprintf(buf, "%*s", len, symb);
+            break;
+
+        case 2:
+            if (len > 27)
+                len = 27;
+
+            sprintf(buf, "$%.4X (%*s)", addr, len, symb);
+            break;
+
+        default:
+            sprintf(buf, "$%.4X", addr);
+            break;
+    }
+
+    return buf;
+}
+
+/* ======================================================================== */
+/*  TRACE_FMT_LABEL  -- The label at an instruction record's PC, if any.    */
+/* ======================================================================== */
+const char *trace_fmt_label(const trace_fmt_t *fmt, const uint_16 *rec)
+{
+    if (!(rec[8] & 1) || !fmt->symtab)
+        return NULL;
+
+    return symtab_getsym(fmt->symtab, rec[7], 0, 0);
+}
+
+/* ======================================================================== */
+/*  TRACE_FMT_DISASM -- Disassemble an instruction record, with its source  */
+/*                      if wanted, the same way the debugger's prompt does. */
+/* ======================================================================== */
+LOCAL const char *trace_fmt_disasm(const trace_fmt_t *fmt, const uint_16 *rec,
+                                   char *dbuf, char *sbuf)
+{
+    const char *dis, *src;
+    uint_32 pc = rec[7];
+
+    dasm1600(dbuf, pc, (rec[8] >> 6) & 1, rec[9], rec[10], rec[11],
+             fmt->symtab);
+    dis = dbuf + 17;
+
+    src = fmt->src && fmt->src_mode >= 0 ? fmt->src(pc) : NULL;
+
+    if (src && fmt->src_mode == 0 && fmt->width >= 40)
+    {
+        snprintf(sbuf, TRACE_FMT_MAX - 17, "%-61.61s | %s", dis, src);
+        dis = sbuf;
+    } else if (src && fmt->src_mode > 0)
+    {
+        dis = src;
+    }
+
+    /* Skip the address and the words of the instruction. */
+    return strlen(dis) > 22 ? dis + 22 : "";
+}
+
+/* ======================================================================== */
+/*  TRACE_FMT        -- Format a record.                                    */
+/* ======================================================================== */
+int trace_fmt(trace_fmt_t *fmt, const uint_16 *rec, char *buf)
+{
+    char    dbuf[1024], sbuf[TRACE_FMT_MAX];
+    char    addrbuf[36], pcbuf[36];
+    const char *dis;
+    uint_64 now = trace_fmt_cycle(rec);
+    int     flags = rec[8], irq = (flags >> 8) & 7, i;
+
+    /* -------------------------------------------------------------------- */
+    /*  Names just get remembered.                                          */
+    /* -------------------------------------------------------------------- */
+    if (flags == TRACE_NAME)
+    {
+        char *name = fmt->name[rec[0] % TRACE_NAMES];
+
+        for (i = 0; i < TRACE_NAME_LEN; i++)
+        {
+            uint_16 w = rec[i < 14 ? 1 + i / 2 : 2 + i / 2];
+            name[i] = i & 1 ? w >> 8 : w & 0xFF;
+        }
+        name[TRACE_NAME_LEN] = 0;
+        return 0;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Reads and writes.                                                   */
+    /* -------------------------------------------------------------------- */
+    if (flags == TRACE_RD || flags == TRACE_WR)
+    {
+        const char *name = fmt->name[rec[3] % TRACE_NAMES];
+
+        return sprintf(buf, " %s a=%s d=%.4X %-16s (PC = %s) t=%llu\n",
+                       flags == TRACE_RD ? "RD" : "WR",
+                       trace_fmt_addr(fmt->symtab, fmt->symb_fmt, rec[0],
+                                      addrbuf),
+                       rec[1], name[0] ? name : "?",
+                       trace_fmt_addr(fmt->symtab, fmt->symb_fmt, rec[2],
+                                      pcbuf),
+                       now);
+    }
+
+    if (!(flags & 1))
+        return 0;
+
+    /* -------------------------------------------------------------------- */
+    /*  Instructions, as the debugger shows them at its prompt.             */
+    /* -------------------------------------------------------------------- */
+    dis = trace_fmt_disasm(fmt, rec, dbuf, sbuf);
+
+    return snprintf(buf, TRACE_FMT_MAX,
+        fmt->show_time ?
+           " %.4X %.4X %.4X %.4X %.4X %.4X %.4X %.4X %c%c%c%c%c%c%c%c"
+           "%-*.*s %8llu\n"
+        :
+           " %.4X %.4X %.4X %.4X %.4X %.4X %.4X %.4X %c%c%c%c%c%c%c%c"
+           "%-*.*s\n",
+           rec[0], rec[1], rec[2], rec[3], rec[4], rec[5], rec[6], rec[7],
+           flags & 0x02 ? 'S' : '-', flags & 0x04 ? 'C' : '-',
+           flags & 0x08 ? 'O' : '-', flags & 0x10 ? 'Z' : '-',
+           flags & 0x20 ? 'I' : '-', flags & 0x40 ? 'D' : '-',
+           flags & 0x80 ? 'i' : '-',
+           irq == 1 ? 'q' :
+           irq == 2 ? 'b' :
+           irq == 3 ? '?' :
+           irq == 4 ? 'Q' :
+           irq == 5 ? 'B' : '-',
+           fmt->width, fmt->width, dis, now);
+}
+
+/* ======================================================================== */
+/*  TRACE_MK_ACCESS  -- Fill in a read or write record.                     */
+/* ======================================================================== */
+void trace_mk_access(uint_16 *rec, int kind, uint_32 addr, uint_32 data,
+                     uint_32 pc, int req, uint_64 now)
+{
+    memset(rec, 0, TRACE_REC_WORDS * sizeof(uint_16));
+
+    rec[0]  = addr;
+    rec[1]  = data;
+    rec[2]  = pc;
+    rec[3]  = req;
+    rec[8]  = kind;
+    rec[12] = (now    ) & 0xFFFF;
+    rec[13] = (now>>16) & 0xFFFF;
+    rec[14] = (now>>32) & 0xFFFF;
+    rec[15] = (now>>48) & 0xFFFF;
+}
+
+/* ======================================================================== */
+/*  TRACE_MK_NAME    -- Fill in a requestor's name record.                  */
+/* ======================================================================== */
+void trace_mk_name(uint_16 *rec, int req, const char *name, uint_64 now)
+{
+    int i, len = strlen(name);
+
+    trace_mk_access(rec, TRACE_NAME, req, 0, 0, 0, now);
+
+    for (i = 0; i < TRACE_NAME_LEN && i < len; i++)
+        rec[i < 14 ? 1 + i / 2 : 2 + i / 2] |=
+            (uint_8)name[i] << (i & 1 ? 8 : 0);
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,149 @@
+/*
+ * ============================================================================
+ *  Title:    Trace Formatting
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Turns trace records (see trace.h) into the text the debugger prints.
+ *  The records carry all the formatting needs, so it can happen well after
+ *  the fact:  on a thread of its own while the emulator runs, or offline
+ *  in jztrace.
+ *
+ *  Symbol lookups, disassembly and the terminal cost far more than running
+ *  the instruction being traced did.  So the debugger only fills in a
+ *  record and hands it to a TRACE_PR_T, whose thread does the rest.  The
+ *  emulator takes a lock once per TRACE_PR_CHUNK records, and only waits
+ *  if the printer falls TRACE_PR_BUFS chunks behind.  Records that sit
+ *  for TRACE_PR_WAIT cycles go over even if their chunk isn't full, so
+ *  a trickle of watch hits still shows up promptly.
+ *
+ *  TRACE_FMT_INIT   -- Set up a formatter.
+ *  TRACE_FMT_ADDR   -- Format an address with its symbol.
+ *  TRACE_FMT_LABEL  -- The label at an instruction record's PC, if any.
+ *  TRACE_FMT        -- Format a record.
+ *  TRACE_MK_ACCESS  -- Fill in a read or write record.
+ *  TRACE_MK_NAME    -- Fill in a requestor's name record.
+ *
+ *  TRACE_PR_CREATE  -- Start a printer.
+ *  TRACE_PR_FMT     -- The printer's formatter.
+ *  TRACE_PR_PUT     -- Queue a record to print.
+ *  TRACE_PR_TICK    -- Hand over records that have waited long enough.
+ *  TRACE_PR_SYNC    -- Wait until everything queued is printed.
+ *  TRACE_PR_DESTROY -- Print whatever's queued, and stop.
+ * ============================================================================
+ */
+#ifndef TRACE_FMT_H_
+#define TRACE_FMT_H_
+
+#define TRACE_FMT_MAX   (2048)  /* Longest text for one record.             */
+#define TRACE_PR_CHUNK  (1024)  /* Records per chunk.                       */
+#define TRACE_PR_BUFS   (16)    /* Chunks the printer may fall behind.      */
+#define TRACE_PR_WAIT   (15000) /* Cycles a record may wait to go over.     */
+
+/* ------------------------------------------------------------------------ */
+/*  TRACE_FMT_T      -- How to format records.  The names are filled in     */
+/*                      from the name records as they go by.                */
+/* ------------------------------------------------------------------------ */
+typedef struct trace_fmt_t
+{
+    symtab_t    *symtab;        /* Symbols, or NULL.                        */
+    int         symb_fmt;       /* Address format, 0 - 3, as 'debug_t'.     */
+    int         width;          /* Columns of disassembly, or -1 for all.   */
+    int         show_time;      /* Show instructions' cycle counts.         */
+    int         src_mode;       /* -1 disasm, 0 mixed, 1 source if any.     */
+    const char  *(*src)(uint_32 addr);  /* Source for an address, or NULL.  */
+    char        name[TRACE_NAMES][TRACE_NAME_LEN + 1];
+} trace_fmt_t;
+
+typedef struct trace_pr_t trace_pr_t;
+
+/* ======================================================================== */
+/*  TRACE_FMT_INIT   -- Set 'fmt' up to format with 'symtab', showing all   */
+/*                      of the disassembly and the cycle counts.            */
+/* ======================================================================== */
+void trace_fmt_init(trace_fmt_t *fmt, symtab_t *symtab);
+
+/* ======================================================================== */
+/*  TRACE_FMT_ADDR   -- Format 'addr' into 'buf', with its symbol as the    */
+/*                      debugger's address format 'symb_fmt' says.  'buf'   */
+/*                      must hold 36 characters.  Returns 'buf'.            */
+/* ======================================================================== */
+char *trace_fmt_addr(symtab_t *symtab, int symb_fmt, uint_32 addr,
+                     char *buf);
+
+/* ======================================================================== */
+/*  TRACE_FMT_LABEL  -- If 'rec' is an instruction, and there's a symbol    */
+/*                      at its PC, returns the symbol.  Else NULL.          */
+/* ======================================================================== */
+const char *trace_fmt_label(const trace_fmt_t *fmt, const uint_16 *rec);
+
+/* ======================================================================== */
+/*  TRACE_FMT        -- Format 'rec' into 'buf', which must hold            */
+/*                      TRACE_FMT_MAX characters, as one line ending in a   */
+/*                      newline.  Returns its length, or 0 if there's       */
+/*                      nothing to print, as for a name record.             */
+/* ======================================================================== */
+int trace_fmt(trace_fmt_t *fmt, const uint_16 *rec, char *buf);
+
+/* ======================================================================== */
+/*  TRACE_MK_ACCESS  -- Fill in a TRACE_RD or TRACE_WR record.              */
+/* ======================================================================== */
+void trace_mk_access(uint_16 *rec, int kind, uint_32 addr, uint_32 data,
+                     uint_32 pc, int req, uint_64 now);
+
+/* ======================================================================== */
+/*  TRACE_MK_NAME    -- Fill in a TRACE_NAME record.                        */
+/* ======================================================================== */
+void trace_mk_name(uint_16 *rec, int req, const char *name, uint_64 now);
+
+/* ======================================================================== */
+/*  TRACE_PR_CREATE  -- Start a printer that prints with jzp_printf.        */
+/*                      Returns NULL on failure.                            */
+/* ======================================================================== */
+trace_pr_t *trace_pr_create(void);
+
+/* ======================================================================== */
+/*  TRACE_PR_FMT     -- The printer's formatter.  Only change it right      */
+/*                      after TRACE_PR_SYNC, while the printer is idle.     */
+/* ======================================================================== */
+trace_fmt_t *trace_pr_fmt(trace_pr_t *pr);
+
+/* ======================================================================== */
+/*  TRACE_PR_PUT     -- Queue 'rec' to print.                               */
+/* ======================================================================== */
+void trace_pr_put(trace_pr_t *pr, const uint_16 *rec);
+
+/* ======================================================================== */
+/*  TRACE_PR_TICK    -- Hand over the records queued so far, if the first   */
+/*                      of them is TRACE_PR_WAIT cycles older than 'now'.   */
+/* ======================================================================== */
+void trace_pr_tick(trace_pr_t *pr, uint_64 now);
+
+/* ======================================================================== */
+/*  TRACE_PR_SYNC    -- Wait until everything queued has been printed.      */
+/*                      Cheap if nothing has been queued since the last.    */
+/* ======================================================================== */
+void trace_pr_sync(trace_pr_t *pr);
+
+/* ======================================================================== */
+/*  TRACE_PR_DESTROY -- Print whatever's queued, and stop.                  */
+/* ======================================================================== */
+void trace_pr_destroy(trace_pr_t *pr);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,254 @@
+/*
+ * ============================================================================
+ *  Title:    Trace Formatting -- Printer Thread
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See trace_fmt.h.
+ *
+ *  This works just as the trace file writer in trace.c does:  the emulator
+ *  fills the chunk buffer at 'tail' and hands it over by bumping 'pending';
+ *  the printer thread takes them from 'head', formats and prints them, and
+ *  gives each back by dropping 'pending'.  Neither holds the lock while
+ *  copying or printing.
+ *
+ *  The disassembler works in static buffers, so only one thread may use
+ *  it at a time.  The debugger syncs with the printer before it prints
+ *  anything itself, which also keeps its output in order with ours.
+ * ============================================================================
+ */
+
+#include "sdl.h"
+#include "config.h"
+#include "util/symtab.h"
+#include "debug/trace.h"
+#include "debug/trace_fmt.h"
+
+struct trace_pr_t
+{
+    trace_fmt_t fmt;                /* Formatter.  Thread, until synced.    */
+    char        *text;              /* Formatted record.  Thread only.      */
+    uint_16     *buf[TRACE_PR_BUFS];    /* Chunk buffers.                   */
+    int         len[TRACE_PR_BUFS];     /* Records in each when pending.    */
+    int         tail;               /* Buffer the emulator is filling.      */
+    int         fill;               /* Records in it so far.                */
+    int         head;               /* Printer's next buffer.  Thread only. */
+    uint_64     first;              /* Cycle of the first record in 'tail'. */
+    int         busy;               /* Handed anything over since the sync. */
+
+    int         pending;            /* Buffers handed to the thread.        */
+    int         quit;               /* Request for thread to exit.          */
+    SDL_mutex   *lock;              /* Guards 'pending' and 'quit'.         */
+    SDL_cond    *wake;              /* Signals thread there's work to do.   */
+    SDL_cond    *done;              /* Signals emulator a buffer is free.   */
+    SDL_Thread  *thread;
+};
+
+/* ======================================================================== */
+/*  TRACE_PR_CHUNK_OUT -- Format and print one chunk.  Runs on the thread.  */
+/* ======================================================================== */
+LOCAL void trace_pr_chunk_out(trace_pr_t *pr, const uint_16 *rec, int n)
+{
+    const char *label;
+    int i;
+
+    for (i = 0; i < n; i++, rec += TRACE_REC_WORDS)
+    {
+        if ((label = trace_fmt_label(&pr->fmt, rec)) != NULL)
+            jzp_printf("%s:\n", label);
+
+        if (trace_fmt(&pr->fmt, rec, pr->text) > 0)
+            jzp_printf("%s", pr->text);
+    }
+
+    jzp_flush();
+}
+
+/* ======================================================================== */
+/*  TRACE_PR_THREAD  -- Print each chunk handed to us until told to quit.   */
+/*                      Everything handed over before the quit is printed.  */
+/* ======================================================================== */
+LOCAL int trace_pr_thread(void *opaque)
+{
+    trace_pr_t *pr = (trace_pr_t *)opaque;
+
+    SDL_LockMutex(pr->lock);
+    for (;;)
+    {
+        while (!pr->quit && !pr->pending)
+            SDL_CondWait(pr->wake, pr->lock);
+
+        if (!pr->pending)
+            break;
+
+        SDL_UnlockMutex(pr->lock);
+        trace_pr_chunk_out(pr, pr->buf[pr->head], pr->len[pr->head]);
+        pr->head = (pr->head + 1) % TRACE_PR_BUFS;
+        SDL_LockMutex(pr->lock);
+
+        pr->pending--;
+        SDL_CondSignal(pr->done);
+    }
+    SDL_UnlockMutex(pr->lock);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  TRACE_PR_CREATE  -- Start a printer.                                    */
+/* ======================================================================== */
+trace_pr_t *trace_pr_create(void)
+{
+    trace_pr_t *pr = CALLOC(trace_pr_t, 1);
+    int i;
+
+    if (!pr)
+        goto fail;
+
+    for (i = 0; i < TRACE_PR_BUFS; i++)
+        if (!(pr->buf[i] = CALLOC(uint_16, TRACE_PR_CHUNK*TRACE_REC_WORDS)))
+            goto fail;
+
+    trace_fmt_init(&pr->fmt, NULL);
+    pr->text = CALLOC(char, TRACE_FMT_MAX);
+    pr->lock = SDL_CreateMutex();
+    pr->wake = SDL_CreateCond();
+    pr->done = SDL_CreateCond();
+
+    if (!pr->text || !pr->lock || !pr->wake || !pr->done)
+        goto fail;
+
+    if (!(pr->thread = SDL_CreateThread(trace_pr_thread, (void *)pr)))
+        goto fail;
+
+    return pr;
+
+fail:
+    fprintf(stderr, "trace:  Could not start trace printer\n");
+    if (pr)
+    {
+        if (pr->done) SDL_DestroyCond(pr->done);
+        if (pr->wake) SDL_DestroyCond(pr->wake);
+        if (pr->lock) SDL_DestroyMutex(pr->lock);
+        CONDFREE(pr->text);
+        for (i = 0; i < TRACE_PR_BUFS; i++)
+            CONDFREE(pr->buf[i]);
+        free(pr);
+    }
+    return NULL;
+}
+
+/* ======================================================================== */
+/*  TRACE_PR_FMT     -- The printer's formatter.                            */
+/* ======================================================================== */
+trace_fmt_t *trace_pr_fmt(trace_pr_t *pr)
+{
+    return &pr->fmt;
+}
+
+/* ======================================================================== */
+/*  TRACE_PR_HAND_OFF -- Give the buffer we're filling to the printer, and  */
+/*                       wait for a free one if it has fallen behind.       */
+/* ======================================================================== */
+LOCAL void trace_pr_hand_off(trace_pr_t *pr)
+{
+    pr->len[pr->tail] = pr->fill;
+
+    SDL_LockMutex(pr->lock);
+    pr->pending++;
+    SDL_CondSignal(pr->wake);
+    while (pr->pending == TRACE_PR_BUFS)
+        SDL_CondWait(pr->done, pr->lock);
+    SDL_UnlockMutex(pr->lock);
+
+    pr->tail = (pr->tail + 1) % TRACE_PR_BUFS;
+    pr->fill = 0;
+    pr->busy = 1;
+}
+
+/* ======================================================================== */
+/*  TRACE_PR_PUT     -- Queue a record to print.                            */
+/* ======================================================================== */
+void trace_pr_put(trace_pr_t *pr, const uint_16 *rec)
+{
+    if (!pr->fill)
+        pr->first = (uint_64)rec[12]       | (uint_64)rec[13] << 16 |
+                    (uint_64)rec[14] << 32 | (uint_64)rec[15] << 48;
+
+    memcpy(pr->buf[pr->tail] + pr->fill * TRACE_REC_WORDS, rec,
+           TRACE_REC_WORDS * sizeof(uint_16));
+
+    if (++pr->fill == TRACE_PR_CHUNK)
+        trace_pr_hand_off(pr);
+}
+
+/* ======================================================================== */
+/*  TRACE_PR_TICK    -- Hand over records that have waited long enough.     */
+/* ======================================================================== */
+void trace_pr_tick(trace_pr_t *pr, uint_64 now)
+{
+    if (pr->fill && now >= pr->first + TRACE_PR_WAIT)
+        trace_pr_hand_off(pr);
+}
+
+/* ======================================================================== */
+/*  TRACE_PR_SYNC    -- Wait until everything queued is printed.            */
+/* ======================================================================== */
+void trace_pr_sync(trace_pr_t *pr)
+{
+    if (pr->fill)
+        trace_pr_hand_off(pr);
+
+    if (!pr->busy)
+        return;
+
+    SDL_LockMutex(pr->lock);
+    while (pr->pending)
+        SDL_CondWait(pr->done, pr->lock);
+    SDL_UnlockMutex(pr->lock);
+
+    pr->busy = 0;
+}
+
+/* ======================================================================== */
+/*  TRACE_PR_DESTROY -- Print whatever's queued, and stop.                  */
+/* ======================================================================== */
+void trace_pr_destroy(trace_pr_t *pr)
+{
+    int i;
+
+    if (pr->fill)
+        trace_pr_hand_off(pr);
+
+    SDL_LockMutex(pr->lock);
+    pr->quit = 1;
+    SDL_CondSignal(pr->wake);
+    SDL_UnlockMutex(pr->lock);
+
+    SDL_WaitThread(pr->thread, NULL);
+
+    SDL_DestroyCond(pr->done);
+    SDL_DestroyCond(pr->wake);
+    SDL_DestroyMutex(pr->lock);
+    free(pr->text);
+    for (i = 0; i < TRACE_PR_BUFS; i++)
+        free(pr->buf[i]);
+    free(pr);
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
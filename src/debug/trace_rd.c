@@ -0,0 +1,459 @@
+/*
+ * ============================================================================
+ *  Title:    Instruction Trace Files -- Reader
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See trace.h, and trace_.h for the file format.
+ *
+ *  The reader keeps the whole index in memory and one chunk decoded.
+ *  Seeking finds the chunk with a binary search on the index, decodes it
+ *  if it isn't the one we already have, then finds the record within it.
+ *  Chunks are decoded whole, as each record is only meaningful relative
+ *  to the one before.  This half doesn't need SDL, so that tools can use
+ *  it outside of jzIntv.
+ * ============================================================================
+ */
+
+#include "config.h"
+#include "plat/plat_lib.h"
+#include "minilzo/minilzo.h"
+#include "debug/trace.h"
+#include "debug/trace_.h"
+
+typedef struct trace_idx_t
+{
+    uint_64     first_rec;
+    uint_64     first_cycle;
+    uint_64     offset;
+} trace_idx_t;
+
+struct trace_rd_t
+{
+    char        *fname;
+    FILE        *f;
+    trace_idx_t *index;
+    int         chunks;
+    uint_64     count;          /* Records in the whole trace.              */
+
+    int         cur;            /* Chunk in 'rec', or -1.                   */
+    int         cur_len;        /* Records in it.                           */
+    uint_64     pos;            /* Record TRACE_NEXT will return.           */
+    uint_16     *rec;           /* The decoded chunk.                       */
+    uint_8      *enc_buf;       /* The chunk as encoded.                    */
+    uint_8      *lzo_buf;       /* The chunk as compressed.                 */
+};
+
+/* ======================================================================== */
+/*  TRACE_GET32 / TRACE_GET64:  Header fields.                              */
+/* ======================================================================== */
+LOCAL uint_32 trace_get32(const uint_8 *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint_32)p[3] << 24);
+}
+
+LOCAL uint_64 trace_get64(const uint_8 *p)
+{
+    return trace_get32(p) | ((uint_64)trace_get32(p + 4) << 32);
+}
+
+/* ======================================================================== */
+/*  TRACE_DECODE     -- Undo TRACE_ENCODE.  Returns -1 if the encoded data  */
+/*                      doesn't hold exactly 'n' records.                   */
+/* ======================================================================== */
+LOCAL int trace_decode(const uint_8 *in, int len, uint_16 *rec, int n)
+{
+    uint_16 prev[TRACE_REC_WORDS];
+    const uint_8 *end = in + len;
+    int     i, j;
+
+    memset(prev, 0, sizeof(prev));
+
+    for (i = 0; i < n; i++, rec += TRACE_REC_WORDS)
+    {
+        uint_32 m;
+
+        if (end - in < 2)
+            return -1;
+
+        m   = in[0] | (in[1] << 8);
+        in += 2;
+
+        for (j = 0; j < TRACE_REC_WORDS; j++)
+        {
+            uint_32 z = 0;
+            int     shift = 0;
+
+            if ((m >> j) & 1)
+            {
+                do
+                {
+                    if (in == end || shift > 14)
+                        return -1;
+                    z     |= (uint_32)(*in & 0x7F) << shift;
+                    shift += 7;
+                } while (*in++ & 0x80);
+
+                prev[j] += (z >> 1) ^ (z & 1 ? 0xFFFF : 0);
+            }
+            rec[j] = prev[j];
+        }
+    }
+
+    return in == end ? 0 : -1;
+}
+
+/* ======================================================================== */
+/*  TRACE_READ_INDEX -- Read the index from the end of the file.  Returns   */
+/*                      -1 if there isn't a good one.                       */
+/* ======================================================================== */
+LOCAL int trace_read_index(trace_rd_t *rd, long size)
+{
+    uint_8  ftr[TRACE_FTR_LEN], *buf;
+    uint_64 idx_ofs;
+    uint_32 chunks;
+    int     i;
+
+    if (size < TRACE_HDR_LEN + TRACE_FTR_LEN ||
+        fseek(rd->f, size - TRACE_FTR_LEN, SEEK_SET) ||
+        fread(ftr, 1, TRACE_FTR_LEN, rd->f) != TRACE_FTR_LEN ||
+        memcmp(ftr + 12, TRACE_FTR_MAGIC, 4) != 0)
+        return -1;
+
+    idx_ofs = trace_get64(ftr);
+    chunks  = trace_get32(ftr + 8);
+
+    if (idx_ofs + (uint_64)chunks * TRACE_IDX_LEN + TRACE_FTR_LEN
+            != (uint_64)size)
+        return -1;
+
+    if (!(buf   = CALLOC(uint_8, chunks * TRACE_IDX_LEN + 1)) ||
+        !(rd->index = CALLOC(trace_idx_t, chunks + 1)) ||
+        fseek(rd->f, (long)idx_ofs, SEEK_SET) ||
+        fread(buf, TRACE_IDX_LEN, chunks, rd->f) != chunks)
+    {
+        CONDFREE(buf);
+        CONDFREE(rd->index);
+        return -1;
+    }
+
+    for (i = 0; i < (int)chunks; i++)
+    {
+        rd->index[i].first_rec   = trace_get64(buf + i * TRACE_IDX_LEN);
+        rd->index[i].first_cycle = trace_get64(buf + i * TRACE_IDX_LEN + 8);
+        rd->index[i].offset      = trace_get64(buf + i * TRACE_IDX_LEN + 16);
+    }
+    free(buf);
+
+    rd->chunks = chunks;
+    return 0;
+}
+
+/* ======================================================================== */
+/*  TRACE_SCAN_INDEX -- Rebuild the index by walking the chunk headers, up  */
+/*                      to the first one that's damaged or cut short.       */
+/* ======================================================================== */
+LOCAL int trace_scan_index(trace_rd_t *rd, long size)
+{
+    uint_8  chdr[TRACE_CHDR_LEN];
+    uint_64 ofs = TRACE_HDR_LEN, next_rec = 0;
+    int     alloc = 0;
+
+    while (ofs + TRACE_CHDR_LEN <= (uint_64)size &&
+           !fseek(rd->f, (long)ofs, SEEK_SET) &&
+           fread(chdr, 1, TRACE_CHDR_LEN, rd->f) == TRACE_CHDR_LEN &&
+           !memcmp(chdr, TRACE_CHUNK_MAGIC, 4) &&
+           trace_get64(chdr + 4) == next_rec &&
+           ofs + TRACE_CHDR_LEN + trace_get32(chdr + 28) <= (uint_64)size)
+    {
+        if (rd->chunks == alloc)
+        {
+            trace_idx_t *new_idx;
+
+            alloc   = alloc ? alloc * 2 : 256;
+            new_idx = REALLOC(rd->index, trace_idx_t, alloc);
+            if (!new_idx)
+                return -1;
+            rd->index = new_idx;
+        }
+
+        rd->index[rd->chunks].first_rec   = next_rec;
+        rd->index[rd->chunks].first_cycle = trace_get64(chdr + 12);
+        rd->index[rd->chunks].offset      = ofs;
+        rd->chunks++;
+
+        next_rec += trace_get32(chdr + 20);
+        ofs      += TRACE_CHDR_LEN + trace_get32(chdr + 28);
+    }
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  TRACE_LOAD       -- Decode chunk 'c' into 'rec', if it isn't already.   */
+/* ======================================================================== */
+LOCAL int trace_load(trace_rd_t *rd, int c)
+{
+    uint_8   chdr[TRACE_CHDR_LEN];
+    uint_32  n, enc_len, lzo_len;
+    lzo_uint out_len;
+
+    if (c == rd->cur)
+        return 0;
+
+    rd->cur = -1;
+
+    if (fseek(rd->f, (long)rd->index[c].offset, SEEK_SET) ||
+        fread(chdr, 1, TRACE_CHDR_LEN, rd->f) != TRACE_CHDR_LEN)
+        goto fail;
+
+    n       = trace_get32(chdr + 20);
+    enc_len = trace_get32(chdr + 24);
+    lzo_len = trace_get32(chdr + 28);
+    out_len = enc_len;
+
+    if (memcmp(chdr, TRACE_CHUNK_MAGIC, 4) != 0 ||
+        n == 0 || n > TRACE_CHUNK ||
+        enc_len > TRACE_ENC_MAX || lzo_len > TRACE_LZO_MAX ||
+        fread(rd->lzo_buf, 1, lzo_len, rd->f) != lzo_len ||
+        lzo1x_decompress_safe(rd->lzo_buf, lzo_len, rd->enc_buf, &out_len,
+                              NULL) != LZO_E_OK ||
+        out_len != enc_len ||
+        trace_decode(rd->enc_buf, enc_len, rd->rec, n))
+        goto fail;
+
+    rd->cur     = c;
+    rd->cur_len = n;
+    return 0;
+
+fail:
+    fprintf(stderr, "trace:  '%s' is damaged at chunk %d\n", rd->fname, c);
+    return -1;
+}
+
+/* ======================================================================== */
+/*  TRACE_OPEN       -- Open a trace file for reading.                      */
+/* ======================================================================== */
+trace_rd_t *trace_open(const char *fname)
+{
+    trace_rd_t *rd = CALLOC(trace_rd_t, 1);
+    uint_8  hdr[TRACE_HDR_LEN];
+    long    size;
+
+    if (!rd)
+        goto fail;
+
+    rd->cur     = -1;
+    rd->fname   = strdup(fname);
+    rd->rec     = CALLOC(uint_16, TRACE_CHUNK * TRACE_REC_WORDS);
+    rd->enc_buf = CALLOC(uint_8, TRACE_ENC_MAX);
+    rd->lzo_buf = CALLOC(uint_8, TRACE_LZO_MAX);
+
+    if (!rd->fname || !rd->rec || !rd->enc_buf || !rd->lzo_buf)
+        goto fail;
+
+    if (!(rd->f = fopen(fname, "rb")))
+    {
+        perror("fopen()");
+        goto fail;
+    }
+
+    if (fread(hdr, 1, TRACE_HDR_LEN, rd->f) != TRACE_HDR_LEN ||
+        memcmp(hdr, TRACE_MAGIC, 8) != 0 ||
+        trace_get32(hdr +  8) <  1 ||
+        trace_get32(hdr +  8) >  TRACE_VERSION ||
+        trace_get32(hdr + 12) != TRACE_REC_WORDS)
+    {
+        fprintf(stderr, "trace:  '%s' is not a jzIntv trace\n", fname);
+        goto fail;
+    }
+
+    if (fseek(rd->f, 0, SEEK_END) || (size = ftell(rd->f)) < 0)
+        goto fail;
+
+    if (trace_read_index(rd, size))
+    {
+        fprintf(stderr, "trace:  '%s' has no index.  Rebuilding it.\n",
+                fname);
+        if (trace_scan_index(rd, size))
+            goto fail;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  The last chunk's length isn't in the index.  Read it to get the     */
+    /*  number of records.                                                  */
+    /* -------------------------------------------------------------------- */
+    if (rd->chunks > 0)
+    {
+        if (trace_load(rd, rd->chunks - 1))
+            goto fail;
+        rd->count = rd->index[rd->chunks - 1].first_rec + rd->cur_len;
+    }
+
+    return rd;
+
+fail:
+    fprintf(stderr, "trace:  Could not read '%s'\n", fname);
+    if (rd)
+    {
+        if (rd->f) fclose(rd->f);
+        CONDFREE(rd->index);
+        CONDFREE(rd->lzo_buf);
+        CONDFREE(rd->enc_buf);
+        CONDFREE(rd->rec);
+        CONDFREE(rd->fname);
+        free(rd);
+    }
+    return NULL;
+}
+
+/* ======================================================================== */
+/*  TRACE_COUNT      -- Number of records in the trace.                     */
+/* ======================================================================== */
+uint_64 trace_count(const trace_rd_t *rd)
+{
+    return rd->count;
+}
+
+/* ======================================================================== */
+/*  TRACE_SEEK       -- Move to a record number.                            */
+/* ======================================================================== */
+int trace_seek(trace_rd_t *rd, uint_64 rec)
+{
+    if (rec >= rd->count)
+        return -1;
+
+    rd->pos = rec;
+    return 0;
+}
+
+/* ======================================================================== */
+/*  TRACE_SEEK_CYCLE -- Move to the first record at or after a cycle.       */
+/* ======================================================================== */
+int trace_seek_cycle(trace_rd_t *rd, uint_64 cycle)
+{
+    int lo, hi, mid;
+
+    if (rd->chunks == 0)
+        return -1;
+
+    /* -------------------------------------------------------------------- */
+    /*  Find the last chunk that starts at or before 'cycle'.  What we're   */
+    /*  after is in there, or else it's the first record of the next.       */
+    /* -------------------------------------------------------------------- */
+    lo = 0;
+    hi = rd->chunks - 1;
+    while (lo < hi)
+    {
+        mid = (lo + hi + 1) / 2;
+        if (rd->index[mid].first_cycle <= cycle) lo = mid;
+        else                                     hi = mid - 1;
+    }
+
+    if (trace_load(rd, lo))
+        return -1;
+
+    /* -------------------------------------------------------------------- */
+    /*  Then the first record in it that's at or after 'cycle'.             */
+    /* -------------------------------------------------------------------- */
+    hi = rd->cur_len;
+    lo = 0;
+    while (lo < hi)
+    {
+        const uint_16 *r = rd->rec + (mid = (lo + hi) / 2) * TRACE_REC_WORDS;
+        uint_64 now = (uint_64)r[12]       | (uint_64)r[13] << 16 |
+                      (uint_64)r[14] << 32 | (uint_64)r[15] << 48;
+
+        if (now < cycle) lo = mid + 1;
+        else             hi = mid;
+    }
+
+    return trace_seek(rd, rd->index[rd->cur].first_rec + lo);
+}
+
+/* ======================================================================== */
+/*  TRACE_TELL       -- Record number the next TRACE_NEXT will return.      */
+/* ======================================================================== */
+uint_64 trace_tell(const trace_rd_t *rd)
+{
+    return rd->pos;
+}
+
+/* ======================================================================== */
+/*  TRACE_NEXT       -- Read a record.                                      */
+/* ======================================================================== */
+int trace_next(trace_rd_t *rd, uint_16 *rec)
+{
+    int lo, hi, mid;
+
+    if (rd->pos >= rd->count)
+        return -1;
+
+    /* -------------------------------------------------------------------- */
+    /*  Reading straight through, we're in the current chunk or the next.   */
+    /*  Otherwise, look it up.                                              */
+    /* -------------------------------------------------------------------- */
+    lo = rd->cur;
+    if (lo < 0 || rd->pos < rd->index[lo].first_rec ||
+        rd->pos >= rd->index[lo].first_rec + rd->cur_len)
+    {
+        if (lo >= 0 && lo + 1 < rd->chunks &&
+            rd->pos == rd->index[lo + 1].first_rec)
+        {
+            lo++;
+        } else
+        {
+            lo = 0;
+            hi = rd->chunks - 1;
+            while (lo < hi)
+            {
+                mid = (lo + hi + 1) / 2;
+                if (rd->index[mid].first_rec <= rd->pos) lo = mid;
+                else                                     hi = mid - 1;
+            }
+        }
+
+        if (trace_load(rd, lo))
+            return -1;
+    }
+
+    memcpy(rec, rd->rec + (rd->pos - rd->index[lo].first_rec)
+                                   * TRACE_REC_WORDS,
+           TRACE_REC_WORDS * sizeof(uint_16));
+    rd->pos++;
+    return 0;
+}
+
+/* ======================================================================== */
+/*  TRACE_CLOSE      -- Close a trace file.                                 */
+/* ======================================================================== */
+void trace_close(trace_rd_t *rd)
+{
+    if (!rd)
+        return;
+
+    fclose(rd->f);
+    free(rd->index);
+    free(rd->lzo_buf);
+    free(rd->enc_buf);
+    free(rd->rec);
+    free(rd->fname);
+    free(rd);
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -4,7 +4,7 @@
  *  Author:   J. Zbiciak
  * ============================================================================
  *  This module implements a "demo recorder", which records updates to GRAM,
- *  BACKTAB and the PSG to a file.  Currently it does not record Intellivoice.
+ *  BACKTAB and the PSG to a file, along with writes to the Intellivoice.
  *
  *  The output file can be fed through a post-processor, which then reformats
  *  and compresses the data, for use in a demo-player on a real Intellivision.
@@ -13,7 +13,12 @@
  *  interface, the demo recorder gets ticked by the STIC directly, and the
  *  STIC hands the demo recorder its current vision of the STIC control 
  *  registers, BACKTAB and GRAM.  The demo recorder then only has to snoop
- *  the PSG registers.
+ *  the PSG registers.  The Intellivoice reports each write it accepts to
+ *  DEMO_VOICE, and those are recorded ahead of the frame they landed in.
+ *
+ *  Records collect in a block buffer, which is written out every so many
+ *  frames rather than once per frame.  With LZO enabled, each block is
+ *  compressed on its way out.
  *
  * ============================================================================
  */
@@ -27,6 +32,10 @@
 #include "ay8910/ay8910.h"
 #include "stic/stic.h"
 
+#ifndef NO_LZO
+# include "minilzo/minilzo.h"
+#endif
+
 /* ======================================================================== */
 /*  SIGBIT_PSG   -- Significant bits in PSG  registers.                     */
 /*  SIGBIT_STIC  -- Significant bits in STIC registers.                     */
@@ -87,7 +96,10 @@ LOCAL const int stic_regs[32] =
 
 
 /* ======================================================================== */
-/*  DEMO_BUF     -- Buffer we construct each frame in.                      */
+/*  DEMO FILE FORMAT                                                        */
+/*                                                                          */
+/*  The file is a series of records, each of which starts with a 4-byte     */
+/*  signature.  All values are little endian.                               */
 /*                                                                          */
 /*  Frame format:                                                           */
 /*                                                                          */
@@ -103,8 +115,28 @@ LOCAL const int stic_regs[32] =
 /*      N bytes     PSG0 registers (1 byte each)                            */
 /*      N bytes     PSG1 registers (1 byte each)                            */
 /*                                                                          */
+/*  Voice record format, ahead of the frame the writes happened in:         */
+/*                                                                          */
+/*      4 bytes     0x2B3B4B5B  Voice header                                */
+/*      2 bytes     Number of writes                                        */
+/*      N bytes     Writes (2 bytes each):                                  */
+/*                      Bit 15:     0 == ALD ($0080), 1 == FIFO ($0081)     */
+/*                      Bits 10-0:  Value written                           */
+/*                                                                          */
+/*  When recording with LZO, every block of records is wrapped in:          */
+/*                                                                          */
+/*      4 bytes     0x2C3C4C5C  Block header                                */
+/*      4 bytes     Length of the records                                   */
+/*      4 bytes     Length stored.  If equal to the above, the records      */
+/*                  are stored as-is, otherwise they're LZO compressed.     */
+/*      N bytes     The records                                             */
+/*                                                                          */
+/*  Without LZO, the records are written one after another, unwrapped.      */
 /* ======================================================================== */
-LOCAL uint_8 demo_buf[54 + 32*2 + 64*8 + 240*2 + 16 + 16];
+#define FRAME_MAX   (54 + 32*2 + 64*8 + 240*2 + 16 + 16)
+#define VOICE_MAX   (6 + 2*DEMO_VOICE_MAX)
+#define BLKHDR_LEN  (12)
+#define FLUSH_MAX   (3600)          /* At most a minute's frames per block. */
 
 #define EMIT_32(buf, word)  do {\
                                 buf[0]   = ((word) >>  0) & 0xFF;           \
@@ -122,6 +154,121 @@ LOCAL uint_8 demo_buf[54 + 32*2 + 64*8 + 240*2 + 16 + 16];
 
 #define EMIT_8(buf, word)   *(buf)++ = word;
 
+/* ======================================================================== */
+/*  DEMO_WRITE   -- Write bytes to the demo file.  On error, close the      */
+/*                  file and stop recording.                                */
+/* ======================================================================== */
+LOCAL int demo_write(demo_t *demo, const uint_8 *buf, size_t len)
+{
+    if (fwrite(buf, 1, len, demo->f) == len)
+        return 0;
+
+    perror("fwrite()");
+    fprintf(stderr, "demo:  Error writing demo file.  Recording stopped.\n");
+    fclose(demo->f);
+    demo->f = NULL;
+    return -1;
+}
+
+/* ======================================================================== */
+/*  DEMO_FLUSH   -- Write out the block buffer, compressing it if asked.    */
+/* ======================================================================== */
+LOCAL void demo_flush(demo_t *demo)
+{
+    demo->blk_frames = 0;
+
+    if (!demo->f || demo->blk_len == 0)
+        return;
+
+#ifndef NO_LZO
+    if (demo->lzo)
+    {
+        uint_8   *buf = demo->lzo_buf;
+        lzo_uint lzo_len = 0;
+        int      r;
+
+        r = lzo1x_1_compress(demo->blk, demo->blk_len,
+                             demo->lzo_buf + BLKHDR_LEN, &lzo_len,
+                             (lzo_voidp)demo->lzo_wrk);
+
+        /* ---------------------------------------------------------------- */
+        /*  Store the block as-is if LZO couldn't shrink it.                */
+        /* ---------------------------------------------------------------- */
+        if (r != LZO_E_OK || lzo_len >= (lzo_uint)demo->blk_len)
+            lzo_len = demo->blk_len;
+
+        EMIT_32(buf, 0x2C3C4C5C);
+        EMIT_32(buf, demo->blk_len);
+        EMIT_32(buf, lzo_len);
+
+        if (lzo_len == (lzo_uint)demo->blk_len)
+        {
+            if (demo_write(demo, demo->lzo_buf, BLKHDR_LEN) == 0)
+                demo_write(demo, demo->blk, demo->blk_len);
+        } else
+        {
+            demo_write(demo, demo->lzo_buf, BLKHDR_LEN + lzo_len);
+        }
+
+        demo->blk_len = 0;
+        return;
+    }
+#endif
+
+    demo_write(demo, demo->blk, demo->blk_len);
+    demo->blk_len = 0;
+}
+
+/* ======================================================================== */
+/*  DEMO_ROOM    -- Make room for 'len' more bytes in the block buffer,     */
+/*                  flushing it if need be.  Returns where to put them, or  */
+/*                  NULL if recording has stopped.                          */
+/* ======================================================================== */
+LOCAL uint_8 *demo_room(demo_t *demo, int len)
+{
+    if (demo->blk_len + len > demo->blk_max)
+        demo_flush(demo);
+
+    return demo->f ? demo->blk + demo->blk_len : NULL;
+}
+
+/* ======================================================================== */
+/*  DEMO_EMIT_VOICE  -- Move the voice writes seen so far into a record.    */
+/* ======================================================================== */
+LOCAL void demo_emit_voice(demo_t *demo)
+{
+    uint_8 *buf, *start;
+    int i;
+
+    if (demo->voice_cnt == 0)
+        return;
+
+    if (!(buf = start = demo_room(demo, 6 + 2 * demo->voice_cnt)))
+        return;
+
+    EMIT_32(buf, 0x2B3B4B5B);
+    EMIT_16(buf, demo->voice_cnt);
+    for (i = 0; i < demo->voice_cnt; i++)
+        EMIT_16(buf, demo->voice[i]);
+
+    demo->blk_len  += buf - start;
+    demo->voice_cnt = 0;
+}
+
+/* ======================================================================== */
+/*  DEMO_VOICE   -- Called from IVOICE_WR for each write it accepts.        */
+/* ======================================================================== */
+void demo_voice(demo_t *demo, int addr, uint_32 data)
+{
+    if (!demo->f)
+        return;
+
+    if (demo->voice_cnt == DEMO_VOICE_MAX)
+        demo_emit_voice(demo);
+
+    demo->voice[demo->voice_cnt++] = (addr ? 0x8000 : 0) | (data & 0x7FF);
+}
+
 
 /* ======================================================================== */
 /*  DEMO_TICK    -- Called from STIC_TICK at the start of VBlank.           */
@@ -139,8 +286,10 @@ void demo_tick
     uint_32 psg0_chg    = { 0 };
     uint_32 psg1_chg    = { 0 };
     uint_32 mask;
-    uint_8  *buf;
+    uint_8  *buf, *start;
 
+    if (!demo->f)
+        return;
 
     /* -------------------------------------------------------------------- */
     /*  Scan the STIC registers and look for changes.  Ignore "dontcares".  */
@@ -246,8 +395,13 @@ void demo_tick
     /*      N bytes     BTAB cards (2 bytes each)                           */
     /*      N bytes     PSG0 registers (1 byte each)                        */
     /*      N bytes     PSG1 registers (1 byte each)                        */
+    /*                                                                      */
+    /*  Any voice writes from this frame go in their own record first.      */
     /* -------------------------------------------------------------------- */
-    buf = demo_buf;
+    demo_emit_voice(demo);
+
+    if (!(buf = start = demo_room(demo, FRAME_MAX)))
+        return;
 
     EMIT_32(buf, 0x2A3A4A5A);
     EMIT_32(buf, stic_chg);
@@ -280,9 +434,12 @@ void demo_tick
         if ((psg1_chg >> i) & 1)
             EMIT_8(buf, demo->psg1_reg[i]);
 
-    assert((size_t)(buf - demo_buf) <= sizeof(demo_buf));
+    assert(buf - start <= FRAME_MAX);
 
-    fwrite(demo_buf, 1, buf - demo_buf, demo->f);
+    demo->blk_len += buf - start;
+
+    if (++demo->blk_frames >= demo->flush_frames)
+        demo_flush(demo);
 
     return;
 }
@@ -296,17 +453,53 @@ int demo_init
     demo_t      *demo,
     char        *demo_file,
     ay8910_t    *psg0,
-    ay8910_t    *psg1
+    ay8910_t    *psg1,
+    int         flush_frames,
+    int         lzo
 )
 {
     memset(demo, 0, sizeof(*demo));
 
+    if (flush_frames < 1)         flush_frames = 1;
+    if (flush_frames > FLUSH_MAX) flush_frames = FLUSH_MAX;
+
+#ifdef NO_LZO
+    if (lzo)
+    {
+        fprintf(stderr, "demo:  No LZO support.  Recording uncompressed.\n");
+        lzo = 0;
+    }
+#endif
+
+    demo->flush_frames = flush_frames;
+    demo->lzo          = lzo;
+    demo->blk_max      = flush_frames * (FRAME_MAX + VOICE_MAX);
+    demo->blk          = CALLOC(uint_8, demo->blk_max);
+
+#ifndef NO_LZO
+    if (lzo)
+    {
+        /* Worst case LZO1X output, per the LZO documentation.              */
+        demo->lzo_buf = CALLOC(uint_8, BLKHDR_LEN + demo->blk_max +
+                                       demo->blk_max / 16 + 64 + 3);
+        demo->lzo_wrk = CALLOC(uint_8, LZO1X_1_MEM_COMPRESS);
+    }
+#endif
+
+    if (!demo->blk || (lzo && (!demo->lzo_buf || !demo->lzo_wrk)))
+    {
+        fprintf(stderr, "demo:  Out of memory\n");
+        demo_dtor(demo);
+        return -1;
+    }
+
     if (!(demo->f = fopen(demo_file, "wb")))
     {
         perror("fopen()");
         fprintf(stderr, "Could not open demo file '%s' for writing.\n",
                 demo_file);
 
+        demo_dtor(demo);
         return -1;
     }
 
@@ -321,8 +514,22 @@ int demo_init
 /* ======================================================================== */
 void demo_dtor(demo_t *demo)
 {
-    if (demo && demo->f)
+    if (!demo)
+        return;
+
+    if (demo->f)
+    {
+        demo_emit_voice(demo);
+        demo_flush(demo);
+    }
+
+    if (demo->f)
         fclose(demo->f);
+
+    demo->f = NULL;
+    CONDFREE(demo->blk);
+    CONDFREE(demo->lzo_buf);
+    CONDFREE(demo->lzo_wrk);
 }
 
 /* ======================================================================== */
@@ -4,13 +4,19 @@
  *  Author:   J. Zbiciak
  * ============================================================================
  *  This module implements a "demo recorder", which records updates to GRAM,
- *  BACKTAB and the PSG to a file.  Currently it does not record Intellivoice.
+ *  BACKTAB and the PSG to a file, along with writes to the Intellivoice.
+ *
+ *  Records are collected in a block buffer and written out every so many
+ *  frames, optionally compressed with LZO.  See demo.c for the format.
  * ============================================================================
  */
 
 #ifndef DEMO_H_
 #define DEMO_H_ 1
 
+#define DEMO_FLUSH_FRAMES   (60)    /* Default frames per block.            */
+#define DEMO_VOICE_MAX      (256)   /* Voice writes per voice record.       */
+
 #ifndef STIC_T_
 #define STIC_T_ 1
 typedef struct stic_t stic_t;
@@ -32,6 +38,19 @@ typedef struct demo_t
     ay8910_t    *psg0, *psg1;
     uint_16     psg0_reg[16];
     uint_16     psg1_reg[16];
+
+    uint_16     voice[DEMO_VOICE_MAX];  /* Intellivoice writes this frame.  */
+    int         voice_cnt;
+
+    uint_8      *blk;           /* Records waiting to be written.           */
+    int         blk_len;        /* Bytes in blk.                            */
+    int         blk_max;        /* Size of blk.                             */
+    int         blk_frames;     /* Frames in blk.                           */
+    int         flush_frames;   /* Write blk out after this many frames.    */
+
+    int         lzo;            /* Compress each block with LZO.            */
+    uint_8      *lzo_buf;       /* Compressed block.                        */
+    uint_8      *lzo_wrk;       /* LZO compressor's work memory.            */
 } demo_t;
 
 /* ======================================================================== */
@@ -44,14 +63,23 @@ void demo_tick
 );
 
 /* ======================================================================== */
-/*  DEMO_INIT    -- Initialize the demo recorder.                           */
+/*  DEMO_VOICE   -- Called from IVOICE_WR for each write it accepts.        */
+/*                  'addr' is 0 for the ALD, 1 for the FIFO.                */
+/* ======================================================================== */
+void demo_voice(demo_t *demo, int addr, uint_32 data);
+
+/* ======================================================================== */
+/*  DEMO_INIT    -- Initialize the demo recorder.  Records are written out  */
+/*                  every 'flush_frames' frames, compressed if 'lzo'.       */
 /* ======================================================================== */
 int demo_init
 (
     demo_t      *demo,
     char        *demo_file,
     ay8910_t    *psg0,
-    ay8910_t    *psg1
+    ay8910_t    *psg1,
+    int         flush_frames,
+    int         lzo
 );
 
 void demo_dtor(demo_t *demo);
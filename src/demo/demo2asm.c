@@ -18,10 +18,18 @@
 /*                                                                          */
 /*  The assembly format output by this converter will evolve alongside the  */
 /*  player.  Make sure that the player and the converter are matched!       */
+/*                                                                          */
+/*  Demos recorded with --demo-lzo come in LZO compressed blocks.  We       */
+/*  unpack those as we load the file.  Intellivoice writes are kept with    */
+/*  the frame they happened in, and written out as a table by frame.        */
 /* ======================================================================== */
 
 #include "config.h"
 
+#ifndef NO_LZO
+# include "minilzo/minilzo.h"
+#endif
+
 /* ======================================================================== */
 /*  Utility functions for pulling apart frames.                             */
 /* ======================================================================== */
@@ -75,9 +83,26 @@ static inline uint_8 get_8(uint_8 **buf)
 /*      N bytes     PSG0 registers (1 byte each)                            */
 /*      N bytes     PSG1 registers (1 byte each)                            */
 /*                                                                          */
+/*  Voice record format, ahead of the frame the writes happened in:         */
+/*                                                                          */
+/*      4 bytes     0x2B3B4B5B  Voice header                                */
+/*      2 bytes     Number of writes                                        */
+/*      N bytes     Writes (2 bytes each):                                  */
+/*                      Bit 15:     0 == ALD ($0080), 1 == FIFO ($0081)     */
+/*                      Bits 10-0:  Value written                           */
+/*                                                                          */
+/*  LZO block format, wrapped around the above when recorded with LZO:      */
+/*                                                                          */
+/*      4 bytes     0x2C3C4C5C  Block header                                */
+/*      4 bytes     Length of the records                                   */
+/*      4 bytes     Length stored.  If equal to the above, the records      */
+/*                  are stored as-is, otherwise they're LZO compressed.     */
+/*      N bytes     The records                                             */
+/*                                                                          */
 /* ======================================================================== */
 
 #define HDR_SZ (4+4+8+30+2+2)
+#define BLK_SZ (4+4+4)
 
 typedef struct frame_t
 {
@@ -94,6 +119,9 @@ typedef struct frame_t
     uint_16 btab[240];
     uint_8  psg0[14 ];
     uint_8  psg1[14 ];
+
+    uint_16 *voice;     // Intellivoice writes during this frame.
+    int     voice_cnt;
 } frame_t;
 
 /* ======================================================================== */
@@ -160,6 +188,124 @@ int tile_to_id(uint_8 *tile)
 
 int gr_chg_hist[64];
 int bt_chg_hist[240];
+int voice_writes = 0;
+
+/* ------------------------------------------------------------------------ */
+/*  Voice writes after the last frame, from a recording cut off mid-frame.  */
+/*  They belong to the frame that would have come next.                     */
+/* ------------------------------------------------------------------------ */
+uint_16 *trail_voice = NULL;
+int      trail_cnt   = 0;
+int      num_frames  = 0;
+
+/* ======================================================================== */
+/*  LOAD_DEMO_FILE   -- Read the whole demo file into memory, unpacking     */
+/*                      LZO blocks if it has them.                          */
+/* ======================================================================== */
+uint_8 *demo_data = NULL;
+long    demo_len  = 0;
+long    demo_pos  = 0;
+
+void load_demo_file(char *fname)
+{
+    FILE *f;
+    uint_8 *file, *buf;
+    long file_len, pos, raw_len, st_len;
+
+    /* -------------------------------------------------------------------- */
+    /*  Open up the file and slurp it in.                                   */
+    /* -------------------------------------------------------------------- */
+    if (!(f = fopen(fname, "rb")))
+    {
+        perror("fopen()");
+        fprintf(stderr, "Could not open '%s' for reading\n", fname);
+        exit(1);
+    }
+
+    fseek(f, 0, SEEK_END);
+    file_len = ftell(f);
+    rewind(f);
+
+    if (!(file = malloc(file_len + 1)) ||
+        (long)fread(file, 1, file_len, f) != file_len)
+    {
+        fprintf(stderr, "Could not read '%s'\n", fname);
+        exit(1);
+    }
+    fclose(f);
+
+    /* -------------------------------------------------------------------- */
+    /*  Without LZO, the file is just the records.                          */
+    /* -------------------------------------------------------------------- */
+    buf = file;
+    if (file_len < BLK_SZ || GET_32(buf) != 0x2C3C4C5C)
+    {
+        demo_data = file;
+        demo_len  = file_len;
+        return;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Otherwise, unpack it one block at a time.                           */
+    /* -------------------------------------------------------------------- */
+    for (pos = 0; pos < file_len; pos += BLK_SZ + st_len)
+    {
+        buf = file + pos;
+
+        if (file_len - pos < BLK_SZ || GET_32(buf) != 0x2C3C4C5C)
+        {
+            fprintf(stderr, "Bad LZO block header at file offset %ld\n", pos);
+            exit(1);
+        }
+
+        raw_len = GET_32(buf);
+        st_len  = GET_32(buf);
+
+        if (st_len > file_len - pos - BLK_SZ || st_len > raw_len ||
+            !(demo_data = realloc(demo_data, demo_len + raw_len)))
+        {
+            fprintf(stderr, "Bad LZO block at file offset %ld\n", pos);
+            exit(1);
+        }
+
+        if (st_len == raw_len)
+        {
+            memcpy(demo_data + demo_len, buf, raw_len);
+        } else
+        {
+#ifndef NO_LZO
+            lzo_uint len = raw_len;
+
+            if (lzo1x_decompress_safe(buf, st_len, demo_data + demo_len,
+                                      &len, NULL) != LZO_E_OK ||
+                (long)len != raw_len)
+#endif
+            {
+                fprintf(stderr, "Could not unpack LZO block at file "
+                                "offset %ld\n", pos);
+                exit(1);
+            }
+        }
+
+        demo_len += raw_len;
+    }
+
+    free(file);
+}
+
+/* ======================================================================== */
+/*  DEMO_READ        -- fread() workalike for the loaded demo.              */
+/* ======================================================================== */
+int demo_read(void *dst, int size, int cnt)
+{
+    if (cnt > (demo_len - demo_pos) / size)
+        cnt = (demo_len - demo_pos) / size;
+
+    memcpy(dst, demo_data + demo_pos, size * cnt);
+    demo_pos += size * cnt;
+
+    return cnt;
+}
 
 
 /* ======================================================================== */
@@ -173,7 +319,6 @@ frame_t *read_demo_file(char *fname)
     frame_t *head = NULL;
     frame_t *curr = NULL;
     frame_t *prev = NULL;
-    FILE *f;
 
     uint_8 hdr[HDR_SZ], *buf;
     uint_8 stic_tmp[32*2];
@@ -186,19 +331,45 @@ frame_t *read_demo_file(char *fname)
     int i, j;
     int stic_cnt, gram_cnt, btab_cnt, psg0_cnt, psg1_cnt;
     int frame_no = 0;
+    uint_16 *voice = NULL;
+    int voice_cnt = 0, cnt;
 
     /* -------------------------------------------------------------------- */
-    /*  Open up the file and prepare to parse!                              */
+    /*  Load up the file and prepare to parse!                              */
     /* -------------------------------------------------------------------- */
-    if (!(f = fopen(fname, "rb")))
-    {
-        perror("fopen()");
-        fprintf(stderr, "Could not open '%s' for reading\n", fname);
-        exit(1);
-    }
+    load_demo_file(fname);
 
-    while ((r = fread(hdr, 1, HDR_SZ, f)) == HDR_SZ)
+    while (demo_len - demo_pos >= 6)
     {
+        /* ---------------------------------------------------------------- */
+        /*  Collect voice records for the frame that follows them.          */
+        /* ---------------------------------------------------------------- */
+        buf = demo_data + demo_pos;
+
+        if (GET_32(buf) == 0x2B3B4B5B)
+        {
+            cnt = GET_16(buf);
+            demo_pos += 6;
+
+            if (demo_len - demo_pos < 2 * cnt ||
+                !(voice = realloc(voice, (voice_cnt + cnt) * 2)))
+            {
+                fprintf(stderr,
+                        "Short read getting voice record.\n"
+                        "File offset:  %llu\n", (uint_64)demo_pos);
+                exit(1);
+            }
+
+            for (i = 0; i < cnt; i++)
+                voice[voice_cnt++] = GET_16(buf);
+
+            demo_pos += 2 * cnt;
+            continue;
+        }
+
+        if ((r = demo_read(hdr, 1, HDR_SZ)) != HDR_SZ)
+            break;
+
         /* ---------------------------------------------------------------- */
         /*  Allocate structure and prepare to read the header.              */
         /* ---------------------------------------------------------------- */
@@ -216,6 +387,12 @@ frame_t *read_demo_file(char *fname)
         if (!head) 
             head = curr;
 
+        curr->voice     = voice;
+        curr->voice_cnt = voice_cnt;
+        voice_writes   += voice_cnt;
+        voice           = NULL;
+        voice_cnt       = 0;
+
         buf = hdr;
 
         sig = GET_32(buf);
@@ -226,7 +403,7 @@ frame_t *read_demo_file(char *fname)
                     "Expected frame signature, got %.8X instead\n"
                     "File offset:  %llu\n"
                     "Frame number: %d\n",
-                    sig, (uint_64)ftell(f), frame_no);
+                    sig, (uint_64)demo_pos, frame_no);
             exit(1);
         }
 
@@ -275,47 +452,47 @@ frame_t *read_demo_file(char *fname)
         }
 
         if (stic_cnt &&
-            (r = fread(stic_tmp, 2, stic_cnt, f)) != stic_cnt)
+            (r = demo_read(stic_tmp, 2, stic_cnt)) != stic_cnt)
         {
             fprintf(stderr, 
                     "Short read getting STIC regs from frame.\n"
-                    "File offset:  %llu\n", (uint_64)ftell(f));
+                    "File offset:  %llu\n", (uint_64)demo_pos);
             exit(1);
         }
 
         if (gram_cnt &&
-            (r = fread(gram_tmp, 8, gram_cnt, f)) != gram_cnt)
+            (r = demo_read(gram_tmp, 8, gram_cnt)) != gram_cnt)
         {
             fprintf(stderr, 
                     "Short read getting GRAM tiles from frame.\n"
-                    "File offset:  %llu\n", (uint_64)ftell(f));
+                    "File offset:  %llu\n", (uint_64)demo_pos);
             exit(1);
         }
 
         if (btab_cnt &&
-            (r = fread(btab_tmp, 2, btab_cnt, f)) != btab_cnt)
+            (r = demo_read(btab_tmp, 2, btab_cnt)) != btab_cnt)
         {
             fprintf(stderr, 
                     "Short read getting BTAB cards from frame.\n"
-                    "File offset:  %llu\n", (uint_64)ftell(f));
+                    "File offset:  %llu\n", (uint_64)demo_pos);
             exit(1);
         }
 
         if (psg0_cnt &&
-            (r = fread(psg0_tmp, 1, psg0_cnt, f)) != psg0_cnt)
+            (r = demo_read(psg0_tmp, 1, psg0_cnt)) != psg0_cnt)
         {
             fprintf(stderr, 
                     "Short read getting PSG0 registers from frame.\n"
-                    "File offset:  %llu\n", (uint_64)ftell(f));
+                    "File offset:  %llu\n", (uint_64)demo_pos);
             exit(1);
         }
 
         if (psg1_cnt &&
-            (r = fread(psg1_tmp, 1, psg1_cnt, f)) != psg1_cnt)
+            (r = demo_read(psg1_tmp, 1, psg1_cnt)) != psg1_cnt)
         {
             fprintf(stderr, 
                     "Short read getting PSG1 registers from frame.\n"
-                    "File offset:  %llu\n", (uint_64)ftell(f));
+                    "File offset:  %llu\n", (uint_64)demo_pos);
             exit(1);
         }
 
@@ -369,6 +546,18 @@ frame_t *read_demo_file(char *fname)
         bt_chg_hist[btab_cnt]++;
     }
 
+    /* -------------------------------------------------------------------- */
+    /*  Voice writes after the last frame go with the frame after it.       */
+    /* -------------------------------------------------------------------- */
+    trail_voice   = voice;
+    trail_cnt     = voice_cnt;
+    voice_writes += voice_cnt;
+    num_frames    = frame_no;
+
+    if (trail_cnt)
+        fprintf(stderr, "%d Intellivoice writes after the last frame; "
+                        "listed under frame %d\n", trail_cnt, frame_no);
+
     /* -------------------------------------------------------------------- */
     /*  And that's it.  Seriously!                                          */
     /* -------------------------------------------------------------------- */
@@ -376,13 +565,65 @@ frame_t *read_demo_file(char *fname)
 }
 
 
+/* ======================================================================== */
+/*  PUT_VOICE        -- Write one frame's voice writes as table entries.    */
+/*                      A count only holds 10 bits, so a busy frame may     */
+/*                      take more than one entry.                           */
+/* ======================================================================== */
+void put_voice(int frame_no, const uint_16 *voice, int voice_cnt)
+{
+    int i, n;
+
+    while (voice_cnt > 0)
+    {
+        n = voice_cnt > 1023 ? 1023 : voice_cnt;
+
+        printf("        BIDECLE %-15d ; Frame %d\n", frame_no, frame_no);
+        printf("        DECLE   %-15d ; Writes\n", n);
+
+        for (i = 0; i < n; i++)
+            printf("        BIDECLE $%.4X           ; $%.4X <- $%.3X\n",
+                   voice[i], voice[i] & 0x8000 ? 0x81 : 0x80,
+                   voice[i] & 0x7FF);
+
+        voice     += n;
+        voice_cnt -= n;
+    }
+}
+
+/* ======================================================================== */
+/*  PUT_VOICE_TABLE  -- Write all the voice writes as one table:  for each  */
+/*                      frame with writes, its number, how many, and each   */
+/*                      write as recorded.  Bit 15 picks the address, $80   */
+/*                      or $81, and bits 10-0 hold the value.  A frame      */
+/*                      number of $FFFF ends the table.                     */
+/* ======================================================================== */
+void put_voice_table(frame_t *head)
+{
+    frame_t *curr;
+    int frame_no = 0;
+
+    printf("\n;; Intellivoice writes, by frame.  Bit 15 of each write "
+           "picks $0080 or $0081.\n");
+    printf("VOICE_TBL:\n");
+
+    for (curr = head; curr; curr = curr->next, frame_no++)
+        put_voice(frame_no, curr->voice, curr->voice_cnt);
+
+    put_voice(num_frames, trail_voice, trail_cnt);
+
+    printf("        BIDECLE $FFFF           ; End of table\n");
+}
+
 main(int argc, char *argv[])
 {
     int i, j, k;
+    frame_t *head;
 
-    read_demo_file(argv[1]);
+    head = read_demo_file(argv[1]);
     printf("did it!\n");
     printf("%d unique GRAM tiles\n", num_tiles);
+    printf("%d Intellivoice writes\n", voice_writes);
 
     for (i = 0; i < num_tiles; i++)
     {
@@ -398,5 +639,8 @@ main(int argc, char *argv[])
     for (i = 0; i < 64; i++)
         printf("%4d", gr_chg_hist[i]);
 
+    if (voice_writes)
+        put_voice_table(head);
+
     return 0;
 }
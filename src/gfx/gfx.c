@@ -31,8 +31,10 @@
 #include "gfx_scale.h"
 //#include "file/file.h"
 #include "mvi/mvi.h"
+#include "mvi/mviwrite.h"
 #include "lzoe/lzoe.h"
 #include "file/file.h"
+#include "serializer/snapshot.h"
 
 #ifdef GCWZERO
 #include "jzintv.h"
@@ -62,6 +64,7 @@ typedef struct gfx_pvt_t
 
     int         movie_init;         /*  Is movie structure initialized?     */
     mvi_t       *movie;             /*  Pointer to mvi_t to reduce deps     */
+    mviw_t      *mviw;              /*  Encoder thread for current movie    */
 
     uint_8  *RESTRICT inter_vid;    /*  Intermediate video after prescaler  */
     uint_8  *RESTRICT prev;         /*  previous frame for dirty-rect       */
@@ -83,6 +86,7 @@ typedef struct gfx_pvt_t
 
 } gfx_pvt_t;
 
+LOCAL void gfx_ser_init(periph_p p);
 LOCAL void gfx_dtor(periph_p p);
 LOCAL void gfx_tick_generic(gfx_t *gfx);
 LOCAL void gfx_find_dirty_rects(gfx_t *gfx);
@@ -597,6 +601,7 @@ int gfx_init(gfx_t *gfx, int desire_x, int desire_y, int desire_bpp,
     gfx->periph.max_tick    = 14934;
     gfx->periph.addr_base   = 0;
     gfx->periph.addr_mask   = 0;
+    gfx->periph.ser_init    = gfx_ser_init;
     gfx->periph.dtor        = gfx_dtor;
 
 #ifdef BENCHMARK_GFX
@@ -618,6 +623,20 @@ die:
     return -1;
 }
 
+/* ======================================================================== */
+/*  GFX_SER_INIT -- Register the frame bookkeeping and border settings for  */
+/*                  snapshots.  The display itself is redrawn on resync.    */
+/*                  None of it feeds back into the machine, so it is all    */
+/*                  left out of the state hash.                             */
+/* ======================================================================== */
+LOCAL void gfx_ser_init(periph_p p)
+{
+    gfx_t *gfx = (gfx_t *)p;
+
+    SNAP_DERIVED_FIELDS(p->name, gfx, gfx_t, bbox,    tot_dropped_frames);
+    SNAP_DERIVED_FIELDS(p->name, gfx, gfx_t, b_color, debug_blank);
+}
+
 /* ======================================================================== */
 /*  GFX_DTOR     -- Tear down the gfx_t                                     */
 /* ======================================================================== */
@@ -628,9 +647,13 @@ LOCAL void gfx_dtor(periph_p p)
     if (gfx->pvt &&
         gfx->pvt->movie)
     {
+        mviw_destroy(gfx->pvt->mviw);
+        gfx->pvt->mviw = NULL;
+
         if (gfx->pvt->movie->f)
             fclose(gfx->pvt->movie->f);
 
+        mvi_dtor(gfx->pvt->movie);
         CONDFREE(gfx->pvt->movie);
     }
 
@@ -1442,6 +1465,12 @@ void gfx_movieupd(gfx_t *gfx)
         /* ---------------------------------------------------------------- */
         if ((gfx->scrshot & GFX_MOVIE) != 0) 
         {
+            /* ------------------------------------------------------------ */
+            /*  Let the encoder thread finish before we touch the movie.    */
+            /* ------------------------------------------------------------ */
+            mviw_destroy(pvt->mviw);
+            pvt->mviw = NULL;
+
             if (pvt->movie->f)
             {
                 fclose(pvt->movie->f);
@@ -1519,10 +1548,21 @@ void gfx_movieupd(gfx_t *gfx)
         /* ---------------------------------------------------------------- */
         gfx->scrshot |= GFX_MOVIE;
         pvt->movie->fr = 0;
+
+        /* ---------------------------------------------------------------- */
+        /*  Encode on a thread if we can, so that encoding and writing      */
+        /*  don't cost us frames.  If not, encode inline as before.         */
+        /* ---------------------------------------------------------------- */
+        pvt->mviw = mviw_create(pvt->movie);
     }
 
     if ((gfx->scrshot & GFX_RESET) == 0)
-        mvi_wr_frame(pvt->movie, gfx->vid, gfx->bbox);
+    {
+        if (pvt->mviw)
+            mviw_frame(pvt->mviw, gfx->vid, gfx->bbox);
+        else
+            mvi_wr_frame(pvt->movie, gfx->vid, gfx->bbox);
+    }
 }
 
 
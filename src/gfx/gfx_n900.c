@@ -392,6 +392,7 @@ LOCAL void gfx_dtor(periph_p p)
         if (gfx->pvt->movie->f)
             fclose(gfx->pvt->movie->f);
 
+        mvi_dtor(gfx->pvt->movie);
         CONDFREE(gfx->pvt->movie);
     }
 
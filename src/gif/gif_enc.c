@@ -30,7 +30,7 @@ LOCAL int     gif_img_sz  = 0;
 LOCAL int gen_mpi(uint_8 *src, uint_8 *xtra, uint_8 *dst, 
                   int cnt, uint_8 *pal);
 
-int gif_best_stats[6];
+int gif_best_stat[6];
 
 /* ======================================================================== */
 /*  GIF_START -- Starts a single or multi-frame GIF.                        */
@@ -65,6 +65,7 @@ int gif_start
     {
         gif->vid = gif->pal = NULL;
     }
+    gif->lzw = CALLOC(lzw_t, 1);
 
     if (!gif_enc_buf || gif_enc_buf_sz < x_dim * y_dim * 2)
     {
@@ -73,7 +74,7 @@ int gif_start
         gif_enc_buf    = CALLOC(uint_8, gif_enc_buf_sz);
     }
 
-    if (!gif_enc_buf || (multi && (!gif->pal || !gif->vid)))
+    if (!gif_enc_buf || !gif->lzw || (multi && (!gif->pal || !gif->vid)))
     {
         fprintf(stderr, "gif_start: out of memory\n");
         return -1;
@@ -197,6 +198,7 @@ int gif_finish(gif_t *gif)
     /* -------------------------------------------------------------------- */
     if (gif->vid) { free(gif->vid); gif->vid = NULL; }
     if (gif->pal) { free(gif->pal); gif->pal = NULL; }
+    if (gif->lzw) { lzw_dtor(gif->lzw); free(gif->lzw); gif->lzw = NULL; }
 
     return 1;   /* wrote 1 byte. */
 }
@@ -235,8 +237,8 @@ int gif_wr_frame_s
     /* -------------------------------------------------------------------- */
     /*  Now compress the image.                                             */
     /* -------------------------------------------------------------------- */
-    lzw_len = lzw_encode(vid, enc_ptr, gif->x_dim*gif->y_dim, 
-                         gif_enc_buf_sz - (enc_ptr - gif_enc_buf));
+    lzw_len = lzw_encode(gif->lzw, vid, enc_ptr, gif->x_dim*gif->y_dim,
+                         gif_enc_buf_sz - (enc_ptr - gif_enc_buf), -1);
 
     if (lzw_len < 0)
         return -1;
@@ -321,6 +323,7 @@ int gif_wr_frame_m
     int x, y, xx, yy, min_x, min_y, max_x, max_y, width, height;
     int n_col_d, n_col_e = 0, n_col_f = 0, lct_sz_d, lct_sz_e, lct_sz_f;
     int enc_sz_a, enc_sz_b, enc_sz_c, enc_sz_d, enc_sz_e, enc_sz_f;
+    int max_a, max_b = 0, max_c = 0, best_max;
     int best_sz, best_lct_sz, trans_idx, do_trans = 0;
     int lzw_len; 
     int cnt, num_trans = 0;
@@ -495,22 +498,34 @@ int gif_wr_frame_m
     /*                                                                      */
     /*  We reuse gif_img_tr as a compression buffer here, since we don't    */
     /*  need that image any longer, but we do need a temp buffer for LZW.   */
-    /* -------------------------------------------------------------------- */
-    enc_sz_a  = lzw_encode(gif_img_a, gif_img_tr, cnt, gif_img_sz*2);
+    /*                                                                      */
+    /*  With no extra image, gen_mpi() hands out colors in ascending order, */
+    /*  so the last palette entry is the largest color in the image.  The   */
+    /*  largest pixel in a remapped image is one less than its color count. */
+    /*  That saves the LZW encoder rescanning every image for them.         */
+    /* -------------------------------------------------------------------- */
+    max_a     = gif_pal_d[n_col_d - 1];
+    enc_sz_a  = lzw_encode(gif->lzw, gif_img_a, gif_img_tr, cnt,
+                           gif_img_sz*2, max_a);
     enc_sz_b  = -1;
     enc_sz_c  = -1;
-    enc_sz_d  = lzw_encode(gif_img_d, gif_img_tr, cnt, gif_img_sz*2);
+    enc_sz_d  = lzw_encode(gif->lzw, gif_img_d, gif_img_tr, cnt,
+                           gif_img_sz*2, n_col_d - 1);
     enc_sz_e  = -1;
     enc_sz_f  = -1;
     if (trans)
     {
-        enc_sz_b = lzw_encode(gif_img_b, gif_img_tr, cnt, gif_img_sz*2);
-        enc_sz_e = lzw_encode(gif_img_e, gif_img_tr, cnt, gif_img_sz*2);
+        max_b    = gif_pal_e[n_col_e - 1];
+        enc_sz_b = lzw_encode(gif->lzw, gif_img_b, gif_img_tr, cnt,
+                              gif_img_sz*2, max_b);
+        enc_sz_e = lzw_encode(gif->lzw, gif_img_e, gif_img_tr, cnt,
+                              gif_img_sz*2, n_col_e - 1);
 #if 1
-        enc_sz_c = lzw_encode2(gif_img_b,  gif_img_a, 
-                               gif_img_tr, cnt, gif_img_sz);
-        enc_sz_f = lzw_encode2(gif_img_f,  gif_img_d, 
-                               gif_img_tr, cnt, gif_img_sz);
+        max_c    = max_a > max_b ? max_a : max_b;
+        enc_sz_c = lzw_encode2(gif->lzw, gif_img_b,  gif_img_a,
+                               gif_img_tr, cnt, gif_img_sz, max_c);
+        enc_sz_f = lzw_encode2(gif->lzw, gif_img_f,  gif_img_d,
+                               gif_img_tr, cnt, gif_img_sz, n_col_f - 1);
 #endif
     }
 
@@ -531,6 +546,7 @@ int gif_wr_frame_m
     best_lct    = NULL;
     best_lct_sz = 0;
     best_sz     = enc_sz_a;
+    best_max    = max_a;
     trans_idx   = 0;
     do_trans    = 0;
     best        = 'a';
@@ -543,6 +559,7 @@ int gif_wr_frame_m
         best_lct    = NULL;
         best_lct_sz = 0;
         best_sz     = enc_sz_b;
+        best_max    = max_b;
         trans_idx   = gif->trans;
         do_trans    = 1;
         best        = 'b';
@@ -555,6 +572,7 @@ int gif_wr_frame_m
         best_lct    = gif_pal_d;
         best_lct_sz = lct_sz_d;
         best_sz     = enc_sz_d;
+        best_max    = n_col_d - 1;
         trans_idx   = 0;
         do_trans    = 0;
         best        = 'd';
@@ -567,6 +585,7 @@ int gif_wr_frame_m
         best_lct    = gif_pal_e;
         best_lct_sz = lct_sz_e;
         best_sz     = enc_sz_e;
+        best_max    = n_col_e - 1;
         trans_idx   = n_col_e - 1;
         do_trans    = 1;
         best        = 'e';
@@ -579,6 +598,7 @@ int gif_wr_frame_m
         best_lct    = NULL;
         best_lct_sz = 0;
         best_sz     = enc_sz_c;
+        best_max    = max_c;
         trans_idx   = gif->trans;
         do_trans    = 1;
         best        = 'c';
@@ -591,6 +611,7 @@ int gif_wr_frame_m
         best_lct    = gif_pal_f;
         best_lct_sz = lct_sz_f;
         best_sz     = enc_sz_f;
+        best_max    = n_col_f - 1;
         trans_idx   = n_col_f - 1;
         do_trans    = 1;
         best        = 'f';
@@ -662,13 +683,15 @@ int gif_wr_frame_m
     /* -------------------------------------------------------------------- */
     if (best_img2)
     {
-        lzw_len = lzw_encode2(best_img1, best_img2, enc_ptr, cnt, 
-                              gif_enc_buf_sz - (enc_ptr - gif_enc_buf) - 1);
+        lzw_len = lzw_encode2(gif->lzw, best_img1, best_img2, enc_ptr, cnt,
+                              gif_enc_buf_sz - (enc_ptr - gif_enc_buf) - 1,
+                              best_max);
 
     } else
     {
-        lzw_len = lzw_encode(best_img1, enc_ptr, cnt,
-                             gif_enc_buf_sz - (enc_ptr - gif_enc_buf) - 1);
+        lzw_len = lzw_encode(gif->lzw, best_img1, enc_ptr, cnt,
+                             gif_enc_buf_sz - (enc_ptr - gif_enc_buf) - 1,
+                             best_max);
     }
     if (lzw_len < 0)
     {
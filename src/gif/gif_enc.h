@@ -19,9 +19,10 @@ typedef struct gif_t
     int     x_dim, y_dim;
     int     trans, n_cols;
     uint_8  *vid, *pal;
+    struct lzw_t *lzw;      /* LZW code table, reused for every frame.      */
 } gif_t;
 
-int gif_best_stat[6];
+extern int gif_best_stat[6];
 
 /* ======================================================================== */
 /*  GIF_START -- Starts a single or multi-frame GIF.                        */
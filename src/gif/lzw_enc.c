@@ -8,7 +8,9 @@
 /*  My data structure is entirely uncreative.  I use an N-way tree to       */
 /*  represent the current code table.  It's dirt simple to implement, but   */
 /*  it's a memory pig.  Since the longest code is 12 bits, I use indices    */
-/*  instead of pointers, and use a static table of codes.                   */
+/*  instead of pointers.  The table belongs to the caller's lzw_t, so it    */
+/*  carries over from one image to the next.  Clearing it only touches the  */
+/*  rows that were actually chained from.                                   */
 /* ======================================================================== */
 
 #include "config.h"
@@ -21,10 +23,10 @@
 #endif
 
 
-int lzw_encode(const uint_8 *i_buf, uint_8 *o_buf, int i_len, int max_o_len)
+int lzw_encode(lzw_t *lzw, const uint_8 *i_buf, uint_8 *o_buf,
+               int i_len, int max_o_len, int max_sym)
 {
-    static uint_16 *dict = NULL;
-    static int      dict_size = 0;
+    uint_16 *dict;
     const uint_8 *i_end = i_buf + i_len;
     const uint_8 *i_ptr;
     uint_8 *o_end = o_buf + max_o_len - 1; 
@@ -32,7 +34,7 @@ int lzw_encode(const uint_8 *i_buf, uint_8 *o_buf, int i_len, int max_o_len)
     uint_8 *last_len_byte;
     int i;
     int code_size;
-    int max_sym = 0, dict_stride;
+    int dict_stride;
     uint_32 curr_word = 0;
     int curr_bits = 0;
     int code = 0, next_new_code, curr_size;
@@ -40,12 +42,14 @@ int lzw_encode(const uint_8 *i_buf, uint_8 *o_buf, int i_len, int max_o_len)
     int next_char = 0, next_code;
 
     /* -------------------------------------------------------------------- */
-    /*  First, scan the buffer and determine the total dynamic range of     */
-    /*  the input bytes.  We'll pick our starting code size based on that.  */
+    /*  If the caller doesn't know the total dynamic range of the input     */
+    /*  bytes, scan the buffer for it.  We'll pick our starting code size   */
+    /*  based on that.                                                      */
     /* -------------------------------------------------------------------- */
-    for (i = 0; i < i_len; i++)
-        if (i_buf[i] > max_sym) 
-            max_sym = i_buf[i];
+    if (max_sym < 0)
+        for (i = 0; i < i_len; i++)
+            if (i_buf[i] > max_sym)
+                max_sym = i_buf[i];
     dict_stride = max_sym + 1;
     Dprintf(("max_sym = %.2X\n", max_sym));
 
@@ -60,15 +64,18 @@ int lzw_encode(const uint_8 *i_buf, uint_8 *o_buf, int i_len, int max_o_len)
     /*  Allocate the dictionary.  We store the tree in a 2-D array.  One    */
     /*  dimension is the code number, and the other is the codes it chains  */
     /*  to.  We size this to the maximum number of symbols in the input,    */
-    /*  so that it's not too big.                                           */
+    /*  so that it's not too big, and only grow it when we have to.         */
     /* -------------------------------------------------------------------- */
-    if (dict_size < dict_stride)
+    if (lzw->dict_size < dict_stride)
     {
-        if (dict) 
-            free(dict);
-        dict      = CALLOC(uint_16, 4096 * dict_stride);
-        dict_size = dict_stride;
+        CONDFREE(lzw->dict);
+        lzw->dict      = CALLOC(uint_16, 4096 * dict_stride);
+        lzw->dict_size = lzw->dict ? dict_stride : 0;
+        lzw->dirty     = 0;
+        if (!lzw->dict)
+            return -1;
     }
+    dict = lzw->dict;
 
     /* -------------------------------------------------------------------- */
     /*  Output the code length, and prepare to compress.                    */
@@ -94,7 +101,9 @@ int lzw_encode(const uint_8 *i_buf, uint_8 *o_buf, int i_len, int max_o_len)
 
         /* ---------------------------------------------------------------- */
         /*  If dictionary's full, send a clear code and flush dictionary.   */
-        /*  Otherwise, patch the previous code+char into the dictionary.    */
+        /*  Otherwise, patch the previous code+char into the dictionary,    */
+        /*  unless it's the end.  We still count the code, as that decides  */
+        /*  how wide end-of-info goes out.                                  */
         /* ---------------------------------------------------------------- */
         if (next_new_code == 0x1000)
         {
@@ -123,13 +132,18 @@ int lzw_encode(const uint_8 *i_buf, uint_8 *o_buf, int i_len, int max_o_len)
 
             curr_size = code_size + 1;
             next_new_code = (1 << code_size) + 2;
-            memset(dict, 0, 4096*sizeof(uint_16)*dict_stride);
+            memset(dict, 0, lzw->dirty * sizeof(uint_16));
+            lzw->dirty = 0;
         } else
         {
             Dprintf(("new code: %.3X = %.3X + %.2X\n", next_new_code, 
                      code, next_char));
 
-            dict[code*dict_stride + next_char] = next_new_code;
+            if (next_char != end_of_info)
+            {
+                dict[code*dict_stride + next_char] = next_new_code;
+                lzw->dirty = next_new_code * dict_stride;
+            }
             if (next_new_code == (1 << curr_size))
                 curr_size++;
             next_new_code++;
@@ -240,18 +254,17 @@ overflow:
 # define Dprintf(x) 
 #endif
 
-int lzw_encode2(const uint_8 *i_buf, const uint_8 *i_buf_alt,
-                uint_8 *o_buf, int i_len, int max_o_len)
+int lzw_encode2(lzw_t *lzw, const uint_8 *i_buf, const uint_8 *i_buf_alt,
+                uint_8 *o_buf, int i_len, int max_o_len, int max_sym)
 {
-    static uint_16 *dict = NULL;
-    static int      dict_size = 0;
+    uint_16 *dict;
     int i_idx = 0;
     uint_8 *o_end = o_buf + max_o_len - 1; 
     uint_8 *o_ptr; 
     uint_8 *last_len_byte;
     int i;
     int code_size;
-    int max_sym = 0, dict_stride;
+    int dict_stride;
     uint_32 curr_word = 0;
     int curr_bits = 0;
     int code = 0, next_new_code, curr_size;
@@ -259,16 +272,18 @@ int lzw_encode2(const uint_8 *i_buf, const uint_8 *i_buf_alt,
     int next_char = 0, next_code;
 
     /* -------------------------------------------------------------------- */
-    /*  First, scan the buffer and determine the total dynamic range of     */
-    /*  the input bytes.  We'll pick our starting code size based on that.  */
+    /*  If the caller doesn't know the total dynamic range of the input     */
+    /*  bytes, scan the buffers for it.  We'll pick our starting code size  */
+    /*  based on that.                                                      */
     /* -------------------------------------------------------------------- */
-    for (i = 0; i < i_len; i++)
-    {
-        if (i_buf[i] > max_sym) 
-            max_sym = i_buf[i];
-        if (i_buf_alt[i] > max_sym) 
-            max_sym = i_buf_alt[i];
-    }
+    if (max_sym < 0)
+        for (i = 0; i < i_len; i++)
+        {
+            if (i_buf[i] > max_sym)
+                max_sym = i_buf[i];
+            if (i_buf_alt[i] > max_sym)
+                max_sym = i_buf_alt[i];
+        }
 
     dict_stride = max_sym + 1;
     Dprintf(("max_sym = %.2X\n", max_sym));
@@ -284,15 +299,18 @@ int lzw_encode2(const uint_8 *i_buf, const uint_8 *i_buf_alt,
     /*  Allocate the dictionary.  We store the tree in a 2-D array.  One    */
     /*  dimension is the code number, and the other is the codes it chains  */
     /*  to.  We size this to the maximum number of symbols in the input,    */
-    /*  so that it's not too big.                                           */
+    /*  so that it's not too big, and only grow it when we have to.         */
     /* -------------------------------------------------------------------- */
-    if (dict_size < dict_stride)
+    if (lzw->dict_size < dict_stride)
     {
-        if (dict) 
-            free(dict);
-        dict      = CALLOC(uint_16, 4096 * dict_stride);
-        dict_size = dict_stride;
+        CONDFREE(lzw->dict);
+        lzw->dict      = CALLOC(uint_16, 4096 * dict_stride);
+        lzw->dict_size = lzw->dict ? dict_stride : 0;
+        lzw->dirty     = 0;
+        if (!lzw->dict)
+            return -1;
     }
+    dict = lzw->dict;
 
     /* -------------------------------------------------------------------- */
     /*  Output the code length, and prepare to compress.                    */
@@ -317,7 +335,9 @@ int lzw_encode2(const uint_8 *i_buf, const uint_8 *i_buf_alt,
 
         /* ---------------------------------------------------------------- */
         /*  If dictionary's full, send a clear code and flush dictionary.   */
-        /*  Otherwise, patch the previous code+char into the dictionary.    */
+        /*  Otherwise, patch the previous code+char into the dictionary,    */
+        /*  unless it's the end.  We still count the code, as that decides  */
+        /*  how wide end-of-info goes out.                                  */
         /* ---------------------------------------------------------------- */
         if (next_new_code == 0x1000)
         {
@@ -346,13 +366,18 @@ int lzw_encode2(const uint_8 *i_buf, const uint_8 *i_buf_alt,
 
             curr_size = code_size + 1;
             next_new_code = (1 << code_size) + 2;
-            memset(dict, 0, 4096*sizeof(uint_16)*dict_stride);
+            memset(dict, 0, lzw->dirty * sizeof(uint_16));
+            lzw->dirty = 0;
         } else
         {
             Dprintf(("new code: %.3X = %.3X + %.2X\n", next_new_code, 
                      code, next_char));
 
-            dict[code*dict_stride + next_char] = next_new_code;
+            if (next_char != end_of_info)
+            {
+                dict[code*dict_stride + next_char] = next_new_code;
+                lzw->dirty = next_new_code * dict_stride;
+            }
             if (next_new_code == (1 << curr_size))
                 curr_size++;
             next_new_code++;
@@ -473,6 +498,16 @@ overflow:
     return -1;
 }
 
+/* ======================================================================== */
+/*  LZW_DTOR     -- Free an lzw_t's code table.                             */
+/* ======================================================================== */
+void lzw_dtor(lzw_t *lzw)
+{
+    CONDFREE(lzw->dict);
+    lzw->dict_size = 0;
+    lzw->dirty     = 0;
+}
+
 
 /* ======================================================================== */
 /*  This program is free software; you can redistribute it and/or modify    */
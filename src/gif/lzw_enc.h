@@ -8,15 +8,36 @@
 /*  My data structure is entirely uncreative.  I use an N-way tree to       */
 /*  represent the current code table.  It's dirt simple to implement, but   */
 /*  it's a memory pig.  Since the longest code is 12 bits, I use indices    */
-/*  instead of pointers, and use a static table of codes.                   */
+/*  instead of pointers.                                                    */
+/*                                                                          */
+/*  The table lives in an lzw_t that the caller owns, so that it can be     */
+/*  reused from one image to the next, and so that separate lzw_t's can     */
+/*  encode in separate threads.  A zeroed lzw_t is ready to use.            */
+/*                                                                          */
+/*  'max_sym' is the largest byte value in the input(s).  Callers that      */
+/*  already know it save a pass over the image.  Pass -1 to have the        */
+/*  encoder scan for it.                                                    */
 /* ======================================================================== */
 
 #ifndef LZW_ENC_H_
 #define LZW_ENC_H_ 1
 
-int lzw_encode (const uint_8 *i_buf, uint_8 *o_buf, int i_len, int max_o_len);
-int lzw_encode2(const uint_8 *i_buf, const uint_8 *i_buf_alt,
-                      uint_8 *o_buf, int i_len, int max_o_len);
+typedef struct lzw_t
+{
+    uint_16 *dict;          /* 4096 x dict_size table of chained codes.     */
+    int     dict_size;      /* Symbols per row the table has room for.      */
+    int     dirty;          /* Entries that may be non-zero, from the top.  */
+} lzw_t;
+
+int lzw_encode (lzw_t *lzw, const uint_8 *i_buf, uint_8 *o_buf,
+                int i_len, int max_o_len, int max_sym);
+int lzw_encode2(lzw_t *lzw, const uint_8 *i_buf, const uint_8 *i_buf_alt,
+                      uint_8 *o_buf, int i_len, int max_o_len, int max_sym);
+
+/* ======================================================================== */
+/*  LZW_DTOR     -- Free an lzw_t's code table.                             */
+/* ======================================================================== */
+void lzw_dtor(lzw_t *lzw);
 
 #endif
 /* ======================================================================== */
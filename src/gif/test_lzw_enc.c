@@ -40,6 +40,7 @@ int main(void)
     FILE *f;
     int x, y, i;
     uint_8 *gif_ptr = gif_file;
+    lzw_t lzw;
 
     for (y = 0; y < 200; y++)
         for (x = 0; x < 160; x++)
@@ -64,7 +65,9 @@ int main(void)
     gif_ptr += sizeof(gif_local);
 
     /* now compress the image */
-    i = lzw_encode(image, gif_ptr, 200*160, 65536-10-13-768-2);
+    memset(&lzw, 0, sizeof(lzw));
+    i = lzw_encode(&lzw, image, gif_ptr, 200*160, 65536-10-13-768-2, -1);
+    lzw_dtor(&lzw);
 
     if (i < 0)
     {
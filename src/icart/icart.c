@@ -14,6 +14,7 @@
 #include "cp1600/cp1600.h"
 #include "lzoe/lzoe.h"
 #include "icart/icart.h"
+#include "serializer/snapshot.h"
 
 /* ======================================================================== */
 /*  ICART_CALC_BS    -- Calculate an address for a bank-switched address.   */
@@ -78,24 +79,29 @@ void    icart_wr_f   (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
     icart_t *ic = (icart_t *)(per->parent);
     UNUSED(ign);
     ic->rom.image[addr] = data;
+    SNAP_DIRTY(ic->dirty, addr);
 }
 void    icart_wr_fn  (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
 {
     icart_t *ic = (icart_t *)(per->parent);
     UNUSED(ign);
     ic->rom.image[addr] = data & 0xFF;
+    SNAP_DIRTY(ic->dirty, addr);
 }
 void    icart_wr_b   (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
 {
     icart_t *ic = (icart_t *)(per->parent);
     UNUSED(ign);
-    ic->rom.image[icart_calc_bs(ic, addr)] = data;
+    addr = icart_calc_bs(ic, addr);
+    ic->rom.image[addr] = data;
+    SNAP_DIRTY(ic->dirty, addr);
 }
 void    icart_wr_bn  (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
 {
     icart_t *ic = (icart_t *)(per->parent);
     UNUSED(ign);
     ic->rom.image[addr] = data & 0xFF;
+    SNAP_DIRTY(ic->dirty, addr);
 }
 
 /* ======================================================================== */
@@ -369,7 +375,7 @@ int icart_register
 )
 {
     int         attr, p_attr;
-    int         i, idx, shf;
+    int         i, j, idx, shf;
     char        buf[17];
     int         has_banksw = 0;
     uint_32     addr_lo, addr_hi;
@@ -464,6 +470,22 @@ int icart_register
         ic->bs.dtor      = NULL;
 
         periph_register(bus, &(ic->bs), 0x40, 0x5F, "ICart BankSw");
+        snap_register(ic->bs.name, ic->bs_tbl, sizeof(ic->bs_tbl));
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Snapshots only need the writable pages of the image.  Register    */
+    /*  each run of writable pages as one span, tracked by the writers.     */
+    /* -------------------------------------------------------------------- */
+    for (i = 0; i < 256; i = j + 1)
+    {
+        for (j = i; j < 256 && (1 & (ic->rom.writable[j >> 5] >> (j & 31)));
+             j++)
+            ;
+
+        if (j > i)
+            snap_track("ICart RAM", ic->rom.image, i << 8, (j - i) * 256,
+                       sizeof(uint_16), ic->dirty);
     }
 
     return 0;
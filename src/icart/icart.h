@@ -26,6 +26,7 @@ typedef struct icart_t
     uint_32     bs_tbl[32];
     icartrom_t  rom;
     int         cache_bs;
+    uint_32     dirty[8];   /* RAM pages written since last snapshot.       */
 } icart_t;
 
 /* ======================================================================== */
@@ -52,11 +52,11 @@
 #define jzdprintf(x)
 #endif
 
-#undef HIGH_QUALITY
-#define SCBUF_SIZE   (4096)             /* Must be power of 2               */
+#define SCBUF_SIZE   (LPC12_SCBUF_SIZE) /* Must be power of 2               */
 #define SCBUF_MASK   (SCBUF_SIZE - 1)
 #define PER_PAUSE    (64)               /* Equiv timing period for pauses.  */
-#define PER_NOISE    (64)               /* Equiv timing period for noise.   */
+#define RS_TAPS      (16)               /* Default resampler taps/phase.    */
+#define RS_PHASES    (256)              /* Resampler phases.                */
 
 #define FIFO_ADDR    (0x1800 << 3)      /* SP0256 address of speech FIFO.   */
 
@@ -73,78 +73,24 @@
 #include "lzoe/lzoe.h"
 #include "file/file.h"
 #include "ivoice.h"
+#include "lpc12.h"
+#include "resamp.h"
+#include "snd/wavwrite.h"
+#include "serializer/snapshot.h"
 
 /* ======================================================================== */
 /*  Internal function prototypes.                                           */
 /* ======================================================================== */
-LOCAL INLINE sint_16 limit (sint_16 s);
 LOCAL INLINE uint_32 bitrev(uint_32 val);
-LOCAL int            lpc12_update(lpc12_t *f, int, sint_16 *, uint_32 *);
-LOCAL void           lpc12_regdec(lpc12_t *f);
 LOCAL uint_32        sp0256_getb(ivoice_t *ivoice, int len);
 LOCAL void           sp0256_micro(ivoice_t *iv);
 LOCAL void           iv_smp_start (ivoice_t *iv);
 LOCAL void           iv_smp_stop  (ivoice_t *iv);
 LOCAL INLINE void    iv_smp_record(ivoice_t *iv, int ns, sint_16 *out, int id);
+LOCAL int            iv_rs_drain  (ivoice_t *iv);
+LOCAL uint_32        ivoice_tk_state(periph_t *per, uint_32 len);
 
 
-LOCAL const uint_8 wav_hdr[44] =
-{
-    0x52, 0x49, 0x46, 0x46, /* "RIFF"                                       */
-    0x00, 0x00, 0x00, 0x00, /* Total file length - 8                        */
-    0x57, 0x41, 0x56, 0x45, /* "WAVE"                                       */
-    0x66, 0x6D, 0x74, 0x20, /* "fmt "                                       */
-    0x10, 0x00, 0x00, 0x00, /* 0x10 == PCM                                  */
-    0x01, 0x00,             /* 0x01 == PCM                                  */
-    0x01, 0x00,             /* 1 channel                                    */
-    0x10, 0x27, 0x00, 0x00, /* Sample rate == 10kHz                         */
-    0x20, 0x4E, 0x00, 0x00, /* Byte rate == 20 kB/sec                       */
-    0x02, 0x00,             /* Block alignment:  channels * bits/sample / 8 */
-    0x10, 0x00,             /* Bits/sample = 16.                            */
-    0x64, 0x61, 0x74, 0x61, /* "data"                                       */
-    0x00, 0x00, 0x00, 0x00  /* Total sample data length                     */
-};
-
-/* ======================================================================== */
-/*  IV_SMP_UPHDR -- Update length field in header for each sample block.    */
-/* ======================================================================== */
-LOCAL void iv_smp_uphdr(ivoice_t *iv)
-{
-    uint_32 tot_smp_bytes, tot_file_bytes;
-    uint_8  upd_wav_hdr[44];
-
-    /* -------------------------------------------------------------------- */
-    /*  Poke the size information into the header both places it appears.   */
-    /*  Do this to a private copy of the header.                            */
-    /* -------------------------------------------------------------------- */
-    memcpy(upd_wav_hdr, wav_hdr, 44);
-
-    tot_smp_bytes  = iv->smp_totsmp * 2;
-    tot_file_bytes = tot_smp_bytes + 36; 
-
-    /* Total file size, minus first 8 bytes */
-    upd_wav_hdr[ 4] = (tot_file_bytes >>  0) & 0xFF;
-    upd_wav_hdr[ 5] = (tot_file_bytes >>  8) & 0xFF;
-    upd_wav_hdr[ 6] = (tot_file_bytes >> 16) & 0xFF;
-    upd_wav_hdr[ 7] = (tot_file_bytes >> 24) & 0xFF;
-
-    /* Total size of sample-data payload */
-    upd_wav_hdr[40] = (tot_smp_bytes  >>  0) & 0xFF;
-    upd_wav_hdr[41] = (tot_smp_bytes  >>  8) & 0xFF;
-    upd_wav_hdr[42] = (tot_smp_bytes  >> 16) & 0xFF;
-    upd_wav_hdr[43] = (tot_smp_bytes  >> 24) & 0xFF;
-
-    /* -------------------------------------------------------------------- */
-    /*  Rewind to the beginning of the file to write the header.  Skip      */
-    /*  it if the seek fails for some reason.                               */
-    /* -------------------------------------------------------------------- */
-    if (fseek(iv->smp_file, 0, SEEK_SET) == 0)
-    {
-        fwrite(upd_wav_hdr, 44, 1, iv->smp_file);
-        fseek(iv->smp_file,  0, SEEK_END);
-    }
-}
-
 /* ======================================================================== */
 /*  IV_SMP_START -- Start a new sample recording file.                      */
 /* ======================================================================== */
@@ -188,8 +134,8 @@ LOCAL void iv_smp_start(ivoice_t *iv)
     iv->smp_totsmp = 0;
     if (iv->smp_file)
     {
-        /* Write an initial WAV header w/out size information initially. */
-        fwrite(wav_hdr, 1, sizeof(wav_hdr), iv->smp_file);
+        /* The writer thread puts the WAV header on the file. */
+        wavw_begin(iv->smp_wavw, iv->smp_file, 10000);
         jzp_clear_and_eol(
                 jzp_printf("ivoice:  starting sample: %s", iv->smp_cname)); 
         jzp_flush();
@@ -209,13 +155,6 @@ LOCAL void iv_smp_stop(ivoice_t *iv)
     if (!iv->smp_tname || !iv->smp_file)
         return;
 
-    /* -------------------------------------------------------------------- */
-    /*  Write the file length to the header and close the file.             */
-    /* -------------------------------------------------------------------- */
-    iv_smp_uphdr(iv);
-    fclose(iv->smp_file);
-    iv->smp_file = NULL;
-
     jzp_clear_and_eol(
         jzp_printf("ivoice:  stopping sample: %s  CRC: %.8X  len: %d", 
                    iv->smp_cname, iv->smp_cursum, iv->smp_totsmp));
@@ -230,12 +169,15 @@ LOCAL void iv_smp_stop(ivoice_t *iv)
                 break;
 
     /* -------------------------------------------------------------------- */
-    /*  If we found a match, so don't keep it.                              */
+    /*  Have the writer thread fix up the header and close the file.  If    */
+    /*  we found a match, it also deletes the file, as we don't keep it.    */
     /* -------------------------------------------------------------------- */
+    wavw_end(iv->smp_wavw, i != iv->smp_number ? iv->smp_cname : NULL);
+    iv->smp_file = NULL;
+
     if (i != iv->smp_number)
     {
         jzp_printf("ivoice:  sample was a repeat of earlier sample: %d\n", i);
-        unlink(iv->smp_cname);
         return;
     }
 
@@ -251,258 +193,26 @@ LOCAL void iv_smp_stop(ivoice_t *iv)
 LOCAL INLINE void iv_smp_record(ivoice_t *iv, int num_samp, sint_16 *out,
                                  int oidx)
 {
-    uint_8 buf[SCBUF_SIZE * 2];
-
     if (iv->smp_file)
     {
-        int i;
-
-        for (i = 0; i < num_samp; i++)
-        {
-            buf[2*i + 0] =  out[(i+oidx) & SCBUF_MASK]       & 0xFF;
-            buf[2*i + 1] = (out[(i+oidx) & SCBUF_MASK] >> 8) & 0xFF;
-        }
-        fwrite(buf, 2, num_samp, iv->smp_file);
-        iv->smp_totsmp += num_samp;
-        iv_smp_uphdr(iv);  /* fix bug where early exit leaves 0 len in hdr. */
-    }
-}
-
-LOCAL INLINE void iv_smp_ckupd(ivoice_t *iv, uint_8 byte)
-{
-    iv->smp_cursum = CRC32_UPDATE(iv->smp_cursum, byte);
-}
-
-/* ======================================================================== */
-/*  IVOICE_QTBL  -- Coefficient Quantization Table.  This comes from a      */
-/*                  SP0250 data sheet, and should be correct for SP0256.    */
-/* ======================================================================== */
-LOCAL const sint_16 qtbl[128] =
-{
-    0,      9,      17,     25,     33,     41,     49,     57,
-    65,     73,     81,     89,     97,     105,    113,    121,
-    129,    137,    145,    153,    161,    169,    177,    185,
-    193,    201,    209,    217,    225,    233,    241,    249,
-    257,    265,    273,    281,    289,    297,    301,    305,
-    309,    313,    317,    321,    325,    329,    333,    337,
-    341,    345,    349,    353,    357,    361,    365,    369,
-    373,    377,    381,    385,    389,    393,    397,    401,
-    405,    409,    413,    417,    421,    425,    427,    429,
-    431,    433,    435,    437,    439,    441,    443,    445,
-    447,    449,    451,    453,    455,    457,    459,    461,
-    463,    465,    467,    469,    471,    473,    475,    477,
-    479,    481,    482,    483,    484,    485,    486,    487,
-    488,    489,    490,    491,    492,    493,    494,    495,
-    496,    497,    498,    499,    500,    501,    502,    503,
-    504,    505,    506,    507,    508,    509,    510,    511
-};
-
-/* ======================================================================== */
-/*  LIMIT            -- Limiter function for digital sample output.         */
-/* ======================================================================== */
-LOCAL INLINE sint_16 limit(sint_16 s)
-{
-#ifdef HIGH_QUALITY /* Higher quality than the original, but who cares? */
-    if (s >  8191) return  8191;
-    if (s < -8192) return -8192;
-#else
-    if (s >  127) return  127;
-    if (s < -128) return -128;
-#endif
-    return s;
-}
-
-/* ======================================================================== */
-/*  SAMP_MPY         -- Multiply sample w/ coef                             */
-/* ======================================================================== */
-LOCAL int samp_mpy(int coef, int samp)
-{
-    return coef * samp;
-}
+        int head = num_samp;
 
-/* ======================================================================== */
-/*  AMP_DECODE       -- Decode amplitude register                           */
-/* ======================================================================== */
-LOCAL int amp_decode(uint_8 a)
-{
-    /* -------------------------------------------------------------------- */
-    /*  Amplitude has 3 bits of exponent and 5 bits of mantissa.  This      */
-    /*  contradicts USP 4,296,269 but matches the SP0250 Apps Manual.       */
-    /* -------------------------------------------------------------------- */
-    int expn = (a & 0xE0) >> 5;
-    int mant = (a & 0x1F);
-    int ampl = mant << expn;
-
-    /* -------------------------------------------------------------------- */
-    /*  Careful reading of USP 4,296,279, around line 60 in column 14 on    */
-    /*  page 16 of the scan suggests the LSB might be held and injected     */
-    /*  into the output while the exponent gets counted down, although      */
-    /*  this seems dubious.                                                 */
-    /* -------------------------------------------------------------------- */
-#if 0
-    if (mant & 1)
-        ampl |= (1 << expn) - 1;
-#endif
-
-    return ampl;
-}
-
-/* ======================================================================== */
-/*  LPC12_UPDATE     -- Update the 12-pole filter, outputting samples.      */
-/* ======================================================================== */
-LOCAL int lpc12_update(lpc12_t *f, int num_samp, sint_16 *out, uint_32 *optr)
-{
-    int i, j;
-    sint_16 samp;
-    int do_int, bit;
-    int oidx = *optr;
-
-    /* -------------------------------------------------------------------- */
-    /*  Iterate up to the desired number of samples.  We actually may       */
-    /*  break out early if our repeat count expires.                        */
-    /* -------------------------------------------------------------------- */
-    for (i = 0; i < num_samp; i++)
-    {
         /* ---------------------------------------------------------------- */
-        /*  Generate a series of periodic impulses, or random noise.        */
+        /*  'out' is a ring.  Hand the writer up to two contiguous spans.   */
         /* ---------------------------------------------------------------- */
-        do_int = 0;
-        samp   = 0;
-        bit    = f->rng & 1;
-        f->rng = (f->rng >> 1) ^ (bit ? 0x4001 : 0);
-
-        if (--f->cnt <= 0)
-        {
-            if (f->rpt-- <= 0)      /* Stop if we expire the repeat counter */
-            {
-                f->cnt = f->rpt = 0;
-                break;
-            }
-
-            f->cnt = f->per ? f->per : PER_NOISE;
-            samp   = f->amp;
-            do_int = f->interp;
-        }
-
-        if (!f->per)
-            samp   = bit ? -f->amp : f->amp;
+        oidx &= SCBUF_MASK;
+        if (oidx + head > SCBUF_SIZE)
+            head = SCBUF_SIZE - oidx;
 
-        /* ---------------------------------------------------------------- */
-        /*  If we need to, process the interpolation registers.             */
-        /* ---------------------------------------------------------------- */
-        if (do_int)
-        {
-            f->r[0] += f->r[14];
-            f->r[1] += f->r[15];
-
-            f->amp   = amp_decode(f->r[0]);
-            f->per   = f->r[1];
-
-            do_int   = 0;
-        }
-
-        /* ---------------------------------------------------------------- */
-        /*  Each 2nd order stage looks like one of these.  The App. Manual  */
-        /*  gives the first form, the patent gives the second form.         */
-        /*  They're equivalent except for time delay.  I implement the      */
-        /*  first form.   (Note: 1/Z == 1 unit of time delay.)              */
-        /*                                                                  */
-        /*          ---->(+)-------->(+)----------+------->                 */
-        /*                ^           ^           |                         */
-        /*                |           |           |                         */
-        /*                |           |           |                         */
-        /*               [B]        [2*F]         |                         */
-        /*                ^           ^           |                         */
-        /*                |           |           |                         */
-        /*                |           |           |                         */
-        /*                +---[1/Z]<--+---[1/Z]<--+                         */
-        /*                                                                  */
-        /*                                                                  */
-        /*                +---[2*F]<---+                                    */
-        /*                |            |                                    */
-        /*                |            |                                    */
-        /*                v            |                                    */
-        /*          ---->(+)-->[1/Z]-->+-->[1/Z]---+------>                 */
-        /*                ^                        |                        */
-        /*                |                        |                        */
-        /*                |                        |                        */
-        /*                +-----------[B]<---------+                        */
-        /*                                                                  */
-        /* ---------------------------------------------------------------- */
-        for (j = 0; j < 6; j++)
-        {
-#if 1
-            samp += (((int)f->b_coef[j] * (int)f->z_data[j][1]) >> 9);
-            samp += (((int)f->f_coef[j] * (int)f->z_data[j][0]) >> 8);
-#else
-            int temp;
-            /*temp  = ((int)f->f_coef[j] * (int)f->z_data[j][0]) << 1;*/
-            /*temp += ((int)f->b_coef[j] * (int)f->z_data[j][1]);*/
-            static int fdly = 0;
-            
-            if (f->f_coef[j] >= 0)
-                temp =    2 * f->f_coef[j] * f->z_data[j][0] + fdly;
-            else
-                temp = -(-2 * f->f_coef[j] * f->z_data[j][0] + fdly);
-            
-            fdly  =  1 & (temp >> 26);
-            temp +=  samp_mpy(f->b_coef[j], f->z_data[j][1]);
-            samp +=  temp >> 9;
-#endif
-
-            f->z_data[j][1] = f->z_data[j][0];
-            f->z_data[j][0] = samp;
-        }
-
-#ifdef HIGH_QUALITY /* Higher quality than the original, but who cares? */
-        out[oidx++ & SCBUF_MASK] = limit(samp) << 2;
-#else 
-        out[oidx++ & SCBUF_MASK] = (limit(samp >> 4) << 8);
-#endif
+        wavw_write(iv->smp_wavw, out + oidx, head);
+        wavw_write(iv->smp_wavw, out, num_samp - head);
+        iv->smp_totsmp += num_samp;
     }
-
-    *optr = oidx;
-
-    return i;
 }
 
-/*LOCAL int stage_map[6] = { 4, 2, 0, 5, 3, 1 };*/
-/*LOCAL int stage_map[6] = { 3, 0, 4, 1, 5, 2 };*/
-/*LOCAL int stage_map[6] = { 3, 0, 1, 4, 2, 5 };*/
-LOCAL const int stage_map[6] = { 0, 1, 2, 3, 4, 5 };
-
-/* ======================================================================== */
-/*  LPC12_REGDEC -- Decode the register set in the filter bank.             */
-/* ======================================================================== */
-LOCAL void lpc12_regdec(lpc12_t *f)
+LOCAL INLINE void iv_smp_ckupd(ivoice_t *iv, uint_8 byte)
 {
-    int i;
-
-    /* -------------------------------------------------------------------- */
-    /*  Decode the Amplitude and Period registers.  Force cnt to 0 to get   */
-    /*  the initial impulse.  (Redundant?)                                  */
-    /* -------------------------------------------------------------------- */
-    f->amp = amp_decode(f->r[0]);
-    f->cnt = 0;
-    f->per = f->r[1];
-
-    /* -------------------------------------------------------------------- */
-    /*  Decode the filter coefficients from the quant table.                */
-    /* -------------------------------------------------------------------- */
-    for (i = 0; i < 6; i++)
-    {
-        #define IQ(x) (((x) & 0x80) ? qtbl[0x7F & -(x)] : -qtbl[(x)])
-
-        f->b_coef[stage_map[i]] = IQ(f->r[2 + 2*i]);
-        f->f_coef[stage_map[i]] = IQ(f->r[3 + 2*i]);
-    }
-
-    /* -------------------------------------------------------------------- */
-    /*  Set the Interp flag based on whether we have interpolation parms    */
-    /* -------------------------------------------------------------------- */
-    f->interp = f->r[14] || f->r[15];
-
-    return;
+    iv->smp_cursum = CRC32_UPDATE(iv->smp_cursum, byte);
 }
 
 /* ======================================================================== */
@@ -1486,6 +1196,22 @@ LOCAL void sp0256_micro(ivoice_t *iv)
         /* ---------------------------------------------------------------- */
         lpc12_regdec(&iv->filt);
 
+        #ifdef LPC12_RECORD
+        {
+            /* Log frames for ivoice/test_lpc12.  Format is in lpc12.h. */
+            static FILE *lpc12_rec = NULL;
+
+            if (!lpc12_rec)
+                lpc12_rec = fopen("lpc12_rec.bin", "wb");
+            if (lpc12_rec)
+            {
+                fputc( iv->filt.rpt       & 0xFF, lpc12_rec);
+                fputc((iv->filt.rpt >> 8) & 0xFF, lpc12_rec);
+                fwrite(iv->filt.r, 1, 16, lpc12_rec);
+            }
+        }
+        #endif
+
         /* ---------------------------------------------------------------- */
         /*  Break out since we now have a repeat count.                     */
         /* ---------------------------------------------------------------- */
@@ -1540,6 +1266,65 @@ LOCAL int ivoice_rdrom(ivoice_t *iv, int page)
     return 0;
 }
 
+/* ======================================================================== */
+/*  IV_RS_DRAIN  -- Drain the scratch buffer through the polyphase          */
+/*                  resampler into the sound buffers.  Returns -1 if we     */
+/*                  ran out of clean buffers, 0 otherwise.                  */
+/* ======================================================================== */
+LOCAL int iv_rs_drain(ivoice_t *ivoice)
+{
+    int idx, len, room, got;
+
+    do
+    {
+        /* ---------------------------------------------------------------- */
+        /*  Give the resampler as much of the scratch buffer as it'll take. */
+        /*  It only holds a little, but always has room once drained.       */
+        /* ---------------------------------------------------------------- */
+        while (ivoice->sc_tail < ivoice->sc_head)
+        {
+            idx = ivoice->sc_tail & SCBUF_MASK;
+            len = ivoice->sc_head - ivoice->sc_tail;
+            if (len > SCBUF_SIZE - idx)
+                len = SCBUF_SIZE - idx;
+
+            got = resamp_push(ivoice->resamp, ivoice->scratch + idx, len);
+            ivoice->sc_tail += got;
+
+            if (got < len)
+                break;
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  Fill as much of the current sound buffer as we can.             */
+        /* ---------------------------------------------------------------- */
+        room = ivoice->snd_buf.snd->buf_size - ivoice->cur_len;
+        got  = resamp_pull(ivoice->resamp, ivoice->cur_buf + ivoice->cur_len,
+                           room);
+        ivoice->cur_len += got;
+
+        /* ---------------------------------------------------------------- */
+        /*  Commit the buffer when it's full, and try to get a clean one.   */
+        /* ---------------------------------------------------------------- */
+        if (got == room)
+        {
+            ivoice->snd_buf.dirty[ivoice->snd_buf.num_dirty++] = 
+                ivoice->cur_buf;
+
+            if (ivoice->snd_buf.num_clean == 0)
+            {
+                ivoice->cur_buf = NULL;
+                return -1;
+            }
+
+            ivoice->cur_buf = 
+                ivoice->snd_buf.clean[--ivoice->snd_buf.num_clean];
+            ivoice->cur_len = 0;
+        }
+    } while (got == room || ivoice->sc_tail < ivoice->sc_head);
+
+    return 0;
+}
 
 /* ======================================================================== */
 /*  IVOICE_TK    -- Where the magic happens.  Generate voice data for       */
@@ -1587,9 +1372,13 @@ uint_32 ivoice_tk(periph_t *per, uint_32 len)
 
         /* ---------------------------------------------------------------- */
         /*  First, drain as much of our scratch buffer as we can into the   */
-        /*  sound buffers.                                                  */
+        /*  sound buffers.  Use the resampler if we have one, otherwise     */
+        /*  fall back to the sliding window below.                          */
         /* ---------------------------------------------------------------- */
-        while (ivoice->sc_tail < ivoice->sc_head)
+        if (ivoice->resamp && iv_rs_drain(ivoice))
+            goto abort;
+
+        while (!ivoice->resamp && ivoice->sc_tail < ivoice->sc_head)
         {
             sint_32 s, ws;
 
@@ -1726,6 +1515,46 @@ abort:
     return (ivoice->sound_current >> 1) - per->now;
 }
 
+/* ======================================================================== */
+/*  IVOICE_TK_STATE -- State-only tick, used when sound is off.  Runs the   */
+/*                     microsequencer on the same schedule as IVOICE_TK,    */
+/*                     so LRQ and the FIFO behave exactly as they would     */
+/*                     with sound, but skips from one period boundary to    */
+/*                     the next instead of generating samples.              */
+/* ======================================================================== */
+LOCAL uint_32 ivoice_tk_state(periph_t *per, uint_32 len)
+{
+    ivoice_t *ivoice = (ivoice_t*)per;
+    uint_64 until = (per->now + len) << 1;
+    int samples, did_samp;
+
+    if (until <= ivoice->sound_current)
+        return 0;
+
+    /* -------------------------------------------------------------------- */
+    /*  Same sample count as IVOICE_TK.  There's no scratch buffer to fill  */
+    /*  up, so we always get through all of them.                           */
+    /* -------------------------------------------------------------------- */
+    samples  = ((int)(until - ivoice->sound_current + 178)) / 179;
+    did_samp = 0;
+
+    while (did_samp < samples)
+    {
+        if (ivoice->filt.rpt <= 0 && ivoice->filt.cnt <= 0)
+            sp0256_micro(ivoice);
+
+        if (ivoice->silent &&
+            ivoice->filt.rpt <= 0 && ivoice->filt.cnt <= 0)
+            did_samp  = samples;
+        else
+            did_samp += lpc12_skip(&ivoice->filt, samples - did_samp);
+    }
+
+    ivoice->sound_current += did_samp * 179;
+
+    return (ivoice->sound_current >> 1) - per->now;
+}
+
 
 /* ======================================================================== */
 /*  IVOICE_RD    -- Handle reads from the Intellivoice.                     */
@@ -1791,6 +1620,9 @@ void ivoice_wr(periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
         ivoice->lrq = 0;
         ivoice->ald = (0xFF & data) << 4;
 
+        if (ivoice->demo)
+            demo_voice(ivoice->demo, 0, data & 0xFF);
+
         return;
     } 
 
@@ -1820,6 +1652,9 @@ void ivoice_wr(periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
             ivoice->mode     = 0;
             ivoice->page     = 0x1000 << 3;
             ivoice->silent   = 1;
+
+            if (ivoice->demo)
+                demo_voice(ivoice->demo, 1, 0x400);
             return;
         }
 
@@ -1841,6 +1676,9 @@ void ivoice_wr(periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
 #endif
         ivoice->fifo[ivoice->fifo_head++ & 63] = data & 0x3FF;
 
+        if (ivoice->demo)
+            demo_voice(ivoice->demo, 1, data & 0x3FF);
+
         return;
     }
 }
@@ -1856,6 +1694,20 @@ LOCAL void ivoice_reset(periph_t *p)
     ivoice_wr(p, NULL, 1, 0x400);
 }
 
+/* ======================================================================== */
+/*  IVOICE_SER_INIT  -- Register the Intellivoice for snapshots.  The       */
+/*                      microsequencer, FIFO and filter go in; the audio    */
+/*                      plumbing and sample files don't.                    */
+/* ======================================================================== */
+LOCAL void ivoice_ser_init(periph_p p)
+{
+    ivoice_t *ivoice = (ivoice_t *)p;
+
+    SNAP_FIELDS(p->name, ivoice, ivoice_t, silent,        silent);
+    SNAP_FIELDS(p->name, ivoice, ivoice_t, sound_current, sample_int);
+    SNAP_FIELDS(p->name, ivoice, ivoice_t, filt,          fifo);
+}
+
 /* ======================================================================== */
 /*  IVOICE_DTOR  -- Destroy an Intellivoice                                 */
 /* ======================================================================== */
@@ -1863,6 +1715,14 @@ LOCAL void ivoice_dtor(periph_p p)
 {
     ivoice_t *ivoice = (ivoice_t *)p;
 
+    iv_smp_stop(ivoice);
+    wavw_destroy(ivoice->smp_wavw);
+    ivoice->smp_wavw = NULL;
+
+    if (ivoice->resamp)
+        resamp_dtor(ivoice->resamp);
+
+    CONDFREE(ivoice->resamp);
     CONDFREE(ivoice->window);
     CONDFREE(ivoice->scratch);
     CONDFREE(ivoice->smp_tname);
@@ -1880,6 +1740,7 @@ int ivoice_init
     snd_t           *snd,       /*  Sound device to register w/.            */
     int             rate,       /*  Desired sample rate.                    */
     int             wind,       /*  Sliding window size.                    */
+    int             taps,       /*  Resampler taps/phase, 0 = use window.   */
     const char      *smp_tname  /*  Filename template for saving samples.   */
 )
 {
@@ -1893,13 +1754,49 @@ int ivoice_init
     /* -------------------------------------------------------------------- */
     /*  Sanity checks.                                                      */
     /* -------------------------------------------------------------------- */
-    if (rate < 10000 || rate > 96000)
+    if ((rate < 10000 || rate > 96000) && rate != 0)
     {
         fprintf(stderr, "ivoice:  Sampling rate of %d is invalid.  Must be "
                         "between 10000 and 96000.\n", rate);
         return -1;
     }
 
+    /* -------------------------------------------------------------------- */
+    /*  With no sound, run in state-only mode:  The microsequencer, FIFO    */
+    /*  and LRQ work as usual, but we don't synthesize any samples, so we   */
+    /*  don't need the resampler, buffers, or the sound device.             */
+    /* -------------------------------------------------------------------- */
+    if (!rate)
+    {
+        if (smp_tname)
+            jzp_printf("ivoice:  Sound is off; not saving voice samples.\n");
+
+        smp_tname = NULL;
+        taps      = 0;
+        wind      = 1;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  If taps == -1, use the default resampler length.  If taps == 0,     */
+    /*  use the old sliding window instead of the resampler.                */
+    /* -------------------------------------------------------------------- */
+    if (taps == -1)
+        taps = RS_TAPS;
+
+    if (taps > 0)
+    {
+        if (!(ivoice->resamp = CALLOC(resamp_t, 1)) ||
+            resamp_init(ivoice->resamp, 3579545, 358, rate, taps, RS_PHASES))
+        {
+            fprintf(stderr, "ivoice:  Could not set up resampler.\n");
+            CONDFREE(ivoice->resamp);
+            return -1;
+        }
+
+        jzp_printf("ivoice:  Polyphase resampler: %d taps x %d phases\n",
+                   ivoice->resamp->taps, ivoice->resamp->phases);
+    }
+
     /* -------------------------------------------------------------------- */
     /*  If wind == -1, calculate a window size based on the ratio of our    */
     /*  sample rate to the device's native rate.                            */
@@ -1911,7 +1808,9 @@ int ivoice_init
 
         if (wind < 1) wind = 1;
 
-        jzp_printf("ivoice:  Automatic sliding-window setting: %d\n", wind);
+        if (!ivoice->resamp)
+            jzp_printf("ivoice:  Automatic sliding-window setting: %d\n",
+                       wind);
     }
 
     /* -------------------------------------------------------------------- */
@@ -1921,8 +1820,9 @@ int ivoice_init
     ivoice->periph.write     = ivoice_wr;
     ivoice->periph.peek      = ivoice_rd;
     ivoice->periph.poke      = ivoice_wr;
-    ivoice->periph.tick      = ivoice_tk;
+    ivoice->periph.tick      = rate ? ivoice_tk : ivoice_tk_state;
     ivoice->periph.reset     = ivoice_reset;
+    ivoice->periph.ser_init  = ivoice_ser_init;
     ivoice->periph.min_tick  = 14934;
     ivoice->periph.max_tick  = 14934;
     ivoice->periph.addr_base = addr;
@@ -1946,16 +1846,17 @@ int ivoice_init
 
 
     /* -------------------------------------------------------------------- */
-    /*  Register this as a sound peripheral with the SND driver.            */
+    /*  Register this as a sound peripheral with the SND driver, and set    */
+    /*  up our initial working buffer.                                      */
     /* -------------------------------------------------------------------- */
-    if (snd_register((periph_p)snd, &ivoice->snd_buf))
-        return -1;
+    if (rate)
+    {
+        if (snd_register((periph_p)snd, &ivoice->snd_buf))
+            return -1;
 
-    /* -------------------------------------------------------------------- */
-    /*  Set up our initial working buffer.                                  */
-    /* -------------------------------------------------------------------- */
-    ivoice->cur_buf = ivoice->snd_buf.clean[--ivoice->snd_buf.num_clean];
-    ivoice->cur_len = 0;
+        ivoice->cur_buf = ivoice->snd_buf.clean[--ivoice->snd_buf.num_clean];
+        ivoice->cur_len = 0;
+    }
 
     /* -------------------------------------------------------------------- */
     /*  Allocate a scratch buffer for generating 10kHz samples.             */
@@ -1993,8 +1894,10 @@ int ivoice_init
     {
         if ((ivoice->smp_tname = strdup(smp_tname)) != NULL)
         {
-            if ((ivoice->smp_cname = CALLOC(char, strlen(smp_tname)+10))==NULL)
+            if ((ivoice->smp_cname = CALLOC(char, strlen(smp_tname)+10))==NULL
+                || (ivoice->smp_wavw = wavw_create()) == NULL)
             {
+                CONDFREE(ivoice->smp_cname);
                 free(ivoice->smp_tname);
                 ivoice->smp_tname = NULL;
             }
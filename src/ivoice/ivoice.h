@@ -43,6 +43,7 @@ typedef struct ivoice_t
     int         wind_sum;   /* Window sum.                                  */
     int         wind_ptr;   /* Window pointer.                              */
     int         rate, wind; /* Sample rate, Window size.                    */
+    struct resamp_t *resamp;/* Polyphase resampler.  NULL: Use window.      */
 
     lpc12_t     filt;       /* 12-pole filter                               */
     int         lrq;        /* Load ReQuest.  == 0 if we can accept a load  */
@@ -64,10 +65,13 @@ typedef struct ivoice_t
     char        *smp_tname; /* File name template for samples.              */
     char        *smp_cname; /* File name template for samples.              */
     FILE        *smp_file;  /* File to put Intellivoice samples in.         */
+    struct wavw_t *smp_wavw;/* Background writer for sample files.          */
     int         smp_number; /* Sequence number for samples.                 */
     uint_32     *smp_cksum; /* Checksum history to avoid saving repeats.    */
     uint_32     smp_cursum; /* Current checksum.                            */
     uint_32     smp_totsmp; /* total number of samples in sample file.      */
+
+    struct demo_t *demo;    /* Demo recorder to report writes to, or NULL.  */
 } ivoice_t;
 
 
@@ -97,6 +101,7 @@ int ivoice_init
     snd_t           *snd,       /*  Sound device to register w/.    */
     int             rate,       /*  Desired sample rate.            */
     int             wind,       /*  Sliding window size.            */
+    int             taps,       /*  Resampler taps/phase, 0 = none. */
     const char      *smp_tname  /*  Sample file name template.      */
 );
 
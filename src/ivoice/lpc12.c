@@ -0,0 +1,581 @@
+/*
+ * ============================================================================
+ *  Title:    SP0256 12-pole LPC Filter
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  The filter proper, split out of ivoice.c so that it can be tested in
+ *  isolation.  See lpc12.h.
+ *
+ *  LPC12_UPDATE spends most of its time between excitation impulses, where
+ *  nothing but the filter taps change.  It runs those stretches through a
+ *  straight-line kernel with the coefficients and delay line held in
+ *  locals, and hands the one sample at each period boundary (where the
+ *  repeat count, interpolation and impulse live) to LPC12_UPDATE_REF.
+ * ============================================================================
+ */
+
+#undef HIGH_QUALITY
+#define PER_NOISE    (64)               /* Equiv timing period for noise.   */
+#define LPC12_BLK    (256)              /* Kernel block length in samples.  */
+
+#include "../config.h"
+#include "periph/periph.h"
+#include "snd/snd.h"
+#include "ivoice.h"
+#include "lpc12.h"
+
+/* ======================================================================== */
+/*  IVOICE_QTBL  -- Coefficient Quantization Table.  This comes from a      */
+/*                  SP0250 data sheet, and should be correct for SP0256.    */
+/* ======================================================================== */
+LOCAL const sint_16 qtbl[128] =
+{
+    0,      9,      17,     25,     33,     41,     49,     57,
+    65,     73,     81,     89,     97,     105,    113,    121,
+    129,    137,    145,    153,    161,    169,    177,    185,
+    193,    201,    209,    217,    225,    233,    241,    249,
+    257,    265,    273,    281,    289,    297,    301,    305,
+    309,    313,    317,    321,    325,    329,    333,    337,
+    341,    345,    349,    353,    357,    361,    365,    369,
+    373,    377,    381,    385,    389,    393,    397,    401,
+    405,    409,    413,    417,    421,    425,    427,    429,
+    431,    433,    435,    437,    439,    441,    443,    445,
+    447,    449,    451,    453,    455,    457,    459,    461,
+    463,    465,    467,    469,    471,    473,    475,    477,
+    479,    481,    482,    483,    484,    485,    486,    487,
+    488,    489,    490,    491,    492,    493,    494,    495,
+    496,    497,    498,    499,    500,    501,    502,    503,
+    504,    505,    506,    507,    508,    509,    510,    511
+};
+
+/* ======================================================================== */
+/*  LIMIT            -- Limiter function for digital sample output.         */
+/* ======================================================================== */
+LOCAL INLINE sint_16 limit(sint_16 s)
+{
+#ifdef HIGH_QUALITY /* Higher quality than the original, but who cares? */
+    if (s >  8191) return  8191;
+    if (s < -8192) return -8192;
+#else
+    if (s >  127) return  127;
+    if (s < -128) return -128;
+#endif
+    return s;
+}
+
+/* ======================================================================== */
+/*  SAMP_MPY         -- Multiply sample w/ coef                             */
+/* ======================================================================== */
+LOCAL int samp_mpy(int coef, int samp)
+{
+    return coef * samp;
+}
+
+/* ======================================================================== */
+/*  AMP_DECODE       -- Decode amplitude register                           */
+/* ======================================================================== */
+LOCAL int amp_decode(uint_8 a)
+{
+    /* -------------------------------------------------------------------- */
+    /*  Amplitude has 3 bits of exponent and 5 bits of mantissa.  This      */
+    /*  contradicts USP 4,296,269 but matches the SP0250 Apps Manual.       */
+    /* -------------------------------------------------------------------- */
+    int expn = (a & 0xE0) >> 5;
+    int mant = (a & 0x1F);
+    int ampl = mant << expn;
+
+    /* -------------------------------------------------------------------- */
+    /*  Careful reading of USP 4,296,279, around line 60 in column 14 on    */
+    /*  page 16 of the scan suggests the LSB might be held and injected     */
+    /*  into the output while the exponent gets counted down, although      */
+    /*  this seems dubious.                                                 */
+    /* -------------------------------------------------------------------- */
+#if 0
+    if (mant & 1)
+        ampl |= (1 << expn) - 1;
+#endif
+
+    return ampl;
+}
+
+/* ======================================================================== */
+/*  LPC12_UPDATE_REF -- Update the 12-pole filter, outputting samples.      */
+/*                      This is the reference version, which processes      */
+/*                      one sample at a time.  LPC12_UPDATE must match it.  */
+/* ======================================================================== */
+int lpc12_update_ref(lpc12_t *f, int num_samp, sint_16 *out, uint_32 *optr)
+{
+    int i, j;
+    sint_16 samp;
+    int do_int, bit;
+    int oidx = *optr;
+
+    /* -------------------------------------------------------------------- */
+    /*  Iterate up to the desired number of samples.  We actually may       */
+    /*  break out early if our repeat count expires.                        */
+    /* -------------------------------------------------------------------- */
+    for (i = 0; i < num_samp; i++)
+    {
+        /* ---------------------------------------------------------------- */
+        /*  Generate a series of periodic impulses, or random noise.        */
+        /* ---------------------------------------------------------------- */
+        do_int = 0;
+        samp   = 0;
+        bit    = f->rng & 1;
+        f->rng = (f->rng >> 1) ^ (bit ? 0x4001 : 0);
+
+        if (--f->cnt <= 0)
+        {
+            if (f->rpt-- <= 0)      /* Stop if we expire the repeat counter */
+            {
+                f->cnt = f->rpt = 0;
+                break;
+            }
+
+            f->cnt = f->per ? f->per : PER_NOISE;
+            samp   = f->amp;
+            do_int = f->interp;
+        }
+
+        if (!f->per)
+            samp   = bit ? -f->amp : f->amp;
+
+        /* ---------------------------------------------------------------- */
+        /*  If we need to, process the interpolation registers.             */
+        /* ---------------------------------------------------------------- */
+        if (do_int)
+        {
+            f->r[0] += f->r[14];
+            f->r[1] += f->r[15];
+
+            f->amp   = amp_decode(f->r[0]);
+            f->per   = f->r[1];
+
+            do_int   = 0;
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  Each 2nd order stage looks like one of these.  The App. Manual  */
+        /*  gives the first form, the patent gives the second form.         */
+        /*  They're equivalent except for time delay.  I implement the      */
+        /*  first form.   (Note: 1/Z == 1 unit of time delay.)              */
+        /*                                                                  */
+        /*          ---->(+)-------->(+)----------+------->                 */
+        /*                ^           ^           |                         */
+        /*                |           |           |                         */
+        /*                |           |           |                         */
+        /*               [B]        [2*F]         |                         */
+        /*                ^           ^           |                         */
+        /*                |           |           |                         */
+        /*                |           |           |                         */
+        /*                +---[1/Z]<--+---[1/Z]<--+                         */
+        /*                                                                  */
+        /*                                                                  */
+        /*                +---[2*F]<---+                                    */
+        /*                |            |                                    */
+        /*                |            |                                    */
+        /*                v            |                                    */
+        /*          ---->(+)-->[1/Z]-->+-->[1/Z]---+------>                 */
+        /*                ^                        |                        */
+        /*                |                        |                        */
+        /*                |                        |                        */
+        /*                +-----------[B]<---------+                        */
+        /*                                                                  */
+        /* ---------------------------------------------------------------- */
+        for (j = 0; j < 6; j++)
+        {
+#if 1
+            samp += (((int)f->b_coef[j] * (int)f->z_data[j][1]) >> 9);
+            samp += (((int)f->f_coef[j] * (int)f->z_data[j][0]) >> 8);
+#else
+            int temp;
+            /*temp  = ((int)f->f_coef[j] * (int)f->z_data[j][0]) << 1;*/
+            /*temp += ((int)f->b_coef[j] * (int)f->z_data[j][1]);*/
+            static int fdly = 0;
+            
+            if (f->f_coef[j] >= 0)
+                temp =    2 * f->f_coef[j] * f->z_data[j][0] + fdly;
+            else
+                temp = -(-2 * f->f_coef[j] * f->z_data[j][0] + fdly);
+            
+            fdly  =  1 & (temp >> 26);
+            temp +=  samp_mpy(f->b_coef[j], f->z_data[j][1]);
+            samp +=  temp >> 9;
+#endif
+
+            f->z_data[j][1] = f->z_data[j][0];
+            f->z_data[j][0] = samp;
+        }
+
+#ifdef HIGH_QUALITY /* Higher quality than the original, but who cares? */
+        out[oidx++ & LPC12_SCBUF_MASK] = limit(samp) << 2;
+#else 
+        out[oidx++ & LPC12_SCBUF_MASK] = (limit(samp >> 4) << 8);
+#endif
+    }
+
+    *optr = oidx;
+
+    return i;
+}
+
+/* ======================================================================== */
+/*  LPC12_STAGE      -- One 2nd order stage, as in LPC12_UPDATE_REF.  The   */
+/*                      cast reproduces the sint_16 wraparound of 'samp'.   */
+/*                      Wrapping twice is the same as wrapping once after   */
+/*                      both adds, so both products stay off the chain of   */
+/*                      dependent adds that runs through the six stages.    */
+/* ======================================================================== */
+#define LPC12_STAGE(s, b, f, z0, z1)                                        \
+    do {                                                                    \
+        s  = (sint_16)(s + ((((b) * (z1)) >> 9) + (((f) * (z0)) >> 8)));    \
+        z1 = z0;                                                            \
+        z0 = s;                                                             \
+    } while (0)
+
+/* ======================================================================== */
+/*  LPC12_FILT_C     -- Run the 12 poles over a block of excitation,        */
+/*                      replacing it with the filter output.  Portable C.   */
+/* ======================================================================== */
+LOCAL void lpc12_filt_c(lpc12_t *RESTRICT f, sint_16 *RESTRICT x, int len)
+{
+    const sint_16 *RESTRICT b = f->b_coef;
+    const sint_16 *RESTRICT c = f->f_coef;
+    int z00 = f->z_data[0][0], z01 = f->z_data[0][1];
+    int z10 = f->z_data[1][0], z11 = f->z_data[1][1];
+    int z20 = f->z_data[2][0], z21 = f->z_data[2][1];
+    int z30 = f->z_data[3][0], z31 = f->z_data[3][1];
+    int z40 = f->z_data[4][0], z41 = f->z_data[4][1];
+    int z50 = f->z_data[5][0], z51 = f->z_data[5][1];
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        int samp = x[i];
+
+        LPC12_STAGE(samp, b[0], c[0], z00, z01);
+        LPC12_STAGE(samp, b[1], c[1], z10, z11);
+        LPC12_STAGE(samp, b[2], c[2], z20, z21);
+        LPC12_STAGE(samp, b[3], c[3], z30, z31);
+        LPC12_STAGE(samp, b[4], c[4], z40, z41);
+        LPC12_STAGE(samp, b[5], c[5], z50, z51);
+
+        x[i] = samp;
+    }
+
+    f->z_data[0][0] = z00;  f->z_data[0][1] = z01;
+    f->z_data[1][0] = z10;  f->z_data[1][1] = z11;
+    f->z_data[2][0] = z20;  f->z_data[2][1] = z21;
+    f->z_data[3][0] = z30;  f->z_data[3][1] = z31;
+    f->z_data[4][0] = z40;  f->z_data[4][1] = z41;
+    f->z_data[5][0] = z50;  f->z_data[5][1] = z51;
+}
+
+#if defined(__SSE2__)
+/* ======================================================================== */
+/*  LPC12_FILT_SSE2  -- Same as LPC12_FILT_C, as a systolic array.          */
+/*                                                                          */
+/*  Each of the six stages is a 16-bit lane, and lane 'j' works on sample   */
+/*  't - j' while lane 0 works on sample 't'.  Every step, each lane takes  */
+/*  its input from the lane below it on the previous step, so the entire    */
+/*  cascade advances one sample per step.  The first and last five steps    */
+/*  fill and drain the pipe, with the idle lanes' delay lines held.         */
+/*                                                                          */
+/*  The stage math is done mod 2^16, which is what the sint_16 'samp' in    */
+/*  LPC12_UPDATE_REF does.  (b * z) >> 9 only contributes its bits 9..24,   */
+/*  which we put together from PMULLW and PMULHW.  Likewise for >> 8.       */
+/* ======================================================================== */
+#include <emmintrin.h>
+
+#define LPC12_SSE2_STEP(in_samp)                                            \
+    do {                                                                    \
+        __m128i lb_, hb_, lf_, hf_, in_;                                    \
+        in_ = _mm_insert_epi16(_mm_slli_si128(s, 2), (in_samp), 0);         \
+        lb_ = _mm_mullo_epi16(bc, z1);                                      \
+        hb_ = _mm_mulhi_epi16(bc, z1);                                      \
+        lf_ = _mm_mullo_epi16(fc, z0);                                      \
+        hf_ = _mm_mulhi_epi16(fc, z0);                                      \
+        lb_ = _mm_or_si128(_mm_srli_epi16(lb_, 9), _mm_slli_epi16(hb_, 7)); \
+        lf_ = _mm_or_si128(_mm_srli_epi16(lf_, 8), _mm_slli_epi16(hf_, 8)); \
+        s   = _mm_add_epi16(_mm_add_epi16(lb_, lf_), in_);                  \
+    } while (0)
+
+#define LPC12_SSE2_HOLD(m)                                                  \
+    do {                                                                    \
+        z1 = _mm_or_si128(_mm_and_si128(m, z0), _mm_andnot_si128(m, z1));   \
+        z0 = _mm_or_si128(_mm_and_si128(m, s ), _mm_andnot_si128(m, z0));   \
+    } while (0)
+
+LOCAL void lpc12_filt_sse2(lpc12_t *RESTRICT f, sint_16 *RESTRICT x, int len)
+{
+    __m128i bc, fc, z0, z1, s, m;
+    int i;
+
+    bc = _mm_setr_epi16(f->b_coef[0], f->b_coef[1], f->b_coef[2],
+                        f->b_coef[3], f->b_coef[4], f->b_coef[5], 0, 0);
+    fc = _mm_setr_epi16(f->f_coef[0], f->f_coef[1], f->f_coef[2],
+                        f->f_coef[3], f->f_coef[4], f->f_coef[5], 0, 0);
+    z0 = _mm_setr_epi16(f->z_data[0][0], f->z_data[1][0], f->z_data[2][0],
+                        f->z_data[3][0], f->z_data[4][0], f->z_data[5][0],
+                        0, 0);
+    z1 = _mm_setr_epi16(f->z_data[0][1], f->z_data[1][1], f->z_data[2][1],
+                        f->z_data[3][1], f->z_data[4][1], f->z_data[5][1],
+                        0, 0);
+    s  = _mm_setzero_si128();
+
+    /* -------------------------------------------------------------------- */
+    /*  Fill:  Only lanes 0 through 'i' have a sample to work on.           */
+    /* -------------------------------------------------------------------- */
+    for (i = 0; i < 5; i++)
+    {
+        LPC12_SSE2_STEP(x[i]);
+        m = _mm_cmplt_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7),
+                            _mm_set1_epi16(i + 1));
+        LPC12_SSE2_HOLD(m);
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Steady state.  Lane 5 holds the finished sample from 5 steps ago.   */
+    /* -------------------------------------------------------------------- */
+    for (i = 5; i < len; i++)
+    {
+        LPC12_SSE2_STEP(x[i]);
+        z1 = z0;
+        z0 = s;
+        x[i - 5] = _mm_extract_epi16(s, 5);
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Drain:  Lanes below 'i - len + 1' have run out of samples.          */
+    /* -------------------------------------------------------------------- */
+    for (i = len; i < len + 5; i++)
+    {
+        LPC12_SSE2_STEP(0);
+        m = _mm_cmpgt_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7),
+                            _mm_set1_epi16(i - len));
+        LPC12_SSE2_HOLD(m);
+        x[i - 5] = _mm_extract_epi16(s, 5);
+    }
+
+    f->z_data[0][0] = _mm_extract_epi16(z0, 0);
+    f->z_data[1][0] = _mm_extract_epi16(z0, 1);
+    f->z_data[2][0] = _mm_extract_epi16(z0, 2);
+    f->z_data[3][0] = _mm_extract_epi16(z0, 3);
+    f->z_data[4][0] = _mm_extract_epi16(z0, 4);
+    f->z_data[5][0] = _mm_extract_epi16(z0, 5);
+    f->z_data[0][1] = _mm_extract_epi16(z1, 0);
+    f->z_data[1][1] = _mm_extract_epi16(z1, 1);
+    f->z_data[2][1] = _mm_extract_epi16(z1, 2);
+    f->z_data[3][1] = _mm_extract_epi16(z1, 3);
+    f->z_data[4][1] = _mm_extract_epi16(z1, 4);
+    f->z_data[5][1] = _mm_extract_epi16(z1, 5);
+}
+
+/* Fill and drain cost ten steps, so short runs are cheaper in C.           */
+#define LPC12_FILT(f, x, len) \
+    ((len) < 32 ? lpc12_filt_c(f, x, len) : lpc12_filt_sse2(f, x, len))
+#else
+#define LPC12_FILT(f, x, len) lpc12_filt_c(f, x, len)
+#endif
+
+/* ======================================================================== */
+/*  LPC12_RUN        -- Run the filter for 'num_samp' samples that do not   */
+/*                      cross a period boundary.  The excitation for such   */
+/*                      samples is either silence (voiced) or +/- amp from  */
+/*                      the LFSR (unvoiced), so we generate it a block at   */
+/*                      a time, filter the block, then limit and store it.  */
+/* ======================================================================== */
+LOCAL void lpc12_run(lpc12_t *RESTRICT f, int num_samp,
+                     sint_16 *RESTRICT out, uint_32 oidx)
+{
+    sint_16 buf[LPC12_BLK];
+    int     i, len, bit;
+    int     pos, neg;
+    uint_32 rng = f->rng;
+
+    /* -------------------------------------------------------------------- */
+    /*  Between impulses, voiced excitation is zero.  The LFSR still        */
+    /*  steps every sample either way.                                      */
+    /* -------------------------------------------------------------------- */
+    pos = f->per ? 0 : f->amp;
+    neg = -pos;
+
+    f->cnt -= num_samp;
+
+    while (num_samp > 0)
+    {
+        len = num_samp < LPC12_BLK ? num_samp : LPC12_BLK;
+
+        for (i = 0; i < len; i++)
+        {
+            bit    = rng & 1;
+            rng    = (rng >> 1) ^ (0x4001 & -bit);
+            buf[i] = bit ? neg : pos;
+        }
+
+        LPC12_FILT(f, buf, len);
+
+        for (i = 0; i < len; i++)
+        {
+#ifdef HIGH_QUALITY /* Higher quality than the original, but who cares? */
+            out[(oidx + i) & LPC12_SCBUF_MASK] = limit(buf[i]) << 2;
+#else 
+            out[(oidx + i) & LPC12_SCBUF_MASK] = (limit(buf[i] >> 4) << 8);
+#endif
+        }
+
+        oidx     += len;
+        num_samp -= len;
+    }
+
+    f->rng = rng;
+}
+
+/* ======================================================================== */
+/*  LPC12_UPDATE     -- Update the 12-pole filter, outputting samples.      */
+/* ======================================================================== */
+int lpc12_update(lpc12_t *f, int num_samp, sint_16 *out, uint_32 *optr)
+{
+    int i = 0, len;
+
+    while (i < num_samp)
+    {
+        /* ---------------------------------------------------------------- */
+        /*  Samples that leave 'cnt' above zero are plain filter work.      */
+        /* ---------------------------------------------------------------- */
+        len = f->cnt - 1;
+        if (len > num_samp - i)
+            len = num_samp - i;
+
+        if (len > 0)
+        {
+            lpc12_run(f, len, out, *optr);
+            *optr += len;
+            i     += len;
+            continue;
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  Period boundary:  Let the reference code handle the impulse,    */
+        /*  interpolation and repeat count.  Stop if the repeat expires.    */
+        /* ---------------------------------------------------------------- */
+        if (lpc12_update_ref(f, 1, out, optr) == 0)
+            break;
+        i++;
+    }
+
+    return i;
+}
+
+/* ======================================================================== */
+/*  LPC12_SKIP       -- Advance the filter's timing by up to 'num_samp'     */
+/*                      samples without generating them.  Steps the period  */
+/*                      and repeat counters and the interpolation exactly   */
+/*                      as LPC12_UPDATE does, so the microsequencer sees    */
+/*                      the same timing.  The filter and noise state are    */
+/*                      left alone, since they only affect the output.      */
+/* ======================================================================== */
+int lpc12_skip(lpc12_t *f, int num_samp)
+{
+    int i = 0, len;
+
+    while (i < num_samp)
+    {
+        /* ---------------------------------------------------------------- */
+        /*  Jump straight to the next period boundary.                      */
+        /* ---------------------------------------------------------------- */
+        len = f->cnt - 1;
+        if (len > num_samp - i)
+            len = num_samp - i;
+
+        if (len > 0)
+        {
+            f->cnt -= len;
+            i      += len;
+            continue;
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  Period boundary:  Same bookkeeping as LPC12_UPDATE_REF.         */
+        /* ---------------------------------------------------------------- */
+        if (--f->cnt <= 0)
+        {
+            if (f->rpt-- <= 0)
+            {
+                f->cnt = f->rpt = 0;
+                break;
+            }
+
+            f->cnt = f->per ? f->per : PER_NOISE;
+
+            if (f->interp)
+            {
+                f->r[0] += f->r[14];
+                f->r[1] += f->r[15];
+
+                f->amp   = amp_decode(f->r[0]);
+                f->per   = f->r[1];
+            }
+        }
+        i++;
+    }
+
+    return i;
+}
+
+/*LOCAL int stage_map[6] = { 4, 2, 0, 5, 3, 1 };*/
+/*LOCAL int stage_map[6] = { 3, 0, 4, 1, 5, 2 };*/
+/*LOCAL int stage_map[6] = { 3, 0, 1, 4, 2, 5 };*/
+LOCAL const int stage_map[6] = { 0, 1, 2, 3, 4, 5 };
+
+/* ======================================================================== */
+/*  LPC12_REGDEC -- Decode the register set in the filter bank.             */
+/* ======================================================================== */
+void lpc12_regdec(lpc12_t *f)
+{
+    int i;
+
+    /* -------------------------------------------------------------------- */
+    /*  Decode the Amplitude and Period registers.  Force cnt to 0 to get   */
+    /*  the initial impulse.  (Redundant?)                                  */
+    /* -------------------------------------------------------------------- */
+    f->amp = amp_decode(f->r[0]);
+    f->cnt = 0;
+    f->per = f->r[1];
+
+    /* -------------------------------------------------------------------- */
+    /*  Decode the filter coefficients from the quant table.                */
+    /* -------------------------------------------------------------------- */
+    for (i = 0; i < 6; i++)
+    {
+        #define IQ(x) (((x) & 0x80) ? qtbl[0x7F & -(x)] : -qtbl[(x)])
+
+        f->b_coef[stage_map[i]] = IQ(f->r[2 + 2*i]);
+        f->f_coef[stage_map[i]] = IQ(f->r[3 + 2*i]);
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Set the Interp flag based on whether we have interpolation parms    */
+    /* -------------------------------------------------------------------- */
+    f->interp = f->r[14] || f->r[15];
+
+    return;
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,78 @@
+/*
+ * ============================================================================
+ *  Title:    SP0256 12-pole LPC Filter
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  This is the filter half of the Intellivoice emulation.  The SP0256
+ *  microsequencer in ivoice.c loads the register set and repeat count;
+ *  the routines here turn that into samples.
+ *
+ *  LPC12_UPDATE is the block-processing filter used by the emulator.
+ *  LPC12_UPDATE_REF is the original one-sample-at-a-time filter.  The two
+ *  must produce bit-identical output and leave bit-identical filter state.
+ *  See ivoice/test_lpc12.c.
+ *
+ *  LPC12_SKIP steps only the timing, for running with sound turned off.
+ * ============================================================================
+ *  Requires config.h, periph/periph.h, snd/snd.h and ivoice/ivoice.h.
+ * ============================================================================
+ */
+#ifndef LPC12_H_
+#define LPC12_H_
+
+/* ------------------------------------------------------------------------ */
+/*  The output buffer handed to LPC12_UPDATE is circular, and must be       */
+/*  exactly this size.                                                      */
+/* ------------------------------------------------------------------------ */
+#define LPC12_SCBUF_SIZE    (4096)      /* Must be power of 2               */
+#define LPC12_SCBUF_MASK    (LPC12_SCBUF_SIZE - 1)
+
+/* ------------------------------------------------------------------------ */
+/*  Recorded frame format, used by ivoice.c when built with LPC12_RECORD    */
+/*  and read back by test_lpc12:  repeat count as 16-bit little endian,     */
+/*  followed by the 16 bytes of the register set.                           */
+/* ------------------------------------------------------------------------ */
+#define LPC12_FRAME_BYTES   (18)
+
+/* ======================================================================== */
+/*  LPC12_UPDATE     -- Update the 12-pole filter, outputting samples.      */
+/*                      Returns number of samples generated, which may be   */
+/*                      less than num_samp if the repeat count expires.     */
+/* ======================================================================== */
+int lpc12_update(lpc12_t *f, int num_samp, sint_16 *out, uint_32 *optr);
+
+/* ======================================================================== */
+/*  LPC12_UPDATE_REF -- Reference version of LPC12_UPDATE.  Slow, simple.   */
+/* ======================================================================== */
+int lpc12_update_ref(lpc12_t *f, int num_samp, sint_16 *out, uint_32 *optr);
+
+/* ======================================================================== */
+/*  LPC12_SKIP       -- Advance the filter's timing by up to 'num_samp'     */
+/*                      samples without generating output.  Returns the     */
+/*                      number of samples skipped, as LPC12_UPDATE would.   */
+/* ======================================================================== */
+int lpc12_skip(lpc12_t *f, int num_samp);
+
+/* ======================================================================== */
+/*  LPC12_REGDEC     -- Decode the register set in the filter bank.         */
+/* ======================================================================== */
+void lpc12_regdec(lpc12_t *f);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
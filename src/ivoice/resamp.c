@@ -0,0 +1,305 @@
+/*
+ * ============================================================================
+ *  Title:    Polyphase Resampler
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See resamp.h.  The coefficient table is computed once at init time in
+ *  floating point.  The per-sample work is all fixed point:  a phase
+ *  lookup, a 'taps'-long multiply-accumulate, and a rational step.
+ * ============================================================================
+ */
+
+#include "config.h"
+#include "ivoice/resamp.h"
+
+#define RESAMP_SLACK (512)      /* Extra history beyond 'taps' for pushes.  */
+#define RESAMP_CUTOFF (0.45)    /* Passband edge, fraction of lower rate.   */
+
+/* ======================================================================== */
+/*  RESAMP_DESIGN -- Compute the windowed-sinc table.                       */
+/*                                                                          */
+/*  Phase 'p' covers outputs that fall between 'p / phases' and             */
+/*  '(p + 1) / phases' of the way from input sample 'h_pos' to the next,    */
+/*  and is designed for the middle of that range.  Tap 'k' multiplies       */
+/*  input sample 'h_pos - taps/2 + 1 + k'.  Each phase is normalized to     */
+/*  unity gain at DC so that a constant input yields a constant output.     */
+/* ======================================================================== */
+LOCAL void resamp_design(resamp_t *rs, double fc)
+{
+    int p, k, half = rs->taps / 2;
+
+    for (p = 0; p < rs->phases; p++)
+    {
+        double   h[256], sum = 0.0;
+        double   frac = (p + 0.5) / rs->phases;
+        sint_16 *c = rs->coef + p * rs->taps;
+        int      isum = 0, big = 0;
+
+        for (k = 0; k < rs->taps; k++)
+        {
+            double d = frac + half - 1 - k;
+            double x = 2.0 * fc * d;
+            double s = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double w = 0.42 + 0.50 * cos(2.0 * M_PI * d / rs->taps)
+                            + 0.08 * cos(4.0 * M_PI * d / rs->taps);
+
+            h[k] = s * w;
+            sum += h[k];
+        }
+
+        for (k = 0; k < rs->taps; k++)
+        {
+            double v = floor(32768.0 * h[k] / sum + 0.5);
+
+            c[k]  = (sint_16)v;
+            isum += c[k];
+            if (abs(c[k]) > abs(c[big]))
+                big = k;
+        }
+
+        /* Put rounding error on the biggest tap, where it hurts least. */
+        c[big] += 32768 - isum;
+    }
+}
+
+/* ======================================================================== */
+/*  RESAMP_INIT  -- Set up a resampler from in_clk / in_div to out_rate.    */
+/* ======================================================================== */
+int resamp_init
+(
+    resamp_t    *rs,
+    uint_32     in_clk,
+    uint_32     in_div,
+    uint_32     out_rate,
+    int         taps,
+    int         phases
+)
+{
+    double in_rate, fc;
+
+    memset(rs, 0, sizeof(resamp_t));
+
+    taps = (taps + 1) & ~1;
+    if (taps < 2 || taps > 256 || phases < 1 || phases > 4096 ||
+        !in_clk || !in_div || !out_rate)
+    {
+        fprintf(stderr, "resamp:  Invalid parameters:  %d taps, %d phases\n",
+                taps, phases);
+        return -1;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Each output advances in_clk / (in_div * out_rate) input samples.    */
+    /* -------------------------------------------------------------------- */
+    if ((uint_64)in_div * out_rate > 0x7FFFFFFF)
+    {
+        fprintf(stderr, "resamp:  Rate ratio out of range\n");
+        return -1;
+    }
+
+    rs->taps   = taps;
+    rs->phases = phases;
+    rs->inc    = in_clk;
+    rs->den    = in_div * out_rate;
+    rs->pmul   = ((uint_64)phases << 32) / rs->den;
+    rs->h_size = taps + RESAMP_SLACK;
+    rs->coef   = CALLOC(sint_16, taps * phases);
+    rs->hist   = CALLOC(sint_16, rs->h_size);
+
+    if (!rs->coef || !rs->hist)
+    {
+        fprintf(stderr, "resamp:  Out of memory\n");
+        resamp_dtor(rs);
+        return -1;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Cut off a little below the lower of the two Nyquist rates.  'fc'    */
+    /*  is in cycles per input sample.                                      */
+    /* -------------------------------------------------------------------- */
+    in_rate = (double)in_clk / in_div;
+    fc      = RESAMP_CUTOFF;
+    if (out_rate < in_rate)
+        fc *= out_rate / in_rate;
+
+    resamp_design(rs, fc);
+    resamp_reset(rs);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  RESAMP_RESET -- Clear history and phase.  Keeps the filter.             */
+/* ======================================================================== */
+void resamp_reset(resamp_t *rs)
+{
+    /* -------------------------------------------------------------------- */
+    /*  Start with half a filter's worth of silence behind the first        */
+    /*  input, so the first output lines up with the first input.           */
+    /* -------------------------------------------------------------------- */
+    memset(rs->hist, 0, rs->h_size * sizeof(sint_16));
+    rs->h_pos = rs->taps / 2 - 1;
+    rs->h_len = rs->h_pos;
+    rs->frc   = 0;
+}
+
+/* ======================================================================== */
+/*  RESAMP_PUSH  -- Append up to 'len' samples of input.                    */
+/* ======================================================================== */
+int resamp_push(resamp_t *rs, const sint_16 *in, int len)
+{
+    int keep = rs->h_pos - rs->taps / 2 + 1;
+
+    /* -------------------------------------------------------------------- */
+    /*  Slide the history down if we're out of room, keeping just what      */
+    /*  the next output needs.                                              */
+    /* -------------------------------------------------------------------- */
+    if (rs->h_len + len > rs->h_size && keep > 0)
+    {
+        if (keep > rs->h_len)
+            keep = rs->h_len;
+
+        memmove(rs->hist, rs->hist + keep,
+                (rs->h_len - keep) * sizeof(sint_16));
+        rs->h_len -= keep;
+        rs->h_pos -= keep;
+    }
+
+    if (len > rs->h_size - rs->h_len)
+        len = rs->h_size - rs->h_len;
+
+    memcpy(rs->hist + rs->h_len, in, len * sizeof(sint_16));
+    rs->h_len += len;
+
+    return len;
+}
+
+/* ======================================================================== */
+/*  RESAMP_KERN  -- Inner loop of RESAMP_PULL for a given tap count.  With  */
+/*                  a constant 'TAPS', the compiler fully unrolls and       */
+/*                  vectorizes the multiply-accumulate.                     */
+/* ======================================================================== */
+#define RESAMP_KERN(TAPS)                                                   \
+    while (n < len && h_pos + half < h_len)                                 \
+    {                                                                       \
+        const sint_16 *RESTRICT c = coef + (int)((frc * pmul) >> 32) * TAPS;\
+        const sint_16 *RESTRICT x = hist + h_pos - half + 1;                \
+        sint_32 acc = 0x4000;                                               \
+        int k;                                                              \
+                                                                            \
+        for (k = 0; k < TAPS; k++)                                          \
+            acc += c[k] * x[k];                                             \
+                                                                            \
+        acc >>= 15;                                                         \
+        out[n++] = acc > 32767 ? 32767 : acc < -32768 ? -32768 : acc;       \
+                                                                            \
+        frc += inc;                                                         \
+        while (frc >= den)                                                  \
+        {                                                                   \
+            frc -= den;                                                     \
+            h_pos++;                                                        \
+        }                                                                   \
+    }
+
+#if defined(__SSE2__)
+/* ======================================================================== */
+/*  RESAMP_KERN_SSE2 -- Same as RESAMP_KERN, for tap counts that are a      */
+/*                      multiple of 8.  PMADDWD does 8 taps at a time, and  */
+/*                      PACKSSDW clamps the result without branching.       */
+/* ======================================================================== */
+#include <emmintrin.h>
+
+#define RESAMP_KERN_SSE2(TAPS)                                              \
+    while (n < len && h_pos + half < h_len)                                 \
+    {                                                                       \
+        const sint_16 *c = coef + (int)((frc * pmul) >> 32) * TAPS;         \
+        const sint_16 *x = hist + h_pos - half + 1;                         \
+        __m128i acc = _mm_setzero_si128();                                  \
+        int k;                                                              \
+                                                                            \
+        for (k = 0; k < TAPS; k += 8)                                       \
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(                        \
+                    _mm_loadu_si128((const __m128i *)(c + k)),              \
+                    _mm_loadu_si128((const __m128i *)(x + k))));            \
+                                                                            \
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));             \
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));             \
+        acc = _mm_srai_epi32(_mm_add_epi32(acc, rnd), 15);                  \
+        out[n++] = (sint_16)_mm_cvtsi128_si32(_mm_packs_epi32(acc, acc));   \
+                                                                            \
+        frc += inc;                                                         \
+        while (frc >= den)                                                  \
+        {                                                                   \
+            frc -= den;                                                     \
+            h_pos++;                                                        \
+        }                                                                   \
+    }
+#endif
+
+/* ======================================================================== */
+/*  RESAMP_PULL  -- Generate up to 'len' output samples.                    */
+/* ======================================================================== */
+int resamp_pull(resamp_t *RESTRICT rs, sint_16 *RESTRICT out, int len)
+{
+    const sint_16 *RESTRICT coef = rs->coef;
+    const sint_16 *RESTRICT hist = rs->hist;
+    const uint_64 pmul  = rs->pmul;
+    const uint_32 inc   = rs->inc, den = rs->den;
+    const int     taps  = rs->taps, half = taps / 2, h_len = rs->h_len;
+    uint_32       frc   = rs->frc;
+    int           h_pos = rs->h_pos;
+    int           n     = 0;
+
+#if defined(__SSE2__)
+    const __m128i rnd   = _mm_set1_epi32(0x4000);
+
+    switch (taps)
+    {
+        case 8:  RESAMP_KERN_SSE2(8);                       break;
+        case 16: RESAMP_KERN_SSE2(16);                      break;
+        case 32: RESAMP_KERN_SSE2(32);                      break;
+        default: if (taps % 8) { RESAMP_KERN(taps);      }
+                 else          { RESAMP_KERN_SSE2(taps); }  break;
+    }
+#else
+    switch (taps)
+    {
+        case 8:  RESAMP_KERN(8);    break;
+        case 16: RESAMP_KERN(16);   break;
+        case 32: RESAMP_KERN(32);   break;
+        default: RESAMP_KERN(taps); break;
+    }
+#endif
+
+    rs->frc   = frc;
+    rs->h_pos = h_pos;
+
+    return n;
+}
+
+/* ======================================================================== */
+/*  RESAMP_DTOR  -- Free a resampler's tables.                              */
+/* ======================================================================== */
+void resamp_dtor(resamp_t *rs)
+{
+    CONDFREE(rs->coef);
+    CONDFREE(rs->hist);
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
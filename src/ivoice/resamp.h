@@ -0,0 +1,91 @@
+/*
+ * ============================================================================
+ *  Title:    Polyphase Resampler
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Fixed-point polyphase FIR resampler, used to bring the Intellivoice's
+ *  ~10kHz output up to the sound device's rate.
+ *
+ *  The input rate is given as a clock and divider (3579545 / 358 for the
+ *  SP0256), so that the step between output samples is an exact ratio.
+ *  The filter is a windowed sinc, split into 'phases' sub-filters of
+ *  'taps' taps each.  Each output sample picks the sub-filter nearest its
+ *  fractional position between input samples.
+ *
+ *  Usage:  Push input with RESAMP_PUSH, pull output with RESAMP_PULL.
+ *  The resampler only holds a small amount of input.  RESAMP_PUSH takes
+ *  what fits, and RESAMP_PULL produces output until it runs out of input.
+ * ============================================================================
+ */
+#ifndef RESAMP_H_
+#define RESAMP_H_
+
+typedef struct resamp_t
+{
+    int         taps;       /* Taps per phase.  Even.                       */
+    int         phases;     /* Number of phases.                            */
+    sint_16     *coef;      /* phases x taps coefficient table, Q15.        */
+    sint_16     *hist;      /* Input history.                               */
+    int         h_size;     /* Size of history buffer.                      */
+    int         h_len;      /* Number of samples in history buffer.         */
+    int         h_pos;      /* Input sample at or just before output.       */
+    uint_32     frc;        /* Output position between inputs, over 'den'.  */
+    uint_32     inc;        /* Amount 'frc' steps per output sample.        */
+    uint_32     den;        /* Denominator for 'frc' and 'inc'.             */
+    uint_64     pmul;       /* Maps 'frc' to a phase number.  32.32         */
+} resamp_t;
+
+/* ======================================================================== */
+/*  RESAMP_INIT  -- Set up a resampler from in_clk / in_div to out_rate.    */
+/*                  Returns 0 on success, -1 on failure.                    */
+/* ======================================================================== */
+int resamp_init
+(
+    resamp_t    *rs,
+    uint_32     in_clk,         /*  Input clock...                          */
+    uint_32     in_div,         /*  ...and divider giving input rate.       */
+    uint_32     out_rate,       /*  Output sample rate.                     */
+    int         taps,           /*  Taps per phase.  Rounded up to even.    */
+    int         phases          /*  Number of phases.                       */
+);
+
+/* ======================================================================== */
+/*  RESAMP_RESET -- Clear history and phase.  Keeps the filter.             */
+/* ======================================================================== */
+void resamp_reset(resamp_t *rs);
+
+/* ======================================================================== */
+/*  RESAMP_PUSH  -- Append up to 'len' samples of input.  Returns the       */
+/*                  number of samples actually taken.                       */
+/* ======================================================================== */
+int resamp_push(resamp_t *rs, const sint_16 *in, int len);
+
+/* ======================================================================== */
+/*  RESAMP_PULL  -- Generate up to 'len' output samples.  Returns the       */
+/*                  number of samples actually generated.                   */
+/* ======================================================================== */
+int resamp_pull(resamp_t *rs, sint_16 *out, int len);
+
+/* ======================================================================== */
+/*  RESAMP_DTOR  -- Free a resampler's tables.                              */
+/* ======================================================================== */
+void resamp_dtor(resamp_t *rs);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,176 @@
+/* ======================================================================== */
+/*  TEST_LPC12  -- Check LPC12_UPDATE against LPC12_UPDATE_REF.             */
+/*                                                                          */
+/*  Usage:  test_lpc12 [frames.bin]                                         */
+/*                                                                          */
+/*  With no argument, runs a stream of pseudo-random register sets.  With   */
+/*  an argument, plays back frames recorded by an ivoice.o built with       */
+/*  -DLPC12_RECORD.  Either way, both filters see identical state and the   */
+/*  same sequence of (randomly sized) update calls, and every sample, the   */
+/*  return values and the resulting filter state must match exactly.        */
+/* ======================================================================== */
+
+#include <time.h>
+#include "config.h"
+#include "periph/periph.h"
+#include "snd/snd.h"
+#include "ivoice/ivoice.h"
+#include "ivoice/lpc12.h"
+
+#define NUM_RAND_FRAMES (200000)
+
+LOCAL sint_16 out_ref[LPC12_SCBUF_SIZE];
+LOCAL sint_16 out_new[LPC12_SCBUF_SIZE];
+LOCAL clock_t t_ref, t_new;
+LOCAL long    tot_samp;
+
+LOCAL uint_32 seed = 1;
+
+LOCAL uint_32 rnd(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) & 0xFFFFFF;
+}
+
+/* ======================================================================== */
+/*  RUN_FRAME    -- Run one frame through both filters and compare.         */
+/* ======================================================================== */
+LOCAL int run_frame(lpc12_t *ref, lpc12_t *new_, long frame)
+{
+    uint_32 optr_ref = 0, optr_new = 0;
+    int     len, n_ref, n_new, i;
+    clock_t t0;
+
+    do
+    {
+        /* Mostly ivoice_tk sized chunks, with some very short ones. */
+        len = rnd() & 1 ? 1 + (rnd() & 7) : 1 + (rnd() % 1024);
+
+        t0     = clock();
+        n_ref  = lpc12_update_ref(ref, len, out_ref, &optr_ref);
+        t_ref += clock() - t0;
+        t0     = clock();
+        n_new  = lpc12_update    (new_, len, out_new, &optr_new);
+        t_new += clock() - t0;
+
+        if (n_ref != n_new || optr_ref != optr_new)
+        {
+            printf("frame %ld: count mismatch: ref %d, new %d\n",
+                   frame, n_ref, n_new);
+            return -1;
+        }
+
+        for (i = 0; i < n_ref; i++)
+        {
+            uint_32 idx = (optr_ref - n_ref + i) & LPC12_SCBUF_MASK;
+            if (out_ref[idx] != out_new[idx])
+            {
+                printf("frame %ld: sample %d mismatch: ref %d, new %d\n",
+                       frame, i, out_ref[idx], out_new[idx]);
+                return -1;
+            }
+        }
+
+        if (memcmp(ref, new_, sizeof(lpc12_t)) != 0)
+        {
+            printf("frame %ld: filter state mismatch\n", frame);
+            return -1;
+        }
+
+        tot_samp += n_ref;
+    } while (n_ref == len);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  LOAD_FRAME   -- Set up both filters the way SP0256_MICRO would.         */
+/* ======================================================================== */
+LOCAL void load_frame(lpc12_t *ref, lpc12_t *new_, int rpt,
+                      const uint_8 *r, int clear)
+{
+    int i;
+
+    ref->rpt = rpt;
+    if (clear)
+        for (i = 0; i < 6; i++)
+            ref->z_data[i][0] = ref->z_data[i][1] = 0;
+    memcpy(ref->r, r, 16);
+    lpc12_regdec(ref);
+    memcpy(new_, ref, sizeof(lpc12_t));
+}
+
+int main(int argc, char *argv[])
+{
+    lpc12_t ref, new_;
+    uint_8  r[LPC12_FRAME_BYTES];
+    long    frame = 0;
+    int     i;
+
+    memset(&ref, 0, sizeof(ref));
+    ref.rng = 1;
+
+    if (argc > 1)
+    {
+        FILE *f = fopen(argv[1], "rb");
+
+        if (!f)
+        {
+            perror("fopen()");
+            fprintf(stderr, "test_lpc12: can't open '%s'\n", argv[1]);
+            exit(1);
+        }
+
+        while (fread(r, 1, LPC12_FRAME_BYTES, f) == LPC12_FRAME_BYTES)
+        {
+            load_frame(&ref, &new_, r[0] | (r[1] << 8), r + 2, 1);
+            if (run_frame(&ref, &new_, frame++))
+                exit(1);
+        }
+        fclose(f);
+    } else
+    {
+        for (frame = 0; frame < NUM_RAND_FRAMES; frame++)
+        {
+            for (i = 0; i < 16; i++)
+                r[i] = rnd();
+
+            /* Exercise noise, pauses and no-interpolation frames too. */
+            switch (rnd() & 7)
+            {
+                case 0: r[1]  = 0;              break;
+                case 1: r[0]  = 0; r[1] = 64;   break;
+                case 2: r[14] = r[15] = 0;      break;
+                default:                        break;
+            }
+
+            load_frame(&ref, &new_, 1 + (rnd() & 63), r, (rnd() & 3) == 0);
+            if (run_frame(&ref, &new_, frame))
+                exit(1);
+        }
+    }
+
+    printf("%ld frames, %ld samples match.\n", frame, tot_samp);
+    printf("ref: %.3fs   new: %.3fs\n",
+           (double)t_ref / CLOCKS_PER_SEC, (double)t_new / CLOCKS_PER_SEC);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -24,6 +24,7 @@
 #include "periph/periph.h"
 #include "jlp/jlp.h"
 #include "plat/plat_lib.h" /* rand_jz */
+#include "serializer/snapshot.h"
 
 #ifdef BYTE_LE
 # define    E(x) (x)
@@ -96,6 +97,8 @@ LOCAL void jlp_sg_flash_to_ram(jlp_t *jlp)
                 jlp->ram[0x25], jlp->ram[0x26]);
 
     memcpy((void *)&jlp->ram[addr], (void *)&jlp->sg_img[row], 192);
+    SNAP_DIRTY(jlp->dirty, addr);
+    SNAP_DIRTY(jlp->dirty, addr + 95);
 }
 
 LOCAL void jlp_sg_erase_sector(jlp_t *jlp)
@@ -175,6 +178,10 @@ LOCAL void jlp_write(periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
     /*  (normal RAM) up front.                                              */
     /* -------------------------------------------------------------------- */
     if (jlp->sleep > 0)                  { jlp->sleep--;            return; }
+
+    /* Every RAM update below lands in the same page as 'addr'. */
+    SNAP_DIRTY(jlp->dirty, addr);
+
     if (addr >= 0x040 && addr <= 0x1F7F) { jlp->ram[addr] = data;   return; }
 
     /* -------------------------------------------------------------------- */
@@ -280,6 +287,7 @@ LOCAL void jlp_poke(periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
 
     UNUSED(ign);
     jlp->ram[addr] = data;
+    SNAP_DIRTY(jlp->dirty, addr);
 }
 
 /* ======================================================================== */
@@ -295,6 +303,18 @@ LOCAL void jlp_dtor(periph_p p)
     CONDFREE(jlp->sg_img  );
 }
 
+/* ======================================================================== */
+/*  JLP_SER_INIT -- Register the JLP RAM and busy time for snapshots.  The  */
+/*                  flash image stays out:  it lives in the save-game file. */
+/* ======================================================================== */
+LOCAL void jlp_ser_init(periph_p p)
+{
+    jlp_t *jlp = (jlp_t *)p;
+
+    snap_track(p->name, jlp->ram, 0, 8192, sizeof(uint_16), jlp->dirty);
+    SNAP_FIELDS(p->name, jlp, jlp_t, sleep, sleep);
+}
+
 /* ======================================================================== */
 /*  JLP_INIT     -- Sets up the JLP support                                 */
 /* ======================================================================== */
@@ -317,7 +337,7 @@ int jlp_init
     jlp->periph.max_tick  = ~0U;
     jlp->periph.addr_base = 0x8000;
     jlp->periph.addr_mask = 0x1FFF;
-    jlp->periph.ser_init  = 0;
+    jlp->periph.ser_init  = jlp_ser_init;
     jlp->periph.dtor      = jlp_dtor;
 
     /* -------------------------------------------------------------------- */
@@ -15,6 +15,7 @@ typedef struct jlp_t
     int         sleep;      /* Emulate "busy" time after a slot write.      */
     uint_16    *sg_img;     /* Save game image                              */
     FILE       *sg_file;    /* Save-game filename                           */
+    uint_32     dirty[1];   /* RAM pages written since last snapshot.       */
 } jlp_t;
 
 
@@ -42,8 +42,14 @@
 #include "ivoice/ivoice.h"
 #include "jlp/jlp.h"
 #include "locutus/locutus_adapt.h"
+#include "serializer/rewind.h"
+#include "serializer/inpmov.h"
+#include "serializer/inplog.h"
+#include "serializer/autosave.h"
 #include "cfg/mapping.h"
 #include "cfg/cfg.h"
+#include "serializer/snapshot.h"
+#include "debug/debug_if.h"
 
 #ifdef macintosh
 # include "console.h"
@@ -83,8 +89,11 @@ int displaycontrolinfo=0;
 cfg_t intv;
 
 double elapsed(int);
-void save_state(int);
+void save_state(void);
 void load_dump(void);
+static void resync_after_restore(void);
+static void rewind_service(void);
+static void resume_autosave(void);
 
 /*volatile int please_die = 0;*/
 /*volatile int reset = 0;*/
@@ -278,6 +287,7 @@ int main(int argc, char *argv[])
     double cycles = 0, rate, irate, then, now, icyc;
     uint_32 s_cnt = 0;
     int paused = 0;
+    int failed;
     char title[128];
 
 #ifdef GCWZERO //create directory structure
@@ -322,6 +332,16 @@ mkdir("/media/data/local/home/.jzintellivision/configfiles",S_IRWXU);
         {
             usage();
         }
+
+        /* ---------------------------------------------------------------- */
+        /*  Headless runs use SDL's dummy drivers, which have to be picked  */
+        /*  before SDL starts up.                                           */
+        /* ---------------------------------------------------------------- */
+        if (!strcmp(argv[iter], "--headless"))
+        {
+            putenv("SDL_VIDEODRIVER=dummy");
+            putenv("SDL_AUDIODRIVER=dummy");
+        }
     }
 #endif
 
@@ -421,6 +441,13 @@ mkdir("/media/data/local/home/.jzintellivision/configfiles",S_IRWXU);
     jzp_printf("Starting jzIntv...\n");
     jzp_flush();
 
+    /* -------------------------------------------------------------------- */
+    /*  Pick up where the last run left off, if it left an autosave.  An    */
+    /*  input movie always starts from power-on, so not with one of those.  */
+    /* -------------------------------------------------------------------- */
+    if (intv.autosave && intv.inpmov.mode == INPMOV_OFF)
+        resume_autosave();
+
     if (intv.start_dly > 0)
         plat_delay(intv.start_dly);
 
@@ -446,7 +473,22 @@ restart:
     {
 
       uint_64 max_step;
-        int do_reset = intv.do_reset;
+        int do_reset;
+
+        /* ---------------------------------------------------------------- */
+        /*  While playing back an input movie, the movie decides when the   */
+        /*  machine resets, and the host can't reset, load or rewind it.    */
+        /* ---------------------------------------------------------------- */
+        if (intv.inpmov.mode == INPMOV_PLAY)
+        {
+            intv.do_reset   = 0;
+            intv.do_load    = 0;
+            intv.do_rewind  = 0;
+            if (inpmov_poll(&intv.inpmov, intv.intv->periph.now))
+                periph_reset(intv.intv);
+        }
+
+        do_reset = intv.do_reset;
 
         if (intv.gui_mode)
             do_gui_mode();
@@ -455,14 +497,17 @@ restart:
         {
 			jzp_printf("\nDump requested.\n");
             intv.do_dump = 0;
-			save_state(0);
+			save_state();
 		}
 
         if (intv.do_load)
         {
 			jzp_printf("\nLoad requested.\n");
             intv.do_load = 0;
-			load_dump();
+            if (intv.inpmov.mode != INPMOV_OFF)
+                jzp_printf("Can't load during an input movie.\n");
+            else
+                load_dump();
 		}
 
         if (do_reset)
@@ -475,6 +520,7 @@ restart:
             if (s_cnt)
             {
                 s_cnt = 0;
+                inpmov_reset(&intv.inpmov, intv.intv->periph.now);
                 periph_reset(intv.intv);
             }
             /* This is incredibly hackish, and is an outgrowth of my
@@ -508,6 +554,14 @@ jzp_printf("cpu.now = %-8d  stic.now = %-8d diff = %-8d step = %-8d\n", (int)int
             if (!paused)
                 speed_resync(&(intv.speed));
         }
+
+        if (intv.do_budget)
+        {
+            intv.do_budget = 0;
+            if (intv.budget)
+                intv.budget->overlay = !intv.budget->overlay;
+            intv.stic.bt_dirty = 3;     /* repaint what the overlay covered */
+        }
 #ifdef GCWZERO
 	static int foundconfig=0;
 	if (!foundconfig)
@@ -992,6 +1046,20 @@ jzp_printf("cpu.now = %-8d  stic.now = %-8d diff = %-8d step = %-8d\n", (int)int
         }
 
 
+        /* ---------------------------------------------------------------- */
+        /*  Record the last frame, or step back one.  Holding REWIND steps  */
+        /*  back one frame per pass, and we don't run the machine forward.  */
+        /* ---------------------------------------------------------------- */
+        if (intv.rewind && !do_reset)
+        {
+            if (intv.do_rewind & 2)
+                intv.do_rewind |= 1;
+            rewind_service();
+        }
+
+        if (intv.autosave && !do_reset)
+            autosave_service(intv.autosave);
+
         if (paused)
         {
             intv.gfx.dirty = 1;
@@ -1005,6 +1073,12 @@ jzp_printf("cpu.now = %-8d  stic.now = %-8d diff = %-8d step = %-8d\n", (int)int
             intv.event.periph.tick((periph_p)&(intv.event), 20000);
             plat_delay(1000/60);
             cycles += 20000;
+        } else if (intv.rewind && (intv.do_rewind & 2))
+        {
+            intv.gfx.dirty = 1;
+            intv.gfx.periph.tick  ((periph_p)&(intv.gfx),   20000);
+            intv.event.periph.tick((periph_p)&(intv.event), 0);
+            plat_delay(1000/60);
         } else
             cycles += periph_tick((periph_p)(intv.intv), max_step);
 
@@ -1025,13 +1099,23 @@ jzp_printf("cpu.now = %-8d  stic.now = %-8d diff = %-8d step = %-8d\n", (int)int
 #ifdef GCWZERO
 #else
                 jzp_printf("Rate: [%6.2f%% %6.2f%%]  Drop Gfx:[%6.2f%% %6d] "
-                       "Snd:[%6.2f%% %2d %6.3f]\r",
+                       "Snd:[%6.2f%% %2d %6.3f]",
                         rate * 100., irate * 100.,
                         100. * intv.gfx.tot_dropped_frames / intv.gfx.tot_frames,
                         (int)intv.gfx.tot_dropped_frames,
                         100. * intv.snd.mixbuf.tot_drop / intv.snd.tot_frame,
                         (int)intv.snd.mixbuf.tot_drop,
                         (double)intv.snd.tot_dirty / intv.snd.tot_frame);
+
+                if (intv.autosave)
+                {
+                    double cap_us, cmp_ms, wr_ms;
+
+                    autosave_times(intv.autosave, &cap_us, &cmp_ms, &wr_ms);
+                    jzp_printf("  Save:[%5.0fus %6.2fms %6.2fms]",
+                               cap_us, cmp_ms, wr_ms);
+                }
+                jzp_printf("\r");
 #endif
 
 #if 0
@@ -1113,9 +1197,11 @@ jzp_printf("cpu.now = %-8d  stic.now = %-8d diff = %-8d step = %-8d\n", (int)int
     if (intv.do_exit)
         jzp_printf("\nExited on user request.\n");
 
+    failed = inpmov_failed(&intv.inpmov);
+
     cfg_dtor(&intv);
 
-    return 0;
+    return failed;
 }
 
 
@@ -1214,657 +1300,202 @@ void dump_state(void)
 
 /*
  * ============================================================================
- *  SAVE_STATE
+ *  SAVE_STATE   -- Snapshot the machine and write it to "dump.sav".
+ *  LOAD_DUMP    -- Read "dump.sav" back into the machine.
+ *
+ *  Both share one snapshot arena, allocated on first use.  By then every
+ *  device has registered its state, so the arena is sized to fit.
  * ============================================================================
  */
+static snap_t dump_snap;
 
-void save_state(int altname)
+static int dump_snap_init(void)
 {
-    FILE *f;
-    int addr, i, k;
-	unsigned short data;
-
-	if (altname) {
-		f = fopen("dump_check.sav","wb");
-	} else {
-		f = fopen("dump.sav","wb");
-	}
-    if (!f)
-    {
-        perror("fopen(\"dump.sav\", \"w\")");
-        jzp_printf("couldn't open dump.sav.\n");
+    return dump_snap.arena ? 0 : snap_init(&dump_snap);
+}
 
-		return;
-    }
+void save_state(void)
+{
+    double start = get_time();
 
-    char phase[7];
-    memcpy(phase, "phase_1", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-    fwrite(&intv.cp1600.periph.addr_base, sizeof(intv.cp1600.periph.addr_base), 1, f);
-    fwrite(&intv.cp1600.periph.addr_mask, sizeof(intv.cp1600.periph.addr_mask), 1, f);
-    fwrite(&intv.cp1600.periph.now, sizeof(intv.cp1600.periph.now), 1, f);
-    fwrite(&intv.cp1600.periph.min_tick, sizeof(intv.cp1600.periph.min_tick), 1, f);
-    fwrite(&intv.cp1600.periph.max_tick, sizeof(intv.cp1600.periph.max_tick), 1, f);
-    fwrite(&intv.cp1600.periph.next_tick, sizeof(intv.cp1600.periph.next_tick), 1, f);
-
-    fwrite(&intv.cp1600.snoop.addr_base, sizeof(intv.cp1600.snoop.addr_base), 1, f);
-    fwrite(&intv.cp1600.snoop.addr_mask, sizeof(intv.cp1600.snoop.addr_mask), 1, f);
-    fwrite(&intv.cp1600.snoop.now, sizeof(intv.cp1600.snoop.now), 1, f);
-    fwrite(&intv.cp1600.snoop.min_tick, sizeof(intv.cp1600.snoop.min_tick), 1, f);
-    fwrite(&intv.cp1600.snoop.max_tick, sizeof(intv.cp1600.snoop.max_tick), 1, f);
-    fwrite(&intv.cp1600.snoop.next_tick, sizeof(intv.cp1600.snoop.next_tick), 1, f);
-
-    fwrite(&intv.cp1600.tot_cycle, sizeof(intv.cp1600.tot_cycle), 1, f);
-    fwrite(&intv.cp1600.tot_instr, sizeof(intv.cp1600.tot_instr), 1, f);
-    fwrite(&intv.cp1600.tot_cache, sizeof(intv.cp1600.tot_cache), 1, f);
-    fwrite(&intv.cp1600.tot_noncache, sizeof(intv.cp1600.tot_noncache), 1, f);
-
-    for (i = 0; i <= 7; i++)
+    if (dump_snap_init() || snap_take(&dump_snap) ||
+        snap_save(&dump_snap, "dump.sav"))
     {
-        fwrite(&intv.cp1600.r[i], sizeof(intv.cp1600.r[i]), 1, f);
+        jzp_printf("couldn't save dump.sav.\n");
+        return;
     }
 
-    fwrite(&intv.cp1600.S, sizeof(intv.cp1600.S), 1, f);
-    fwrite(&intv.cp1600.C, sizeof(intv.cp1600.C), 1, f);
-    fwrite(&intv.cp1600.O, sizeof(intv.cp1600.O), 1, f);
-    fwrite(&intv.cp1600.Z, sizeof(intv.cp1600.Z), 1, f);
-    fwrite(&intv.cp1600.I, sizeof(intv.cp1600.I), 1, f);
-    fwrite(&intv.cp1600.D, sizeof(intv.cp1600.D), 1, f);
-
-    fwrite(&intv.cp1600.intr, sizeof(intv.cp1600.intr), 1, f);
-
-    fwrite(&intv.cp1600.req_bus.intrq, sizeof(intv.cp1600.req_bus.intrq), 1, f);
-
-    memcpy(phase, "phase_2", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-    fwrite(&intv.cp1600.req_bus.intrq_until, sizeof(intv.cp1600.req_bus.intrq_until), 1, f);
-    fwrite(&intv.cp1600.req_bus.busrq_until, sizeof(intv.cp1600.req_bus.busrq_until), 1, f);
-    fwrite(&intv.cp1600.req_bus.next_intrq, sizeof(intv.cp1600.req_bus.next_intrq), 1, f);
-    fwrite(&intv.cp1600.req_bus.next_busrq, sizeof(intv.cp1600.req_bus.next_busrq), 1, f);
-    fwrite(&intv.cp1600.req_bus.intak, sizeof(intv.cp1600.req_bus.intak), 1, f);
-    fwrite(&intv.cp1600.req_bus.busak, sizeof(intv.cp1600.req_bus.busak), 1, f);
-
-    memcpy(phase, "phase_3", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-    fwrite(&intv.cp1600.oldpc, sizeof(intv.cp1600.oldpc), 1, f);
-    fwrite(&intv.cp1600.ext, sizeof(intv.cp1600.ext), 1, f);
-    fwrite(&intv.cp1600.int_vec, sizeof(intv.cp1600.int_vec), 1, f);
-
-    memcpy(phase, "phase_4", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
+    jzp_printf("Saved %u bytes to dump.sav in %.2f ms\n",
+               dump_snap.size, (get_time() - start) * 1000.0);
+}
 
-    for (i = 0; i < 1 << (CP1600_MEMSIZE-CP1600_DECODE_PAGE - 5); i++)
+void load_dump(void)
+{
+    if (dump_snap_init() || snap_load(&dump_snap, "dump.sav") ||
+        snap_restore(&dump_snap))
     {
-        fwrite(&intv.cp1600.cacheable[i], sizeof(intv.cp1600.cacheable[i]), 1, f);
-    }
-
-    memcpy(phase, "phase_5", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-    fwrite(&intv.cp1600.instr_tick_per, sizeof(intv.cp1600.instr_tick_per), 1, f);
-
-	for (addr = 0; addr <= 0xFFFF; addr++)
-	{
-		data = periph_peek((periph_p)intv.intv, (periph_p)intv.intv,
-						   addr, 0);
-        fwrite(&data, sizeof(data), 1, f);
-	}
-
-    memcpy(phase, "phase_6", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-    fwrite(&intv.stic.stic_cr.addr_base, sizeof(intv.stic.stic_cr.addr_base), 1, f);
-    fwrite(&intv.stic.stic_cr.addr_mask, sizeof(intv.stic.stic_cr.addr_mask), 1, f);
-    fwrite(&intv.stic.stic_cr.now, sizeof(intv.stic.stic_cr.now), 1, f);
-    fwrite(&intv.stic.stic_cr.min_tick, sizeof(intv.stic.stic_cr.min_tick), 1, f);
-    fwrite(&intv.stic.stic_cr.max_tick, sizeof(intv.stic.stic_cr.max_tick), 1, f);
-    fwrite(&intv.stic.stic_cr.next_tick, sizeof(intv.stic.stic_cr.next_tick), 1, f);
-
-    fwrite(&intv.stic.snoop_btab.addr_base, sizeof(intv.stic.snoop_btab.addr_base), 1, f);
-    fwrite(&intv.stic.snoop_btab.addr_mask, sizeof(intv.stic.snoop_btab.addr_mask), 1, f);
-    fwrite(&intv.stic.snoop_btab.now, sizeof(intv.stic.snoop_btab.now), 1, f);
-    fwrite(&intv.stic.snoop_btab.min_tick, sizeof(intv.stic.snoop_btab.min_tick), 1, f);
-    fwrite(&intv.stic.snoop_btab.max_tick, sizeof(intv.stic.snoop_btab.max_tick), 1, f);
-    fwrite(&intv.stic.snoop_btab.next_tick, sizeof(intv.stic.snoop_btab.next_tick), 1, f);
-
-    fwrite(&intv.stic.snoop_gram.addr_base, sizeof(intv.stic.snoop_gram.addr_base), 1, f);
-    fwrite(&intv.stic.snoop_gram.addr_mask, sizeof(intv.stic.snoop_gram.addr_mask), 1, f);
-    fwrite(&intv.stic.snoop_gram.now, sizeof(intv.stic.snoop_gram.now), 1, f);
-    fwrite(&intv.stic.snoop_gram.min_tick, sizeof(intv.stic.snoop_gram.min_tick), 1, f);
-    fwrite(&intv.stic.snoop_gram.max_tick, sizeof(intv.stic.snoop_gram.max_tick), 1, f);
-    fwrite(&intv.stic.snoop_gram.next_tick, sizeof(intv.stic.snoop_gram.next_tick), 1, f);
-
-    fwrite(&intv.stic.req_bus->intrq, sizeof(intv.stic.req_bus->intrq), 1, f);
-    fwrite(&intv.stic.req_bus->intrq_until, sizeof(intv.stic.req_bus->intrq_until), 1, f);
-    fwrite(&intv.stic.req_bus->busrq_until, sizeof(intv.stic.req_bus->busrq_until), 1, f);
-    fwrite(&intv.stic.req_bus->next_intrq, sizeof(intv.stic.req_bus->next_intrq), 1, f);
-    fwrite(&intv.stic.req_bus->next_busrq, sizeof(intv.stic.req_bus->next_busrq), 1, f);
-    fwrite(&intv.stic.req_bus->intak, sizeof(intv.stic.req_bus->intak), 1, f);
-    fwrite(&intv.stic.req_bus->busak, sizeof(intv.stic.req_bus->busak), 1, f);
-
-    fwrite(&intv.stic.cp_row, sizeof(intv.stic.cp_row), 1, f);
-    fwrite(&intv.stic.ve_post, sizeof(intv.stic.ve_post), 1, f);
-    fwrite(&intv.stic.vid_enable, sizeof(intv.stic.vid_enable), 1, f);
-    fwrite(&intv.stic.mode, sizeof(intv.stic.mode), 1, f);
-    fwrite(&intv.stic.p_mode, sizeof(intv.stic.p_mode), 1, f);
-    fwrite(&intv.stic.bt_dirty, sizeof(intv.stic.bt_dirty), 1, f);
-    fwrite(&intv.stic.gr_dirty, sizeof(intv.stic.gr_dirty), 1, f);
-    fwrite(&intv.stic.ob_dirty, sizeof(intv.stic.ob_dirty), 1, f);
-
-    fwrite(&intv.stic.rand_regs, sizeof(intv.stic.rand_regs), 1, f);
-    fwrite(&intv.stic.pal, sizeof(intv.stic.pal), 1, f);
-    fwrite(&intv.stic.drop_frame, sizeof(intv.stic.drop_frame), 1, f);
-    fwrite(&intv.stic.gmem_accessible, sizeof(intv.stic.gmem_accessible), 1, f);
-    fwrite(&intv.stic.stic_accessible, sizeof(intv.stic.stic_accessible), 1, f);
-    fwrite(&intv.stic.next_irq, sizeof(intv.stic.next_irq), 1, f);
-
-    memcpy(phase, "phase_7", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-    fwrite(&intv.stic.phase, sizeof(intv.stic.phase), 1, f);
-    fwrite(&intv.stic.next_phase, sizeof(intv.stic.next_phase), 1, f);
-
-    memcpy(phase, "phase_8", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-    for (i=0; i<0x40; i++) {
-        fwrite(&intv.stic.raw[i], sizeof(intv.stic.raw[i]), 1, f);
-    }
-
-    for (i=0; i<0x140 * 8; i++) {
-        fwrite(&intv.stic.gmem[i], sizeof(intv.stic.gmem[i]), 1, f);
-    }
-
-    fwrite(&intv.stic.fifo_ptr, sizeof(intv.stic.fifo_ptr), 1, f);
-
-    memcpy(phase, "phase8a", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-    for (i=0; i<240; i++) {
-        fwrite(&intv.stic.btab_sr[i], sizeof(intv.stic.btab_sr[i]), 1, f);
-    }
-    for (i=0; i<240; i++) {
-        fwrite(&intv.stic.btab[i], sizeof(intv.stic.btab[i]), 1, f);
-    }
-    for (i=0; i<12; i++) {
-        fwrite(&intv.stic.last_bg[i], sizeof(intv.stic.last_bg[i]), 1, f);
-    }
-    memcpy(phase, "phase8b", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-    fwrite(&intv.stic.time, sizeof(intv.stic.time), 1, f);
-
-    memcpy(phase, "phase8c", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-    for (i=0; i<240*8; i++) {
-        fwrite(&intv.stic.bt_bmp[i], sizeof(intv.stic.bt_bmp[i]), 1, f);
-    }
-    for (i=0; i<16*16  / 8; i++) {
-        fwrite(&intv.stic.mob_img[i], sizeof(intv.stic.mob_img[i]), 1, f);
-    }
-    for (i=0; i<8; i++) {
-        for (k=0; k<16; k++) {
-            fwrite(&intv.stic.mob_bmp[i][k], sizeof(intv.stic.mob_bmp[i][k]), 1, f);
-        }
-    }
-    for (i=0; i<192*224 / 8; i++) {
-        fwrite(&intv.stic.mpl_img[i], sizeof(intv.stic.mpl_img[i]), 1, f);
+        jzp_printf("couldn't load dump.sav.\n");
+        return;
     }
-    for (i=0; i<192*224 /32; i++) {
-        fwrite(&intv.stic.mpl_vsb[i], sizeof(intv.stic.mpl_vsb[i]), 1, f);
-    }
-    for (i=0; i<192*224 /32; i++) {
-        fwrite(&intv.stic.mpl_pri[i], sizeof(intv.stic.mpl_pri[i]), 1, f);
-    }
-    for (i=0; i<192*224 / 8; i++) {
-        fwrite(&intv.stic.xbt_img[i], sizeof(intv.stic.xbt_img[i]), 1, f);
-    }
-    for (i=0; i<192*224 /32; i++) {
-        fwrite(&intv.stic.xbt_bmp[i], sizeof(intv.stic.xbt_bmp[i]), 1, f);
-    }
-    for (i=0; i<192*224 / 8; i++) {
-        fwrite(&intv.stic.image[i], sizeof(intv.stic.image[i]), 1, f);
-    }
-
-    memcpy(phase, "phase8d", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-    for (i=0; i<8; i++) {
-        for (k=0; k<4; k++) {
-            fwrite(&intv.stic.gfx->bbox[i][k], sizeof(intv.stic.gfx->bbox[i][k]), 1, f);
-        }
-    }
-
-    fwrite(&intv.stic.gfx->dirty, sizeof(intv.stic.gfx->dirty), 1, f);
-    fwrite(&intv.stic.gfx->drop_frame, sizeof(intv.stic.gfx->drop_frame), 1, f);
-    fwrite(&intv.stic.gfx->dropped_frames, sizeof(intv.stic.gfx->dropped_frames), 1, f);
-    fwrite(&intv.stic.gfx->tot_frames, sizeof(intv.stic.gfx->tot_frames), 1, f);
-    fwrite(&intv.stic.gfx->tot_dropped_frames, sizeof(intv.stic.gfx->tot_dropped_frames), 1, f);
-
-    fwrite(&intv.stic.gfx->b_color, sizeof(intv.stic.gfx->b_color), 1, f);
-    fwrite(&intv.stic.gfx->b_dirty, sizeof(intv.stic.gfx->b_dirty), 1, f);
-    fwrite(&intv.stic.gfx->x_blank, sizeof(intv.stic.gfx->x_blank), 1, f);
-    fwrite(&intv.stic.gfx->y_blank, sizeof(intv.stic.gfx->y_blank), 1, f);
-    fwrite(&intv.stic.gfx->x_delay, sizeof(intv.stic.gfx->x_delay), 1, f);
-    fwrite(&intv.stic.gfx->y_delay, sizeof(intv.stic.gfx->y_delay), 1, f);
-    fwrite(&intv.stic.gfx->debug_blank, sizeof(intv.stic.gfx->debug_blank), 1, f);
-
-    memcpy(phase, "phase8e", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-    fwrite(&intv.stic.gfx->periph.addr_base, sizeof(intv.stic.gfx->periph.addr_base), 1, f);
-    fwrite(&intv.stic.gfx->periph.addr_mask, sizeof(intv.stic.gfx->periph.addr_mask), 1, f);
-    fwrite(&intv.stic.gfx->periph.now, sizeof(intv.stic.gfx->periph.now), 1, f);
-    fwrite(&intv.stic.gfx->periph.min_tick, sizeof(intv.stic.gfx->periph.min_tick), 1, f);
-    fwrite(&intv.stic.gfx->periph.max_tick, sizeof(intv.stic.gfx->periph.max_tick), 1, f);
-    fwrite(&intv.stic.gfx->periph.next_tick, sizeof(intv.stic.gfx->periph.next_tick), 1, f);
-
-    fwrite(&intv.stic.gfx->periph.next_tick, sizeof(intv.stic.gfx->periph.next_tick), 1, f);
-
-    memcpy(phase, "phase_9", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
-
-#if 0
-	for (k=0; k<32; k++) {
-        fwrite(&intv.exec.banksw[k], sizeof(intv.exec.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fwrite(&intv.exec2.banksw[k], sizeof(intv.exec2.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fwrite(&intv.sys_ram.banksw[k], sizeof(intv.sys_ram.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fwrite(&intv.sys_ram2.banksw[k], sizeof(intv.sys_ram2.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fwrite(&intv.scr_ram.banksw[k], sizeof(intv.scr_ram.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fwrite(&intv.glt_ram.banksw[k], sizeof(intv.glt_ram.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fwrite(&intv.game0.banksw[k], sizeof(intv.game0.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fwrite(&intv.game1.banksw[k], sizeof(intv.game1.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fwrite(&intv.game2.banksw[k], sizeof(intv.game2.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fwrite(&intv.ecs0.banksw[k], sizeof(intv.ecs0.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fwrite(&intv.ecs1.banksw[k], sizeof(intv.ecs1.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fwrite(&intv.ecs2.banksw[k], sizeof(intv.ecs2.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fwrite(&intv.ecs_ram.banksw[k], sizeof(intv.ecs_ram.banksw[k]), 1, f);
-	}
-#endif
 
-    memcpy(phase, "phase10", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
+    resync_after_restore();
 
-	for (k=0; k<4096 + 256; k++) {
-        fwrite(&intv.exec_img[k], sizeof(intv.exec_img[k]), 1, f);
-	}
-	for (k=0; k<2048; k++) {
-        fwrite(&intv.grom_img[k], sizeof(intv.grom_img[k]), 1, f);
-	}
-	for (k=0; k<4096 * 3; k++) {
-        fwrite(&intv.ecs_img[k], sizeof(intv.ecs_img[k]), 1, f);
-	}
+    jzp_printf("Loaded dump.sav\n");
+}
 
-    memcpy(phase, "phase11", sizeof(phase));
-	fwrite(phase, sizeof(phase), 1, f);
+/* ======================================================================== */
+/*  RESUME_AUTOSAVE  -- Restore the machine from its autosave file, if it   */
+/*                      has one.  Shares the arena with SAVE_STATE.         */
+/* ======================================================================== */
+static void resume_autosave(void)
+{
+    if (dump_snap_init() || autosave_load(intv.autosave, &dump_snap) ||
+        snap_restore(&dump_snap))
+        return;
 
-    // Write periph's notion of 'now'
-    fwrite(&intv.intv->periph.now, sizeof(intv.intv->periph.now), 1, f);
+    resync_after_restore();
 
-    fclose(f);
+    jzp_printf("Resumed from autosave.\n");
 }
 
+/* ======================================================================== */
+/*  RESYNC_AFTER_RESTORE -- Memory changed behind the CPU's back, so toss   */
+/*                          its decode cache.  Then force display refreshes */
+/*                          everywhere and resync time.                     */
+/* ======================================================================== */
+static void resync_after_restore(void)
+{
+    cp1600_invalidate(&intv.cp1600, 0, 0xFFFF);
+    stic_resync(&(intv.stic));
+    gfx_resync(&(intv.gfx));
+    speed_resync(&(intv.speed));
+}
 
 /*
  * ============================================================================
- *  LOAD_DUMP
+ *  REWIND_SERVICE   -- Called from the main loop between ticks.  Steps
+ *                      back if asked to, else records each new frame.
+ *  REWIND_REQUEST   -- Called by the debugger to step back some frames.
+ *  REWIND_TO        -- Called by the debugger to go back to the last frame
+ *                      before a given cycle, so it can replay from there.
+ *  REWIND_TO_DONE   -- Called by the debugger when it's done replaying.
+ *
+ *  Frames are recorded between ticks, which always end on a STIC phase
+ *  boundary, and only when the frame count changes.  The debugger runs
+ *  in the middle of a tick, so it can't restore state itself.  Instead
+ *  it queues a request and lets the CPU run out the tick; we step back
+ *  here and then halt back into the debugger.
+ *
+ *  A replay takes its controller input from the input log, and can only
+ *  go back as far as the log does.
  * ============================================================================
  */
+static int      rw_pending = 0;     /* Frames the debugger asked to undo.  */
+static uint_32  rw_last_frame = 0;  /* gfx frame count at last push.       */
+static int      rw_to_pending = 0;  /* Debugger asked for REWIND_TO.       */
+static uint_64  rw_to_when = 0;     /* ...and this is the cycle it gave.   */
 
-void load_dump()
+static void rewind_service(void)
 {
-    FILE *f;
-    int addr, i, test, k;
-	unsigned short data, data2;
-	char phase[8];
-    memset(phase, 0, sizeof(phase));
+    static char rw_reason[64];
+    int frames = rw_pending + (intv.do_rewind & 1);
+    int popped = 0;
 
-    f = fopen("dump.sav","rb");
-    if (!f)
+    if (rw_to_pending)
     {
-        perror("fopen(\"dump.sav\", \"r\")");
-        jzp_printf("couldn't open dump.sav.\n");
-
-		return;
-    }
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase);//1
-
-    fread(&intv.cp1600.periph.addr_base, sizeof(intv.cp1600.periph.addr_base), 1, f);
-    fread(&intv.cp1600.periph.addr_mask, sizeof(intv.cp1600.periph.addr_mask), 1, f);
-    fread(&intv.cp1600.periph.now, sizeof(intv.cp1600.periph.now), 1, f);
-    fread(&intv.cp1600.periph.min_tick, sizeof(intv.cp1600.periph.min_tick), 1, f);
-    fread(&intv.cp1600.periph.max_tick, sizeof(intv.cp1600.periph.max_tick), 1, f);
-    fread(&intv.cp1600.periph.next_tick, sizeof(intv.cp1600.periph.next_tick), 1, f);
-
-    fread(&intv.cp1600.snoop.addr_base, sizeof(intv.cp1600.snoop.addr_base), 1, f);
-    fread(&intv.cp1600.snoop.addr_mask, sizeof(intv.cp1600.snoop.addr_mask), 1, f);
-    fread(&intv.cp1600.snoop.now, sizeof(intv.cp1600.snoop.now), 1, f);
-    fread(&intv.cp1600.snoop.min_tick, sizeof(intv.cp1600.snoop.min_tick), 1, f);
-    fread(&intv.cp1600.snoop.max_tick, sizeof(intv.cp1600.snoop.max_tick), 1, f);
-    fread(&intv.cp1600.snoop.next_tick, sizeof(intv.cp1600.snoop.next_tick), 1, f);
-
-    fread(&intv.cp1600.tot_cycle, sizeof(intv.cp1600.tot_cycle), 1, f);
-    fread(&intv.cp1600.tot_instr, sizeof(intv.cp1600.tot_instr), 1, f);
-    fread(&intv.cp1600.tot_cache, sizeof(intv.cp1600.tot_cache), 1, f);
-    fread(&intv.cp1600.tot_noncache, sizeof(intv.cp1600.tot_noncache), 1, f);
-
-    for (i = 0; i <= 7; i++)
-    {
-        fread(&intv.cp1600.r[i], sizeof(intv.cp1600.r[i]), 1, f);
-    }
-
-    fread(&intv.cp1600.S, sizeof(intv.cp1600.S), 1, f);
-    fread(&intv.cp1600.C, sizeof(intv.cp1600.C), 1, f);
-    fread(&intv.cp1600.O, sizeof(intv.cp1600.O), 1, f);
-    fread(&intv.cp1600.Z, sizeof(intv.cp1600.Z), 1, f);
-    fread(&intv.cp1600.I, sizeof(intv.cp1600.I), 1, f);
-    fread(&intv.cp1600.D, sizeof(intv.cp1600.D), 1, f);
-
-    fread(&intv.cp1600.intr, sizeof(intv.cp1600.intr), 1, f);
-
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //2
+        rw_to_pending = 0;
 
-    fread(&intv.cp1600.req_bus.intrq, sizeof(intv.cp1600.req_bus.intrq), 1, f);
-    fread(&intv.cp1600.req_bus.intrq_until, sizeof(intv.cp1600.req_bus.intrq_until), 1, f);
-    fread(&intv.cp1600.req_bus.busrq_until, sizeof(intv.cp1600.req_bus.busrq_until), 1, f);
-    fread(&intv.cp1600.req_bus.next_intrq, sizeof(intv.cp1600.req_bus.next_intrq), 1, f);
-    fread(&intv.cp1600.req_bus.next_busrq, sizeof(intv.cp1600.req_bus.next_busrq), 1, f);
-    fread(&intv.cp1600.req_bus.intak, sizeof(intv.cp1600.req_bus.intak), 1, f);
-    fread(&intv.cp1600.req_bus.busak, sizeof(intv.cp1600.req_bus.busak), 1, f);
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //3
-
-    fread(&intv.cp1600.oldpc, sizeof(intv.cp1600.oldpc), 1, f);
-    fread(&intv.cp1600.ext, sizeof(intv.cp1600.ext), 1, f);
-    fread(&intv.cp1600.int_vec, sizeof(intv.cp1600.int_vec), 1, f);
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //4
-
-    for (i = 0; i < 1 << (CP1600_MEMSIZE-CP1600_DECODE_PAGE - 5); i++)
-    {
-        fread(&intv.cp1600.cacheable[i], sizeof(intv.cp1600.cacheable[i]), 1, f);
-    }
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //5
+        if (rewind_back_to(intv.rewind, rw_to_when) != 0)
+        {
+            debug_halt_reason    = "Lost the rewind history.";
+            debug_fault_detected = DEBUG_ASYNC_HALT;
+            rw_last_frame = intv.gfx.tot_frames;
+            return;
+        }
 
-    fread(&intv.cp1600.instr_tick_per, sizeof(intv.cp1600.instr_tick_per), 1, f);
+        /* The machine moved, whether or not we can replay from here. */
+        resync_after_restore();
 
-	for (addr = 0; addr <= 0xFFFF; addr++)
-	{
-        fread(&data, sizeof(data), 1, f);
-        if (addr > 0x40)
+        if (inplog_replay(&intv.inplog) == 0)
+        {
+            /* The debugger replays from here one instruction at a time. */
+            intv.cp1600.instr_tick_per = 1;
+            debug_rewound = 1;
+        } else
         {
-            periph_write((periph_p)intv.intv, (periph_p)intv.intv,
-                               addr, data);
+            debug_halt_reason    = "Lost the input log.";
+            debug_fault_detected = DEBUG_ASYNC_HALT;
         }
-	}
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //6
-
-    fread(&intv.stic.stic_cr.addr_base, sizeof(intv.stic.stic_cr.addr_base), 1, f);
-    fread(&intv.stic.stic_cr.addr_mask, sizeof(intv.stic.stic_cr.addr_mask), 1, f);
-    fread(&intv.stic.stic_cr.now, sizeof(intv.stic.stic_cr.now), 1, f);
-    fread(&intv.stic.stic_cr.min_tick, sizeof(intv.stic.stic_cr.min_tick), 1, f);
-    fread(&intv.stic.stic_cr.max_tick, sizeof(intv.stic.stic_cr.max_tick), 1, f);
-    fread(&intv.stic.stic_cr.next_tick, sizeof(intv.stic.stic_cr.next_tick), 1, f);
-
-    fread(&intv.stic.snoop_btab.addr_base, sizeof(intv.stic.snoop_btab.addr_base), 1, f);
-    fread(&intv.stic.snoop_btab.addr_mask, sizeof(intv.stic.snoop_btab.addr_mask), 1, f);
-    fread(&intv.stic.snoop_btab.now, sizeof(intv.stic.snoop_btab.now), 1, f);
-    fread(&intv.stic.snoop_btab.min_tick, sizeof(intv.stic.snoop_btab.min_tick), 1, f);
-    fread(&intv.stic.snoop_btab.max_tick, sizeof(intv.stic.snoop_btab.max_tick), 1, f);
-    fread(&intv.stic.snoop_btab.next_tick, sizeof(intv.stic.snoop_btab.next_tick), 1, f);
-
-    fread(&intv.stic.snoop_gram.addr_base, sizeof(intv.stic.snoop_gram.addr_base), 1, f);
-    fread(&intv.stic.snoop_gram.addr_mask, sizeof(intv.stic.snoop_gram.addr_mask), 1, f);
-    fread(&intv.stic.snoop_gram.now, sizeof(intv.stic.snoop_gram.now), 1, f);
-    fread(&intv.stic.snoop_gram.min_tick, sizeof(intv.stic.snoop_gram.min_tick), 1, f);
-    fread(&intv.stic.snoop_gram.max_tick, sizeof(intv.stic.snoop_gram.max_tick), 1, f);
-    fread(&intv.stic.snoop_gram.next_tick, sizeof(intv.stic.snoop_gram.next_tick), 1, f);
-
-    fread(&intv.stic.req_bus->intrq, sizeof(intv.stic.req_bus->intrq), 1, f);
-    fread(&intv.stic.req_bus->intrq_until, sizeof(intv.stic.req_bus->intrq_until), 1, f);
-    fread(&intv.stic.req_bus->busrq_until, sizeof(intv.stic.req_bus->busrq_until), 1, f);
-    fread(&intv.stic.req_bus->next_intrq, sizeof(intv.stic.req_bus->next_intrq), 1, f);
-    fread(&intv.stic.req_bus->next_busrq, sizeof(intv.stic.req_bus->next_busrq), 1, f);
-    fread(&intv.stic.req_bus->intak, sizeof(intv.stic.req_bus->intak), 1, f);
-    fread(&intv.stic.req_bus->busak, sizeof(intv.stic.req_bus->busak), 1, f);
-
-    fread(&intv.stic.cp_row, sizeof(intv.stic.cp_row), 1, f);
-    fread(&intv.stic.ve_post, sizeof(intv.stic.ve_post), 1, f);
-    fread(&intv.stic.vid_enable, sizeof(intv.stic.vid_enable), 1, f);
-    fread(&intv.stic.mode, sizeof(intv.stic.mode), 1, f);
-
-    fread(&intv.stic.p_mode, sizeof(intv.stic.p_mode), 1, f);
-    fread(&intv.stic.bt_dirty, sizeof(intv.stic.bt_dirty), 1, f);
-    fread(&intv.stic.gr_dirty, sizeof(intv.stic.gr_dirty), 1, f);
-    fread(&intv.stic.ob_dirty, sizeof(intv.stic.ob_dirty), 1, f);
-    fread(&intv.stic.rand_regs, sizeof(intv.stic.rand_regs), 1, f);
-
-    fread(&intv.stic.pal, sizeof(intv.stic.pal), 1, f);
-    fread(&intv.stic.drop_frame, sizeof(intv.stic.drop_frame), 1, f);
-    fread(&intv.stic.gmem_accessible, sizeof(intv.stic.gmem_accessible), 1, f);
-    fread(&intv.stic.stic_accessible, sizeof(intv.stic.stic_accessible), 1, f);
-    fread(&intv.stic.next_irq, sizeof(intv.stic.next_irq), 1, f);
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //7
-
-    fread(&intv.stic.phase, sizeof(intv.stic.phase), 1, f);
-    fread(&intv.stic.next_phase, sizeof(intv.stic.next_phase), 1, f);
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //8
-
-    for (i=0; i<0x40; i++) {
-        fread(&intv.stic.raw[i], sizeof(intv.stic.raw[i]), 1, f);
-    }
 
-    for (i=0; i<0x140 * 8; i++) {
-        fread(&intv.stic.gmem[i], sizeof(intv.stic.gmem[i]), 1, f);
+        rw_last_frame = intv.gfx.tot_frames;
+        return;
     }
 
-    fread(&intv.stic.fifo_ptr, sizeof(intv.stic.fifo_ptr), 1, f);
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //8a
-
-    for (i=0; i<240; i++) {
-        fread(&intv.stic.btab_sr[i], sizeof(intv.stic.btab_sr[i]), 1, f);
-    }
-    for (i=0; i<240; i++) {
-        fread(&intv.stic.btab[i], sizeof(intv.stic.btab[i]), 1, f);
-    }
-    for (i=0; i<12; i++) {
-        fread(&intv.stic.last_bg[i], sizeof(intv.stic.last_bg[i]), 1, f);
+    if (frames && intv.inpmov.mode != INPMOV_OFF)
+    {
+        jzp_printf("Can't rewind during an input movie.\n");
+        rw_pending     = 0;
+        intv.do_rewind = 0;
+        frames         = 0;
     }
 
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //8b
-
-    fread(&intv.stic.time, sizeof(intv.stic.time), 1, f);
+    if (frames)
+    {
+        while (popped < frames && rewind_pop(intv.rewind) == 0)
+            popped++;
 
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //8c
+        if (popped)
+            resync_after_restore();
 
-    for (i=0; i<240*8; i++) {
-        fread(&intv.stic.bt_bmp[i], sizeof(intv.stic.bt_bmp[i]), 1, f);
-    }
-    for (i=0; i<16*16  / 8; i++) {
-        fread(&intv.stic.mob_img[i], sizeof(intv.stic.mob_img[i]), 1, f);
-    }
-    for (i=0; i<8; i++) {
-        for (k=0; k<16; k++) {
-            fread(&intv.stic.mob_bmp[i][k], sizeof(intv.stic.mob_bmp[i][k]), 1, f);
+        if (rw_pending)
+        {
+            sprintf(rw_reason, "Rewound %d frame%s; %d left.", popped,
+                    popped == 1 ? "" : "s", rewind_frames(intv.rewind));
+            debug_halt_reason    = rw_reason;
+            debug_fault_detected = DEBUG_ASYNC_HALT;
         }
-    }
-    for (i=0; i<192*224 / 8; i++) {
-        fread(&intv.stic.mpl_img[i], sizeof(intv.stic.mpl_img[i]), 1, f);
-    }
-    for (i=0; i<192*224 /32; i++) {
-        fread(&intv.stic.mpl_vsb[i], sizeof(intv.stic.mpl_vsb[i]), 1, f);
-    }
-    for (i=0; i<192*224 /32; i++) {
-        fread(&intv.stic.mpl_pri[i], sizeof(intv.stic.mpl_pri[i]), 1, f);
-    }
-    for (i=0; i<192*224 / 8; i++) {
-        fread(&intv.stic.xbt_img[i], sizeof(intv.stic.xbt_img[i]), 1, f);
-    }
-    for (i=0; i<192*224 /32; i++) {
-        fread(&intv.stic.xbt_bmp[i], sizeof(intv.stic.xbt_bmp[i]), 1, f);
-    }
-    for (i=0; i<192*224 / 8; i++) {
-        fread(&intv.stic.image[i], sizeof(intv.stic.image[i]), 1, f);
-    }
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //8d
 
-    for (i=0; i<8; i++) {
-        for (k=0; k<4; k++) {
-            fread(&intv.stic.gfx->bbox[i][k], sizeof(intv.stic.gfx->bbox[i][k]), 1, f);
-        }
+        rw_pending      = 0;
+        intv.do_rewind &= ~1U;
+        rw_last_frame   = intv.gfx.tot_frames;
+        return;
     }
 
-    fread(&intv.stic.gfx->dirty, sizeof(intv.stic.gfx->dirty), 1, f);
-    fread(&intv.stic.gfx->drop_frame, sizeof(intv.stic.gfx->drop_frame), 1, f);
-    fread(&intv.stic.gfx->dropped_frames, sizeof(intv.stic.gfx->dropped_frames), 1, f);
-    fread(&intv.stic.gfx->tot_frames, sizeof(intv.stic.gfx->tot_frames), 1, f);
-    fread(&intv.stic.gfx->tot_dropped_frames, sizeof(intv.stic.gfx->tot_dropped_frames), 1, f);
-
-    fread(&intv.stic.gfx->b_color, sizeof(intv.stic.gfx->b_color), 1, f);
-    fread(&intv.stic.gfx->b_dirty, sizeof(intv.stic.gfx->b_dirty), 1, f);
-    fread(&intv.stic.gfx->x_blank, sizeof(intv.stic.gfx->x_blank), 1, f);
-    fread(&intv.stic.gfx->y_blank, sizeof(intv.stic.gfx->y_blank), 1, f);
-    fread(&intv.stic.gfx->x_delay, sizeof(intv.stic.gfx->x_delay), 1, f);
-    fread(&intv.stic.gfx->y_delay, sizeof(intv.stic.gfx->y_delay), 1, f);
-    fread(&intv.stic.gfx->debug_blank, sizeof(intv.stic.gfx->debug_blank), 1, f);
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //9
-
-    fread(&intv.stic.gfx->periph.addr_base, sizeof(intv.stic.gfx->periph.addr_base), 1, f);
-    fread(&intv.stic.gfx->periph.addr_mask, sizeof(intv.stic.gfx->periph.addr_mask), 1, f);
-    fread(&intv.stic.gfx->periph.now, sizeof(intv.stic.gfx->periph.now), 1, f);
-    fread(&intv.stic.gfx->periph.min_tick, sizeof(intv.stic.gfx->periph.min_tick), 1, f);
-    fread(&intv.stic.gfx->periph.max_tick, sizeof(intv.stic.gfx->periph.max_tick), 1, f);
-    fread(&intv.stic.gfx->periph.next_tick, sizeof(intv.stic.gfx->periph.next_tick), 1, f);
-
-    fread(&intv.stic.gfx->periph.next_tick, sizeof(intv.stic.gfx->periph.next_tick), 1, f);
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //9
-
-#if 0
-	for (k=0; k<32; k++) {
-        fread(&intv.exec.banksw[k], sizeof(intv.exec.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fread(&intv.exec2.banksw[k], sizeof(intv.exec2.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fread(&intv.sys_ram.banksw[k], sizeof(intv.sys_ram.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fread(&intv.sys_ram2.banksw[k], sizeof(intv.sys_ram2.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fread(&intv.scr_ram.banksw[k], sizeof(intv.scr_ram.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fread(&intv.glt_ram.banksw[k], sizeof(intv.glt_ram.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fread(&intv.game0.banksw[k], sizeof(intv.game0.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fread(&intv.game1.banksw[k], sizeof(intv.game1.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fread(&intv.game2.banksw[k], sizeof(intv.game2.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fread(&intv.ecs0.banksw[k], sizeof(intv.ecs0.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fread(&intv.ecs1.banksw[k], sizeof(intv.ecs1.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fread(&intv.ecs2.banksw[k], sizeof(intv.ecs2.banksw[k]), 1, f);
-	}
-	for (k=0; k<32; k++) {
-        fread(&intv.ecs_ram.banksw[k], sizeof(intv.ecs_ram.banksw[k]), 1, f);
-	}
-#endif
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //10
-
-	for (k=0; k<4096 + 256; k++) {
-        fread(&intv.exec_img[k], sizeof(intv.exec_img[k]), 1, f);
-	}
-	for (k=0; k<2048; k++) {
-        fread(&intv.grom_img[k], sizeof(intv.grom_img[k]), 1, f);
-	}
-	for (k=0; k<4096 * 3; k++) {
-        fread(&intv.ecs_img[k], sizeof(intv.ecs_img[k]), 1, f);
-	}
-
-	fread(phase, sizeof(phase)-1, 1, f);
-	jzp_printf("phase read: %s\n", phase); //10
+    if (intv.gfx.tot_frames != rw_last_frame)
+    {
+        rw_last_frame = intv.gfx.tot_frames;
+        rewind_push(intv.rewind, intv.cp1600.periph.now);
+    }
+}
 
+int rewind_request(int frames)
+{
+    if (!intv.rewind)
+        return -1;
 
-    // Get periph's notion of 'now'
-    fread(&intv.intv->periph.now, sizeof(intv.intv->periph.now), 1, f);
+    if (frames <= 0)
+        rewind_stats(intv.rewind);
+    else
+        rw_pending += frames;
 
-    fclose(f);
+    return rewind_frames(intv.rewind);
+}
 
-	save_state(1);
-    
-    // Force display refreshes everywhere
-    stic_resync(&(intv.stic));
-    gfx_resync(&(intv.gfx));
+int rewind_to(uint_64 when, uint_64 *stamp)
+{
+    if (!intv.rewind || intv.inpmov.mode != INPMOV_OFF ||
+        rewind_find(intv.rewind, when, stamp) < 0 ||
+        !inplog_reaches(&intv.inplog, *stamp))
+        return -1;
 
-    // Force time to resync
-    speed_resync(&(intv.speed));
+    rw_to_pending = 1;
+    rw_to_when    = when;
+    return 0;
+}
 
-	jzp_printf("load ended\n");
+void rewind_to_done(void)
+{
+    inplog_live(&intv.inplog);
 }
 
 /* ======================================================================== */
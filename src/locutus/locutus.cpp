@@ -25,6 +25,7 @@ t_locutus::t_locutus()
     memset( (void *)&ram     [0]   , 0, sizeof( ram      ) );
     memset( (void *)&mem_map [0][0], 0, sizeof( mem_map  ) );
     memset( (void *)&pfl_map [0][0], 0, sizeof( pfl_map  ) );
+    memset( (void *)&ram_dirty[0]  , 0, sizeof( ram_dirty) );
 
     for (int i = 0; i < 256; i++)
         mem_perm[i][0].reset();
@@ -42,6 +42,10 @@ class t_locutus
     uint16_t        pfl_map [16][16];   // bits 11:0 form bits 19:12 of addr
     t_perm          pfl_perm[16][16];
 
+    // One bit per para of ram[], set on write.  The layout matches the
+    // snapshot engine's dirty bitmaps:  para N is bit N%32 of word N/32.
+    uint32_t        ram_dirty[LOCUTUS_CAPACITY / 256 / 32];
+
     t_cpu_cache_if* cpu_cache;
 
     std::bitset<64>               feature_flag;
@@ -90,6 +94,7 @@ class t_locutus
         validate_addr( "t_locutus::write", addr );
         ram[addr] = data;
         initialized[addr] = true;
+        ram_dirty[addr >> 13] |= 1u << ((addr >> 8) & 31);
     }
        
     inline uint16_t get_mem_map ( const uint8_t para, const bool reset ) const
@@ -173,6 +178,19 @@ class t_locutus
     }
 
     t_addr_list get_initialized_span_list( void ) const;
+
+    // -------------------------------------------------------------------- //
+    //  Raw state, for emulator snapshots.  The maps and permissions are    //
+    //  one contiguous block of plain data.                                 //
+    // -------------------------------------------------------------------- //
+    uint16_t* get_ram_ptr  ( void ) { return ram;       }
+    uint32_t* get_ram_dirty( void ) { return ram_dirty; }
+    void*     get_map_ptr  ( void ) { return mem_map;   }
+
+    size_t    get_map_size ( void ) const
+    {
+        return (const char *)( pfl_perm + 16 ) - (const char *)mem_map;
+    }
 };
 
 
@@ -7,6 +7,11 @@
 
 #include "locutus_adapt.h"
 
+extern "C"
+{
+#include "serializer/snapshot.h"
+}
+
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -89,6 +94,20 @@ extern "C" void locutus_dtor( periph_p periph )
     wrap->locutus_priv = 0;
 }
 
+// ------------------------------------------------------------------------ //
+//  LOCUTUS_SER_INIT -- Register the RAM and memory maps for snapshots.     //
+//                      RAM writes are tracked by t_locutus::write().       //
+// ------------------------------------------------------------------------ //
+extern "C" void locutus_ser_init( periph_p periph )
+{
+    t_locutus_wrap *wrap = (t_locutus_wrap *)periph;
+    t_locutus      &loc  = wrap->locutus_priv->locutus;
+
+    snap_track   ( periph->name, loc.get_ram_ptr(), 0, LOCUTUS_CAPACITY,
+                   sizeof( uint16_t ), loc.get_ram_dirty() );
+    snap_register( periph->name, loc.get_map_ptr(), loc.get_map_size() );
+}
+
 extern "C" int make_locutus
 (
     t_locutus_wrap  *loc_wrap,      /*  pointer to a Locutus wrapper    */
@@ -140,7 +159,7 @@ extern "C" int make_locutus
 
     loc_wrap->periph.addr_base  = 0;
     loc_wrap->periph.addr_mask  = ~0U;
-    loc_wrap->periph.ser_init   = NULL; // no support for serializer() 
+    loc_wrap->periph.ser_init   = locutus_ser_init;
 
     return 0;
 }
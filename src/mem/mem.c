@@ -19,6 +19,7 @@
 #include "mem.h"
 #include "cp1600/cp1600.h"
 #include "serializer/serializer.h"
+#include "serializer/snapshot.h"
 
 
 /*
@@ -95,6 +96,7 @@ void    mem_wr_8    (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
     mem_t *mem = (mem_t*)per;
     UNUSED(ign);
     mem->image[addr] = data & 0xFF;
+    SNAP_DIRTY(mem->dirty, addr);
 }
 
 void    mem_wr_10   (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
@@ -102,6 +104,7 @@ void    mem_wr_10   (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
     mem_t *mem = (mem_t*)per;
     UNUSED(ign);
     mem->image[addr] = data & 0x3FF;
+    SNAP_DIRTY(mem->dirty, addr);
 }
 
 void    mem_wr_16   (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
@@ -109,6 +112,7 @@ void    mem_wr_16   (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
     mem_t *mem = (mem_t*)per;
     UNUSED(ign);
     mem->image[addr] = data;
+    SNAP_DIRTY(mem->dirty, addr);
 }
 
 void    mem_wr_g16  (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
@@ -117,6 +121,7 @@ void    mem_wr_g16  (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
     UNUSED(ign);
     if ((rand() & 131071) == 3) data ^= 1 << (0xF & rand());
     mem->image[addr] = data;
+    SNAP_DIRTY(mem->dirty, addr);
 }
 
 void    mem_wr_gen  (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
@@ -124,6 +129,7 @@ void    mem_wr_gen  (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
     mem_t *mem = (mem_t*)per;
     UNUSED(ign);
     mem->image[addr] = data & mem->data_mask;
+    SNAP_DIRTY(mem->dirty, addr);
 }
 
 void    mem_wr_null (periph_t *per, periph_t *ign, uint_32 addr, uint_32 data)
@@ -458,12 +464,9 @@ int mem_make_glitch_ram
  */
 void mem_ser_init(periph_p p)
 {
-#ifdef NO_SERIALIZER
-    UNUSED(p);
-#else
-    ser_hier_t *hier, *phier;
     mem_t *mem = (mem_t *)p;
-
+#ifndef NO_SERIALIZER
+    ser_hier_t *hier, *phier;
 
     hier  = ser_new_hierarchy(NULL, p->name);
     phier = ser_new_hierarchy(hier, "periph");
@@ -485,6 +488,16 @@ void mem_ser_init(periph_p p)
                      SER_MAND|SER_HEX);
     }
 #endif
+
+    /* -------------------------------------------------------------------- */
+    /*  Paged ROMs only need their page selection in a snapshot.  RAMs    */
+    /*  need their whole image, tracked a page at a time by the writers.    */
+    /* -------------------------------------------------------------------- */
+    if (p->read == mem_rd_p16)
+        SNAP_FIELDS(p->name, mem, mem_t, page, page_sel);
+    else
+        snap_track(p->name, mem->image, 0, mem->img_length,
+                   sizeof(uint_16), mem->dirty);
 }
 
 
@@ -32,6 +32,7 @@ typedef struct mem_t
     uint_8      page_sel;   /*  The page selected in the ROM seg            */
     uint_32     img_length; /*  Actual length of memory image.              */
     void        *cpu;       /*  CPU pointer for handling caching.           */
+    uint_32     dirty[8];   /*  Pages written since last snapshot.          */
 } mem_t;
 
 
@@ -59,6 +59,13 @@
 /*  The length of the row-delta map is implied by the Y dimension of        */
 /*  the screen.                                                             */
 /*                                                                          */
+/*  KEYFRAMES                                                               */
+/*                                                                          */
+/*  A frame that's sent without a row-delta map doesn't depend on the       */
+/*  frames before it, other than for the bounding boxes.  The encoder       */
+/*  sends at least one of every 16 frames it sends this way.  MVI_INDEX     */
+/*  finds them, so that a decoder can start partway into a movie.           */
+/*                                                                          */
 /*  ROW REPEAT MAP                                                          */
 /*                                                                          */
 /*  If present, the row-repeat map indicates which rows are repeats         */
@@ -121,13 +128,6 @@
 #define FLG_DLTMAP (16)
 #define FLG_LZOCMP (32)
 
-LOCAL uint_8 *enc_vid = NULL, *enc_buf = NULL, *enc_vid2;
-#ifndef NO_LZO
-LOCAL uint_8 *lzo_wrk = NULL, *lzo_tmp = NULL;
-#endif
-LOCAL uint_32 rowrpt[MVI_MAX_Y >> 5];
-LOCAL uint_32 rowdlt[MVI_MAX_Y >> 5];
-
 #define ENC_BUF_SZ (MVI_MAX_X * MVI_MAX_Y + 128)
 
 
@@ -156,22 +156,43 @@ void mvi_init(mvi_t *movie, int x_dim, int y_dim)
     movie->fr  = 0;
     movie->f   = NULL;
 
-    if (!enc_buf ) enc_buf  = CALLOC(uint_8, ENC_BUF_SZ);
-    if (!enc_vid ) enc_vid  = CALLOC(uint_8, MVI_MAX_X * MVI_MAX_Y);
-    if (!enc_vid2) enc_vid2 = CALLOC(uint_8, MVI_MAX_X * MVI_MAX_Y);
+    /* -------------------------------------------------------------------- */
+    /*  Scratch areas are per-movie, so two movies can be encoded or        */
+    /*  decoded at once, on different threads if need be.                   */
+    /* -------------------------------------------------------------------- */
+    movie->enc_buf  = CALLOC(uint_8, ENC_BUF_SZ);
+    movie->enc_vid  = CALLOC(uint_8, MVI_MAX_X * MVI_MAX_Y);
+    movie->enc_vid2 = CALLOC(uint_8, MVI_MAX_X * MVI_MAX_Y);
 
 #ifndef NO_LZO
-    if (!lzo_wrk) lzo_wrk = CALLOC(uint_8, LZO1X_MEM_COMPRESS);
-    if (!lzo_tmp) lzo_tmp = CALLOC(uint_8, ENC_BUF_SZ);
+    movie->lzo_wrk  = CALLOC(uint_8, LZO1X_MEM_COMPRESS);
+    movie->lzo_tmp  = CALLOC(uint_8, ENC_BUF_SZ);
 #endif
 
-    if (!enc_buf || !enc_vid || !enc_vid2 || !movie->vid)
+    if (!movie->enc_buf || !movie->enc_vid || !movie->enc_vid2 ||
+        !movie->vid)
     {
         perror("MVI_INIT");
         exit(1);
     }
 }
 
+/* ======================================================================== */
+/*  MVI_DTOR:  Release a movie's frame and scratch areas.  Does not close   */
+/*             the file.                                                    */
+/* ======================================================================== */
+void mvi_dtor(mvi_t *movie)
+{
+    CONDFREE(movie->vid);
+    CONDFREE(movie->enc_buf);
+    CONDFREE(movie->enc_vid);
+    CONDFREE(movie->enc_vid2);
+#ifndef NO_LZO
+    CONDFREE(movie->lzo_wrk);
+    CONDFREE(movie->lzo_tmp);
+#endif
+}
+
 /* ======================================================================== */
 /*  MVI_WR_FRAME:  Encode and write a movie frame to the movie file.        */
 /* ======================================================================== */
@@ -184,6 +205,11 @@ void mvi_wr_frame(mvi_t *movie, uint_8 *vid, uint_8 bbox[8][4])
     int yi, yo;
     uint_8 header_byte = 0;
     int rle_max_len;
+    uint_8  *enc_buf  = movie->enc_buf;
+    uint_8  *enc_vid  = movie->enc_vid;
+    uint_8  *enc_vid2 = movie->enc_vid2;
+    uint_32 *rowrpt   = movie->rowrpt;
+    uint_32 *rowdlt   = movie->rowdlt;
     uint_8 *enc_hdr;
     uint_8 *enc_ptr = enc_buf;
     uint_8 *evid = vid;
@@ -249,7 +275,7 @@ void mvi_wr_frame(mvi_t *movie, uint_8 *vid, uint_8 bbox[8][4])
     /* -------------------------------------------------------------------- */
     if (send_frame && rowdlt_ok)
     {
-        memset(rowdlt, 0, sizeof(rowdlt));      /* zero out repeat bitmap.  */
+        memset(rowdlt, 0, sizeof(movie->rowdlt));   /* zero repeat bitmap   */
         for (yi = yo = 0; yi < movie->y_dim; yi++)
         {
             if (memcmp(movie->vid + (yi*movie->x_dim),
@@ -305,7 +331,7 @@ void mvi_wr_frame(mvi_t *movie, uint_8 *vid, uint_8 bbox[8][4])
     /* -------------------------------------------------------------------- */
     if (send_frame && enc_height_rd > 1)
     {
-        memset(rowrpt, 0, sizeof(rowrpt));      /* zero out repeat bitmap.  */
+        memset(rowrpt, 0, sizeof(movie->rowrpt));   /* zero repeat bitmap   */
         memcpy(enc_vid, evid, movie->x_dim);    /* copy first row           */
         for (yi = 1, yo = 1; yi < enc_height_rd; yi++)
         {
@@ -541,19 +567,20 @@ no_rle:
 
 #ifndef NO_LZO
     /* -------------------------------------------------------------------- */
-    /*  Try to compress the encoded frame with LZO.                         */
+    /*  Try to compress the encoded frame with LZO, if we got the memory.   */
     /* -------------------------------------------------------------------- */
-    if (lzo_wrk && lzo_tmp && enc_ptr > enc_hdr + 8)
+    if (movie->lzo_wrk && movie->lzo_tmp && enc_ptr > enc_hdr + 8)
     {
         int r;
         lzo_uint lzo_len = 0, data_len = enc_ptr - enc_hdr - 8;
 
         r = lzo1x_1_compress(enc_hdr + 8, data_len,
-                             lzo_tmp, &lzo_len, (lzo_voidp)lzo_wrk);
+                             movie->lzo_tmp, &lzo_len,
+                             (lzo_voidp)movie->lzo_wrk);
 
         if (r == LZO_E_OK && lzo_len < data_len && lzo_len > 0)
         {
-            memcpy(enc_hdr + 8, lzo_tmp, lzo_len);
+            memcpy(enc_hdr + 8, movie->lzo_tmp, lzo_len);
             enc_ptr = enc_hdr + 8 + lzo_len;
             lzo_comp = 1;
             movie->tot_lzosave += data_len - lzo_len;
@@ -605,6 +632,11 @@ int  mvi_rd_frame(mvi_t *movie, uint_8 *vid, uint_8 bbox[8][4])
     int got_rle    = 0;
     int got_rowdlt = 0;
     int lzo_comp   = 0;
+    uint_8  *enc_buf  = movie->enc_buf;
+    uint_8  *enc_vid  = movie->enc_vid;
+    uint_8  *enc_vid2 = movie->enc_vid2;
+    uint_32 *rowrpt   = movie->rowrpt;
+    uint_32 *rowdlt   = movie->rowdlt;
     uint_8 *dec_ptr = enc_buf, *dec_end;
     uint_8 *dec_vid;
     uint_8 *dvid;
@@ -740,20 +772,20 @@ again:
         int r; 
         lzo_uint lzo_len = 0;
 
-        if (!lzo_tmp)
+        if (!movie->lzo_tmp)
         {
             fprintf(stderr, "MVI_RD: This movie is LZO-compressed, but "
                             "there is insufficient memory for decompresion\n");
             return -1;
         }
 
-        r = lzo1x_decompress(dec_ptr, fr_len - 8, lzo_tmp, 
+        r = lzo1x_decompress(dec_ptr, fr_len - 8, movie->lzo_tmp, 
                              &lzo_len, 
                              (lzo_voidp)NULL);
 
         if (r == LZO_E_OK)
         {
-            memcpy(dec_ptr, lzo_tmp, lzo_len);
+            memcpy(dec_ptr, movie->lzo_tmp, lzo_len);
             fr_len  = 8 + lzo_len;
             dec_end = dec_ptr + lzo_len;
         } else
@@ -777,7 +809,7 @@ again:
     /* -------------------------------------------------------------------- */
     /*  If we have a row-delta map, read that in.                           */
     /* -------------------------------------------------------------------- */
-    memset(rowdlt, 0, sizeof(rowdlt));
+    memset(rowdlt, 0, sizeof(movie->rowdlt));
     enc_height_rd = movie->y_dim;
 
     if (got_rowdlt)
@@ -806,7 +838,7 @@ again:
     /* -------------------------------------------------------------------- */
     /*  If we have a row-repeat map, read that in.                          */
     /* -------------------------------------------------------------------- */
-    memset(rowrpt, 0, sizeof(rowrpt));
+    memset(rowrpt, 0, sizeof(movie->rowrpt));
     enc_height = enc_height_rd;
 
     if (got_rowrpt)
@@ -979,6 +1011,148 @@ again:
            (got_bbox  ? 0 : MVI_BB_SAME);
 }
 
+/* ======================================================================== */
+/*  MVI_INDEX -- Scan a movie file for keyframes.  Returns the number of    */
+/*               keyframes, and a malloc'd array of them in '*keys'.  Sets  */
+/*               '*frames' to the number of frames in the file.  Leaves     */
+/*               the file at the start.  Returns -1 on error.               */
+/* ======================================================================== */
+int mvi_index(mvi_t *movie, mvi_key_t **keys, int *frames)
+{
+    mvi_key_t *key = NULL;
+    uint_8 hdr[8];
+    uint_8 bbox[8][4];
+    int n_keys = 0, max_keys = 0, ord = 0;
+    int x_dim = 0, y_dim = 0;
+    long ofs;
+
+    if (!movie->f || fseek(movie->f, 0, SEEK_SET) != 0)
+        return -1;
+
+    memset(bbox, 0, sizeof(bbox));
+
+    /* -------------------------------------------------------------------- */
+    /*  Walk the frame headers, skipping over the frame data.  The only     */
+    /*  data we need is the bounding boxes, since they're only sent when    */
+    /*  they change.                                                        */
+    /* -------------------------------------------------------------------- */
+    while ((ofs = ftell(movie->f)) >= 0 && fread(hdr, 1, 8, movie->f) == 8)
+    {
+        uint_32 fr_len, flags;
+
+        if (hdr[0] == 0x4A && hdr[1] == 0x5A &&
+            hdr[2] == 0x6A && hdr[3] == 0x7A)
+        {
+            x_dim = (hdr[5] << 8) | hdr[4];
+            y_dim = (hdr[7] << 8) | hdr[6];
+            continue;
+        }
+
+        fr_len = (hdr[0] <<  0) |
+                 (hdr[1] <<  8) |
+                 (hdr[2] << 16) |
+                 (hdr[3] << 24);
+        flags  = hdr[7];
+
+        if (fr_len < 8 || fr_len > ENC_BUF_SZ)
+        {
+            fprintf(stderr, "MVI_INDEX: Bad frame length %d at offset %ld\n",
+                    fr_len, ofs);
+            goto fail;
+        }
+
+        if ((flags & FLG_FRSENT) != 0 && (flags & FLG_DLTMAP) == 0)
+        {
+            if (n_keys == max_keys)
+            {
+                mvi_key_t *new_key;
+
+                max_keys = max_keys ? max_keys * 2 : 256;
+                new_key  = (mvi_key_t *)realloc(key,
+                                                max_keys * sizeof(mvi_key_t));
+                if (!new_key)
+                {
+                    fprintf(stderr, "MVI_INDEX: Out of memory\n");
+                    goto fail;
+                }
+                key = new_key;
+            }
+
+            key[n_keys].ofs   = ofs;
+            key[n_keys].ord   = ord;
+            key[n_keys].x_dim = x_dim;
+            key[n_keys].y_dim = y_dim;
+            memcpy(key[n_keys].bbox, bbox, sizeof(bbox));
+            n_keys++;
+        }
+
+        if (flags & FLG_BBSENT)
+        {
+            uint_8 *data = movie->enc_buf;
+
+            if (fread(data, 1, fr_len - 8, movie->f) != fr_len - 8)
+            {
+                fprintf(stderr, "MVI_INDEX: Short read on frame %d\n", ord);
+                goto fail;
+            }
+
+            if (flags & FLG_LZOCMP)
+            {
+#ifdef NO_LZO
+                fprintf(stderr, "MVI_INDEX: This movie is LZO-compressed.  "
+                                "LZO compression support is not compiled "
+                                "in.\n");
+                goto fail;
+#else
+                lzo_uint lzo_len = 0;
+
+                if (lzo1x_decompress(data, fr_len - 8, movie->lzo_tmp,
+                                     &lzo_len, (lzo_voidp)NULL) != LZO_E_OK ||
+                    lzo_len < sizeof(bbox))
+                {
+                    fprintf(stderr, "MVI_INDEX: LZO error on frame %d\n",
+                            ord);
+                    goto fail;
+                }
+                data = movie->lzo_tmp;
+#endif
+            }
+
+            memcpy(bbox, data, sizeof(bbox));
+        } else if (fseek(movie->f, fr_len - 8, SEEK_CUR) != 0)
+            goto fail;
+
+        ord++;
+    }
+
+    if (fseek(movie->f, 0, SEEK_SET) != 0)
+        goto fail;
+
+    *keys   = key;
+    *frames = ord;
+    return n_keys;
+
+fail:
+    CONDFREE(key);
+    return -1;
+}
+
+/* ======================================================================== */
+/*  MVI_SEEK  -- Position a movie at a keyframe from MVI_INDEX, so that     */
+/*               the next MVI_RD_FRAME returns that frame.                  */
+/* ======================================================================== */
+int mvi_seek(mvi_t *movie, const mvi_key_t *key)
+{
+    if (!movie->f || fseek(movie->f, key->ofs, SEEK_SET) != 0)
+        return -1;
+
+    movie->x_dim = key->x_dim;
+    movie->y_dim = key->y_dim;
+    memcpy(movie->bbox, key->bbox, sizeof(movie->bbox));
+
+    return 0;
+}
+
 /* ======================================================================== */
 /*  This program is free software; you can redistribute it and/or modify    */
 /*  it under the terms of the GNU General Public License as published by    */
@@ -18,12 +18,35 @@ typedef struct mvi_t            /*  Movie-related stuff.                */
 #ifndef NO_LZO
     uint_32 tot_lzosave;        /*  Total bytes saved by LZO            */
 #endif
+
+    /*  Encoder/decoder scratch.  Private to mvi.c.                     */
+    uint_8  *enc_buf;           /*  Encoded frame.                      */
+    uint_8  *enc_vid;           /*  Frame with repeated rows removed.   */
+    uint_8  *enc_vid2;          /*  Frame with unchanged rows removed.  */
+#ifndef NO_LZO
+    uint_8  *lzo_wrk;           /*  LZO compressor work area.           */
+    uint_8  *lzo_tmp;           /*  LZO (de)compressor output.          */
+#endif
+    uint_32 rowrpt[MVI_MAX_Y >> 5];     /*  Row-repeat bitmap.          */
+    uint_32 rowdlt[MVI_MAX_Y >> 5];     /*  Row-delta bitmap.           */
 } mvi_t;                        
 
 
+typedef struct mvi_key_t        /*  A keyframe, found by mvi_index.     */
+{
+    long    ofs;                /*  File offset of its frame header.    */
+    int     ord;                /*  Frames in the file before it.       */
+    int     x_dim, y_dim;       /*  Movie dimensions at that point.     */
+    uint_8  bbox[8][4];         /*  Bounding boxes before it's decoded. */
+} mvi_key_t;
+
+
 void mvi_init(mvi_t *movie, int x_dim, int y_dim);
+void mvi_dtor(mvi_t *movie);
 void mvi_wr_frame(mvi_t *movie, uint_8 *vid, uint_8 bbox[8][4]);
 int  mvi_rd_frame(mvi_t *movie, uint_8 *vid, uint_8 bbox[8][4]);
+int  mvi_index   (mvi_t *movie, mvi_key_t **keys, int *frames);
+int  mvi_seek    (mvi_t *movie, const mvi_key_t *key);
 
 /* Flags returned by mvi_rd_frame */
 #define MVI_FR_SAME (1)     /* set if movie file skipped the frame  */
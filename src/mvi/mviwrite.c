@@ -0,0 +1,179 @@
+/*
+ * ============================================================================
+ *  Title:    Background Movie Writer
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See mviwrite.h.
+ *
+ *  The slots form a ring.  'head' and 'tail' count frames queued and
+ *  encoded since the writer started;  only their difference matters.
+ *  The emulator advances 'head', the thread advances 'tail', both under
+ *  'lock'.  Neither holds the lock while copying or encoding:  slots
+ *  between 'tail' and 'head' belong to the thread, and the rest belong
+ *  to the emulator.
+ * ============================================================================
+ */
+
+#include "sdl.h"
+#include "config.h"
+#include "mvi/mvi.h"
+#include "mvi/mviwrite.h"
+
+#define MVIW_SLOTS  (8)         /* Frames that can be waiting to encode.    */
+
+struct mviw_t
+{
+    mvi_t       *movie;     /* Movie being encoded.  Thread only.           */
+    uint_8      *vid;       /* MVIW_SLOTS frames of pixels.                 */
+    uint_8      bbox[MVIW_SLOTS][8][4];     /* ...and their bounding boxes. */
+    int         fr_size;    /* Bytes per frame.                             */
+    uint_32     head;       /* Frames queued by emulator.                   */
+    uint_32     tail;       /* Frames encoded by thread.                    */
+    int         quit;       /* Request for thread to exit.                  */
+    int         stalls;     /* Number of times the emulator had to wait.    */
+
+    SDL_mutex   *lock;      /* Guards all of the above.                     */
+    SDL_cond    *wake;      /* Signals thread that there's work.            */
+    SDL_cond    *room;      /* Signals emulator that there's room.          */
+    SDL_Thread  *thread;
+};
+
+/* ======================================================================== */
+/*  MVIW_THREAD  -- Encode queued frames until told to quit and there's     */
+/*                  nothing left to encode.                                 */
+/* ======================================================================== */
+LOCAL int mviw_thread(void *opaque)
+{
+    mviw_t *w = (mviw_t *)opaque;
+
+    SDL_LockMutex(w->lock);
+    for (;;)
+    {
+        int slot;
+
+        while (!w->quit && w->head == w->tail)
+            SDL_CondWait(w->wake, w->lock);
+
+        if (w->head == w->tail)
+            break;
+
+        slot = w->tail % MVIW_SLOTS;
+        SDL_UnlockMutex(w->lock);
+
+        mvi_wr_frame(w->movie, w->vid + slot * w->fr_size, w->bbox[slot]);
+
+        SDL_LockMutex(w->lock);
+        w->tail++;
+        SDL_CondSignal(w->room);
+    }
+    SDL_UnlockMutex(w->lock);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  MVIW_CREATE  -- Start encoding a movie on a thread.                     */
+/* ======================================================================== */
+mviw_t *mviw_create(mvi_t *movie)
+{
+    mviw_t *w = CALLOC(mviw_t, 1);
+
+    if (!w)
+        goto fail;
+
+    w->movie   = movie;
+    w->fr_size = movie->x_dim * movie->y_dim;
+    w->vid     = CALLOC(uint_8, MVIW_SLOTS * w->fr_size);
+    w->lock    = SDL_CreateMutex();
+    w->wake    = SDL_CreateCond();
+    w->room    = SDL_CreateCond();
+
+    if (!w->vid || !w->lock || !w->wake || !w->room)
+        goto fail;
+
+    if (!(w->thread = SDL_CreateThread(mviw_thread, (void *)w)))
+        goto fail;
+
+    return w;
+
+fail:
+    fprintf(stderr, "mviw:  Could not start movie encoder thread.\n");
+    if (w)
+    {
+        if (w->room) SDL_DestroyCond(w->room);
+        if (w->wake) SDL_DestroyCond(w->wake);
+        if (w->lock) SDL_DestroyMutex(w->lock);
+        CONDFREE(w->vid);
+        free(w);
+    }
+    return NULL;
+}
+
+/* ======================================================================== */
+/*  MVIW_FRAME   -- Queue a frame for the movie.                            */
+/* ======================================================================== */
+void mviw_frame(mviw_t *w, const uint_8 *vid, uint_8 bbox[8][4])
+{
+    int slot;
+
+    SDL_LockMutex(w->lock);
+    while (w->head - w->tail >= MVIW_SLOTS)
+    {
+        w->stalls++;
+        SDL_CondWait(w->room, w->lock);
+    }
+    slot = w->head % MVIW_SLOTS;
+    SDL_UnlockMutex(w->lock);
+
+    memcpy(w->vid + slot * w->fr_size, vid, w->fr_size);
+    memcpy(w->bbox[slot], bbox, sizeof(w->bbox[slot]));
+
+    SDL_LockMutex(w->lock);
+    w->head++;
+    SDL_CondSignal(w->wake);
+    SDL_UnlockMutex(w->lock);
+}
+
+/* ======================================================================== */
+/*  MVIW_DESTROY -- Encode any queued frames, then stop the thread.         */
+/* ======================================================================== */
+void mviw_destroy(mviw_t *w)
+{
+    if (!w)
+        return;
+
+    SDL_LockMutex(w->lock);
+    w->quit = 1;
+    SDL_CondSignal(w->wake);
+    SDL_UnlockMutex(w->lock);
+
+    SDL_WaitThread(w->thread, NULL);
+
+    if (w->stalls)
+        fprintf(stderr, "mviw:  Encoder fell behind; emulation waited %d "
+                        "time%s.\n", w->stalls, w->stalls == 1 ? "" : "s");
+
+    SDL_DestroyCond(w->room);
+    SDL_DestroyCond(w->wake);
+    SDL_DestroyMutex(w->lock);
+    free(w->vid);
+    free(w);
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,61 @@
+/*
+ * ============================================================================
+ *  Title:    Background Movie Writer
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Moves .imv movie encoding off the emulation thread.  The emulator
+ *  copies each frame into one of a few preallocated slots and returns.
+ *  An encoder thread takes frames from the slots in order, encodes them
+ *  with MVI_WR_FRAME and writes them to the movie's file.
+ *
+ *  While the writer is running, the encoder thread owns the mvi_t:  the
+ *  emulator must not look at its file or its statistics until it has
+ *  called MVIW_DESTROY.  The emulator only waits if all the slots fill.
+ *
+ *  MVIW_CREATE  -- Start encoding a movie on a thread.
+ *  MVIW_FRAME   -- Queue a frame for the movie.
+ *  MVIW_DESTROY -- Encode any queued frames, then stop the thread.
+ * ============================================================================
+ */
+#ifndef MVIWRITE_H_
+#define MVIWRITE_H_
+
+typedef struct mviw_t mviw_t;
+
+/* ======================================================================== */
+/*  MVIW_CREATE  -- Start a thread encoding frames into 'movie', which      */
+/*                  must already be initialized and have an open file.      */
+/*                  Returns NULL on failure.                                */
+/* ======================================================================== */
+mviw_t *mviw_create(mvi_t *movie);
+
+/* ======================================================================== */
+/*  MVIW_FRAME   -- Queue a copy of a frame and its bounding boxes.         */
+/*                  Blocks only if every slot is full.                      */
+/* ======================================================================== */
+void mviw_frame(mviw_t *w, const uint_8 *vid, uint_8 bbox[8][4]);
+
+/* ======================================================================== */
+/*  MVIW_DESTROY -- Encode and write any frames still queued, then stop     */
+/*                  the thread.  The movie's file is left open.             */
+/* ======================================================================== */
+void mviw_destroy(mviw_t *w);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -7,6 +7,8 @@
  *  PERIPH_NEW       -- Creates a new peripheral bus
  *  PERIPH_DELETE    -- Disposes a peripheral bus
  *  PERIPH_REGISTER  -- Registers a peripheral on the bus
+ *  PERIPH_MAP       -- Maps a registered peripheral into more addresses
+ *  PERIPH_UNMAP     -- Unmaps it from some addresses
  *  PERIPH_READ      -- Perform a read on a peripheral bus
  *  PERIPH_WRITE     -- Perform a write on a peripheral bus
  *  PERIPH_TICK      -- Perform a tick on a peripheral bus
@@ -28,6 +30,7 @@
 #include "../config.h"
 #include "periph.h"
 #include "serializer/serializer.h"
+#include "serializer/snapshot.h"
 
 
 /*
@@ -116,6 +119,11 @@ periph_bus_p periph_new
     /* -------------------------------------------------------------------- */
     strncpy(bus->periph.name, "Bus", sizeof(bus->periph.name));
 
+    /* -------------------------------------------------------------------- */
+    /*  The bus' notion of 'now' is part of the machine state.              */
+    /* -------------------------------------------------------------------- */
+    SNAP_FIELDS(bus->periph.name, &bus->periph, periph_t, now, next_tick);
+
     return bus;
 }
 
@@ -158,6 +166,73 @@ void periph_delete
     free(bus);
 }
 
+/*
+ * ============================================================================
+ *  PERIPH_BIN_ADD   -- Adds a peripheral to one decode table (reads or
+ *                      writes) over an address range.
+ *  PERIPH_BIN_DEL   -- Removes it again, closing up the gap it leaves.
+ * ============================================================================
+ */
+LOCAL void periph_bin_add
+(
+    periph_bus_p    bus,
+    periph_p        **table,
+    periph_p        periph,
+    uint_32         addr_lo,
+    uint_32         addr_hi,
+    const char      *what
+)
+{
+    uint_32 bin, addr;
+    int i;
+
+    for (addr = addr_lo; addr <= addr_hi; addr += 1 << bus->decode_shift)
+    {
+        bin = (addr & bus->addr_mask) >> bus->decode_shift;
+
+        for (i = 0; i < MAX_PERIPH_BIN && table[i][bin]; i++)
+            if (table[i][bin] == periph)
+                break;
+
+        if (i == MAX_PERIPH_BIN)
+        {
+            fprintf(stderr, "FATAL:  >%d %s devices in address range "
+                            "%.8x..%.8x\n",
+                            MAX_PERIPH_BIN, what,
+                            bin << bus->decode_shift,
+                            ((bin + 1) << bus->decode_shift) - 1);
+            exit(1);
+        }
+
+        table[i][bin] = periph;
+    }
+}
+
+LOCAL void periph_bin_del
+(
+    periph_bus_p    bus,
+    periph_p        **table,
+    periph_p        periph,
+    uint_32         addr_lo,
+    uint_32         addr_hi
+)
+{
+    uint_32 bin, addr;
+    int i;
+
+    for (addr = addr_lo; addr <= addr_hi; addr += 1 << bus->decode_shift)
+    {
+        bin = (addr & bus->addr_mask) >> bus->decode_shift;
+
+        for (i = 0; i < MAX_PERIPH_BIN && table[i][bin]; i++)
+            if (table[i][bin] == periph)
+                break;
+
+        for (; i < MAX_PERIPH_BIN && table[i][bin]; i++)
+            table[i][bin] = i + 1 < MAX_PERIPH_BIN ? table[i + 1][bin] : NULL;
+    }
+}
+
 /*
  * ============================================================================
  *  PERIPH_REGISTER  -- Registers a peripheral on the bus
@@ -172,8 +247,6 @@ void periph_register
     const char      *name       /*  Name of peripheral.                 */
 )
 {
-    uint_32 bin, addr;
-    int i;
     static int unnamed = 0;
     char buf[32];
 
@@ -240,66 +313,66 @@ void periph_register
         periph->name[15] = 0;
 
         /* ---------------------------------------------------------------- */
-        /*  Now register this guy for serialization.                        */
+        /*  Now register this guy for serialization and snapshots.  Every   */
+        /*  device's timekeeping goes in the snapshot; ser_init adds the    */
+        /*  rest of its state.                                              */
         /* ---------------------------------------------------------------- */
-#ifndef NO_SERIALIZER
+        SNAP_FIELDS(periph->name, periph, periph_t, now, next_tick);
+
         if (periph->ser_init)
         {
             periph->ser_init(periph);
             periph->ser_init = NULL;  /* don't double-initialize */
         }
-#endif
     }
 
     /* -------------------------------------------------------------------- */
     /*  Poke the device into our address decode structures.                 */
     /* -------------------------------------------------------------------- */
-    if (periph->read)
-    for (addr = addr_lo; addr <= addr_hi; addr += 1 << bus->decode_shift)
-    {
-        bin = (addr & bus->addr_mask) >> bus->decode_shift;
-
-        for (i = 0; i < MAX_PERIPH_BIN && bus->rd[i][bin]; i++)
-            if (bus->rd[i][bin] == periph)
-                break;
+    periph_map(bus, periph, addr_lo, addr_hi, PERIPH_RD | PERIPH_WR);
 
-        if (i == MAX_PERIPH_BIN)
-        {   
-            fprintf(stderr, "FATAL:  >%d read devices in address range "
-                            "%.8x..%.8x\n",
-                            MAX_PERIPH_BIN,
-                            bin << bus->decode_shift, 
-                            ((bin + 1) << bus->decode_shift) - 1);
-            exit(1);
-        }
-        
-        bus->rd[i][bin] = periph;
-    }
+    jzp_printf("%-16s [0x%.4X...0x%.4X]\n", periph->name, 
+            addr_lo & bus->addr_mask, addr_hi & bus->addr_mask);
+}
 
-    if (periph->write)
-    for (addr = addr_lo; addr <= addr_hi; addr += 1 << bus->decode_shift)
-    {
-        bin = (addr & bus->addr_mask) >> bus->decode_shift;
+/*
+ * ============================================================================
+ *  PERIPH_MAP       -- Adds a registered peripheral's reads and/or writes
+ *                      to an address range, quietly.  Already mapped is OK.
+ *  PERIPH_UNMAP     -- Takes them back out.  Not mapped is OK.  Must not be
+ *                      called from inside a read or write on the same bus.
+ * ============================================================================
+ */
+void periph_map
+(
+    periph_bus_p    bus,        /*  Peripheral bus it's registered on.  */
+    periph_p        periph,     /*  Peripheral being mapped.            */
+    uint_32         addr_lo,    /*  Low end of address range.           */
+    uint_32         addr_hi,    /*  High end of address range.          */
+    int             flags       /*  PERIPH_RD and/or PERIPH_WR.         */
+)
+{
+    if ((flags & PERIPH_RD) && periph->read)
+        periph_bin_add(bus, bus->rd, periph, addr_lo, addr_hi, "read");
 
-        for (i = 0; i < MAX_PERIPH_BIN && bus->wr[i][bin]; i++)
-            if (bus->wr[i][bin] == periph)
-                break;
+    if ((flags & PERIPH_WR) && periph->write)
+        periph_bin_add(bus, bus->wr, periph, addr_lo, addr_hi, "write");
+}
 
-        if (i == MAX_PERIPH_BIN)
-        {   
-            fprintf(stderr, "FATAL:  >%d write devices in address range "
-                            "%.8x..%.8x\n",
-                            MAX_PERIPH_BIN,
-                            bin << bus->decode_shift, 
-                            ((bin + 1) << bus->decode_shift) - 1);
-            exit(1);
-        }
-        
-        bus->wr[i][bin] = periph;
-    }
+void periph_unmap
+(
+    periph_bus_p    bus,        /*  Peripheral bus it's registered on.  */
+    periph_p        periph,     /*  Peripheral being unmapped.          */
+    uint_32         addr_lo,    /*  Low end of address range.           */
+    uint_32         addr_hi,    /*  High end of address range.          */
+    int             flags       /*  PERIPH_RD and/or PERIPH_WR.         */
+)
+{
+    if (flags & PERIPH_RD)
+        periph_bin_del(bus, bus->rd, periph, addr_lo, addr_hi);
 
-    jzp_printf("%-16s [0x%.4X...0x%.4X]\n", periph->name, 
-            addr_lo & bus->addr_mask, addr_hi & bus->addr_mask);
+    if (flags & PERIPH_WR)
+        periph_bin_del(bus, bus->wr, periph, addr_lo, addr_hi);
 }
 
 
@@ -333,6 +406,13 @@ uint_32 periph_read
 
     bin = (addr & busp->addr_mask) >> busp->decode_shift;
 
+    /* -------------------------------------------------------------------- */
+    /*  Count the access if someone's keeping score.  For the CPU, this     */
+    /*  includes the fetches it makes when it decodes an instruction.       */
+    /* -------------------------------------------------------------------- */
+    if (busp->rd_cnt && req == busp->cnt_req)
+        busp->rd_cnt[addr & busp->addr_mask]++;
+
     /* -------------------------------------------------------------------- */
     /*  Perform the peripheral reads.  Peripherals which merely generate    */
     /*  side effects and don't actually drive the bus should return ~0U,    */
@@ -429,6 +509,9 @@ void periph_write
 
     bin = (addr & busp->addr_mask) >> busp->decode_shift;
 
+    if (busp->wr_cnt && req == busp->cnt_req)
+        busp->wr_cnt[addr & busp->addr_mask]++;
+
     /* -------------------------------------------------------------------- */
     /*  Perform the peripheral writes.  Make sure we AND the data being     */
     /*  written with the actual width of the bus.                           */
@@ -110,6 +110,10 @@ typedef struct periph_bus_t
 
     periph_p    list;           /*  Linked list of peripherals on this bus  */
     periph_p    tickable;       /*  Linked list of periph. w/ tick fxns.    */
+
+    uint_32     *rd_cnt;        /*  Per-address read counts, or NULL.       */
+    uint_32     *wr_cnt;        /*  Per-address write counts, or NULL.      */
+    periph_p    cnt_req;        /*  Only count accesses from this periph.   */
 } periph_bus_t, *periph_bus_p;
 
 
@@ -150,6 +154,35 @@ void periph_register
     const char      *name       /*  Name to give device.                */
 );
 
+/*
+ * ============================================================================
+ *  PERIPH_MAP       -- Adds a registered peripheral's reads and/or writes
+ *                      to an address range, quietly.
+ *  PERIPH_UNMAP     -- Takes them back out.  Must not be called from
+ *                      inside a read or write on the same bus.
+ * ============================================================================
+ */
+#define PERIPH_RD (1)
+#define PERIPH_WR (2)
+
+void periph_map
+(
+    periph_bus_p    bus,        /*  Peripheral bus it's registered on.  */
+    periph_p        periph,     /*  Peripheral being mapped.            */
+    uint_32         addr_lo,    /*  Low end of address range.           */
+    uint_32         addr_hi,    /*  High end of address range.          */
+    int             flags       /*  PERIPH_RD and/or PERIPH_WR.         */
+);
+
+void periph_unmap
+(
+    periph_bus_p    bus,        /*  Peripheral bus it's registered on.  */
+    periph_p        periph,     /*  Peripheral being unmapped.          */
+    uint_32         addr_lo,    /*  Low end of address range.           */
+    uint_32         addr_hi,    /*  High end of address range.          */
+    int             flags       /*  PERIPH_RD and/or PERIPH_WR.         */
+);
+
 /*
  * ============================================================================
  *  PERIPH_READ      -- Perform a read on a peripheral bus
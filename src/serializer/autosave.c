@@ -0,0 +1,359 @@
+/*
+ * ============================================================================
+ *  Title:    Autosave
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See autosave.h.
+ *
+ *  The capture snapshot belongs to the writer thread while 'busy' is set,
+ *  and to the emulator otherwise.  The emulator sets 'busy' after taking
+ *  a snapshot, and the thread clears it once the file is renamed into
+ *  place.  Neither holds the lock while copying, compressing or writing.
+ *
+ *  File layout, all header fields little endian:
+ *
+ *      8 bytes     "jzIntvAS"
+ *      4 bytes     AUTOSAVE_VERSION
+ *      4 bytes     Snapshot size in bytes
+ *      4 bytes     Snapshot directory checksum
+ *      4 bytes     Compressed size in bytes
+ *      N bytes     Snapshot arena, LZO compressed
+ * ============================================================================
+ */
+
+#include "sdl.h"
+#include "config.h"
+#include "plat/plat_lib.h"
+#include "minilzo/minilzo.h"
+#include "serializer/snapshot.h"
+#include "serializer/autosave.h"
+
+#ifdef _WIN32
+# define WIN32_LEAN_AND_MEAN
+# include <windows.h>
+# include <io.h>
+#endif
+
+#define AUTOSAVE_VERSION    (1)
+#define AUTOSAVE_HDR_LEN    (24)
+
+LOCAL const char autosave_magic[8] = { 'j','z','I','n','t','v','A','S' };
+
+struct autosave_t
+{
+    char        *fname;     /* The autosave file.                           */
+    char        *tname;     /* Where it's written before the rename.        */
+    double      interval;   /* Seconds between saves.                       */
+    double      next_due;   /* get_time() when the next save is due.        */
+    uint_32     config;     /* SNAP_CONFIG for this machine.                */
+
+    snap_t      snap;       /* The capture.  Thread's while 'busy'.         */
+    uint_8      *lzo_buf;   /* Header and compressed arena.  Thread only.   */
+    uint_8      *lzo_wrk;   /* LZO compressor's work memory.  Thread only.  */
+    int         failed;     /* Last write failed.  Thread only.             */
+
+    int         busy;       /* Thread is saving 'snap'.                     */
+    int         quit;       /* Request for thread to exit.                  */
+    double      capture_us; /* Cost of the last save:  the capture,         */
+    double      compress_ms;/* ...compressing it,                           */
+    double      write_ms;   /* ...and writing and renaming the file.        */
+
+    SDL_mutex   *lock;      /* Guards 'busy' through 'write_ms'.            */
+    SDL_cond    *wake;      /* Signals thread that there's a save to do.    */
+    SDL_Thread  *thread;
+};
+
+/* ======================================================================== */
+/*  AUTOSAVE_PUT32 / AUTOSAVE_GET32:  Header fields.                        */
+/* ======================================================================== */
+LOCAL void autosave_put32(uint_8 *p, uint_32 v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+LOCAL uint_32 autosave_get32(const uint_8 *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint_32)p[3] << 24);
+}
+
+/* ======================================================================== */
+/*  AUTOSAVE_WRITE   -- Compress the capture and write it out.  Runs on the */
+/*                      writer thread.                                      */
+/* ======================================================================== */
+LOCAL void autosave_write(autosave_t *as)
+{
+    double   start = get_time(), mid;
+    lzo_uint len = 0;
+    FILE     *f;
+    int      ok;
+
+    ok = lzo1x_1_compress(as->snap.arena, as->snap.size,
+                          as->lzo_buf + AUTOSAVE_HDR_LEN, &len,
+                          (lzo_voidp)as->lzo_wrk) == LZO_E_OK;
+
+    memcpy(as->lzo_buf, autosave_magic, 8);
+    autosave_put32(as->lzo_buf +  8, AUTOSAVE_VERSION);
+    autosave_put32(as->lzo_buf + 12, as->snap.size);
+    autosave_put32(as->lzo_buf + 16, as->config);
+    autosave_put32(as->lzo_buf + 20, len);
+
+    mid = get_time();
+
+    /* -------------------------------------------------------------------- */
+    /*  Write the temporary file, then rename it over the real one in one   */
+    /*  step.  If that fails, the last good save stays where it is.         */
+    /*  The data has to reach the disk before the rename does, or a crash   */
+    /*  could leave the new name on a file with nothing in it.              */
+    /*  Windows' rename() won't replace a file, so use MoveFileEx() there.  */
+    /* -------------------------------------------------------------------- */
+    if (ok && (f = fopen(as->tname, "wb")) != NULL)
+    {
+        ok = fwrite(as->lzo_buf, 1, AUTOSAVE_HDR_LEN + len, f)
+                == AUTOSAVE_HDR_LEN + len;
+        if (fflush(f) != 0)
+            ok = 0;
+#ifdef _WIN32
+        if (ok && _commit(_fileno(f)) != 0)
+            ok = 0;
+#else
+        if (ok && fsync(fileno(f)) != 0)
+            ok = 0;
+#endif
+        if (fclose(f) != 0)
+            ok = 0;
+    } else
+        ok = 0;
+
+    if (ok)
+    {
+#ifdef _WIN32
+        ok = MoveFileExA(as->tname, as->fname,
+                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+        ok = rename(as->tname, as->fname) == 0;
+#endif
+        if (!ok && !as->failed)
+            fprintf(stderr, "autosave:  Could not replace '%s'.  Keeping "
+                            "the last save.\n", as->fname);
+    } else if (!as->failed)
+        fprintf(stderr, "autosave:  Could not write '%s'\n", as->fname);
+    as->failed = !ok;
+
+    SDL_LockMutex(as->lock);
+    as->compress_ms = (mid - start) * 1000.0;
+    as->write_ms    = (get_time() - mid) * 1000.0;
+    SDL_UnlockMutex(as->lock);
+}
+
+/* ======================================================================== */
+/*  AUTOSAVE_THREAD  -- Write each capture handed to us until told to quit. */
+/* ======================================================================== */
+LOCAL int autosave_thread(void *opaque)
+{
+    autosave_t *as = (autosave_t *)opaque;
+
+    SDL_LockMutex(as->lock);
+    for (;;)
+    {
+        while (!as->quit && !as->busy)
+            SDL_CondWait(as->wake, as->lock);
+
+        if (!as->busy)
+            break;
+
+        SDL_UnlockMutex(as->lock);
+        autosave_write(as);
+        SDL_LockMutex(as->lock);
+
+        as->busy = 0;
+    }
+    SDL_UnlockMutex(as->lock);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  AUTOSAVE_CREATE  -- Start autosaving to a file.                         */
+/* ======================================================================== */
+autosave_t *autosave_create(const char *fname, int seconds)
+{
+    autosave_t *as = CALLOC(autosave_t, 1);
+    uint_32 size = snap_size();
+
+    if (!as)
+        goto fail;
+
+    as->fname    = strdup(fname);
+    as->tname    = CALLOC(char, strlen(fname) + 5);
+    as->interval = seconds > 0 ? seconds : 1;
+    as->next_due = get_time() + as->interval;
+    as->config   = snap_config();
+
+    /* Worst case LZO1X output, per the LZO documentation.                  */
+    as->lzo_buf = CALLOC(uint_8, AUTOSAVE_HDR_LEN + size + size / 16 + 67);
+    as->lzo_wrk = CALLOC(uint_8, LZO1X_1_MEM_COMPRESS);
+    as->lock    = SDL_CreateMutex();
+    as->wake    = SDL_CreateCond();
+
+    if (!as->fname || !as->tname || !as->lzo_buf || !as->lzo_wrk ||
+        !as->lock || !as->wake || snap_init(&as->snap))
+        goto fail;
+
+    sprintf(as->tname, "%s.tmp", fname);
+
+    if (!(as->thread = SDL_CreateThread(autosave_thread, (void *)as)))
+        goto fail;
+
+    return as;
+
+fail:
+    fprintf(stderr, "autosave:  Could not start autosave writer.\n");
+    if (as)
+    {
+        if (as->wake) SDL_DestroyCond(as->wake);
+        if (as->lock) SDL_DestroyMutex(as->lock);
+        snap_dtor(&as->snap);
+        CONDFREE(as->lzo_wrk);
+        CONDFREE(as->lzo_buf);
+        CONDFREE(as->tname);
+        CONDFREE(as->fname);
+        free(as);
+    }
+    return NULL;
+}
+
+/* ======================================================================== */
+/*  AUTOSAVE_SERVICE -- Capture a save if one is due.                       */
+/* ======================================================================== */
+void autosave_service(autosave_t *as)
+{
+    double start = get_time();
+    int busy;
+
+    if (start < as->next_due)
+        return;
+
+    SDL_LockMutex(as->lock);
+    busy = as->busy;
+    SDL_UnlockMutex(as->lock);
+
+    if (busy || snap_take(&as->snap))
+        return;
+
+    as->next_due = start + as->interval;
+
+    SDL_LockMutex(as->lock);
+    as->capture_us = (get_time() - start) * 1e6;
+    as->busy       = 1;
+    SDL_CondSignal(as->wake);
+    SDL_UnlockMutex(as->lock);
+}
+
+/* ======================================================================== */
+/*  AUTOSAVE_LOAD    -- Read the autosave file into a snapshot.             */
+/* ======================================================================== */
+int autosave_load(autosave_t *as, snap_t *snap)
+{
+    uint_8   hdr[AUTOSAVE_HDR_LEN], *buf = NULL;
+    uint_32  len;
+    lzo_uint out_len = snap->size;
+    FILE     *f;
+
+    if (!(f = fopen(as->fname, "rb")))
+        return -1;
+
+    if (fread(hdr, 1, AUTOSAVE_HDR_LEN, f) != AUTOSAVE_HDR_LEN ||
+        memcmp(hdr, autosave_magic, 8) != 0 ||
+        autosave_get32(hdr + 8) != AUTOSAVE_VERSION)
+    {
+        fprintf(stderr, "autosave:  '%s' is not a jzIntv autosave\n",
+                as->fname);
+        goto fail;
+    }
+
+    if (autosave_get32(hdr + 12) != snap->size ||
+        autosave_get32(hdr + 16) != as->config)
+    {
+        fprintf(stderr, "autosave:  '%s' was saved from a different "
+                        "machine configuration\n", as->fname);
+        goto fail;
+    }
+
+    len = autosave_get32(hdr + 20);
+    if (!(buf = CALLOC(uint_8, len + 1)) || fread(buf, 1, len, f) != len ||
+        lzo1x_decompress_safe(buf, len, snap->arena, &out_len, NULL)
+            != LZO_E_OK || out_len != snap->size)
+    {
+        fprintf(stderr, "autosave:  '%s' is damaged\n", as->fname);
+        goto fail;
+    }
+
+    snap->gen = 0;
+    free(buf);
+    fclose(f);
+    return 0;
+
+fail:
+    CONDFREE(buf);
+    fclose(f);
+    return -1;
+}
+
+/* ======================================================================== */
+/*  AUTOSAVE_TIMES   -- Cost of the most recent save.                       */
+/* ======================================================================== */
+void autosave_times(autosave_t *as, double *capture_us, double *compress_ms,
+                    double *write_ms)
+{
+    SDL_LockMutex(as->lock);
+    *capture_us  = as->capture_us;
+    *compress_ms = as->compress_ms;
+    *write_ms    = as->write_ms;
+    SDL_UnlockMutex(as->lock);
+}
+
+/* ======================================================================== */
+/*  AUTOSAVE_DESTROY -- Finish any save in progress and stop.               */
+/* ======================================================================== */
+void autosave_destroy(autosave_t *as)
+{
+    if (!as)
+        return;
+
+    SDL_LockMutex(as->lock);
+    as->quit = 1;
+    SDL_CondSignal(as->wake);
+    SDL_UnlockMutex(as->lock);
+
+    SDL_WaitThread(as->thread, NULL);
+
+    SDL_DestroyCond(as->wake);
+    SDL_DestroyMutex(as->lock);
+    snap_dtor(&as->snap);
+    free(as->lzo_wrk);
+    free(as->lzo_buf);
+    free(as->tname);
+    free(as->fname);
+    free(as);
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,83 @@
+/*
+ * ============================================================================
+ *  Title:    Autosave
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Saves the machine to a file every so many seconds, so that a machine
+ *  that crashes or loses power can pick up close to where it left off.
+ *
+ *  Only the capture runs on the emulation thread:  a snapshot into a
+ *  spare arena, which copies just the pages written since the last one
+ *  unless something else took a snapshot in between.  A writer thread
+ *  then compresses the arena with LZO, writes it to "<file>.tmp" and
+ *  renames that over the autosave file.  The file on disk is therefore
+ *  always one complete save.  The emulator never waits on the writer:
+ *  if a save is still being written when the next one is due, it tries
+ *  again on the next frame.
+ *
+ *  AUTOSAVE_CREATE  -- Start autosaving to a file.
+ *  AUTOSAVE_SERVICE -- Capture a save if one is due.
+ *  AUTOSAVE_LOAD    -- Read the autosave file into a snapshot.
+ *  AUTOSAVE_TIMES   -- Cost of the most recent save.
+ *  AUTOSAVE_DESTROY -- Finish any save in progress and stop.
+ * ============================================================================
+ */
+#ifndef AUTOSAVE_H_
+#define AUTOSAVE_H_
+
+typedef struct autosave_t autosave_t;
+struct snap_t;
+
+/* ======================================================================== */
+/*  AUTOSAVE_CREATE  -- Save to 'fname' every 'seconds'.  All state must    */
+/*                      be registered with the snapshot engine first.       */
+/*                      Returns NULL on failure.                            */
+/* ======================================================================== */
+autosave_t *autosave_create(const char *fname, int seconds);
+
+/* ======================================================================== */
+/*  AUTOSAVE_SERVICE -- Called from the main loop between ticks.  If a      */
+/*                      save is due and the writer is free, capture the     */
+/*                      machine and hand it to the writer.                  */
+/* ======================================================================== */
+void autosave_service(autosave_t *as);
+
+/* ======================================================================== */
+/*  AUTOSAVE_LOAD    -- Read the autosave file into 'snap', which must      */
+/*                      already be initialized.  Returns -1 if there is no  */
+/*                      file, or it doesn't match this machine.             */
+/* ======================================================================== */
+int autosave_load(autosave_t *as, struct snap_t *snap);
+
+/* ======================================================================== */
+/*  AUTOSAVE_TIMES   -- Cost of the most recent save:  the capture on the   */
+/*                      emulation thread, and the writer's compression and  */
+/*                      file writing.                                       */
+/* ======================================================================== */
+void autosave_times(autosave_t *as, double *capture_us, double *compress_ms,
+                    double *write_ms);
+
+/* ======================================================================== */
+/*  AUTOSAVE_DESTROY -- Finish writing any save in progress, then stop the  */
+/*                      writer and free everything.                         */
+/* ======================================================================== */
+void autosave_destroy(autosave_t *as);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
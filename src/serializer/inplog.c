@@ -0,0 +1,268 @@
+/*
+ * ============================================================================
+ *  Title:    Input Log
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See inplog.h.
+ *
+ *  Each record holds one word's change, with its value before and after,
+ *  so records can be undone from the newest end when time goes backwards.
+ *  'base' holds the words as they were before the oldest record, so the
+ *  values at any time the log reaches are 'base' plus the records stamped
+ *  before it.
+ *
+ *  Records are stamped with the log periph's own time, as the movie's
+ *  input records are.  Frames are pushed between ticks, so after one is
+ *  restored, the log's time is that of its next tick, and the records
+ *  stamped before it are the ones already in effect.
+ * ============================================================================
+ */
+
+#include "config.h"
+#include "periph/periph.h"
+#include "pads/pads.h"
+#include "event/event.h"
+#include "serializer/inpmov.h"
+#include "serializer/inplog.h"
+
+/* 'i' counts from the oldest record, 0, to the newest, count - 1. */
+#define INPLOG_REC(log, i) (&(log)->rec[((log)->first + (i)) % INPLOG_SIZE])
+
+LOCAL uint_32 inplog_tick(periph_p p, uint_32 len);
+LOCAL void    inplog_dtor(periph_p p);
+
+/* ======================================================================== */
+/*  INPLOG_PUT       -- Add a record, dropping the oldest if it's full.     */
+/* ======================================================================== */
+LOCAL void inplog_put(inplog_t *log, uint_64 now, int idx, uint_32 value)
+{
+    inplog_rec_t *r;
+
+    if (log->count == INPLOG_SIZE)
+    {
+        r = INPLOG_REC(log, 0);
+        log->base[r->idx] = r->value;
+        log->lost         = 1;
+        log->lost_time    = r->when;
+        log->first        = (log->first + 1) % INPLOG_SIZE;
+        log->count--;
+    }
+
+    r = INPLOG_REC(log, log->count++);
+    r->when  = now;
+    r->was   = log->value[idx];
+    r->value = value;
+    r->idx   = idx;
+
+    log->value[idx] = value;
+}
+
+/* ======================================================================== */
+/*  INPLOG_RECORD    -- Record this tick's changes.                         */
+/* ======================================================================== */
+LOCAL void inplog_record(inplog_t *log)
+{
+    uint_64 now = log->periph.now;
+    int i;
+
+    /* -------------------------------------------------------------------- */
+    /*  Time went backwards.  Forget the future we came back from.          */
+    /* -------------------------------------------------------------------- */
+    while (log->count > 0 && INPLOG_REC(log, log->count - 1)->when >= now)
+    {
+        const inplog_rec_t *r = INPLOG_REC(log, --log->count);
+        log->value[r->idx] = r->was;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  If that went back past the oldest record, 'base' is no good.  The   */
+    /*  log starts over from here.                                          */
+    /* -------------------------------------------------------------------- */
+    if (log->count == 0 && log->lost && log->lost_time >= now)
+    {
+        log->lost_time = now;
+        for (i = 0; i < INPMOV_WORDS; i++)
+            log->base[i] = log->value[i] = *log->word[i];
+    }
+
+    for (i = 0; i < INPMOV_WORDS; i++)
+        if (*log->word[i] != log->value[i])
+            inplog_put(log, now, i, *log->word[i]);
+}
+
+/* ======================================================================== */
+/*  INPLOG_PLAY      -- Apply this tick's records.                          */
+/* ======================================================================== */
+LOCAL void inplog_play(inplog_t *log)
+{
+    uint_64 now = log->periph.now;
+    int     i, changed = 0;
+
+    /* -------------------------------------------------------------------- */
+    /*  Events only set and clear bits, so whatever differs from what we    */
+    /*  wrote last tick is the host's doing.  Keep 'live' up to date.       */
+    /* -------------------------------------------------------------------- */
+    for (i = 0; i < INPMOV_WORDS; i++)
+    {
+        uint_32 w = *log->word[i], v = log->value[i];
+
+        log->live[i] = (log->live[i] | (w & ~v)) & ~(v & ~w);
+    }
+
+    while (log->next < log->count && INPLOG_REC(log, log->next)->when <= now)
+    {
+        const inplog_rec_t *r = INPLOG_REC(log, log->next++);
+        log->value[r->idx] = r->value;
+    }
+
+    for (i = 0; i < INPMOV_WORDS; i++)
+        if (*log->word[i] != log->value[i])
+        {
+            *log->word[i] = log->value[i];
+            changed = 1;
+        }
+
+    if (changed)
+        event_count++;
+}
+
+/* ======================================================================== */
+/*  INPLOG_TICK      -- Runs right after the event subsystem.               */
+/* ======================================================================== */
+LOCAL uint_32 inplog_tick(periph_p p, uint_32 len)
+{
+    inplog_t *log = (inplog_t *)p;
+
+    if (log->mode == INPLOG_RECORD)
+        inplog_record(log);
+    else if (log->mode == INPLOG_REPLAY)
+        inplog_play(log);
+
+    return len;
+}
+
+/* ======================================================================== */
+/*  INPLOG_INIT      -- Set up the log.                                     */
+/* ======================================================================== */
+int inplog_init(inplog_t *log, struct pad_t *pad0, struct pad_t *pad1)
+{
+    int i;
+
+    memset(log, 0, sizeof(inplog_t));
+
+    if (!(log->rec = CALLOC(inplog_rec_t, INPLOG_SIZE)))
+    {
+        fprintf(stderr, "inplog:  Out of memory\n");
+        return -1;
+    }
+
+    log->periph.read      = NULL;
+    log->periph.write     = NULL;
+    log->periph.peek      = NULL;
+    log->periph.poke      = NULL;
+    log->periph.tick      = inplog_tick;
+    log->periph.min_tick  = 3579545 / 480;    /* Same as the event periph */
+    log->periph.max_tick  = 3579545 / 480;
+    log->periph.addr_base = ~0U;
+    log->periph.addr_mask = 0;
+    log->periph.dtor      = inplog_dtor;
+
+    log->mode = INPLOG_RECORD;
+
+    inpmov_bind(log->word, pad0, pad1);
+    for (i = 0; i < INPMOV_WORDS; i++)
+        log->base[i] = log->value[i] = *log->word[i];
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  INPLOG_REACHES   -- Can a replay start at a given cycle?  The frame's   */
+/*                      cycle can be up to a tick past the log's time.      */
+/* ======================================================================== */
+int inplog_reaches(const inplog_t *log, uint_64 when)
+{
+    return log->mode != INPLOG_OFF &&
+           (!log->lost || log->lost_time + log->periph.max_tick < when);
+}
+
+/* ======================================================================== */
+/*  INPLOG_REPLAY    -- Start replaying from the current time.              */
+/* ======================================================================== */
+int inplog_replay(inplog_t *log)
+{
+    uint_64 now = log->periph.now;
+    int i;
+
+    if (log->mode == INPLOG_OFF || (log->lost && log->lost_time >= now))
+        return -1;
+
+    /* Going back again mid-replay keeps the host's inputs from before. */
+    if (log->mode == INPLOG_RECORD)
+        for (i = 0; i < INPMOV_WORDS; i++)
+            log->live[i] = *log->word[i];
+
+    memcpy(log->value, log->base, sizeof(log->value));
+    for (log->next = 0; log->next < log->count; log->next++)
+    {
+        const inplog_rec_t *r = INPLOG_REC(log, log->next);
+
+        if (r->when >= now)
+            break;
+        log->value[r->idx] = r->value;
+    }
+
+    for (i = 0; i < INPMOV_WORDS; i++)
+        *log->word[i] = log->value[i];
+
+    log->mode = INPLOG_REPLAY;
+    event_count++;
+    return 0;
+}
+
+/* ======================================================================== */
+/*  INPLOG_LIVE      -- Stop replaying, and go back to the host's input.    */
+/*                      The next tick drops the records we didn't reach.    */
+/* ======================================================================== */
+void inplog_live(inplog_t *log)
+{
+    int i;
+
+    if (log->mode != INPLOG_REPLAY)
+        return;
+
+    for (i = 0; i < INPMOV_WORDS; i++)
+        *log->word[i] = log->live[i];
+
+    log->mode = INPLOG_RECORD;
+    event_count++;
+}
+
+/* ======================================================================== */
+/*  INPLOG_DTOR      -- Free the log.                                       */
+/* ======================================================================== */
+LOCAL void inplog_dtor(periph_p p)
+{
+    inplog_t *log = (inplog_t *)p;
+
+    CONDFREE(log->rec);
+    log->mode = INPLOG_OFF;
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
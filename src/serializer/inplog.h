@@ -0,0 +1,116 @@
+/*
+ * ============================================================================
+ *  Title:    Input Log
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Keeps the controller input that goes with the rewind buffer's history,
+ *  so the debugger's replays see what the machine saw the first time.
+ *
+ *  The controller and ECS keyboard inputs aren't machine state, so the
+ *  rewind buffer doesn't keep them.  Restoring a frame and running on
+ *  would read whatever the host has now.  Instead, this logs the same
+ *  event words an input movie records, each time the event subsystem
+ *  runs, stored only when they change and stamped with the emulated
+ *  time.  While the debugger replays, the log writes the words back at
+ *  the same times, and keeps track of what the host did meanwhile so it
+ *  can hand the controllers back afterwards.
+ *
+ *  The log is a fixed-size ring.  When it fills up, the oldest records
+ *  are dropped, and replays can't start before them.  When time goes
+ *  backwards, as after a rewind, records newer than the new time are
+ *  dropped too, since that future never happened.
+ *
+ *  Like an input movie, the log is a periph registered right after the
+ *  event subsystem with the same tick rate.
+ *
+ *  INPLOG_INIT      -- Set up the log.
+ *  INPLOG_REACHES   -- Can a replay start at a given cycle?
+ *  INPLOG_REPLAY    -- Start replaying from the current time.
+ *  INPLOG_LIVE      -- Stop replaying, and go back to the host's input.
+ * ============================================================================
+ */
+
+#ifndef INPLOG_H_
+#define INPLOG_H_ 1
+
+#define INPLOG_SIZE     (32768) /* Records the log can hold.                */
+
+enum
+{
+    INPLOG_OFF = 0,             /* No log.                                  */
+    INPLOG_RECORD,              /* Logging the host's inputs.               */
+    INPLOG_REPLAY               /* Writing logged inputs back.              */
+};
+
+typedef struct inplog_rec_t
+{
+    uint_64     when;           /* Time stamp of the change.                */
+    uint_32     was;            /* The word's value before it,              */
+    uint_32     value;          /* ...and after.                            */
+    int         idx;            /* Which word, in movie order.              */
+} inplog_rec_t;
+
+typedef struct inplog_t
+{
+    periph_t    periph;         /* It's a peripheral, ticked after events.  */
+    int         mode;           /* INPLOG_OFF, _RECORD or _REPLAY.          */
+
+    uint_32     *word[INPMOV_WORDS];    /* Event words, in movie order.     */
+    uint_32     value[INPMOV_WORDS];    /* Values as of the last tick.      */
+    uint_32     live[INPMOV_WORDS];     /* Replay:  the host's own values.  */
+    uint_32     base[INPMOV_WORDS];     /* Values before the oldest record. */
+
+    inplog_rec_t *rec;          /* Circular record buffer.                  */
+    int         first;          /* Index of the oldest record.              */
+    int         count;          /* Number of records held.                  */
+    int         next;           /* Replay:  next record, counting from 0.   */
+
+    int         lost;           /* Records have been dropped off the end,   */
+    uint_64     lost_time;      /* ...the newest of them stamped this.      */
+} inplog_t;
+
+/* ======================================================================== */
+/*  INPLOG_INIT      -- Set up 'log' to record the event words of 'pad0'    */
+/*                      and 'pad1'.  Returns -1 on failure.                 */
+/* ======================================================================== */
+int inplog_init(inplog_t *log, struct pad_t *pad0, struct pad_t *pad1);
+
+/* ======================================================================== */
+/*  INPLOG_REACHES   -- Nonzero if the log goes back far enough to replay   */
+/*                      from a rewind frame taken at cycle 'when'.          */
+/* ======================================================================== */
+int inplog_reaches(const inplog_t *log, uint_64 when);
+
+/* ======================================================================== */
+/*  INPLOG_REPLAY    -- Machine state was just restored.  Set the event     */
+/*                      words to what they were at this time, and replay    */
+/*                      the log from here.  Returns -1 if the log doesn't   */
+/*                      reach back that far.                                */
+/* ======================================================================== */
+int inplog_replay(inplog_t *log);
+
+/* ======================================================================== */
+/*  INPLOG_LIVE      -- Stop replaying.  The event words go back to the     */
+/*                      host's inputs, and the log records from here on.    */
+/* ======================================================================== */
+void inplog_live(inplog_t *log);
+
+#endif
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,514 @@
+/*
+ * ============================================================================
+ *  Title:    Input Movies
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See inpmov.h.
+ *
+ *  Records are stamped with emulated time in CPU cycles, stored as the
+ *  difference from the record before.  Input and checkpoint records use
+ *  the movie periph's own time, while resets happen between ticks and
+ *  use the bus's.  The bus can be a little ahead of the periph, so the
+ *  difference can be negative, and is stored zig-zag encoded.
+ *
+ *  Playback reads one record ahead.  Each tick applies every input and
+ *  checkpoint record stamped with the tick's time.  The main loop polls
+ *  for resets between ticks.  Anything left behind means the machine ran
+ *  differently from the recording.
+ *
+ *  File layout, all fixed-size fields little endian:
+ *
+ *      8 bytes     "jzIntvIM"
+ *      4 bytes     INPMOV_VERSION
+ *      4 bytes     CRC-32 of the game image
+ *      4 bytes     Snapshot directory checksum
+ *      4 bytes     Random number seed
+ *      4 bytes     Frames between checkpoints
+ *
+ *  followed by records, each a type byte and a time difference:
+ *
+ *      INPMOV_INPUT    count, then 'count' pairs of word index and value
+ *      INPMOV_CHECK    4 byte CRC-32 of the machine state
+ *      INPMOV_RESET    nothing more
+ *      INPMOV_END      nothing more; last record in the file
+ *
+ *  Times, counts and values are variable-length, 7 bits per byte, least
+ *  significant first, with bit 7 set on all but the last byte.
+ * ============================================================================
+ */
+
+#include "config.h"
+#include "periph/periph.h"
+#include "pads/pads.h"
+#include "event/event.h"
+#include "serializer/snapshot.h"
+#include "serializer/inpmov.h"
+
+#define INPMOV_HDR_LEN  (28)
+#define INPMOV_SPF      (2)     /* Input samples per frame:  events at 120Hz */
+
+enum
+{
+    INPMOV_END = 0,
+    INPMOV_INPUT,
+    INPMOV_CHECK,
+    INPMOV_RESET
+};
+
+LOCAL const char inpmov_magic[8] = { 'j','z','I','n','t','v','I','M' };
+
+LOCAL uint_32 inpmov_tick(periph_p p, uint_32 len);
+LOCAL void    inpmov_dtor(periph_p p);
+
+/* ======================================================================== */
+/*  INPMOV_PUT32 / INPMOV_GET32  -- Little-endian header fields.            */
+/* ======================================================================== */
+LOCAL void inpmov_put32(uint_8 *p, uint_32 v)
+{
+    p[0] = v;   p[1] = v >> 8;  p[2] = v >> 16;  p[3] = v >> 24;
+}
+
+LOCAL uint_32 inpmov_get32(const uint_8 *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint_32)p[3] << 24);
+}
+
+/* ======================================================================== */
+/*  INPMOV_PUT_VAR   -- Write a variable-length number.                     */
+/*  INPMOV_GET_VAR   -- Read one.  Returns -1 at end of file.               */
+/* ======================================================================== */
+LOCAL void inpmov_put_var(FILE *f, uint_64 v)
+{
+    while (v > 0x7F)
+    {
+        putc((int)(0x80 | (v & 0x7F)), f);
+        v >>= 7;
+    }
+    putc((int)v, f);
+}
+
+LOCAL int inpmov_get_var(FILE *f, uint_64 *v)
+{
+    int c, shift = 0;
+
+    *v = 0;
+    do
+    {
+        if ((c = getc(f)) == EOF || shift > 63)
+            return -1;
+
+        *v |= (uint_64)(c & 0x7F) << shift;
+        shift += 7;
+    } while (c & 0x80);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  INPMOV_PUT_REC   -- Start a record of type 'type' at time 'now'.        */
+/* ======================================================================== */
+LOCAL void inpmov_put_rec(inpmov_t *mov, int type, uint_64 now)
+{
+    sint_64 diff = (sint_64)(now - mov->last_time);
+
+    putc(type, mov->f);
+    inpmov_put_var(mov->f, ((uint_64)diff << 1) ^ (uint_64)(diff >> 63));
+    mov->last_time = now;
+}
+
+/* ======================================================================== */
+/*  INPMOV_STOP      -- Stop recording or playing after an error.           */
+/* ======================================================================== */
+LOCAL void inpmov_stop(inpmov_t *mov, const char *why)
+{
+    fprintf(stderr, "inpmov:  %s; input movie stopped\n", why);
+
+    if (mov->mode == INPMOV_PLAY)
+    {
+        mov->failed = 1;
+        *mov->do_exit = 1;
+    }
+
+    mov->mode = INPMOV_OFF;
+}
+
+/* ======================================================================== */
+/*  INPMOV_NEXT      -- Playback:  read the next record's type and time.    */
+/*                      A file that just stops counts as ending there.      */
+/* ======================================================================== */
+LOCAL void inpmov_next(inpmov_t *mov)
+{
+    uint_8  crc[4];
+    uint_64 zz;
+    int     type = getc(mov->f);
+
+    if (type == EOF || inpmov_get_var(mov->f, &zz))
+    {
+        fprintf(stderr, "inpmov:  Movie is truncated\n");
+        mov->next_type = INPMOV_END;
+        mov->next_time = mov->last_time;
+        return;
+    }
+
+    mov->next_type  = type;
+    mov->next_time  = mov->last_time + ((zz >> 1) ^ (0 - (zz & 1)));
+    mov->last_time  = mov->next_time;
+
+    if (type == INPMOV_CHECK)
+    {
+        if (fread(crc, 1, 4, mov->f) != 4)
+        {
+            fprintf(stderr, "inpmov:  Movie is truncated\n");
+            mov->next_type = INPMOV_END;
+            return;
+        }
+        mov->next_crc = inpmov_get32(crc);
+    }
+}
+
+/* ======================================================================== */
+/*  INPMOV_GET_INPUT -- Playback:  read an input record's words.            */
+/* ======================================================================== */
+LOCAL int inpmov_get_input(inpmov_t *mov)
+{
+    uint_64 count, idx, value;
+
+    if (inpmov_get_var(mov->f, &count))
+        return -1;
+
+    while (count-- > 0)
+    {
+        if (inpmov_get_var(mov->f, &idx)   || idx >= INPMOV_WORDS ||
+            inpmov_get_var(mov->f, &value))
+            return -1;
+
+        mov->value[idx] = (uint_32)value;
+    }
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  INPMOV_RECORD    -- Record this tick's inputs, and maybe a checkpoint.  */
+/* ======================================================================== */
+LOCAL void inpmov_record(inpmov_t *mov)
+{
+    uint_64 now = mov->periph.now;
+    uint_8  idx[INPMOV_WORDS];
+    int     i, n = 0;
+
+    for (i = 0; i < INPMOV_WORDS; i++)
+        if (*mov->word[i] != mov->value[i])
+            idx[n++] = i;
+
+    if (n)
+    {
+        inpmov_put_rec(mov, INPMOV_INPUT, now);
+        inpmov_put_var(mov->f, n);
+        for (i = 0; i < n; i++)
+        {
+            mov->value[idx[i]] = *mov->word[idx[i]];
+            inpmov_put_var(mov->f, idx[i]);
+            inpmov_put_var(mov->f, mov->value[idx[i]]);
+        }
+    }
+
+    if (++mov->samples >= mov->check_frames * INPMOV_SPF)
+    {
+        uint_8 crc[4];
+
+        inpmov_put32(crc, snap_hash());
+        inpmov_put_rec(mov, INPMOV_CHECK, now);
+        fwrite(crc, 1, 4, mov->f);
+        mov->samples = 0;
+        mov->checks++;
+    }
+
+    if (ferror(mov->f))
+        inpmov_stop(mov, "Error writing movie");
+}
+
+/* ======================================================================== */
+/*  INPMOV_PLAY      -- Apply this tick's inputs and check its checkpoint.  */
+/* ======================================================================== */
+LOCAL void inpmov_play(inpmov_t *mov)
+{
+    uint_64 now = mov->periph.now;
+    int     i, changed = 0;
+
+    if (mov->next_type == INPMOV_END && now >= mov->next_time)
+    {
+        jzp_printf("\ninpmov:  Playback finished; %u checkpoints matched.\n",
+                   mov->checks);
+        *mov->do_exit = 1;
+        mov->mode = INPMOV_OFF;
+        return;
+    }
+
+    while (mov->next_time == now && (mov->next_type == INPMOV_INPUT ||
+                                     mov->next_type == INPMOV_CHECK))
+    {
+        if (mov->next_type == INPMOV_INPUT)
+        {
+            if (inpmov_get_input(mov))
+            {
+                inpmov_stop(mov, "Movie is corrupt");
+                return;
+            }
+        } else
+        {
+            uint_32 hash = snap_hash();
+
+            if (hash != mov->next_crc)
+            {
+                fprintf(stderr, "inpmov:  Desync at checkpoint %u, cycle "
+                        "%llu:  expected %.8X, got %.8X\n", mov->checks + 1,
+                        (unsigned long long)now, mov->next_crc, hash);
+                inpmov_stop(mov, "Machine state doesn't match");
+                return;
+            }
+            mov->checks++;
+        }
+        inpmov_next(mov);
+    }
+
+    if (mov->next_type != INPMOV_RESET && mov->next_type != INPMOV_END &&
+        mov->next_time < now)
+    {
+        inpmov_stop(mov, "Machine fell out of step with the movie");
+        return;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Write every word, not just the ones that changed, so that keys      */
+    /*  pressed on the host during playback never reach the controllers.    */
+    /* -------------------------------------------------------------------- */
+    for (i = 0; i < INPMOV_WORDS; i++)
+        if (*mov->word[i] != mov->value[i])
+        {
+            *mov->word[i] = mov->value[i];
+            changed = 1;
+        }
+
+    if (changed)
+        event_count++;
+}
+
+/* ======================================================================== */
+/*  INPMOV_TICK      -- Runs right after the event subsystem.               */
+/* ======================================================================== */
+LOCAL uint_32 inpmov_tick(periph_p p, uint_32 len)
+{
+    inpmov_t *mov = (inpmov_t *)p;
+
+    if (mov->mode == INPMOV_RECORD)
+        inpmov_record(mov);
+    else if (mov->mode == INPMOV_PLAY)
+        inpmov_play(mov);
+
+    return len;
+}
+
+/* ======================================================================== */
+/*  INPMOV_INIT      -- Open a movie for recording or playback.             */
+/* ======================================================================== */
+int inpmov_init
+(
+    inpmov_t        *mov,
+    const char      *fname,
+    int             mode,
+    uint_32         check_frames,
+    struct pad_t    *pad0,
+    struct pad_t    *pad1,
+    v_uint_32       *do_exit
+)
+{
+    memset(mov, 0, sizeof(inpmov_t));
+
+    if (!(mov->f = fopen(fname, mode == INPMOV_RECORD ? "wb" : "rb")))
+    {
+        perror("fopen()");
+        fprintf(stderr, "inpmov:  Could not open '%s' for %s\n", fname,
+                mode == INPMOV_RECORD ? "writing" : "reading");
+        return -1;
+    }
+
+    mov->periph.read      = NULL;
+    mov->periph.write     = NULL;
+    mov->periph.peek      = NULL;
+    mov->periph.poke      = NULL;
+    mov->periph.tick      = inpmov_tick;
+    mov->periph.min_tick  = 3579545 / 480;    /* Same as the event periph */
+    mov->periph.max_tick  = 3579545 / 480;
+    mov->periph.addr_base = ~0U;
+    mov->periph.addr_mask = 0;
+    mov->periph.dtor      = inpmov_dtor;
+
+    mov->mode         = mode;
+    mov->check_frames = check_frames > 0 ? check_frames : 1;
+    mov->do_exit      = do_exit;
+
+    inpmov_bind(mov->word, pad0, pad1);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  INPMOV_BIND      -- The event words a movie records, in movie order.    */
+/* ======================================================================== */
+void inpmov_bind(uint_32 *word[INPMOV_WORDS], struct pad_t *pad0,
+                  struct pad_t *pad1)
+{
+    pad_t *pad[2];
+    int i, j, w = 0;
+
+    pad[0] = pad0;
+    pad[1] = pad1;
+    for (i = 0; i < 2; i++)
+    {
+        for (j = 0; j < 17; j++) word[w++] = &pad[i]->l[j];
+        for (j = 0; j < 17; j++) word[w++] = &pad[i]->r[j];
+        for (j = 0; j <  8; j++) word[w++] = &pad[i]->k[j];
+    }
+}
+
+/* ======================================================================== */
+/*  INPMOV_START     -- Write or check the header.                          */
+/* ======================================================================== */
+int inpmov_start(inpmov_t *mov, uint_32 rom_crc, uint_32 *seed)
+{
+    uint_8 hdr[INPMOV_HDR_LEN];
+
+    if (mov->mode == INPMOV_RECORD)
+    {
+        memcpy(hdr, inpmov_magic, 8);
+        inpmov_put32(hdr +  8, INPMOV_VERSION);
+        inpmov_put32(hdr + 12, rom_crc);
+        inpmov_put32(hdr + 16, snap_config());
+        inpmov_put32(hdr + 20, *seed);
+        inpmov_put32(hdr + 24, mov->check_frames);
+
+        if (fwrite(hdr, 1, INPMOV_HDR_LEN, mov->f) != INPMOV_HDR_LEN)
+        {
+            fprintf(stderr, "inpmov:  Error writing movie header\n");
+            return -1;
+        }
+        return 0;
+    }
+
+    if (fread(hdr, 1, INPMOV_HDR_LEN, mov->f) != INPMOV_HDR_LEN ||
+        memcmp(hdr, inpmov_magic, 8) != 0)
+    {
+        fprintf(stderr, "inpmov:  Not a jzIntv input movie\n");
+        return -1;
+    }
+
+    if (inpmov_get32(hdr + 8) != INPMOV_VERSION)
+    {
+        fprintf(stderr, "inpmov:  Movie is version %u; expected %d\n",
+                inpmov_get32(hdr + 8), INPMOV_VERSION);
+        return -1;
+    }
+
+    if (inpmov_get32(hdr + 12) != rom_crc)
+    {
+        fprintf(stderr, "inpmov:  Movie was recorded with a different game "
+                        "(CRC %.8X; this one is %.8X)\n",
+                inpmov_get32(hdr + 12), rom_crc);
+        return -1;
+    }
+
+    if (inpmov_get32(hdr + 16) != snap_config())
+    {
+        fprintf(stderr, "inpmov:  Movie was recorded with a different "
+                        "machine configuration\n");
+        return -1;
+    }
+
+    *seed             = inpmov_get32(hdr + 20);
+    mov->check_frames = inpmov_get32(hdr + 24);
+    inpmov_next(mov);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  INPMOV_RESET     -- Record a machine reset.                             */
+/* ======================================================================== */
+void inpmov_reset(inpmov_t *mov, uint_64 now)
+{
+    if (mov->mode != INPMOV_RECORD)
+        return;
+
+    inpmov_put_rec(mov, INPMOV_RESET, now);
+}
+
+/* ======================================================================== */
+/*  INPMOV_POLL      -- During playback, is a machine reset due?            */
+/* ======================================================================== */
+int inpmov_poll(inpmov_t *mov, uint_64 now)
+{
+    if (mov->mode != INPMOV_PLAY || mov->next_type != INPMOV_RESET)
+        return 0;
+
+    if (mov->next_time < now)
+    {
+        inpmov_stop(mov, "Machine fell out of step with the movie");
+        return 0;
+    }
+
+    if (mov->next_time > now)
+        return 0;
+
+    inpmov_next(mov);
+    return 1;
+}
+
+/* ======================================================================== */
+/*  INPMOV_FAILED    -- Did playback fail to match the recording?           */
+/* ======================================================================== */
+int inpmov_failed(const inpmov_t *mov)
+{
+    return mov->failed;
+}
+
+/* ======================================================================== */
+/*  INPMOV_DTOR      -- Finish off the movie and close it.                  */
+/* ======================================================================== */
+LOCAL void inpmov_dtor(periph_p p)
+{
+    inpmov_t *mov = (inpmov_t *)p;
+
+    if (!mov->f)
+        return;
+
+    if (mov->mode == INPMOV_RECORD)
+    {
+        inpmov_put_rec(mov, INPMOV_END, mov->periph.now);
+        jzp_printf("inpmov:  Recorded %u checkpoints.\n", mov->checks);
+    }
+
+    if (fclose(mov->f) != 0 && mov->mode == INPMOV_RECORD)
+        fprintf(stderr, "inpmov:  Error writing movie\n");
+
+    mov->f    = NULL;
+    mov->mode = INPMOV_OFF;
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
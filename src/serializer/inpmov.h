@@ -0,0 +1,135 @@
+/*
+ * ============================================================================
+ *  Title:    Input Movies
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  An input movie records everything the player did, so a run of the
+ *  emulator can be played back later and come out exactly the same.
+ *
+ *  The movie starts from power-on.  Its header names the game by CRC-32,
+ *  the machine configuration by the snapshot engine's directory checksum,
+ *  and the random number seed.  After that come the inputs:  the event
+ *  words the hand controllers and ECS keyboard read, taken each time the
+ *  event subsystem runs, stored only when they change and stamped with
+ *  the emulated time.  Machine resets are recorded the same way.
+ *
+ *  Every so often the recorder also stores a CRC-32 of the machine state,
+ *  from SNAP_HASH.  Playback checks each one as it goes and stops at the
+ *  first mismatch, so a desync is caught within a few frames of where it
+ *  happened.  The hash leaves out display and frame-drop state, so a
+ *  movie plays back the same at any speed, with or without a display.
+ *
+ *  The movie is a periph.  It registers right after the event subsystem
+ *  with the same tick rate, so it always runs right after it, before the
+ *  controllers next sample their inputs.
+ *
+ *  INPMOV_INIT      -- Open a movie for recording or playback.
+ *  INPMOV_START     -- Write or check the header.
+ *  INPMOV_RESET     -- Record a machine reset.
+ *  INPMOV_POLL      -- During playback, is a machine reset due?
+ *  INPMOV_FAILED    -- Did playback fail to match the recording?
+ *  INPMOV_BIND      -- The event words a movie records.
+ * ============================================================================
+ */
+
+#ifndef INPMOV_H_
+#define INPMOV_H_ 1
+
+#define INPMOV_VERSION  (1)
+#define INPMOV_PAD_WORDS (17 + 17 + 8)  /* l[], r[] and k[] of one pad_t.   */
+#define INPMOV_WORDS    (2 * INPMOV_PAD_WORDS)
+
+enum
+{
+    INPMOV_OFF = 0,             /* No movie.                                */
+    INPMOV_RECORD,              /* Recording inputs.                        */
+    INPMOV_PLAY                 /* Playing inputs back.                     */
+};
+
+typedef struct inpmov_t
+{
+    periph_t    periph;         /* It's a peripheral, ticked after events.  */
+    FILE        *f;             /* The movie file.                          */
+    int         mode;           /* INPMOV_OFF, _RECORD or _PLAY.            */
+    int         failed;         /* Playback didn't match, or bad file.      */
+
+    uint_32     *word[INPMOV_WORDS];    /* Event words, in movie order.     */
+    uint_32     value[INPMOV_WORDS];    /* Their values as of last record.  */
+
+    uint_64     last_time;      /* Time stamp of the last record.           */
+    uint_32     check_frames;   /* Frames between state checkpoints.        */
+    uint_32     samples;        /* Input samples since the last one.        */
+    uint_32     checks;         /* Checkpoints written or matched.          */
+
+    int         next_type;      /* Playback:  type of the next record,      */
+    uint_64     next_time;      /*            its time stamp,               */
+    uint_32     next_crc;       /*            and its hash, if a CHECK.     */
+
+    v_uint_32   *do_exit;       /* Set when playback ends.                  */
+} inpmov_t;
+
+/* ======================================================================== */
+/*  INPMOV_INIT      -- Open 'fname' for recording or playback, capturing   */
+/*                      the event words of 'pad0' and 'pad1'.  A new movie  */
+/*                      checks the machine state every 'check_frames'.      */
+/* ======================================================================== */
+int inpmov_init
+(
+    inpmov_t        *mov,
+    const char      *fname,
+    int             mode,
+    uint_32         check_frames,
+    struct pad_t    *pad0,
+    struct pad_t    *pad1,
+    v_uint_32       *do_exit
+);
+
+/* ======================================================================== */
+/*  INPMOV_START     -- Write the header, or read and check it.  Call after */
+/*                      all state is registered.  '*seed' is recorded, or   */
+/*                      replaced by the recorded one on playback.           */
+/* ======================================================================== */
+int inpmov_start(inpmov_t *mov, uint_32 rom_crc, uint_32 *seed);
+
+/* ======================================================================== */
+/*  INPMOV_RESET     -- Record a machine reset at bus time 'now'.           */
+/* ======================================================================== */
+void inpmov_reset(inpmov_t *mov, uint_64 now);
+
+/* ======================================================================== */
+/*  INPMOV_POLL      -- During playback, returns 1 if the movie resets the  */
+/*                      machine at bus time 'now'.                          */
+/* ======================================================================== */
+int inpmov_poll(inpmov_t *mov, uint_64 now);
+
+/* ======================================================================== */
+/*  INPMOV_FAILED    -- Nonzero if playback didn't match the recording.     */
+/* ======================================================================== */
+int inpmov_failed(const inpmov_t *mov);
+
+/* ======================================================================== */
+/*  INPMOV_BIND      -- Point 'word' at the event words of 'pad0' and       */
+/*                      'pad1', in the order a movie records them.          */
+/* ======================================================================== */
+void inpmov_bind(uint_32 *word[INPMOV_WORDS], struct pad_t *pad0,
+                  struct pad_t *pad1);
+
+#endif
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
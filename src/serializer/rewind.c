@@ -0,0 +1,460 @@
+/*
+ * ============================================================================
+ *  Title:    Rewind Buffer
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See rewind.h.
+ *
+ *  Compressed frames live back to back in one byte ring.  A small
+ *  circular directory records where each frame starts, how long it is,
+ *  and whether it is a keyframe.  The oldest frame is always a keyframe.
+ *
+ *  A new frame is compressed in place, so it needs room for LZO's worst
+ *  case up front.  It goes right after the newest frame if that fits
+ *  before the end of the ring, else at the start of the ring if that
+ *  fits before the oldest frame.  Otherwise the oldest keyframe and its
+ *  deltas are evicted and we try again.
+ *
+ *  Only the newest deltas' keyframe is kept uncompressed.  Popping a
+ *  keyframe unpacks the keyframe before it, so the frames in between
+ *  can still be undone.
+ *
+ *  Capture goes into 'live', which is never edited, so it stays in sync
+ *  with the machine and each push only copies the pages written during
+ *  the frame.  Deltas are formed in a separate scratch arena.  A pop
+ *  restores from the scratch arena, which then trades places with
+ *  'live' since it's the one now in sync.
+ * ============================================================================
+ */
+
+#include "config.h"
+#include "minilzo/minilzo.h"
+#include "serializer/snapshot.h"
+#include "serializer/rewind.h"
+
+#define RW_FPS          (60)    /* Frames pushed per emulated second.       */
+#define RW_KEY_INTERVAL (60)    /* Frames between keyframes.                */
+
+typedef struct rw_frame_t
+{
+    uint_32     off;        /* Offset of the compressed frame in the ring.  */
+    uint_32     len;        /* Compressed length in bytes.                  */
+    int         key;        /* Nonzero for a keyframe.                      */
+    uint_64     when;       /* CPU cycle count when it was taken.           */
+} rw_frame_t;
+
+struct rewind_t
+{
+    snap_t      live;       /* Latest capture, kept in sync with machine.   */
+    snap_t      cur;        /* Scratch:  delta being pushed, frame popped.  */
+    snap_t      key;        /* Keyframe the newest deltas are against.      */
+    int         key_valid;  /* Nonzero if 'key' is in the ring.             */
+    int         since_key;  /* Deltas pushed since that keyframe.           */
+
+    uint_8      *ring;      /* Compressed frames.                           */
+    uint_32     ring_size;  /* Size of the ring in bytes.                   */
+    uint_32     max_comp;   /* Worst-case compressed frame size.            */
+
+    rw_frame_t  *frame;     /* Circular frame directory.                    */
+    int         max_frames; /* Size of the frame directory.                 */
+    int         first;      /* Index of the oldest frame.                   */
+    int         count;      /* Number of frames held.                       */
+
+    uint_8      *lzo_wrk;   /* LZO compressor's work memory.                */
+
+    double      push_time;  /* Total time spent in REWIND_PUSH.             */
+    uint_32     pushes;     /* Number of frames pushed.                     */
+};
+
+/* 'i' counts from the oldest frame, 0, to the newest, count - 1. */
+#define RW_FRAME(rw, i) (&(rw)->frame[((rw)->first + (i)) % (rw)->max_frames])
+
+/* ======================================================================== */
+/*  RW_XOR           -- Set 'dst' to 'a' XOR 'b'.  Arenas are malloc        */
+/*                      aligned.  'dst' may be the same as 'a'.             */
+/* ======================================================================== */
+LOCAL void rw_xor(uint_8 *dst, const uint_8 *a, const uint_8 *b, uint_32 len)
+{
+    uint_32 *d = (uint_32 *)dst;
+    const uint_32 *sa = (const uint_32 *)a;
+    const uint_32 *sb = (const uint_32 *)b;
+    uint_32 i, words = len >> 2;
+
+    for (i = 0; i < words; i++)
+        d[i] = sa[i] ^ sb[i];
+
+    for (i = words << 2; i < len; i++)
+        dst[i] = a[i] ^ b[i];
+}
+
+/* ======================================================================== */
+/*  RW_EVICT         -- Drop the oldest keyframe and its deltas.            */
+/* ======================================================================== */
+LOCAL void rw_evict(rewind_t *rw)
+{
+    do
+    {
+        rw->first = (rw->first + 1) % rw->max_frames;
+        rw->count--;
+    } while (rw->count > 0 && !RW_FRAME(rw, 0)->key);
+
+    if (rw->count == 0)
+        rw->key_valid = 0;
+}
+
+/* ======================================================================== */
+/*  RW_FLUSH         -- Forget everything.                                  */
+/* ======================================================================== */
+LOCAL void rw_flush(rewind_t *rw)
+{
+    rw->first     = 0;
+    rw->count     = 0;
+    rw->key_valid = 0;
+}
+
+/* ======================================================================== */
+/*  RW_PLACE         -- Find room for a new frame, evicting as needed.      */
+/* ======================================================================== */
+LOCAL uint_32 rw_place(rewind_t *rw)
+{
+    while (rw->count > 0)
+    {
+        const rw_frame_t *oldest = RW_FRAME(rw, 0);
+        const rw_frame_t *newest = RW_FRAME(rw, rw->count - 1);
+        uint_32 tail = oldest->off;
+        uint_32 head = newest->off + newest->len;
+
+        if (rw->count < rw->max_frames)
+        {
+            if (newest->off >= tail)
+            {
+                /* Frames don't wrap:  free space at the end and start. */
+                if (rw->ring_size - head >= rw->max_comp) return head;
+                if (tail                 >= rw->max_comp) return 0;
+            } else
+            {
+                /* Frames wrap:  free space is between newest and oldest. */
+                if (tail - head >= rw->max_comp) return head;
+            }
+        }
+
+        rw_evict(rw);
+    }
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  RW_UNPACK        -- Decompress a frame into 'dst'.                      */
+/* ======================================================================== */
+LOCAL int rw_unpack(rewind_t *rw, const rw_frame_t *fr, uint_8 *dst)
+{
+    lzo_uint len = rw->cur.size;
+    int r;
+
+    r = lzo1x_decompress_safe(rw->ring + fr->off, fr->len, dst, &len, NULL);
+
+    return r == LZO_E_OK && len == rw->cur.size ? 0 : -1;
+}
+
+/* ======================================================================== */
+/*  REWIND_CREATE    -- Create a rewind buffer.                             */
+/* ======================================================================== */
+rewind_t *rewind_create(int mbytes, int seconds)
+{
+    rewind_t *rw;
+    uint_32 size = snap_size();
+
+    if (mbytes <= 0 || mbytes > 1024 || seconds <= 0)
+    {
+        fprintf(stderr, "rewind:  Need 1 to 1024 MB and at least 1 second\n");
+        return NULL;
+    }
+
+    if (!(rw = CALLOC(rewind_t, 1)))
+        goto oom;
+
+    rw->ring_size  = (uint_32)mbytes << 20;
+    rw->max_comp   = size + size / 16 + 64 + 3;
+    rw->max_frames = seconds * RW_FPS;
+
+    if (rw->ring_size < 2 * rw->max_comp)
+    {
+        fprintf(stderr, "rewind:  %d MB is too small for %u byte frames\n",
+                mbytes, size);
+        free(rw);
+        return NULL;
+    }
+
+    if (snap_init(&rw->live) || snap_init(&rw->cur) || snap_init(&rw->key))
+        goto oom;
+
+    rw->ring    = CALLOC(uint_8,     rw->ring_size);
+    rw->frame   = CALLOC(rw_frame_t, rw->max_frames);
+    rw->lzo_wrk = CALLOC(uint_8,     LZO1X_1_MEM_COMPRESS);
+
+    if (!rw->ring || !rw->frame || !rw->lzo_wrk)
+        goto oom;
+
+    return rw;
+
+oom:
+    fprintf(stderr, "rewind:  Out of memory\n");
+    rewind_destroy(rw);
+    return NULL;
+}
+
+/* ======================================================================== */
+/*  REWIND_PUSH      -- Record the current machine state as a new frame.    */
+/* ======================================================================== */
+int rewind_push(rewind_t *rw, uint_64 when)
+{
+    double start = get_time();
+    rw_frame_t *fr;
+    const uint_8 *src;
+    lzo_uint len = 0;
+    uint_32 off;
+    int key;
+
+    if (snap_take(&rw->live))
+        return -1;
+
+    /* -------------------------------------------------------------------- */
+    /*  Make room first:  that may evict the keyframe we'd delta against.   */
+    /* -------------------------------------------------------------------- */
+    off = rw_place(rw);
+    key = !rw->key_valid || rw->since_key >= RW_KEY_INTERVAL - 1;
+
+    if (key)
+        src = rw->live.arena;
+    else
+    {
+        rw_xor(rw->cur.arena, rw->live.arena, rw->key.arena, rw->cur.size);
+        rw->cur.gen = 0;
+        src = rw->cur.arena;
+    }
+
+    if (lzo1x_1_compress(src, rw->cur.size, rw->ring + off,
+                         &len, (lzo_voidp)rw->lzo_wrk) != LZO_E_OK)
+    {
+        rw_flush(rw);
+        return -1;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  A new keyframe becomes the reference.                               */
+    /* -------------------------------------------------------------------- */
+    if (key)
+    {
+        memcpy(rw->key.arena, rw->live.arena, rw->key.size);
+        rw->key_valid = 1;
+        rw->since_key = 0;
+    } else
+        rw->since_key++;
+
+    fr = RW_FRAME(rw, rw->count);
+    fr->off  = off;
+    fr->len  = len;
+    fr->key  = key;
+    fr->when = when;
+    rw->count++;
+
+    rw->push_time += get_time() - start;
+    rw->pushes++;
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  REWIND_POP       -- Restore the newest frame and drop it.               */
+/* ======================================================================== */
+int rewind_pop(rewind_t *rw)
+{
+    const rw_frame_t *fr;
+    snap_t tmp;
+    int i;
+
+    if (rw->count == 0)
+        return -1;
+
+    fr = RW_FRAME(rw, rw->count - 1);
+    rw->cur.gen = 0;
+
+    if (rw_unpack(rw, fr, rw->cur.arena))
+    {
+        rw_flush(rw);
+        return -1;
+    }
+
+    if (!fr->key)
+        rw_xor(rw->cur.arena, rw->cur.arena, rw->key.arena, rw->cur.size);
+
+    rw->count--;
+
+    if (!fr->key)
+    {
+        rw->since_key--;
+    } else
+    {
+        /* ---------------------------------------------------------------- */
+        /*  The frames before this one are deltas against the previous      */
+        /*  keyframe, so bring that one back as the reference.              */
+        /* ---------------------------------------------------------------- */
+        rw->key_valid = 0;
+
+        for (i = rw->count - 1; i >= 0; i--)
+            if (RW_FRAME(rw, i)->key)
+                break;
+
+        if (i >= 0)
+        {
+            if (rw_unpack(rw, RW_FRAME(rw, i), rw->key.arena))
+                rw_flush(rw);
+            else
+            {
+                rw->key_valid = 1;
+                rw->since_key = rw->count - 1 - i;
+            }
+        }
+    }
+
+    if (snap_restore(&rw->cur))
+        return -1;
+
+    tmp      = rw->live;
+    rw->live = rw->cur;
+    rw->cur  = tmp;
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  REWIND_FIND      -- Find the last frame before a given cycle.           */
+/* ======================================================================== */
+int rewind_find(const rewind_t *rw, uint_64 when, uint_64 *stamp)
+{
+    int i;
+
+    for (i = rw->count - 1; i >= 0; i--)
+        if (RW_FRAME(rw, i)->when < when)
+            break;
+
+    if (i >= 0 && stamp)
+        *stamp = RW_FRAME(rw, i)->when;
+
+    return i;
+}
+
+/* ======================================================================== */
+/*  REWIND_BACK_TO   -- Restore that frame and drop the ones after it.      */
+/* ======================================================================== */
+int rewind_back_to(rewind_t *rw, uint_64 when)
+{
+    const rw_frame_t *fr;
+    snap_t tmp;
+    int i, k;
+
+    if ((i = rewind_find(rw, when, NULL)) < 0)
+        return -1;
+
+    /* -------------------------------------------------------------------- */
+    /*  Unpack its keyframe as the new reference, then the frame itself.    */
+    /*  The oldest frame is always a keyframe, so there is one.             */
+    /* -------------------------------------------------------------------- */
+    for (k = i; k > 0 && !RW_FRAME(rw, k)->key; k--)
+        ;
+
+    fr = RW_FRAME(rw, i);
+    rw->cur.gen = 0;
+
+    if (rw_unpack(rw, RW_FRAME(rw, k), rw->key.arena) ||
+        (!fr->key && rw_unpack(rw, fr, rw->cur.arena)))
+    {
+        rw_flush(rw);
+        return -1;
+    }
+
+    if (fr->key)
+        memcpy(rw->cur.arena, rw->key.arena, rw->cur.size);
+    else
+        rw_xor(rw->cur.arena, rw->cur.arena, rw->key.arena, rw->cur.size);
+
+    rw->count     = i + 1;
+    rw->key_valid = 1;
+    rw->since_key = i - k;
+
+    if (snap_restore(&rw->cur))
+        return -1;
+
+    tmp      = rw->live;
+    rw->live = rw->cur;
+    rw->cur  = tmp;
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  REWIND_FRAMES    -- Number of frames available to rewind through.       */
+/* ======================================================================== */
+int rewind_frames(const rewind_t *rw)
+{
+    return rw->count;
+}
+
+/* ======================================================================== */
+/*  REWIND_STATS     -- Print memory use and capture cost.                  */
+/* ======================================================================== */
+void rewind_stats(const rewind_t *rw)
+{
+    uint_32 used = 0;
+    int i, keys = 0;
+
+    for (i = 0; i < rw->count; i++)
+    {
+        used += RW_FRAME(rw, i)->len;
+        keys += RW_FRAME(rw, i)->key;
+    }
+
+    jzp_printf("Rewind: %d frames (%.1f sec), %d keyframes, "
+               "%u of %u KB used\n", rw->count, (double)rw->count / RW_FPS,
+               keys, used >> 10, rw->ring_size >> 10);
+
+    if (rw->pushes)
+        jzp_printf("Rewind: %u byte frames, %.1f usec average capture\n",
+                   rw->cur.size, rw->push_time * 1e6 / rw->pushes);
+}
+
+/* ======================================================================== */
+/*  REWIND_DESTROY   -- Free a rewind buffer.                               */
+/* ======================================================================== */
+void rewind_destroy(rewind_t *rw)
+{
+    if (!rw)
+        return;
+
+    snap_dtor(&rw->live);
+    snap_dtor(&rw->cur);
+    snap_dtor(&rw->key);
+    CONDFREE(rw->ring);
+    CONDFREE(rw->frame);
+    CONDFREE(rw->lzo_wrk);
+    free(rw);
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,108 @@
+/*
+ * ============================================================================
+ *  Title:    Rewind Buffer
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Keeps the last few seconds of machine state, one snapshot per frame,
+ *  so play can be stepped or run backwards.
+ *
+ *  Every so often a frame is stored whole as a keyframe.  The frames in
+ *  between are stored as the XOR of the frame with the keyframe before
+ *  it, which is mostly zeros.  Either way, the frame is compressed with
+ *  LZO straight into a fixed-size byte ring.  When the ring or the frame
+ *  limit fills up, the oldest keyframe and the deltas that depend on it
+ *  are dropped together, so memory use never grows past what was asked
+ *  for at creation.
+ *
+ *  Rewinding pops frames off the newest end:  each pop restores that
+ *  frame and forgets it.  The caller resyncs the machine after a pop the
+ *  same way as after loading a snapshot.
+ *
+ *  Each frame is tagged with the cycle it was taken at, so the debugger
+ *  can also go straight back to the last frame before a given cycle and
+ *  replay forward from there.
+ *
+ *  REWIND_CREATE    -- Create a rewind buffer.
+ *  REWIND_PUSH      -- Record the current machine state as a new frame.
+ *  REWIND_POP       -- Restore the newest frame and drop it.
+ *  REWIND_FIND      -- Find the last frame before a given cycle.
+ *  REWIND_BACK_TO   -- Restore that frame and drop the ones after it.
+ *  REWIND_FRAMES    -- Number of frames available to rewind through.
+ *  REWIND_STATS     -- Print memory use and capture cost.
+ *  REWIND_DESTROY   -- Free a rewind buffer.
+ * ============================================================================
+ */
+#ifndef REWIND_H_
+#define REWIND_H_
+
+typedef struct rewind_t rewind_t;
+
+/* ======================================================================== */
+/*  REWIND_CREATE    -- Create a rewind buffer holding up to 'seconds' of   */
+/*                      frames in a ring of 'mbytes' megabytes.  All state  */
+/*                      must be registered with the snapshot engine first.  */
+/*                      Returns NULL on failure.                            */
+/* ======================================================================== */
+rewind_t *rewind_create(int mbytes, int seconds);
+
+/* ======================================================================== */
+/*  REWIND_PUSH      -- Record the current machine state as a new frame,    */
+/*                      evicting the oldest frames if needed.  'when' is    */
+/*                      the CPU's cycle count.                              */
+/* ======================================================================== */
+int rewind_push(rewind_t *rw, uint_64 when);
+
+/* ======================================================================== */
+/*  REWIND_POP       -- Restore the newest frame into the machine and drop  */
+/*                      it.  Returns -1 if there is nothing left.           */
+/* ======================================================================== */
+int rewind_pop(rewind_t *rw);
+
+/* ======================================================================== */
+/*  REWIND_FIND      -- Find the newest frame taken before cycle 'when',    */
+/*                      and put the cycle it was taken at in '*stamp'.      */
+/*                      Returns -1 if there's no such frame.                */
+/* ======================================================================== */
+int rewind_find(const rewind_t *rw, uint_64 when, uint_64 *stamp);
+
+/* ======================================================================== */
+/*  REWIND_BACK_TO   -- Restore the newest frame taken before cycle 'when'  */
+/*                      into the machine, and drop all the frames after it. */
+/*                      Unlike REWIND_POP, that frame stays in the buffer.  */
+/*                      Returns -1 if there is no such frame.               */
+/* ======================================================================== */
+int rewind_back_to(rewind_t *rw, uint_64 when);
+
+/* ======================================================================== */
+/*  REWIND_FRAMES    -- Number of frames available to rewind through.       */
+/* ======================================================================== */
+int rewind_frames(const rewind_t *rw);
+
+/* ======================================================================== */
+/*  REWIND_STATS     -- Print memory use and capture cost.                  */
+/* ======================================================================== */
+void rewind_stats(const rewind_t *rw);
+
+/* ======================================================================== */
+/*  REWIND_DESTROY   -- Free a rewind buffer.                               */
+/* ======================================================================== */
+void rewind_destroy(rewind_t *rw);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,154 @@
+/* ======================================================================== */
+/*  SER_TEST:  Checks that the serializer's binary image round trips.       */
+/*                                                                          */
+/*  The serializer is compiled out of jzIntv for now, so this builds its    */
+/*  own copy with WANT_SERIALIZER.  It registers a few objects of each      */
+/*  kind, saves an image, scribbles on the objects and loads it back, and   */
+/*  checks that images from another build or configuration are refused.     */
+/* ======================================================================== */
+
+#include "config.h"
+#include "serializer/serializer.h"
+
+uint_8  t_u8 [5]  = { 1, 2, 3, 4, 5 };
+sint_16 t_s16[3]  = { -1, 1000, -32768 };
+uint_32 t_u32     = 0xDEADBEEF;
+sint_64 t_s64     = -12345678901LL;
+uint_32 t_init    = 42;         /* SER_INIT:  checked, not loaded.          */
+uint_32 t_info    = 7;          /* SER_INFO:  not in the image at all.      */
+char    t_str[16] = "hello";    /* Strings aren't in the image either.      */
+
+int fails = 0;
+
+#define CHECK(c) \
+    do { if (!(c)) { printf("FAIL:  %s\n", #c); fails++; } } while (0)
+
+/* ======================================================================== */
+/*  SCRIBBLE:  Change every object, so a load has something to undo.        */
+/* ======================================================================== */
+void scribble(void)
+{
+    memset(t_u8,  0xAA, sizeof(t_u8));
+    memset(t_s16, 0x55, sizeof(t_s16));
+    t_u32  = 0;
+    t_s64  = 0;
+    t_info = 8;
+    strcpy(t_str, "bye");
+}
+
+/* ======================================================================== */
+/*  SAME_AS_SAVED:  Are the image's objects back the way they were saved?   */
+/* ======================================================================== */
+int same_as_saved(void)
+{
+    static const uint_8  u8 [5] = { 1, 2, 3, 4, 5 };
+    static const sint_16 s16[3] = { -1, 1000, -32768 };
+
+    return !memcmp(t_u8, u8, sizeof(u8)) && !memcmp(t_s16, s16, sizeof(s16))
+        && t_u32 == 0xDEADBEEF && t_s64 == -12345678901LL;
+}
+
+int main(void)
+{
+    ser_hier_t *top, *sub;
+    uint_8     *img, *bad;
+    uint_32    size;
+    FILE       *f;
+
+    top = ser_new_hierarchy(NULL, "top");
+    sub = ser_new_hierarchy(top,  "sub");
+
+    ser_register(top, "u8",   t_u8,   ser_u8,     5, SER_HEX);
+    ser_register(top, "s16",  t_s16,  ser_s16,    3, 0);
+    ser_register(sub, "u32",  &t_u32, ser_u32,    1, SER_HEX);
+    ser_register(sub, "s64",  &t_s64, ser_s64,    1, 0);
+    ser_register(sub, "init", &t_init, ser_u32,   1, SER_INIT);
+    ser_register(sub, "info", &t_info, ser_u32,   1, SER_INFO);
+    ser_register(top, "str",  t_str,  ser_string, 16, 0);
+
+    /* -------------------------------------------------------------------- */
+    /*  24 bytes of header, then 5 + 6 + 4 + 8 + 4 bytes of objects.        */
+    /* -------------------------------------------------------------------- */
+    size = ser_bin_size();
+    CHECK(size == 24 + 27);
+
+    img = CALLOC(uint_8, size);
+    bad = CALLOC(uint_8, size);
+
+    CHECK(ser_bin_encode(img, size - 1) == -1);
+    CHECK(ser_bin_encode(img, size) == (int)size);
+
+    /* -------------------------------------------------------------------- */
+    /*  A good image loads everything but INFO objects and strings.         */
+    /* -------------------------------------------------------------------- */
+    scribble();
+    CHECK(ser_bin_decode(img, size) == 0);
+    CHECK(same_as_saved());
+    CHECK(t_info == 8);
+    CHECK(!strcmp(t_str, "bye"));
+
+    /* -------------------------------------------------------------------- */
+    /*  Bad images are refused, and nothing gets loaded.                    */
+    /* -------------------------------------------------------------------- */
+    scribble();
+    CHECK(ser_bin_decode(img, size - 1) == -1);
+
+    memcpy(bad, img, size);
+    bad[0] = 'X';                               /* Magic.                   */
+    CHECK(ser_bin_decode(bad, size) == -1);
+
+    memcpy(bad, img, size);
+    bad[8]++;                                   /* Version.                 */
+    CHECK(ser_bin_decode(bad, size) == -1);
+
+    memcpy(bad, img, size);
+    bad[20] ^= 1;                               /* Schema hash.             */
+    CHECK(ser_bin_decode(bad, size) == -1);
+
+    t_init = 43;                                /* Different configuration. */
+    CHECK(ser_bin_decode(img, size) == -1);
+    t_init = 42;
+
+    CHECK(t_u32 == 0 && t_s64 == 0);
+
+    /* -------------------------------------------------------------------- */
+    /*  And through a file.                                                 */
+    /* -------------------------------------------------------------------- */
+    if (!(f = tmpfile()))
+    {
+        perror("tmpfile()");
+        exit(1);
+    }
+
+    ser_bin_decode(img, size);
+    CHECK(ser_bin_write(f) == 0);
+    scribble();
+    rewind(f);
+    CHECK(ser_bin_read(f) == 0);
+    CHECK(same_as_saved());
+    fclose(f);
+
+    free(img);
+    free(bad);
+
+    printf("%s\n", fails ? "FAILED" : "PASSED");
+    return fails != 0;
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-1999, Joseph Zbiciak                  */
+/* ======================================================================== */
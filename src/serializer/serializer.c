@@ -5,6 +5,21 @@
 /*  Key/value pair lists are hung off a hierarchy of namespaces to allow    */
 /*  short, simple names to be used for keys and to simplify disambiguating  */
 /*  multiple instances of a given object (e.g. two PSGs, etc.).             */
+/*                                                                          */
+/*  Binary image layout, all fields little endian:                          */
+/*                                                                          */
+/*      8 bytes     "jzIntvSB"                                              */
+/*      4 bytes     SER_BIN_VERSION                                         */
+/*      4 bytes     Number of objects                                       */
+/*      4 bytes     Object data size in bytes                               */
+/*      4 bytes     Schema hash                                             */
+/*      N bytes     Object data                                             */
+/*                                                                          */
+/*  The object data holds every object in registration order, each one a    */
+/*  plain array of its elements.  SER_INFO objects and strings are left     */
+/*  out, as they're never restored.  The schema hash is a CRC-32 over each  */
+/*  registered object's full name, type, length and INIT/INFO flags, so it  */
+/*  changes if anything is added, removed, reordered or resized.            */
 /* ======================================================================== */
 
 #include "config.h"
@@ -16,9 +31,42 @@ int no_serializer;
 #else
 
 #include "serializer/serializer.h"
+#include "misc/crc32.h"
 
 static ser_hier_t *ser_hier = NULL;
 
+#define SER_BIN_VERSION (1)
+#define SER_BIN_HDR_LEN (24)
+
+static const char ser_bin_magic[8] = { 'j','z','I','n','t','v','S','B' };
+static const int  ser_type_size[]  = { 1, 1, 2, 2, 4, 4, 8, 8, 0 };
+
+static ser_list_t *ser_bin_head = NULL;    /* Objects in the binary image.  */
+static ser_list_t *ser_bin_tail = NULL;
+static uint_32     ser_bin_cnt  = 0;
+static uint_32     ser_bin_len  = 0;       /* Bytes of object data.         */
+static uint_32     ser_schema   = 0xFFFFFFFFU;
+
+/* ======================================================================== */
+/*  SER_HASH_STR:   Fold a name into the schema hash.                       */
+/*  SER_HASH_PATH:  Fold a hierarchy's full name into the schema hash.      */
+/* ======================================================================== */
+static uint_32 ser_hash_str(uint_32 crc, const char *s)
+{
+    for (; *s; s++)
+        crc = crc32_update(crc, (uint_8)*s);
+
+    return crc32_update(crc, 0);
+}
+
+static uint_32 ser_hash_path(uint_32 crc, const ser_hier_t *hier)
+{
+    if (!hier)
+        return crc;
+
+    return ser_hash_str(ser_hash_path(crc, hier->parent), hier->name);
+}
+
 /* ======================================================================== */
 /*  SER_REGISTER:  Register key/value pair that will be serialized.         */
 /* ======================================================================== */
@@ -66,7 +114,28 @@ void ser_register
 
     if (prev) prev->next     = new_rec;
     else      hier->obj_list = new_rec;
-    
+
+    /* -------------------------------------------------------------------- */
+    /*  Fold the object into the schema hash.  Unless it's informative or   */
+    /*  a string, give it the next spot in the binary image.                */
+    /* -------------------------------------------------------------------- */
+    ser_schema = ser_hash_path(ser_schema, hier);
+    ser_schema = ser_hash_str (ser_schema, name);
+    ser_schema = crc32_upd32(ser_schema, (uint_32)type);
+    ser_schema = crc32_upd32(ser_schema, (uint_32)length);
+    ser_schema = crc32_upd32(ser_schema, flags & (SER_INIT | SER_INFO));
+
+    if ((flags & SER_INFO) == 0 && type != ser_string)
+    {
+        new_rec->bin_ofs = ser_bin_len;
+        ser_bin_len     += ser_type_size[type] * length;
+        ser_bin_cnt++;
+
+        if (ser_bin_tail) ser_bin_tail->bin_next = new_rec;
+        else              ser_bin_head           = new_rec;
+        ser_bin_tail = new_rec;
+    }
+
     /* -------------------------------------------------------------------- */
     /*  If this key has its INIT flag set, set it in the hierarchies that   */
     /*  contain it.  If it does not have its INIT flag set, set the NONINIT */
@@ -383,6 +452,250 @@ void ser_print_hierarchy(FILE *f, ser_hier_t *node, int init, int indent)
     return;
 }
 
+/* ======================================================================== */
+/*  SER_BIN_PUT32 / SER_BIN_GET32:  Header fields.                          */
+/* ======================================================================== */
+static void ser_bin_put32(uint_8 *p, uint_32 v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint_32 ser_bin_get32(const uint_8 *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint_32)p[3] << 24);
+}
+
+/* ======================================================================== */
+/*  SER_BIN_PUT:    Copy an object into the image.                          */
+/*  SER_BIN_GET:    Copy an object out of the image.                        */
+/*                                                                          */
+/*  On little endian hosts, an object already looks like its image.         */
+/* ======================================================================== */
+static void ser_bin_put(uint_8 *dst, const ser_list_t *obj)
+{
+    int size = ser_type_size[obj->type];
+#ifdef BYTE_LE
+    memcpy(dst, obj->object, size * obj->length);
+#else
+    void    *p = obj->object;
+    uint_64 v;
+    int     i, j;
+
+    for (i = 0; i < obj->length; i++)
+    {
+        v = ser_get_int(p, obj->type, &p);
+        for (j = 0; j < size; j++)
+            *dst++ = v >> (8 * j);
+    }
+#endif
+}
+
+static void ser_bin_get(const uint_8 *src, const ser_list_t *obj)
+{
+    int size = ser_type_size[obj->type];
+#ifdef BYTE_LE
+    memcpy(obj->object, src, size * obj->length);
+#else
+    union
+    {
+        uint_8  *pu8;   uint_16 *pu16;
+        uint_32 *pu32;  uint_64 *pu64;
+        void    *v;
+    } ptr;
+    uint_64 v;
+    int     i, j;
+
+    ptr.v = obj->object;
+
+    for (i = 0; i < obj->length; i++)
+    {
+        v = 0;
+        for (j = 0; j < size; j++)
+            v |= (uint_64)*src++ << (8 * j);
+
+        switch (size)
+        {
+            case 1: *ptr.pu8 ++ = v; break;
+            case 2: *ptr.pu16++ = v; break;
+            case 4: *ptr.pu32++ = v; break;
+            case 8: *ptr.pu64++ = v; break;
+        }
+    }
+#endif
+}
+
+/* ======================================================================== */
+/*  SER_BIN_SAME:   Does an object match its copy in the image?             */
+/* ======================================================================== */
+static int ser_bin_same(const uint_8 *src, const ser_list_t *obj)
+{
+    int     size = ser_type_size[obj->type];
+    uint_64 mask = size == 8 ? ~(uint_64)0 : ((uint_64)1 << (8 * size)) - 1;
+    void    *p   = obj->object;
+    uint_64 v;
+    int     i, j;
+
+    for (i = 0; i < obj->length; i++)
+    {
+        v = 0;
+        for (j = 0; j < size; j++)
+            v |= (uint_64)*src++ << (8 * j);
+
+        if (v != (ser_get_int(p, obj->type, &p) & mask))
+            return 0;
+    }
+
+    return 1;
+}
+
+/* ======================================================================== */
+/*  SER_BIN_SIZE:    Size in bytes of a binary image, header included.      */
+/* ======================================================================== */
+uint_32 ser_bin_size(void)
+{
+    return SER_BIN_HDR_LEN + ser_bin_len;
+}
+
+/* ======================================================================== */
+/*  SER_BIN_SCHEMA:  Hash of every object registered so far.                */
+/* ======================================================================== */
+uint_32 ser_bin_schema(void)
+{
+    return ser_schema;
+}
+
+/* ======================================================================== */
+/*  SER_BIN_ENCODE:  Write a binary image into 'buf'.                       */
+/* ======================================================================== */
+int ser_bin_encode(uint_8 *buf, uint_32 len)
+{
+    ser_list_t *obj;
+
+    if (len < ser_bin_size())
+        return -1;
+
+    memcpy(buf, ser_bin_magic, 8);
+    ser_bin_put32(buf +  8, SER_BIN_VERSION);
+    ser_bin_put32(buf + 12, ser_bin_cnt);
+    ser_bin_put32(buf + 16, ser_bin_len);
+    ser_bin_put32(buf + 20, ser_schema);
+
+    buf += SER_BIN_HDR_LEN;
+    for (obj = ser_bin_head; obj; obj = obj->bin_next)
+        ser_bin_put(buf + obj->bin_ofs, obj);
+
+    return ser_bin_size();
+}
+
+/* ======================================================================== */
+/*  SER_BIN_DECODE:  Load the objects from a binary image.                  */
+/* ======================================================================== */
+int ser_bin_decode(const uint_8 *buf, uint_32 len)
+{
+    ser_list_t *obj;
+
+    if (len < SER_BIN_HDR_LEN || memcmp(buf, ser_bin_magic, 8) != 0)
+    {
+        fprintf(stderr, "serializer:  Not a jzIntv binary image\n");
+        return -1;
+    }
+
+    if (ser_bin_get32(buf + 8) != SER_BIN_VERSION)
+    {
+        fprintf(stderr, "serializer:  Image is version %u; expected %d\n",
+                ser_bin_get32(buf + 8), SER_BIN_VERSION);
+        return -1;
+    }
+
+    if (ser_bin_get32(buf + 12) != ser_bin_cnt ||
+        ser_bin_get32(buf + 16) != ser_bin_len ||
+        ser_bin_get32(buf + 20) != ser_schema)
+    {
+        fprintf(stderr, "serializer:  Image is from a different build or "
+                        "machine configuration\n");
+        return -1;
+    }
+
+    if (len < ser_bin_size())
+    {
+        fprintf(stderr, "serializer:  Image is truncated\n");
+        return -1;
+    }
+
+    buf += SER_BIN_HDR_LEN;
+
+    /* -------------------------------------------------------------------- */
+    /*  INIT objects came from the configuration, which we can't rerun      */
+    /*  once we're live.  Rather than load them, verify them against what   */
+    /*  we're running, and check them all before loading anything.          */
+    /* -------------------------------------------------------------------- */
+    for (obj = ser_bin_head; obj; obj = obj->bin_next)
+        if ((obj->flags & SER_INIT) && !ser_bin_same(buf + obj->bin_ofs, obj))
+        {
+            fprintf(stderr, "serializer:  Image was saved with a different "
+                            "'%s'\n", obj->name);
+            return -1;
+        }
+
+    for (obj = ser_bin_head; obj; obj = obj->bin_next)
+        if ((obj->flags & SER_INIT) == 0)
+            ser_bin_get(buf + obj->bin_ofs, obj);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  SER_BIN_WRITE:   Write a binary image to a file.                        */
+/* ======================================================================== */
+int ser_bin_write(FILE *f)
+{
+    uint_32 size = ser_bin_size();
+    uint_8  *buf;
+    int     ok;
+
+    if (!(buf = CALLOC(uint_8, size)))
+    {
+        fprintf(stderr, "serializer:  Out of memory\n");
+        return -1;
+    }
+
+    ser_bin_encode(buf, size);
+    ok = fwrite(buf, 1, size, f) == size;
+    free(buf);
+
+    if (!ok)
+    {
+        fprintf(stderr, "serializer:  Error writing binary image\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  SER_BIN_READ:    Read a binary image from a file and load it.           */
+/* ======================================================================== */
+int ser_bin_read(FILE *f)
+{
+    uint_32 size = ser_bin_size();
+    uint_8  *buf;
+    int     r;
+
+    if (!(buf = CALLOC(uint_8, size)))
+    {
+        fprintf(stderr, "serializer:  Out of memory\n");
+        return -1;
+    }
+
+    r = ser_bin_decode(buf, fread(buf, 1, size, f));
+    free(buf);
+
+    return r;
+}
+
 #endif
 
 /* ======================================================================== */
@@ -6,6 +6,12 @@
 /*  Key/value pair lists are hung off a hierarchy of namespaces to allow    */
 /*  short, simple names to be used for keys and to simplify disambiguating  */
 /*  multiple instances of a given object (e.g. two PSGs, etc.).             */
+/*                                                                          */
+/*  Besides the text format, the same objects can be written as a compact   */
+/*  binary image for save states.  Each object's place in the image is      */
+/*  fixed when it registers, and the image's header carries a hash of the   */
+/*  whole schema, so an image is only ever read back by a build that        */
+/*  registered exactly the same objects.                                    */
 /* ======================================================================== */
 
 #ifndef SERIALIZE_H_
@@ -35,6 +41,9 @@ struct ser_list_t
     ser_type_t  type;
     int         length;
     uint_32     flags;
+
+    struct ser_list_t *bin_next;    /* Next object in the binary image.     */
+    uint_32     bin_ofs;            /* Offset of this one in the image.     */
 };
 
 
@@ -124,6 +133,36 @@ void ser_print_string
 /* ======================================================================== */
 void ser_print_hierarchy(FILE *f, ser_hier_t *node, int init, int indent);
 
+/* ======================================================================== */
+/*  SER_BIN_SIZE:    Size in bytes of a binary image, header included.      */
+/* ======================================================================== */
+uint_32 ser_bin_size(void);
+
+/* ======================================================================== */
+/*  SER_BIN_SCHEMA:  Hash of every object registered so far.                */
+/* ======================================================================== */
+uint_32 ser_bin_schema(void);
+
+/* ======================================================================== */
+/*  SER_BIN_ENCODE:  Write a binary image into 'buf'.  Returns its size,    */
+/*                   or -1 if 'len' is too small.                           */
+/* ======================================================================== */
+int ser_bin_encode(uint_8 *buf, uint_32 len);
+
+/* ======================================================================== */
+/*  SER_BIN_DECODE:  Load the objects from a binary image.  Returns 0 on    */
+/*                   success, or -1 if the image doesn't match this build   */
+/*                   or its configuration.  Nothing is loaded on failure.   */
+/* ======================================================================== */
+int ser_bin_decode(const uint_8 *buf, uint_32 len);
+
+/* ======================================================================== */
+/*  SER_BIN_WRITE:   Write a binary image to a file.                        */
+/*  SER_BIN_READ:    Read a binary image from a file and load it.           */
+/* ======================================================================== */
+int ser_bin_write(FILE *f);
+int ser_bin_read (FILE *f);
+
 
 #endif
 #endif
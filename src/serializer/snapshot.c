@@ -0,0 +1,420 @@
+/*
+ * ============================================================================
+ *  Title:    Machine Snapshots
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See snapshot.h.
+ *
+ *  The span directory is a flat array in registration order.  Spans are
+ *  registered during machine setup, so the order is fixed by cfg_init and
+ *  the same from run to run for the same configuration.  The directory
+ *  checksum covers each span's name and length in order.  Tracked spans
+ *  look the same as plain ones in the arena and the file.
+ *
+ *  Each take or restore bumps a generation count and stamps it on the
+ *  snapshot, so at most one snapshot is ever in sync.  Dirty bits are
+ *  cleared only after every span is copied, since two spans that share
+ *  a bitmap may also share a page.
+ *
+ *  File layout, all header fields little endian:
+ *
+ *      8 bytes     "jzIntvSS"
+ *      4 bytes     SNAP_VERSION
+ *      4 bytes     Number of spans
+ *      4 bytes     Arena size in bytes
+ *      4 bytes     Directory checksum
+ *      N bytes     Arena
+ * ============================================================================
+ */
+
+#include "config.h"
+#include "misc/crc32.h"
+#include "serializer/snapshot.h"
+
+#define SNAP_HDR_LEN    (24)
+
+LOCAL const char snap_magic[8] = { 'j','z','I','n','t','v','S','S' };
+
+typedef struct snap_span_t
+{
+    const char  *name;      /* Name of the device that owns the span.       */
+    uint_8      *data;      /* The live state.                              */
+    uint_32     len;        /* Length in bytes.                             */
+    uint_32     *dirty;     /* Dirty bitmap, or NULL if not tracked.        */
+    uint_32     first;      /* Tracked:  index of the first element.        */
+    uint_32     count;      /* Tracked:  number of elements.                */
+    uint_32     esize;      /* Tracked:  size of an element in bytes.       */
+    int         derived;    /* Left out of SNAP_HASH.                       */
+} snap_span_t;
+
+LOCAL snap_span_t   *snap_span     = NULL;
+LOCAL int           snap_num_span  = 0;
+LOCAL int           snap_max_span  = 0;
+LOCAL uint_32       snap_total     = 0;
+LOCAL uint_32       snap_dir_crc   = 0xFFFFFFFFU;
+LOCAL uint_32       snap_gen       = 0;
+
+/* ======================================================================== */
+/*  SNAP_REGISTER    -- Register a span of device state.                    */
+/* ======================================================================== */
+void snap_register(const char *name, void *span, uint_32 len)
+{
+    const char *s;
+
+    if (snap_num_span == snap_max_span)
+    {
+        snap_span_t *new_span;
+        int new_max = snap_max_span ? snap_max_span * 2 : 64;
+
+        new_span = (snap_span_t *)realloc(snap_span,
+                                          new_max * sizeof(snap_span_t));
+        if (!new_span)
+        {
+            fprintf(stderr, "snapshot:  Out of memory registering '%s'\n",
+                    name);
+            exit(1);
+        }
+        snap_span     = new_span;
+        snap_max_span = new_max;
+    }
+
+    snap_span[snap_num_span].name  = name;
+    snap_span[snap_num_span].data  = (uint_8 *)span;
+    snap_span[snap_num_span].len   = len;
+    snap_span[snap_num_span].dirty = NULL;
+    snap_span[snap_num_span].derived = 0;
+    snap_num_span++;
+    snap_total += len;
+
+    for (s = name; *s; s++)
+        snap_dir_crc = crc32_update(snap_dir_crc, (uint_8)*s);
+    snap_dir_crc = crc32_upd32(snap_dir_crc, len);
+}
+
+/* ======================================================================== */
+/*  SNAP_TRACK       -- Register a span with write tracking.                */
+/* ======================================================================== */
+void snap_track(const char *name, void *base, uint_32 first, uint_32 count,
+                uint_32 elem_size, uint_32 *dirty)
+{
+    snap_span_t *span;
+
+    snap_register(name, (uint_8 *)base + first * elem_size,
+                  count * elem_size);
+
+    span        = &snap_span[snap_num_span - 1];
+    span->dirty = dirty;
+    span->first = first;
+    span->count = count;
+    span->esize = elem_size;
+}
+
+/* ======================================================================== */
+/*  SNAP_DERIVED     -- Register a span that SNAP_HASH skips.               */
+/* ======================================================================== */
+void snap_derived(const char *name, void *span, uint_32 len)
+{
+    snap_register(name, span, len);
+    snap_span[snap_num_span - 1].derived = 1;
+}
+
+/* ======================================================================== */
+/*  SNAP_NEXT_GEN    -- Start a new generation.  Zero means "never."        */
+/* ======================================================================== */
+LOCAL uint_32 snap_next_gen(void)
+{
+    if (++snap_gen == 0)
+        snap_gen = 1;
+
+    return snap_gen;
+}
+
+/* ======================================================================== */
+/*  SNAP_COPY_DIRTY  -- Copy a tracked span's dirty pages to 'dst'.         */
+/* ======================================================================== */
+LOCAL void snap_copy_dirty(uint_8 *dst, const snap_span_t *span)
+{
+    uint_32 last = span->first + span->count - 1;
+    uint_32 pg, lo, hi, ofs;
+
+    for (pg = span->first >> 8; pg <= last >> 8; pg++)
+    {
+        if (span->dirty[pg >> 5] == 0)
+        {
+            pg |= 31;                   /* Skip the rest of a clean word.   */
+            continue;
+        }
+
+        if (((span->dirty[pg >> 5] >> (pg & 31)) & 1) == 0)
+            continue;
+
+        lo  = pg << 8          > span->first ? pg << 8          : span->first;
+        hi  = (pg << 8) + 255  < last        ? (pg << 8) + 255  : last;
+        ofs = (lo - span->first) * span->esize;
+
+        memcpy(dst + ofs, span->data + ofs, (hi - lo + 1) * span->esize);
+    }
+}
+
+/* ======================================================================== */
+/*  SNAP_CLEAN       -- Clear the dirty bits of every tracked span.         */
+/* ======================================================================== */
+LOCAL void snap_clean(void)
+{
+    uint_32 pg, last;
+    int i;
+
+    for (i = 0; i < snap_num_span; i++)
+    {
+        const snap_span_t *span = &snap_span[i];
+
+        if (!span->dirty)
+            continue;
+
+        last = span->first + span->count - 1;
+        for (pg = span->first >> 8; pg <= last >> 8; pg++)
+            span->dirty[pg >> 5] &= ~(1U << (pg & 31));
+    }
+}
+
+/* ======================================================================== */
+/*  SNAP_SIZE        -- Total bytes of registered state.                    */
+/* ======================================================================== */
+uint_32 snap_size(void)
+{
+    return snap_total;
+}
+
+/* ======================================================================== */
+/*  SNAP_CONFIG      -- Checksum of the span directory.                     */
+/* ======================================================================== */
+uint_32 snap_config(void)
+{
+    return snap_dir_crc;
+}
+
+/* ======================================================================== */
+/*  SNAP_HASH        -- Checksum of the live machine state.                 */
+/* ======================================================================== */
+uint_32 snap_hash(void)
+{
+    uint_32 crc = 0xFFFFFFFFU;
+    int i;
+
+    for (i = 0; i < snap_num_span; i++)
+        if (!snap_span[i].derived)
+            crc = crc32_block(crc, snap_span[i].data, snap_span[i].len);
+
+    return crc ^ 0xFFFFFFFFU;
+}
+
+/* ======================================================================== */
+/*  SNAP_INIT        -- Allocate an arena for the registered state.         */
+/* ======================================================================== */
+int snap_init(snap_t *snap)
+{
+    snap->size  = snap_total;
+    snap->gen   = 0;
+    snap->arena = CALLOC(uint_8, snap_total ? snap_total : 1);
+
+    if (!snap->arena)
+    {
+        fprintf(stderr, "snapshot:  Out of memory allocating %u bytes\n",
+                snap_total);
+        snap->size = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  SNAP_TAKE        -- Copy machine state into a snapshot.                 */
+/* ======================================================================== */
+int snap_take(snap_t *snap)
+{
+    uint_8 *dst = snap->arena;
+    int in_sync = snap->gen != 0 && snap->gen == snap_gen;
+    int i;
+
+    if (snap->size != snap_total)
+        return -1;
+
+    for (i = 0; i < snap_num_span; i++)
+    {
+        if (in_sync && snap_span[i].dirty)
+            snap_copy_dirty(dst, &snap_span[i]);
+        else
+            memcpy(dst, snap_span[i].data, snap_span[i].len);
+        dst += snap_span[i].len;
+    }
+
+    snap_clean();
+    snap->gen = snap_next_gen();
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  SNAP_RESTORE     -- Copy a snapshot back into the machine.              */
+/* ======================================================================== */
+int snap_restore(snap_t *snap)
+{
+    const uint_8 *src = snap->arena;
+    int i;
+
+    if (snap->size != snap_total)
+        return -1;
+
+    for (i = 0; i < snap_num_span; i++)
+    {
+        memcpy(snap_span[i].data, src, snap_span[i].len);
+        src += snap_span[i].len;
+    }
+
+    snap_clean();
+    snap->gen = snap_next_gen();
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  SNAP_PUT32 / SNAP_GET32  -- Little-endian header fields.                */
+/* ======================================================================== */
+LOCAL void snap_put32(uint_8 *p, uint_32 v)
+{
+    p[0] = v;   p[1] = v >> 8;  p[2] = v >> 16;  p[3] = v >> 24;
+}
+
+LOCAL uint_32 snap_get32(const uint_8 *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint_32)p[3] << 24);
+}
+
+/* ======================================================================== */
+/*  SNAP_SAVE        -- Write a snapshot to a file.                         */
+/* ======================================================================== */
+int snap_save(const snap_t *snap, const char *fname)
+{
+    uint_8 hdr[SNAP_HDR_LEN];
+    FILE *f;
+    int ok;
+
+    if (snap->size != snap_total)
+    {
+        fprintf(stderr, "snapshot:  Snapshot doesn't match this machine\n");
+        return -1;
+    }
+
+    memcpy(hdr, snap_magic, 8);
+    snap_put32(hdr +  8, SNAP_VERSION);
+    snap_put32(hdr + 12, snap_num_span);
+    snap_put32(hdr + 16, snap_total);
+    snap_put32(hdr + 20, snap_dir_crc);
+
+    if (!(f = fopen(fname, "wb")))
+    {
+        perror("fopen()");
+        fprintf(stderr, "snapshot:  Could not open '%s' for writing\n",
+                fname);
+        return -1;
+    }
+
+    ok = fwrite(hdr, 1, SNAP_HDR_LEN, f) == SNAP_HDR_LEN &&
+         fwrite(snap->arena, 1, snap->size, f) == snap->size;
+
+    if (fclose(f) != 0)
+        ok = 0;
+
+    if (!ok)
+    {
+        fprintf(stderr, "snapshot:  Error writing '%s'\n", fname);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  SNAP_LOAD        -- Read a snapshot from a file.                        */
+/* ======================================================================== */
+int snap_load(snap_t *snap, const char *fname)
+{
+    uint_8 hdr[SNAP_HDR_LEN];
+    FILE *f;
+    uint_32 size;
+
+    if (!(f = fopen(fname, "rb")))
+    {
+        perror("fopen()");
+        fprintf(stderr, "snapshot:  Could not open '%s' for reading\n",
+                fname);
+        return -1;
+    }
+
+    if (fread(hdr, 1, SNAP_HDR_LEN, f) != SNAP_HDR_LEN ||
+        memcmp(hdr, snap_magic, 8) != 0)
+    {
+        fprintf(stderr, "snapshot:  '%s' is not a jzIntv snapshot\n", fname);
+        goto fail;
+    }
+
+    if (snap_get32(hdr + 8) != SNAP_VERSION)
+    {
+        fprintf(stderr, "snapshot:  '%s' is version %u; expected %d\n",
+                fname, snap_get32(hdr + 8), SNAP_VERSION);
+        goto fail;
+    }
+
+    size = snap_get32(hdr + 16);
+    if (snap_get32(hdr + 12) != (uint_32)snap_num_span ||
+        size != snap_total || size != snap->size ||
+        snap_get32(hdr + 20) != snap_dir_crc)
+    {
+        fprintf(stderr, "snapshot:  '%s' was saved from a different "
+                        "machine configuration\n", fname);
+        goto fail;
+    }
+
+    snap->gen = 0;
+    if (fread(snap->arena, 1, size, f) != size)
+    {
+        fprintf(stderr, "snapshot:  '%s' is truncated\n", fname);
+        goto fail;
+    }
+
+    fclose(f);
+    return 0;
+
+fail:
+    fclose(f);
+    return -1;
+}
+
+/* ======================================================================== */
+/*  SNAP_DTOR        -- Free a snapshot's arena.                            */
+/* ======================================================================== */
+void snap_dtor(snap_t *snap)
+{
+    CONDFREE(snap->arena);
+    snap->size = 0;
+    snap->gen  = 0;
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,174 @@
+/*
+ * ============================================================================
+ *  Title:    Machine Snapshots
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  A snapshot is a copy of every piece of machine state, taken with a
+ *  handful of memcpy()s.  Each device registers the spans of its state
+ *  structure that hold plain data -- no pointers -- from its ser_init
+ *  hook, and the snapshot engine lays the spans end to end in one flat
+ *  arena.  Taking a snapshot copies each span into the arena; restoring
+ *  one copies them back.
+ *
+ *  Saving to a file writes a short header followed by the arena in one
+ *  fwrite().  The header carries a version number and a checksum of the
+ *  span directory (names and lengths), so a file from a different build
+ *  or a different machine configuration is refused rather than loaded
+ *  into the wrong places.  The arena is in host byte order.
+ *
+ *  All spans must be registered before the first SNAP_INIT.  After a
+ *  restore, the caller still has to resync anything derived from the
+ *  state, such as the CPU's decode cache and the display.
+ *
+ *  Large memories register with SNAP_TRACK instead, handing over a dirty
+ *  bitmap with one bit per 256-element page.  The device's write paths
+ *  set the bit with SNAP_DIRTY.  A snapshot that was the last one taken
+ *  or restored only needs the pages written since then, so taking it
+ *  again copies just those.  Any other snapshot gets a full copy.  The
+ *  engine clears the bits after each take and restore.
+ *
+ *  State that is only derived from the rest, such as rendered display
+ *  lists, or that depends on the host, such as frame-drop counters,
+ *  registers with SNAP_DERIVED instead.  It is saved and restored like
+ *  any other span, but SNAP_HASH leaves it out, so two runs that agree on
+ *  the machine state hash the same even on hosts of different speeds.
+ *
+ *  SNAP_REGISTER    -- Register a span of device state.
+ *  SNAP_TRACK       -- Register a span with write tracking.
+ *  SNAP_DERIVED     -- Register a span that SNAP_HASH skips.
+ *  SNAP_SIZE        -- Total bytes of registered state.
+ *  SNAP_CONFIG      -- Checksum of the span directory.
+ *  SNAP_HASH        -- Checksum of the live machine state.
+ *  SNAP_INIT        -- Allocate an arena for the registered state.
+ *  SNAP_TAKE        -- Copy machine state into a snapshot.
+ *  SNAP_RESTORE     -- Copy a snapshot back into the machine.
+ *  SNAP_SAVE        -- Write a snapshot to a file.
+ *  SNAP_LOAD        -- Read a snapshot from a file.
+ *  SNAP_DTOR        -- Free a snapshot's arena.
+ * ============================================================================
+ */
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#define SNAP_VERSION    (1)
+
+typedef struct snap_t
+{
+    uint_8      *arena;     /* Every registered span, back to back.         */
+    uint_32     size;       /* Size of the arena in bytes.                  */
+    uint_32     gen;        /* Matches the engine's if in sync with the     */
+                            /* machine.  Zero it after editing the arena.   */
+} snap_t;
+
+/* ======================================================================== */
+/*  SNAP_REGISTER    -- Register a span of device state.  'name' must       */
+/*                      outlive the registration; a periph's name will do.  */
+/* ======================================================================== */
+void snap_register(const char *name, void *span, uint_32 len);
+
+/* ======================================================================== */
+/*  SNAP_FIELDS      -- Register the fields 'first' through 'last' of       */
+/*                      structure 's', of type 'type', as one span.         */
+/* ======================================================================== */
+#define SNAP_FIELDS(name, s, type, first, last)                             \
+    snap_register((name), &(s)->first,                                      \
+                  offsetof(type, last) + sizeof((s)->last)                  \
+                  - offsetof(type, first))
+
+/* ======================================================================== */
+/*  SNAP_TRACK       -- Register elements 'first' through 'first+count-1'   */
+/*                      of array 'base' as a span, with writes tracked in   */
+/*                      'dirty'.  The bitmap covers 'base' from element 0,  */
+/*                      so several spans of one array can share it.         */
+/* ======================================================================== */
+void snap_track(const char *name, void *base, uint_32 first, uint_32 count,
+                uint_32 elem_size, uint_32 *dirty);
+
+/* ======================================================================== */
+/*  SNAP_DERIVED     -- Register a span that is saved and restored, but not */
+/*                      covered by SNAP_HASH.                               */
+/*  SNAP_DERIVED_FIELDS -- Like SNAP_FIELDS, for SNAP_DERIVED.              */
+/* ======================================================================== */
+void snap_derived(const char *name, void *span, uint_32 len);
+
+#define SNAP_DERIVED_FIELDS(name, s, type, first, last)                     \
+    snap_derived((name), &(s)->first,                                       \
+                 offsetof(type, last) + sizeof((s)->last)                   \
+                 - offsetof(type, first))
+
+/* ======================================================================== */
+/*  SNAP_DIRTY_WORDS -- Size of a dirty bitmap for 'n' elements.            */
+/*  SNAP_DIRTY       -- Mark element 'i' written.                           */
+/* ======================================================================== */
+#define SNAP_DIRTY_WORDS(n) (((n) + 8191) >> 13)
+#define SNAP_DIRTY(d, i)    ((d)[(i) >> 13] |= 1U << (((i) >> 8) & 31))
+
+/* ======================================================================== */
+/*  SNAP_SIZE        -- Total bytes of registered state.                    */
+/* ======================================================================== */
+uint_32 snap_size(void);
+
+/* ======================================================================== */
+/*  SNAP_CONFIG      -- Checksum of the span directory.  Two machines with  */
+/*                      the same value can exchange snapshots.              */
+/* ======================================================================== */
+uint_32 snap_config(void);
+
+/* ======================================================================== */
+/*  SNAP_HASH        -- CRC-32 of every span except derived ones, read      */
+/*                      straight from the machine.                          */
+/* ======================================================================== */
+uint_32 snap_hash(void);
+
+/* ======================================================================== */
+/*  SNAP_INIT        -- Allocate an arena for the registered state.         */
+/* ======================================================================== */
+int snap_init(snap_t *snap);
+
+/* ======================================================================== */
+/*  SNAP_TAKE        -- Copy machine state into a snapshot.  Only dirty     */
+/*                      pages are copied if 'snap' is in sync.              */
+/* ======================================================================== */
+int snap_take(snap_t *snap);
+
+/* ======================================================================== */
+/*  SNAP_RESTORE     -- Copy a snapshot back into the machine.  Afterward,  */
+/*                      'snap' is the one in sync.                          */
+/* ======================================================================== */
+int snap_restore(snap_t *snap);
+
+/* ======================================================================== */
+/*  SNAP_SAVE        -- Write a snapshot to a file.                         */
+/* ======================================================================== */
+int snap_save(const snap_t *snap, const char *fname);
+
+/* ======================================================================== */
+/*  SNAP_LOAD        -- Read a snapshot from a file.  The snapshot must     */
+/*                      already be initialized.  A file whose header does   */
+/*                      not match is refused before anything is read.       */
+/* ======================================================================== */
+int snap_load(snap_t *snap, const char *fname);
+
+/* ======================================================================== */
+/*  SNAP_DTOR        -- Free a snapshot's arena.                            */
+/* ======================================================================== */
+void snap_dtor(snap_t *snap);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
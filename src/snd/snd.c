@@ -10,6 +10,7 @@
  *  SND_FILL     -- Audio callback used by SDL for filling SDL's buffers.
  *  SND_REGISTER -- Registers a PSG with the SND module.
  *  SND_INIT     -- Initialize a SND_T
+ *  SND_INIT_NULL -- Initialize a SND_T with no audio device.
  * ============================================================================
  */
 
@@ -18,6 +19,7 @@
 #include "config.h"
 #include "periph/periph.h"
 #include "snd.h"
+#include "wavwrite.h"
 #ifdef GCWZERO
 #include "jzintv.h"
 #endif
@@ -34,82 +36,6 @@ typedef struct snd_pvt_t
 } snd_pvt_t;
 
 
-/* ======================================================================== */
-/*  WAV header.                                                             */
-/* ======================================================================== */
-LOCAL const uint_8 snd_wav_hdr[44] =
-{
-    0x52, 0x49, 0x46, 0x46, /*  0  "RIFF"                                   */
-    0x00, 0x00, 0x00, 0x00, /*  4  Total file length - 8                    */
-    0x57, 0x41, 0x56, 0x45, /*  8  "WAVE"                                   */
-    0x66, 0x6D, 0x74, 0x20, /* 12  "fmt "                                   */
-    0x10, 0x00, 0x00, 0x00, /* 16  0x10 == PCM                              */
-    0x01, 0x00,             /* 20  0x01 == PCM                              */
-    0x01, 0x00,             /* 22  1 channel                                */
-    0x00, 0x00, 0x00, 0x00, /* 24  Sample rate                              */
-    0x00, 0x00, 0x00, 0x00, /* 28  Byte rate:  sample rate * block align    */
-    0x02, 0x00,             /* 30  Block align:  channels * bits/sample / 8 */
-    0x10, 0x00,             /* 32  Bits/sample = 16.                        */
-    0x64, 0x61, 0x74, 0x61, /* 36  "data"                                   */
-    0x00, 0x00, 0x00, 0x00  /* 40  Total sample data length                 */
-};
-
-/* ======================================================================== */
-/*  SND_UPDATE_WAV_HDR -- Keep the WAV header up to date.  Stupid format.   */
-/* ======================================================================== */
-LOCAL void snd_update_wav_hdr(FILE *f, int rate)
-{
-    long    filepos;
-    uint_32 tot_smp_bytes, tot_file_bytes;
-    uint_8  upd_wav_hdr[44];
-
-    /* -------------------------------------------------------------------- */
-    /*  Poke the size information into the header both places it appears.   */
-    /*  Do this to a private copy of the header.                            */
-    /* -------------------------------------------------------------------- */
-    memcpy(upd_wav_hdr, snd_wav_hdr, 44);
-
-    filepos = ftell(f);
-    if (filepos < 0)      /* do nothing if ftell() failed. */
-        return;
-
-    tot_smp_bytes  = filepos > 44 ? filepos - 44 : 0;
-    tot_file_bytes = filepos >  8 ? filepos -  8 : 0;
-
-    /* Total file size, minus first 8 bytes */
-    upd_wav_hdr[ 4] = (tot_file_bytes >>  0) & 0xFF;
-    upd_wav_hdr[ 5] = (tot_file_bytes >>  8) & 0xFF;
-    upd_wav_hdr[ 6] = (tot_file_bytes >> 16) & 0xFF;
-    upd_wav_hdr[ 7] = (tot_file_bytes >> 24) & 0xFF;
-
-    /* Total size of sample-data payload */
-    upd_wav_hdr[40] = (tot_smp_bytes  >>  0) & 0xFF;
-    upd_wav_hdr[41] = (tot_smp_bytes  >>  8) & 0xFF;
-    upd_wav_hdr[42] = (tot_smp_bytes  >> 16) & 0xFF;
-    upd_wav_hdr[43] = (tot_smp_bytes  >> 24) & 0xFF;
-
-    /* Poke in the sample rate / byte rate too */
-    upd_wav_hdr[24] = (rate           >>  0) & 0xFF;
-    upd_wav_hdr[25] = (rate           >>  8) & 0xFF;
-    upd_wav_hdr[26] = (rate           >> 16) & 0xFF;
-    upd_wav_hdr[27] = (rate           >> 24) & 0xFF;
-    upd_wav_hdr[28] = (rate * 2       >>  0) & 0xFF;
-    upd_wav_hdr[29] = (rate * 2       >>  8) & 0xFF;
-    upd_wav_hdr[30] = (rate * 2       >> 16) & 0xFF;
-    upd_wav_hdr[31] = (rate * 2       >> 24) & 0xFF;
-
-    /* -------------------------------------------------------------------- */
-    /*  Rewind to the beginning of the file to write the header.  Skip      */
-    /*  it if the seek fails for some reason.                               */
-    /* -------------------------------------------------------------------- */
-    if (fseek(f, 0, SEEK_SET) == 0)
-    {
-        fwrite(upd_wav_hdr, 44, 1, f);
-        fseek(f,  0, SEEK_END);
-    }
-}
-
-
 /*
  * ============================================================================
  *  SND_TICK     -- Update state of the sound universe.  Drains audio data
@@ -304,8 +230,7 @@ one_source:
         /* ---------------------------------------------------------------- */
         if (snd->raw_file && not_silent)
         {
-            fwrite(clean, sizeof(sint_16), snd->buf_size,
-                    snd->raw_file);
+            wavw_write(snd->raw_file, clean, snd->buf_size);
             snd->raw_start = 1;
         }
 
@@ -362,12 +287,6 @@ one_source:
     else
         len = new_now - snd->periph.now;
 
-    /* -------------------------------------------------------------------- */
-    /*  If we're writing a sound sample file, update the file length.       */
-    /* -------------------------------------------------------------------- */
-    if (snd->raw_file && not_silent)
-        snd_update_wav_hdr(snd->raw_file, snd->rate);
-
     return len;
 }
 
@@ -539,6 +458,57 @@ LOCAL const char *snd_fmt_name(uint_16 fmt)
 
 LOCAL void snd_dtor(periph_p p);
 
+/* ======================================================================== */
+/*  SND_SETUP_MIX -- Set up SND as a peripheral, along with its mix         */
+/*                   buffers.  Expects buf_size, buf_cnt and rate to be     */
+/*                   filled in already.                                     */
+/* ======================================================================== */
+LOCAL int snd_setup_mix(snd_t *snd, int rate)
+{
+    int i;
+
+    snd->atten            = 0;
+
+    /* -------------------------------------------------------------------- */
+    /*  Set up SND as a peripheral.                                         */
+    /* -------------------------------------------------------------------- */
+    snd->periph.read      = NULL;
+    snd->periph.write     = NULL;
+    snd->periph.peek      = NULL;
+    snd->periph.poke      = NULL;
+    snd->periph.tick      = snd_tick;
+    snd->periph.min_tick  = snd->buf_size * 894886 / (2*rate);
+    snd->periph.max_tick  = snd->periph.min_tick * 3;
+    snd->periph.addr_base = ~0U;
+    snd->periph.addr_mask = ~0U;
+    snd->periph.dtor      = snd_dtor;
+
+    /* -------------------------------------------------------------------- */
+    /*  Set up our mix buffers as 'clean'.                                  */
+    /* -------------------------------------------------------------------- */
+    snd->mixbuf.tot_buf   = snd->buf_cnt;
+    snd->mixbuf.num_clean = snd->buf_cnt;
+    snd->mixbuf.num_dirty = 0;
+    snd->mixbuf.buf   = CALLOC(sint_16,   snd->buf_size * snd->mixbuf.num_clean);
+    snd->mixbuf.clean = CALLOC(sint_16 *, snd->mixbuf.num_clean);
+    snd->mixbuf.dirty = CALLOC(sint_16 *, snd->mixbuf.num_clean);
+
+    if (mixbuf) free(mixbuf);
+    mixbuf            = CALLOC(sint_32,   snd->buf_size);
+
+    if (!snd->mixbuf.buf || !snd->mixbuf.clean || !snd->mixbuf.dirty || !mixbuf)
+    {
+        fprintf(stderr, "snd_init: Out of memory allocating mixbuf.\n");
+        return -1;
+    }
+
+    for (i = 0; i < snd->mixbuf.num_clean; i++)
+        snd->mixbuf.clean[i] = snd->mixbuf.buf + i * snd->buf_size;
+
+    return 0;
+}
+
+
 /*
  * ============================================================================
  *  SND_INIT     -- Initialize a SND_T
@@ -547,7 +517,6 @@ LOCAL void snd_dtor(periph_p p);
 int snd_init(snd_t *snd, int rate, char *raw_file,
              int user_snd_buf_size, int user_snd_buf_cnt)
 {
-    int i;
     SDL_AudioSpec *wanted = NULL, *actual = NULL;
     SDL_AudioCVT  *audio_cvt = NULL;
     uint_8        *cvt_buf   = NULL;
@@ -673,57 +642,33 @@ int snd_init(snd_t *snd, int rate, char *raw_file,
     /* -------------------------------------------------------------------- */
     snd->buf_size         = actual->samples;
     snd->rate             = actual->freq;
-    snd->atten            = 0;
 
-    /* -------------------------------------------------------------------- */
-    /*  Set up SND as a peripheral.                                         */
-    /* -------------------------------------------------------------------- */
-    snd->periph.read      = NULL;
-    snd->periph.write     = NULL;
-    snd->periph.peek      = NULL;
-    snd->periph.poke      = NULL;
-    snd->periph.tick      = snd_tick;
-    snd->periph.min_tick  = snd->buf_size * 894886 / (2*rate);
-    snd->periph.max_tick  = snd->periph.min_tick * 3;
-    snd->periph.addr_base = ~0U;
-    snd->periph.addr_mask = ~0U;
-    snd->periph.dtor      = snd_dtor;
-
-    /* -------------------------------------------------------------------- */
-    /*  Set up our mix buffers as 'clean'.                                  */
-    /* -------------------------------------------------------------------- */
-    snd->mixbuf.tot_buf   = snd->buf_cnt;
-    snd->mixbuf.num_clean = snd->buf_cnt;
-    snd->mixbuf.num_dirty = 0;
-    snd->mixbuf.buf   = CALLOC(sint_16,   snd->buf_size * snd->mixbuf.num_clean);
-    snd->mixbuf.clean = CALLOC(sint_16 *, snd->mixbuf.num_clean);
-    snd->mixbuf.dirty = CALLOC(sint_16 *, snd->mixbuf.num_clean);
-
-    if (mixbuf) free(mixbuf);
-    mixbuf            = CALLOC(sint_32,   snd->buf_size);
-
-    if (!snd->mixbuf.buf || !snd->mixbuf.clean || !snd->mixbuf.dirty || !mixbuf)
-    {
-        fprintf(stderr, "snd_init: Out of memory allocating mixbuf.\n");
+    if (snd_setup_mix(snd, rate))
         goto fail;
-    }
-
-    for (i = 0; i < snd->mixbuf.num_clean; i++)
-        snd->mixbuf.clean[i] = snd->mixbuf.buf + i * snd->buf_size;
 
     /* -------------------------------------------------------------------- */
     /*  If the user is dumping audio to a raw-audio file, open 'er up.      */
     /* -------------------------------------------------------------------- */
     if (raw_file)
     {
-        snd->raw_file = fopen(raw_file, "wb");
-        if (!snd->raw_file)
+        FILE *f = fopen(raw_file, "wb");
+        if (!f)
         {
             fprintf(stderr,"snd:  Error opening '%s' for writing.\n",raw_file);
             perror("fopen");
             goto fail;
         }
-        snd_update_wav_hdr(snd->raw_file, snd->rate);
+
+        /* ---------------------------------------------------------------- */
+        /*  The writer thread owns the file from here, and keeps the WAV    */
+        /*  header up to date.                                              */
+        /* ---------------------------------------------------------------- */
+        if (!(snd->raw_file = wavw_create()))
+        {
+            fclose(f);
+            goto fail;
+        }
+        wavw_begin(snd->raw_file, f, snd->rate);
         return 0;
     }
 
@@ -750,6 +695,40 @@ fail:
     return -1;
 }
 
+/*
+ * ============================================================================
+ *  SND_INIT_NULL -- Initialize a SND_T with no audio device behind it.
+ *                   Mixing works as usual; the caller drains the mix
+ *                   buffers itself by calling SND_FILL.
+ * ============================================================================
+ */
+int snd_init_null(snd_t *snd, int rate,
+                  int user_snd_buf_size, int user_snd_buf_cnt)
+{
+    memset(snd, 0, sizeof(snd_t));
+    if (!(snd->pvt = CALLOC(snd_pvt_t, 1)))
+    {
+        fprintf(stderr, "snd_init: Out of memory allocating snd_pvt_t.\n");
+        return -1;
+    }
+
+    snd->buf_size = user_snd_buf_size > 0 ? user_snd_buf_size
+                  :                         SND_BUF_SIZE_DEFAULT;
+
+    snd->buf_cnt  = user_snd_buf_cnt  > 0 ? user_snd_buf_cnt
+                  :                         SND_BUF_CNT_DEFAULT;
+
+    snd->rate     = rate;
+
+    if (snd_setup_mix(snd, rate))
+    {
+        snd_dtor(&snd->periph);
+        return -1;
+    }
+
+    return 0;
+}
+
 /* ======================================================================== */
 /*  SND_DTOR     -- Tear down the sound device.                             */
 /* ======================================================================== */
@@ -761,6 +740,13 @@ LOCAL void snd_dtor(periph_p p)
 
     SDL_CloseAudio();
     CONDFREE(mixbuf);
+
+    if (snd->raw_file)
+    {
+        wavw_destroy(snd->raw_file);
+        snd->raw_file = NULL;
+    }
+
     CONDFREE(snd->mixbuf.buf);
     CONDFREE(snd->mixbuf.clean);
     CONDFREE(snd->mixbuf.dirty);
@@ -11,6 +11,7 @@
  *  SND_FILL     -- Audio callback used by SDL for filling SDL's buffers.
  *  SND_REGISTER -- Registers a PSG with the SND module.
  *  SND_INIT     -- Initialize a SND_T
+ *  SND_INIT_NULL -- Initialize a SND_T with no audio device.
  * ============================================================================
  */
 #ifndef _SND_H_
@@ -62,7 +63,7 @@ typedef struct snd_t
     v_uint_32   change_vol;     /* Requests to change volume            */
     int         atten;          /* Attenuation. 0=full blast, 16=mute   */
 
-    FILE        *raw_file;      /* Raw audio data dump file.            */
+    struct wavw_t *raw_file;    /* Writer for audio dump file.          */
     int         raw_start;      /* FLAG: To suppress silence @ start    */
 
     int         buf_size;
@@ -103,6 +104,14 @@ int     snd_register(periph_p snd, snd_buf_t *src);
 int     snd_init(snd_t *snd, int rate, char *raw_file,
                  int user_snd_buf_size, int user_snd_buf_cnt);
 
+/*
+ * ============================================================================
+ *  SND_INIT_NULL -- Initialize a SND_T with no audio device behind it.
+ * ============================================================================
+ */
+int     snd_init_null(snd_t *snd, int rate,
+                      int user_snd_buf_size, int user_snd_buf_cnt);
+
 
 #endif
 /* ======================================================================== */
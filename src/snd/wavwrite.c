@@ -0,0 +1,445 @@
+/*
+ * ============================================================================
+ *  Title:    Background WAV Writer
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  See wavwrite.h.
+ *
+ *  The ring holds little-endian sample bytes.  'head' and 'tail' count
+ *  bytes written and drained since the writer started, and wrap freely;
+ *  only their difference matters.  The emulator advances 'head', the
+ *  thread advances 'tail', both under 'lock'.  Neither holds the lock
+ *  while copying or writing:  the span between 'tail' and 'head' belongs
+ *  to the thread, and the rest of the ring belongs to the emulator.
+ *
+ *  Begin and end requests go on a small command queue, each tagged with
+ *  the value of 'head' when it was made.  The thread drains the ring up
+ *  to a command's tag before acting on the command, so data always lands
+ *  in the file that was current when it was written.
+ * ============================================================================
+ */
+
+#include "sdl.h"
+#include "config.h"
+#include "snd/wavwrite.h"
+
+#define WAVW_RING_SIZE  (1 << 20)   /* Ring size in bytes.  Power of 2.     */
+#define WAVW_RING_MASK  (WAVW_RING_SIZE - 1)
+#define WAVW_BATCH      (1 << 16)   /* Wake thread at this many bytes.      */
+#define WAVW_FLUSH_MS   (250)       /* ...or after this many milliseconds.  */
+#define WAVW_MAX_CMD    (16)        /* Depth of the command queue.          */
+
+typedef struct wavw_cmd_t
+{
+    uint_32     pos;        /* Value of 'head' when command was queued.     */
+    FILE        *file;      /* Begin:  File to start.  NULL:  End.          */
+    int         rate;       /* Begin:  Sample rate for header.              */
+    char        *unlink;    /* End:  File name to delete after close.       */
+} wavw_cmd_t;
+
+struct wavw_t
+{
+    uint_8      *ring;      /* Sample data, little endian.                  */
+    uint_32     head;       /* Bytes written by emulator.                   */
+    uint_32     tail;       /* Bytes drained by thread.                     */
+    wavw_cmd_t  cmd[WAVW_MAX_CMD];
+    int         cmd_head;   /* Commands queued by emulator.                 */
+    int         cmd_tail;   /* Commands completed by thread.                */
+    int         quit;       /* Request for thread to exit.                  */
+    int         stalls;     /* Number of times the emulator had to wait.    */
+
+    SDL_mutex   *lock;      /* Guards all of the above.                     */
+    SDL_cond    *wake;      /* Signals thread that there's work.            */
+    SDL_cond    *room;      /* Signals emulator that there's room.          */
+    SDL_Thread  *thread;
+
+    FILE        *file;      /* Thread only:  Current output file.           */
+    int         rate;       /* Thread only:  Its sample rate.               */
+    uint_32     bytes;      /* Thread only:  Sample bytes written to it.    */
+
+    wavw_t      *next;      /* List of live writers, for wavw_atexit.       */
+};
+
+LOCAL wavw_t *wavw_live = NULL;
+LOCAL int     wavw_atexit_set = 0;
+
+/* ======================================================================== */
+/*  WAV header.                                                             */
+/* ======================================================================== */
+LOCAL const uint_8 wavw_hdr[44] =
+{
+    0x52, 0x49, 0x46, 0x46, /*  0  "RIFF"                                   */
+    0x00, 0x00, 0x00, 0x00, /*  4  Total file length - 8                    */
+    0x57, 0x41, 0x56, 0x45, /*  8  "WAVE"                                   */
+    0x66, 0x6D, 0x74, 0x20, /* 12  "fmt "                                   */
+    0x10, 0x00, 0x00, 0x00, /* 16  0x10 == PCM                              */
+    0x01, 0x00,             /* 20  0x01 == PCM                              */
+    0x01, 0x00,             /* 22  1 channel                                */
+    0x00, 0x00, 0x00, 0x00, /* 24  Sample rate                              */
+    0x00, 0x00, 0x00, 0x00, /* 28  Byte rate:  sample rate * block align    */
+    0x02, 0x00,             /* 30  Block align:  channels * bits/sample / 8 */
+    0x10, 0x00,             /* 32  Bits/sample = 16.                        */
+    0x64, 0x61, 0x74, 0x61, /* 36  "data"                                   */
+    0x00, 0x00, 0x00, 0x00  /* 40  Total sample data length                 */
+};
+
+/* ======================================================================== */
+/*  WAVW_PUT_HDR -- Write the header for the current file.  If 'rewind',    */
+/*                  seek to the front first and come back afterwards.       */
+/* ======================================================================== */
+LOCAL void wavw_put_hdr(wavw_t *w, int rewind)
+{
+    uint_8  hdr[44];
+    uint_32 tot_smp_bytes  = w->bytes;
+    uint_32 tot_file_bytes = w->bytes + 36;
+    uint_32 rate           = w->rate;
+    int     i;
+
+    memcpy(hdr, wavw_hdr, 44);
+
+    for (i = 0; i < 4; i++)
+    {
+        hdr[ 4 + i] = (tot_file_bytes >> (8 * i)) & 0xFF;
+        hdr[24 + i] = (rate           >> (8 * i)) & 0xFF;
+        hdr[28 + i] = (rate * 2       >> (8 * i)) & 0xFF;
+        hdr[40 + i] = (tot_smp_bytes  >> (8 * i)) & 0xFF;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Skip the update if the seek fails, e.g. if we're writing to a pipe. */
+    /* -------------------------------------------------------------------- */
+    if (rewind && fseek(w->file, 0, SEEK_SET) != 0)
+        return;
+
+    fwrite(hdr, 44, 1, w->file);
+
+    if (rewind)
+        fseek(w->file, 0, SEEK_END);
+}
+
+/* ======================================================================== */
+/*  WAVW_DRAIN   -- Write ring bytes [tail, end) to the current file.       */
+/*                  At most two write calls, one per side of the wrap.      */
+/* ======================================================================== */
+LOCAL void wavw_drain(wavw_t *w, uint_32 tail, uint_32 end)
+{
+    while (tail != end && w->file)
+    {
+        uint_32 ofs = tail & WAVW_RING_MASK;
+        uint_32 len = end - tail;
+
+        if (len > WAVW_RING_SIZE - ofs)
+            len = WAVW_RING_SIZE - ofs;
+
+        if (fwrite(w->ring + ofs, 1, len, w->file) != len)
+        {
+            perror("fwrite()");
+            fprintf(stderr, "wavw:  Write failed.  Abandoning file.\n");
+            fclose(w->file);
+            w->file = NULL;
+            return;
+        }
+
+        w->bytes += len;
+        tail     += len;
+    }
+}
+
+/* ======================================================================== */
+/*  WAVW_CLOSE   -- Fix up the header on the current file and close it.     */
+/* ======================================================================== */
+LOCAL void wavw_close(wavw_t *w)
+{
+    if (!w->file)
+        return;
+
+    wavw_put_hdr(w, 1);
+    fclose(w->file);
+    w->file = NULL;
+}
+
+/* ======================================================================== */
+/*  WAVW_THREAD  -- Drain the ring and carry out commands until told to     */
+/*                  quit and there's nothing left to do.                    */
+/* ======================================================================== */
+LOCAL int wavw_thread(void *opaque)
+{
+    wavw_t *w = (wavw_t *)opaque;
+
+    SDL_LockMutex(w->lock);
+    for (;;)
+    {
+        wavw_cmd_t *cmd = NULL;
+        uint_32 tail, end;
+        int idle;
+
+        /* ---------------------------------------------------------------- */
+        /*  Sleep until there's a command, a full batch, or a timeout.      */
+        /*  Waking on the timeout keeps a trickle of data from sitting in   */
+        /*  the ring indefinitely.                                          */
+        /* ---------------------------------------------------------------- */
+        while (!w->quit && w->cmd_head == w->cmd_tail &&
+               w->head - w->tail < WAVW_BATCH)
+        {
+            if (SDL_CondWaitTimeout(w->wake, w->lock, WAVW_FLUSH_MS) ==
+                    SDL_MUTEX_TIMEDOUT)
+                break;
+        }
+
+        if (w->cmd_head != w->cmd_tail)
+        {
+            cmd = &w->cmd[w->cmd_tail % WAVW_MAX_CMD];
+            end = cmd->pos;
+        } else
+            end = w->head;
+
+        tail = w->tail;
+        idle = !cmd && tail == end;
+
+        if (idle && w->quit)
+            break;
+
+        SDL_UnlockMutex(w->lock);
+
+        /* ---------------------------------------------------------------- */
+        /*  Write out the data, then act on the command if there is one.    */
+        /*  Otherwise refresh the header, so a file left behind by a crash  */
+        /*  is still playable up to the last batch.                         */
+        /* ---------------------------------------------------------------- */
+        wavw_drain(w, tail, end);
+
+        if (cmd)
+        {
+            wavw_close(w);
+
+            if (cmd->file)
+            {
+                w->file  = cmd->file;
+                w->rate  = cmd->rate;
+                w->bytes = 0;
+                setvbuf(w->file, NULL, _IONBF, 0);
+                wavw_put_hdr(w, 0);
+            }
+
+            if (cmd->unlink)
+            {
+                unlink(cmd->unlink);
+                free(cmd->unlink);
+            }
+        } else if (!idle && w->file)
+            wavw_put_hdr(w, 1);
+
+        SDL_LockMutex(w->lock);
+        w->tail = end;
+        if (cmd)
+            w->cmd_tail++;
+        SDL_CondBroadcast(w->room);
+    }
+    SDL_UnlockMutex(w->lock);
+
+    wavw_close(w);
+    return 0;
+}
+
+/* ======================================================================== */
+/*  WAVW_ATEXIT  -- Flush any writers still open when we exit, so that      */
+/*                  early exits don't lose the tail of the recording.       */
+/* ======================================================================== */
+LOCAL void wavw_atexit(void)
+{
+    while (wavw_live)
+        wavw_destroy(wavw_live);
+}
+
+/* ======================================================================== */
+/*  WAVW_CREATE  -- Create a writer and start its thread.                   */
+/* ======================================================================== */
+wavw_t *wavw_create(void)
+{
+    wavw_t *w = CALLOC(wavw_t, 1);
+
+    if (!w)
+        goto fail;
+
+    w->ring = CALLOC(uint_8, WAVW_RING_SIZE);
+    w->lock = SDL_CreateMutex();
+    w->wake = SDL_CreateCond();
+    w->room = SDL_CreateCond();
+
+    if (!w->ring || !w->lock || !w->wake || !w->room)
+        goto fail;
+
+    if (!(w->thread = SDL_CreateThread(wavw_thread, (void *)w)))
+        goto fail;
+
+    w->next   = wavw_live;
+    wavw_live = w;
+
+    if (!wavw_atexit_set)
+    {
+        atexit(wavw_atexit);
+        wavw_atexit_set = 1;
+    }
+
+    return w;
+
+fail:
+    fprintf(stderr, "wavw:  Could not start writer thread.\n");
+    if (w)
+    {
+        if (w->room) SDL_DestroyCond(w->room);
+        if (w->wake) SDL_DestroyCond(w->wake);
+        if (w->lock) SDL_DestroyMutex(w->lock);
+        CONDFREE(w->ring);
+        free(w);
+    }
+    return NULL;
+}
+
+/* ======================================================================== */
+/*  WAVW_QUEUE   -- Put a command on the queue, waiting for room.           */
+/* ======================================================================== */
+LOCAL int wavw_queue(wavw_t *w, FILE *f, int rate, const char *unlink_name)
+{
+    wavw_cmd_t *cmd;
+    char *name = NULL;
+
+    if (unlink_name && !(name = strdup(unlink_name)))
+        return -1;
+
+    SDL_LockMutex(w->lock);
+    while (w->cmd_head - w->cmd_tail >= WAVW_MAX_CMD)
+    {
+        w->stalls++;
+        SDL_CondSignal(w->wake);
+        SDL_CondWait(w->room, w->lock);
+    }
+
+    cmd = &w->cmd[w->cmd_head % WAVW_MAX_CMD];
+    cmd->pos    = w->head;
+    cmd->file   = f;
+    cmd->rate   = rate;
+    cmd->unlink = name;
+    w->cmd_head++;
+
+    SDL_CondSignal(w->wake);
+    SDL_UnlockMutex(w->lock);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  WAVW_BEGIN   -- Hand an open file to the writer.                        */
+/* ======================================================================== */
+int wavw_begin(wavw_t *w, FILE *f, int rate)
+{
+    return wavw_queue(w, f, rate, NULL);
+}
+
+/* ======================================================================== */
+/*  WAVW_END     -- Finish the current file, optionally deleting it.        */
+/* ======================================================================== */
+int wavw_end(wavw_t *w, const char *unlink_name)
+{
+    return wavw_queue(w, NULL, 0, unlink_name);
+}
+
+/* ======================================================================== */
+/*  WAVW_WRITE   -- Queue samples for the current file.                     */
+/* ======================================================================== */
+void wavw_write(wavw_t *w, const sint_16 *samp, int num_samp)
+{
+    while (num_samp > 0)
+    {
+        uint_32 head, room;
+        int i, cnt;
+
+        /* ---------------------------------------------------------------- */
+        /*  Find out how much room there is, waiting for some if needed.    */
+        /* ---------------------------------------------------------------- */
+        SDL_LockMutex(w->lock);
+        while ((room = WAVW_RING_SIZE - (w->head - w->tail)) < 2)
+        {
+            w->stalls++;
+            SDL_CondSignal(w->wake);
+            SDL_CondWait(w->room, w->lock);
+        }
+        head = w->head;
+        SDL_UnlockMutex(w->lock);
+
+        /* ---------------------------------------------------------------- */
+        /*  Copy in as much as fits.  'head' is always even, so a sample    */
+        /*  never straddles the wrap.                                       */
+        /* ---------------------------------------------------------------- */
+        cnt = room / 2 < (uint_32)num_samp ? (int)(room / 2) : num_samp;
+
+        for (i = 0; i < cnt; i++)
+        {
+            uint_8 *p = w->ring + ((head + 2 * i) & WAVW_RING_MASK);
+            p[0] =  samp[i]       & 0xFF;
+            p[1] = (samp[i] >> 8) & 0xFF;
+        }
+
+        SDL_LockMutex(w->lock);
+        w->head += 2 * cnt;
+        if (w->head - w->tail >= WAVW_BATCH)
+            SDL_CondSignal(w->wake);
+        SDL_UnlockMutex(w->lock);
+
+        samp     += cnt;
+        num_samp -= cnt;
+    }
+}
+
+/* ======================================================================== */
+/*  WAVW_DESTROY -- Drain the ring, close any open file, stop the thread.   */
+/* ======================================================================== */
+void wavw_destroy(wavw_t *w)
+{
+    wavw_t **pw;
+
+    if (!w)
+        return;
+
+    for (pw = &wavw_live; *pw; pw = &(*pw)->next)
+        if (*pw == w)
+        {
+            *pw = w->next;
+            break;
+        }
+
+    SDL_LockMutex(w->lock);
+    w->quit = 1;
+    SDL_CondSignal(w->wake);
+    SDL_UnlockMutex(w->lock);
+
+    SDL_WaitThread(w->thread, NULL);
+
+    if (w->stalls)
+        fprintf(stderr, "wavw:  Disk fell behind; emulation waited %d "
+                        "time%s.\n", w->stalls, w->stalls == 1 ? "" : "s");
+
+    SDL_DestroyCond(w->room);
+    SDL_DestroyCond(w->wake);
+    SDL_DestroyMutex(w->lock);
+    free(w->ring);
+    free(w);
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
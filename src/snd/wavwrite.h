@@ -0,0 +1,76 @@
+/*
+ * ============================================================================
+ *  Title:    Background WAV Writer
+ *  Author:   J. Zbiciak
+ * ============================================================================
+ *  Moves audio file output off the emulation thread.  The emulator copies
+ *  samples into a large ring buffer, and a writer thread drains the ring
+ *  to disk in big batches.  The writer also owns the WAV header:  it
+ *  writes a placeholder when a file starts, and fills in the lengths as
+ *  it goes and again when the file is closed.
+ *
+ *  One writer can service a sequence of files.  WAVW_BEGIN and WAVW_END
+ *  are queued in order with the sample data, so the emulator never waits
+ *  on a close, either.  The emulator only waits if the ring fills up.
+ *
+ *  WAVW_CREATE  -- Create a writer and start its thread.
+ *  WAVW_BEGIN   -- Hand an open file to the writer.
+ *  WAVW_WRITE   -- Queue 16-bit mono samples for the current file.
+ *  WAVW_END     -- Finish the current file, optionally deleting it.
+ *  WAVW_DESTROY -- Flush everything, close any open file, stop the thread.
+ * ============================================================================
+ */
+#ifndef WAVWRITE_H_
+#define WAVWRITE_H_
+
+typedef struct wavw_t wavw_t;
+
+/* ======================================================================== */
+/*  WAVW_CREATE  -- Create a writer and start its thread.  Returns NULL     */
+/*                  on failure.                                             */
+/* ======================================================================== */
+wavw_t *wavw_create(void);
+
+/* ======================================================================== */
+/*  WAVW_BEGIN   -- Hand an open file to the writer.  The writer owns the   */
+/*                  file from here on and closes it.  The file should be    */
+/*                  empty:  the writer puts the header at the front.        */
+/* ======================================================================== */
+int wavw_begin(wavw_t *w, FILE *f, int rate);
+
+/* ======================================================================== */
+/*  WAVW_WRITE   -- Queue samples for the current file.  Blocks only if     */
+/*                  the ring is full.                                       */
+/* ======================================================================== */
+void wavw_write(wavw_t *w, const sint_16 *samp, int num_samp);
+
+/* ======================================================================== */
+/*  WAVW_END     -- Finish the current file:  fix up its header and close   */
+/*                  it.  If 'unlink_name' is non-NULL, the file is then     */
+/*                  deleted by that name.                                   */
+/* ======================================================================== */
+int wavw_end(wavw_t *w, const char *unlink_name);
+
+/* ======================================================================== */
+/*  WAVW_DESTROY -- Drain the ring, close any open file, stop the thread.   */
+/* ======================================================================== */
+void wavw_destroy(wavw_t *w);
+
+#endif
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -61,6 +61,12 @@ uint_32 speed_tk(periph_t *p, uint_32 len)
     /*      frame rate, audio quality, etc.)                                */
     /* -------------------------------------------------------------------- */
 
+    /* -------------------------------------------------------------------- */
+    /*  If we're running flat out, there's nothing to do.                   */
+    /* -------------------------------------------------------------------- */
+    if (speed->unthrottled)
+        return len;
+
     now       = get_time() * speed->target_rate;
     then      = speed->last_time;    /*  When will THEN be NOW???  SOON!!!  */
     speed->last_time = now;
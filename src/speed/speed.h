@@ -23,6 +23,7 @@ typedef struct speed_t
     uint_32         warmup;
     uint_8          busywaits_ok;
     uint_8          pal;
+    uint_8          unthrottled;    /* Run flat out, e.g. when headless.    */
     gfx_t           *gfx;
     stic_t          *stic;
 } speed_t;
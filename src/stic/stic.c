@@ -13,6 +13,7 @@
 #include "speed/speed.h"
 #include "lzoe/lzoe.h"
 #include "debug/debug_if.h"
+#include "serializer/snapshot.h"
 
 
 LOCAL void stic_draw_fgbg(stic_t *stic);
@@ -141,11 +142,15 @@ LOCAL uint_32 stic_ctrl_rd(periph_t *per, periph_t *req,
         /* ---------------------------------------------------------------- */
         /*  Yes:  Return garbage.                                           */
         /* ---------------------------------------------------------------- */
+        if (stic->budget && access_time)
+            stic->budget->cur.rd_drop++;
+
         if (stic->debug_flags & STIC_SHOW_RD_DROP)
         {
             cp1600_t *cpu = req && req->req ? (cp1600_t *)req->req : NULL;
             int pc = cpu ? cpu->r[7] : -1;
 
+            debug_tr_sync();
             jzp_printf("STIC CTRL RD drop: addr = $%.4X @%llu   ", 
                        addr + per->addr_base, access_time);
 
@@ -319,11 +324,15 @@ LOCAL void stic_ctrl_wr(periph_t *per, periph_t *req,
         /* ---------------------------------------------------------------- */
         /*  Yes:  Drop the write.                                           */
         /* ---------------------------------------------------------------- */
+        if (stic->budget && access_time)
+            stic->budget->cur.wr_drop++;
+
         if (stic->debug_flags & STIC_SHOW_WR_DROP)
         {
             cp1600_t *cpu = req && req->req ? (cp1600_t *)req->req : NULL;
             int pc = cpu ? cpu->r[7] : -1;
 
+            debug_tr_sync();
             jzp_printf("STIC CTRL WR drop: addr = $%.4X @%llu", 
                         addr + per->addr_base, access_time);
             jzp_printf(" (data $%.4X) ", data);
@@ -453,6 +462,7 @@ LOCAL void stic_btab_wr(periph_t *per, periph_t *req,
     if (addr < 0xF0)
     {
         stic->btab_sr[addr] = data;
+        SNAP_DIRTY(stic->btsr_pgs, addr);
         stic->btab[addr]    = data; /* hack */
         stic->bt_dirty     |= 3;    /* hack */
     }
@@ -474,11 +484,15 @@ LOCAL void stic_gmem_wr(periph_t *per, periph_t *req,
     if (access_time > stic->gmem_accessible || 
         access_time < stic->req_bus->intak)
     {
+        if (stic->budget && access_time)
+            stic->budget->cur.wr_drop++;
+
         if (stic->debug_flags & STIC_SHOW_WR_DROP)
         {
             cp1600_t *cpu = req && req->req ? (cp1600_t *)req->req : NULL;
             int pc = cpu ? cpu->r[7] : -1;
 
+            debug_tr_sync();
             jzp_printf("STIC GMEM WR drop: addr = $%.4X @%llu",
                         addr + per->addr_base, access_time);
 
@@ -526,6 +540,7 @@ LOCAL void stic_gmem_wr(periph_t *per, periph_t *req,
         stic->gr_dirty |= 1;
 
     stic->gmem[addr] = data;
+    SNAP_DIRTY(stic->gmem_pgs, addr);
 }
 
 
@@ -557,6 +572,7 @@ LOCAL void stic_gmem_poke(periph_t *per, periph_t *req,
         stic->gr_dirty |= 1;
 
     stic->gmem[addr] = data;
+    SNAP_DIRTY(stic->gmem_pgs, addr);
 }
 
 
@@ -579,11 +595,15 @@ LOCAL uint_32 stic_gmem_rd(periph_t *per, periph_t *req,
     if (access_time > stic->gmem_accessible ||
         access_time < stic->req_bus->intak)
     {
+        if (stic->budget && access_time)
+            stic->budget->cur.rd_drop++;
+
         if (stic->debug_flags & STIC_SHOW_RD_DROP)
         {
             cp1600_t *cpu = req && req->req ? (cp1600_t *)req->req : NULL;
             int pc = cpu ? cpu->r[7] : -1;
 
+            debug_tr_sync();
             jzp_printf("STIC GMEM RD drop: addr = $%.4X @%llu ", 
                        addr + per->addr_base, access_time);
 
@@ -657,6 +677,31 @@ LOCAL void stic_dtor(periph_p p)
         demo_dtor(stic->demo);
 }
 
+/* ======================================================================== */
+/*  STIC_SER_INIT -- Register the STIC for snapshots:  the registers, GRAM, */
+/*                   the display lists, and the bus timing.  GRAM and the   */
+/*                   snooped BACKTAB are tracked by their writers.  The     */
+/*                   display lists and the frame-drop count depend on how   */
+/*                   fast the host keeps up, so the state hash skips them.  */
+/*                   STIC_RESYNC must be called after restoring one.        */
+/* ======================================================================== */
+LOCAL void stic_ser_init(periph_p p)
+{
+    stic_t *stic = (stic_t *)p;
+
+    SNAP_FIELDS(p->name, stic, stic_t, raw,      raw);
+    snap_track (p->name, stic->gmem,    0, sizeof(stic->gmem),
+                sizeof(stic->gmem[0]),  stic->gmem_pgs);
+    SNAP_FIELDS(p->name, stic, stic_t, fifo_ptr, fifo_ptr);
+    snap_track (p->name, stic->btab_sr, 0, 240,
+                sizeof(stic->btab_sr[0]), stic->btsr_pgs);
+    SNAP_FIELDS(p->name, stic, stic_t, btab,     btab);
+    SNAP_DERIVED_FIELDS(p->name, stic, stic_t, last_bg, image);
+    SNAP_FIELDS(p->name, stic, stic_t, phase,    pal);
+    SNAP_DERIVED_FIELDS(p->name, stic, stic_t, drop_frame, drop_frame);
+    SNAP_FIELDS(p->name, stic, stic_t, gmem_accessible, next_phase);
+}
+
 /* ======================================================================== */
 /*  STIC_INIT    -- Initialize this ugly ass peripheral.  Booyah!           */
 /* ======================================================================== */
@@ -804,6 +849,7 @@ int stic_init
     stic->stic_cr.tick      = stic_tick;
     stic->stic_cr.reset     = stic_reset;
     stic->stic_cr.dtor      = stic_dtor;
+    stic->stic_cr.ser_init  = stic_ser_init;
     stic->stic_cr.min_tick  = 57; /* to get started.  stic_tick will reset. */
     stic->stic_cr.max_tick  = 57;
     stic->stic_cr.addr_base = 0x00000000;
@@ -2219,6 +2265,9 @@ uint_32 stic_tick
         /* ---------------------------------------------------------------- */ 
         case 0:
         {
+            if (stic->budget)
+                budget_frame(stic->budget, soon);
+
             if (stic->vid_enable)
             {
                 if (stic->mode != stic->p_mode)
@@ -2227,6 +2276,12 @@ uint_32 stic_tick
                     stic->mode = stic->p_mode;
                 }
                 stic_update(stic);
+
+                if (stic->budget && stic->budget->overlay)
+                {
+                    budget_draw(stic->budget, stic->disp);
+                    stic->gfx->dirty |= 1;
+                }
             }
             else
                 if (stic->drop_frame > 0)
@@ -2349,6 +2404,7 @@ uint_32 stic_tick
             if (stic->vid_enable &&
                 (stic->debug_flags & STIC_SHOW_FIFO_LOAD) != 0)
             {
+                debug_tr_sync();
                 jzp_printf("STIC: Copied $%.3X - $%.3X to video FIFO @%llu\n",
                             0x200 + 20 * (stic->phase - 3),
                             0x1FF + 20 * (stic->phase - 2),
@@ -2381,6 +2437,7 @@ uint_32 stic_tick
             if (stic->vid_enable &&
                 (stic->debug_flags & STIC_SHOW_FIFO_LOAD) != 0)
             {
+                debug_tr_sync();
                 jzp_printf("STIC: Copied $%.3X - $%.3X to video FIFO @%llu\n",
                             0x200 + 20 * (stic->phase - 3),
                             0x1FF + 20 * (stic->phase - 2),
@@ -2453,6 +2510,9 @@ void stic_resync(stic_t *stic)
     stic->bt_dirty = 3; 
     stic->gr_dirty = 1; 
     stic->ob_dirty = 1;
+
+    /* Show the restored frame now, in case we're paused. */
+    stic_push_vid(stic);
 }
 
 
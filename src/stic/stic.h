@@ -46,6 +46,7 @@
 #define _STIC_H 1
 
 #include "cp1600/req_bus.h"
+#include "cp1600/budget.h"
 
 
 /*
@@ -101,6 +102,9 @@ struct stic_t
     uint_8      *disp;
     gfx_t       *gfx;
 
+    uint_32     gmem_pgs[1];    /* GRAM pages written since last snapshot.  */
+    uint_32     btsr_pgs[1];    /* BACKTAB snoops since last snapshot.      */
+
     /* -------------------------------------------------------------------- */
     /*  IRQ and BUSRQ generation.                                           */
     /* -------------------------------------------------------------------- */
@@ -148,6 +152,11 @@ struct stic_t
     /* -------------------------------------------------------------------- */
     demo_t      *demo;
 
+    /* -------------------------------------------------------------------- */
+    /*  Frame budget, closed out at each INTRQ.                             */
+    /* -------------------------------------------------------------------- */
+    budget_t    *budget;
+
     /* -------------------------------------------------------------------- */
     /*  Debugger support                                                    */
     /* -------------------------------------------------------------------- */
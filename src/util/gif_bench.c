@@ -0,0 +1,297 @@
+/* ======================================================================== */
+/*  GIF_BENCH    -- Benchmark the GIF encoder on recorded movies.           */
+/*                                                                          */
+/*  Usage:  gif_bench [-r reps] [-n frames] [-] movie.imv [movie.imv...]    */
+/*                                                                          */
+/*  Decodes the first 'frames' frames of each .imv movie up front, then     */
+/*  times the encoder on them, with no movie decoding in the loop:          */
+/*                                                                          */
+/*      lzw     -- lzw_encode() on every whole frame, the way a screenshot  */
+/*                 is encoded.                                              */
+/*      anim    -- gif_wr_frame_m() on every frame, the way imvtogif builds */
+/*                 an animated GIF.  This tries up to six encodings of      */
+/*                 each frame's changed area and keeps the smallest.        */
+/*                                                                          */
+/*  Each test runs 'reps' times and the fastest run is reported.  '-'       */
+/*  encodes whole frames for 'anim', like imvtogif's '-' does.              */
+/* ======================================================================== */
+
+#include "config.h"
+#include "mvi/mvi.h"
+#include "gif/gif_enc.h"
+#include "gif/lzw_enc.h"
+#include "plat/plat_lib.h"
+
+/* ======================================================================== */
+/*  The STIC palette imvtogif uses, plus a 17th entry for gif_start() to    */
+/*  give the transparent color.                                             */
+/* ======================================================================== */
+LOCAL uint_8 palette[17][3] =
+{
+    { 0x00, 0x00, 0x00 }, { 0x00, 0x2D, 0xFF }, { 0xFF, 0x3D, 0x10 },
+    { 0xC9, 0xCF, 0xAB }, { 0x38, 0x6B, 0x3F }, { 0x00, 0xA7, 0x56 },
+    { 0xFA, 0xEA, 0x50 }, { 0xFF, 0xFC, 0xFF }, { 0xBD, 0xAC, 0xC8 },
+    { 0x24, 0xB8, 0xFF }, { 0xFF, 0xB4, 0x1F }, { 0x54, 0x6E, 0x00 },
+    { 0xFF, 0x4E, 0x57 }, { 0xA4, 0x96, 0xFF }, { 0x75, 0xCC, 0x80 },
+    { 0xB5, 0x1A, 0x58 }, { 0xFF, 0x80, 0x80 },
+};
+
+typedef struct bench_mov_t
+{
+    const char  *name;
+    int         x_dim, y_dim;
+    int         frames;
+    uint_8      *vid;                   /* 'frames' frames, back to back.   */
+} bench_mov_t;
+
+/* ======================================================================== */
+/*  LOAD_MOVIE   -- Decode up to 'max_fr' frames of a movie into memory.    */
+/*                  Repeated frames are dropped, as nothing encodes them.   */
+/* ======================================================================== */
+LOCAL int load_movie(bench_mov_t *bm, const char *name, int max_fr)
+{
+    mvi_t   movie;
+    uint_8  bbox[8][4];
+    uint_8  *curr;
+    int     flag, size;
+
+    memset(bm, 0, sizeof(bench_mov_t));
+    bm->name = name;
+
+    mvi_init(&movie, MVI_MAX_X, MVI_MAX_Y);
+    curr = CALLOC(uint_8, MVI_MAX_X * MVI_MAX_Y);
+
+    if (!curr || !(movie.f = fopen(name, "rb")))
+    {
+        perror("fopen()");
+        fprintf(stderr, "gif_bench: could not open %s\n", name);
+        CONDFREE(curr);
+        mvi_dtor(&movie);
+        return -1;
+    }
+
+    while (bm->frames < max_fr &&
+           (flag = mvi_rd_frame(&movie, curr, bbox)) >= 0)
+    {
+        if (flag & MVI_FR_SAME)
+            continue;
+
+        size = movie.x_dim * movie.y_dim;
+
+        if (bm->frames == 0)
+        {
+            bm->x_dim = movie.x_dim;
+            bm->y_dim = movie.y_dim;
+            bm->vid   = CALLOC(uint_8, (size_t)size * max_fr);
+            if (!bm->vid)
+            {
+                fprintf(stderr, "gif_bench: out of memory\n");
+                break;
+            }
+        } else if (movie.x_dim != bm->x_dim || movie.y_dim != bm->y_dim)
+        {
+            fprintf(stderr, "gif_bench: %s changes size at frame %d; "
+                            "stopping there\n", name, bm->frames);
+            break;
+        }
+
+        memcpy(bm->vid + (size_t)size * bm->frames, curr, size);
+        bm->frames++;
+    }
+
+    fclose(movie.f);
+    free(curr);
+    mvi_dtor(&movie);
+
+    if (bm->frames == 0)
+    {
+        fprintf(stderr, "gif_bench: no frames in %s\n", name);
+        CONDFREE(bm->vid);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  BENCH_LZW    -- Encode every frame whole.  Returns seconds taken, and   */
+/*                  the total compressed size in '*bytes'.                  */
+/* ======================================================================== */
+LOCAL double bench_lzw(const bench_mov_t *bm, lzw_t *lzw, uint_8 *o_buf,
+                       long *bytes)
+{
+    int     size = bm->x_dim * bm->y_dim;
+    int     i, len;
+    double  start = get_time();
+
+    *bytes = 0;
+    for (i = 0; i < bm->frames; i++)
+    {
+        len = lzw_encode(lzw, bm->vid + (size_t)size * i, o_buf, size,
+                         2 * size, -1);
+        if (len < 0)
+        {
+            fprintf(stderr, "gif_bench: frame %d overflowed\n", i);
+            return -1.0;
+        }
+        *bytes += len;
+    }
+
+    return get_time() - start;
+}
+
+/* ======================================================================== */
+/*  BENCH_ANIM   -- Write every frame to an animated GIF in a temporary     */
+/*                  file.  Returns seconds taken, and the GIF's size in     */
+/*                  '*bytes'.                                               */
+/* ======================================================================== */
+LOCAL double bench_anim(const bench_mov_t *bm, int mode, long *bytes)
+{
+    int     size = bm->x_dim * bm->y_dim;
+    int     i, ret;
+    double  start, elapsed;
+    gif_t   gif;
+    FILE    *f;
+
+    if (!(f = tmpfile()))
+    {
+        perror("tmpfile()");
+        return -1.0;
+    }
+
+    start = get_time();
+
+    ret = gif_start(&gif, f, bm->x_dim, bm->y_dim, palette, 16, 1);
+    *bytes = ret;
+    for (i = 0; ret >= 0 && i < bm->frames; i++)
+    {
+        ret = gif_wr_frame_m(&gif, bm->vid + (size_t)size * i, 3, mode);
+        *bytes += ret;
+    }
+    if (ret >= 0)
+        *bytes += gif_finish(&gif);
+
+    elapsed = get_time() - start;
+    fclose(f);
+
+    if (ret < 0)
+    {
+        fprintf(stderr, "gif_bench: GIF encode failed at frame %d\n", i - 1);
+        return -1.0;
+    }
+
+    return elapsed;
+}
+
+/* ======================================================================== */
+/*  REPORT       -- Print one line of results.                              */
+/* ======================================================================== */
+LOCAL void report(const bench_mov_t *bm, const char *test, double t,
+                  long bytes)
+{
+    double pix = (double)bm->x_dim * bm->y_dim * bm->frames;
+
+    printf("%-20s %-5s %7d %10.1f %10ld %9.3f %8.2f\n",
+           bm->name, test, bm->frames, t * 1000.0, bytes,
+           t * 1000.0 / bm->frames, pix / t / 1e6);
+}
+
+LOCAL void usage(void)
+{
+    fprintf(stderr,
+"usage: gif_bench [-r reps] [-n frames] [-] movie.imv [movie.imv...]\n"
+"\n"
+"    -r reps     Runs of each test; the fastest is reported.  Default:  5\n"
+"    -n frames   Frames to load from each movie.  Default:  3600\n"
+"    -           Encode whole frames for the animated GIF test\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    int         reps = 5, max_fr = 3600, mode = 0, i, r;
+    bench_mov_t bm;
+    lzw_t       *lzw;
+    uint_8      *o_buf;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+        if (argv[i][1] == '\0')
+        {
+            mode = 1;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+            usage();
+
+        if      (!strcmp(argv[i], "-r")) reps   = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n")) max_fr = atoi(argv[++i]);
+        else usage();
+    }
+
+    if (i == argc || reps < 1 || max_fr < 1)
+        usage();
+
+    lzw   = CALLOC(lzw_t, 1);
+    o_buf = CALLOC(uint_8, 2 * MVI_MAX_X * MVI_MAX_Y);
+    if (!lzw || !o_buf)
+    {
+        fprintf(stderr, "gif_bench: out of memory\n");
+        exit(1);
+    }
+
+    printf("%-20s %-5s %7s %10s %10s %9s %8s\n", "movie", "test", "frames",
+           "ms", "bytes", "ms/frame", "Mpix/s");
+
+    for (; i < argc; i++)
+    {
+        double  t, best_lzw = -1.0, best_anim = -1.0;
+        long    lzw_bytes = 0, anim_bytes = 0;
+
+        if (load_movie(&bm, argv[i], max_fr))
+            exit(1);
+
+        for (r = 0; r < reps; r++)
+        {
+            if ((t = bench_lzw(&bm, lzw, o_buf, &lzw_bytes)) < 0.0)
+                exit(1);
+            if (best_lzw < 0.0 || t < best_lzw)
+                best_lzw = t;
+
+            if ((t = bench_anim(&bm, mode, &anim_bytes)) < 0.0)
+                exit(1);
+            if (best_anim < 0.0 || t < best_anim)
+                best_anim = t;
+        }
+
+        report(&bm, "lzw",  best_lzw,  lzw_bytes);
+        report(&bm, "anim", best_anim, anim_bytes);
+
+        free(bm.vid);
+    }
+
+    lzw_dtor(lzw);
+    free(lzw);
+    free(o_buf);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
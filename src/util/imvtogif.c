@@ -4,6 +4,11 @@
 #include "gif/gif_enc.h"
 #include "gif/lzw_enc.h"
 
+#ifdef HAS_FORK
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
 
 mvi_t movie;
 
@@ -45,6 +50,7 @@ uint_8 palette[17][3] =
 
 uint_8 curr[MVI_MAX_X * MVI_MAX_Y];
 uint_8 prev[MVI_MAX_X * MVI_MAX_Y];
+uint_8 last[MVI_MAX_X * MVI_MAX_Y];
 
 const char * typedesc[6] =
 {
@@ -62,36 +68,289 @@ int color_map[16];
 
 uint_8 map_palette[16][3];
 
+int n_cols = 16;
+int mode = 0;
+const char *in_name;
+
+/* ======================================================================== */
+/*  Pass 1 decides which source frames become GIF frames, and with what     */
+/*  delays, exactly as encoding them in order would.  Pass 2 can then       */
+/*  split the GIF frames into chunks and encode the chunks in parallel,     */
+/*  each decoding from the keyframe nearest its start.  A chunk starts      */
+/*  from the GIF frame before it, so it optimizes against the same image    */
+/*  the single-threaded encoder would have, and the output is identical.    */
+/* ======================================================================== */
+typedef struct gfr_t
+{
+    int     src;            /* Source frame that becomes this GIF frame.    */
+    int     delay;          /* Its delay, in 100ths of a second.            */
+} gfr_t;
+
+gfr_t *gfr = NULL;
+int   n_gfr = 0, max_gfr = 0;
+
+mvi_key_t *keys = NULL;
+int       n_keys = 0;
+
+typedef struct chunk_sum_t
+{
+    long    hdr;            /* Bytes of GIF header at the front of file.    */
+    int     wrote;          /* Bytes written, including the header.         */
+    int     stat[6];        /* gif_best_stat for this chunk.                */
+} chunk_sum_t;
+
+typedef struct chunk_t
+{
+    int         g0, g1;     /* GIF frames [g0, g1) of the output.           */
+    FILE        *f;         /* Where the chunk is written.                  */
+    chunk_sum_t sum;        /* What encoding it produced.                   */
+} chunk_t;
+
+/* ======================================================================== */
+/*  ADD_GFR      -- Plan a GIF frame.                                       */
+/* ======================================================================== */
+LOCAL void add_gfr(int src, int delay)
+{
+    if (n_gfr == max_gfr)
+    {
+        max_gfr = max_gfr ? max_gfr * 2 : 1024;
+        gfr     = (gfr_t *)realloc(gfr, max_gfr * sizeof(gfr_t));
+        if (!gfr)
+        {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+
+    gfr[n_gfr].src   = src;
+    gfr[n_gfr].delay = delay;
+    n_gfr++;
+}
+
+/* ======================================================================== */
+/*  ENCODE_CHUNK -- Decode the source frames a chunk needs and encode its   */
+/*                  GIF frames.  Writes a GIF header first, which all but   */
+/*                  the first chunk's get dropped when stitching.           */
+/* ======================================================================== */
+LOCAL int encode_chunk(chunk_t *ck)
+{
+    gif_t gif;
+    uint_8 bbox[8][4];
+    int first = gfr[ck->g0 > 0 ? ck->g0 - 1 : 0].src;
+    int final = gfr[ck->g1 - 1].src;
+    int g = ck->g0;
+    int k, i, ord, ret;
+
+    /* -------------------------------------------------------------------- */
+    /*  Find the last keyframe at or before the first frame we need.  For   */
+    /*  all but the first chunk, that's the GIF frame just before ours.     */
+    /* -------------------------------------------------------------------- */
+    for (k = n_keys - 1; k > 0 && keys[k].ord > first; k--)
+        ;
+
+    if (n_keys == 0 || keys[k].ord > first)
+    {
+        fprintf(stderr, "No keyframe before frame %d\n", first);
+        return -1;
+    }
+
+    if (!(movie.f = fopen(in_name, "rb")) || mvi_seek(&movie, &keys[k]) < 0)
+    {
+        perror("fopen()");
+        fprintf(stderr, "Could not open %s for reading\n", in_name);
+        return -1;
+    }
+
+    ret = gif_start(&gif, ck->f, movie.x_dim, movie.y_dim, map_palette,
+                    n_cols, 1);
+    if (ret < 0)
+    {
+        fprintf(stderr, "Error starting GIF file\n");
+        return -1;
+    }
+    ck->sum.hdr   = ret;
+    ck->sum.wrote = ret;
+
+    for (ord = keys[k].ord; ord <= final; ord++)
+    {
+        if (mvi_rd_frame(&movie, curr, bbox) < 0)
+        {
+            fprintf(stderr, "Error decoding frame %d\n", ord);
+            return -1;
+        }
+
+        if (ord == first && ck->g0 > 0)
+        {
+            for (i = 0; i < movie.x_dim * movie.y_dim; i++)
+                gif.vid[i] = color_map[curr[i]];
+        }
+
+        if (g < ck->g1 && ord == gfr[g].src)
+        {
+            for (i = 0; i < movie.x_dim * movie.y_dim; i++)
+                curr[i] = color_map[curr[i]];
+
+            ret = gif_wr_frame_m(&gif, curr, gfr[g].delay, mode);
+            if (ret < 0)
+            {
+                fprintf(stderr, "Error writing frame %d of GIF file\n", ord);
+                return -1;
+            }
+            ck->sum.wrote += ret;
+            g++;
+        }
+    }
+
+    memcpy(ck->sum.stat, gif_best_stat, sizeof(ck->sum.stat));
+
+    fclose(movie.f);
+    free(gif.vid);
+    free(gif.pal);
+    lzw_dtor(gif.lzw);
+    free(gif.lzw);
+    return 0;
+}
+
+#ifdef HAS_FORK
+/* ======================================================================== */
+/*  ENCODE_PARALLEL -- Encode each chunk in its own process, into its own   */
+/*                     temporary file, then stitch them together.  The GIF  */
+/*                     encoder isn't reentrant, so processes, not threads.  */
+/* ======================================================================== */
+LOCAL int encode_parallel(chunk_t *chunk, int n_chunks, FILE *fo)
+{
+    static uint_8 buf[65536];
+    int i, j, status, failed = 0, wrote = 0;
+    pid_t *pid = CALLOC(pid_t, n_chunks);
+
+    if (!pid)
+        return -1;
+
+    fflush(stdout);
+    fflush(stderr);
+
+    for (i = 0; i < n_chunks; i++)
+    {
+        if (!(chunk[i].f = tmpfile()) || (pid[i] = fork()) < 0)
+        {
+            perror("fork()");
+            failed = 1;
+            break;
+        }
+
+        if (pid[i] == 0)
+        {
+            int ret = encode_chunk(&chunk[i]);
+
+            if (ret == 0 &&
+                fwrite(&chunk[i].sum, sizeof(chunk_sum_t), 1, chunk[i].f) != 1)
+                ret = -1;
+            fflush(chunk[i].f);
+            _exit(ret < 0 ? 1 : 0);
+        }
+    }
+
+    for (j = 0; j < i; j++)
+        if (waitpid(pid[j], &status, 0) < 0 ||
+            !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            failed = 1;
+
+    free(pid);
+
+    /* -------------------------------------------------------------------- */
+    /*  Each chunk file holds a GIF header, the chunk's frames, and then    */
+    /*  its chunk_sum_t.  Keep only the first chunk's header.               */
+    /* -------------------------------------------------------------------- */
+    for (i = 0; i < n_chunks && !failed; i++)
+    {
+        FILE *f = chunk[i].f;
+        long len, skip;
+
+        if (fseek(f, -(long)sizeof(chunk_sum_t), SEEK_END) != 0 ||
+            (len = ftell(f)) < 0 ||
+            fread(&chunk[i].sum, sizeof(chunk_sum_t), 1, f) != 1)
+        {
+            failed = 1;
+            break;
+        }
+
+        skip = i == 0 ? 0 : chunk[i].sum.hdr;
+        len -= skip;
+        fseek(f, skip, SEEK_SET);
+
+        while (len > 0)
+        {
+            size_t n = len < (long)sizeof(buf) ? (size_t)len : sizeof(buf);
+
+            if (fread(buf, 1, n, f) != n || fwrite(buf, 1, n, fo) != n)
+            {
+                failed = 1;
+                break;
+            }
+            len -= n;
+        }
+
+        wrote += chunk[i].sum.wrote - skip;
+        for (j = 0; j < 6; j++)
+            gif_best_stat[j] += chunk[i].sum.stat[j];
+    }
+
+    for (i = 0; i < n_chunks; i++)
+        if (chunk[i].f)
+            fclose(chunk[i].f);
+
+    return failed ? -1 : wrote;
+}
+#endif
+
 int main(int argc, char *argv[])
 {
     FILE *fi, *fo;
     uint_8 bbox[8][4];
-    int fr, out_fr = 0;
+    int fr = 0, out_fr = 0, ord;
     int flag;
     int i, j;
-    gif_t gif;
     int prev_gif_time, curr_gif_time, delay;
-    int ret, wrote = 0, skip = 0;
-    int early = 0;
+    int ret, wrote = 0;
+    int early = 0, pend = -1, have_last = 0;
     int same = 0;
-    int n_cols = 16;
-    int mode = 0;
+    int jobs = 1, n_chunks, n_frames;
+    chunk_t *chunk;
+
+#if defined(HAS_FORK) && defined(_SC_NPROCESSORS_ONLN)
+    jobs = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
 
-    if (argc == 4 && argv[1][0] == '-' && argv[1][1] == '\0')
+    while (argc > 3 && argv[1][0] == '-')
     {
-        mode = 1;
+        if (argv[1][1] == '\0')
+            mode = 1;
+        else if (argv[1][1] == 'j' && argv[1][2])
+            jobs = atoi(argv[1] + 2);
+        else if (argv[1][1] == 'j' && argc > 4)
+        {
+            jobs = atoi(argv[2]);
+            argc--;
+            argv++;
+        } else
+            break;
+
         argc--;
         argv++;
     }
 
     if (argc != 3)
     {
-        fprintf(stderr, "%s [-] input.imv output.gif\n", argv[0]);
+        fprintf(stderr, "%s [-] [-j jobs] input.imv output.gif\n", argv[0]);
         exit(1);
     }
 
+    if (jobs < 1)
+        jobs = 1;
+
     mvi_init(&movie, MVI_MAX_X, MVI_MAX_Y);
 
+    in_name = argv[1];
     fi = fopen(argv[1], "rb");
     if (!fi)
     {
@@ -111,37 +370,89 @@ int main(int argc, char *argv[])
 
     memset(movie.vid, 16, MVI_MAX_X * MVI_MAX_Y);
     movie.f = fi;
-    fr = 0;
     prev_gif_time = curr_gif_time = 0;
 
     printf("Pass 1:  Color optimization...\n"); fflush(stdout);
-    while ((flag = mvi_rd_frame(&movie, curr, bbox)) >= 0)
+    for (ord = 0; (flag = mvi_rd_frame(&movie, curr, bbox)) >= 0; ord++)
     {
-        int mask = 0;
-        if ((flag & MVI_FR_SAME) != 0)
+        int size = movie.x_dim * movie.y_dim;
+
+        if ((flag & MVI_FR_SAME) == 0)
+        {
+            int mask = 0;
+
+            for (i = 0; i < size; i++)
+                mask |= 1 << curr[i];
+
+            j = 0;
+            for (i = 0; i < 16; i++)
+                j += (mask >> i) & 1;
+
+            if (j <= 2)
+                color_histo[mask & 0xFFFF] += 80;
+            if (j <= 3)
+                color_histo[mask & 0xFFFF] += 30;
+            if (j <= 4)
+                color_histo[mask & 0xFFFF] += 20;
+            if (j <= 7)
+                color_histo[mask & 0xFFFF] += 10;
+            if (j <= 8)
+                color_histo[mask & 0xFFFF] += 10;
+
+            color_histo[mask & 0xFFFF] += 1;
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  Plan the GIF frames.  'prev' holds the frame waiting to go out  */
+        /*  (source frame 'pend'), and 'last' the last one that went out.   */
+        /*  A waiting frame goes out once the next frame that isn't a dupe  */
+        /*  or too early arrives, unless it matches the last one.           */
+        /* ---------------------------------------------------------------- */
+        if (pend < 0)
+        {
+            if ((flag & MVI_FR_SAME) == 0)
+            {
+                memcpy(prev, curr, size);
+                pend = ord;
+            }
             continue;
+        }
+
+        curr_gif_time += 5;
+        fr++;
+
+        if ((flag & MVI_FR_SAME) && !early)    { same++;    continue; }
+        if (curr_gif_time - prev_gif_time <15) { early = 1; continue; }
+        early = 0;
+
+        delay = (curr_gif_time - prev_gif_time) / 3;
+
+        if (!have_last || memcmp(prev, last, size))
+        {
+            prev_gif_time += 3*delay + 2;
+            add_gfr(pend, delay);
+            memcpy(last, prev, size);
+            have_last = 1;
+            out_fr++;
+        }
+
+        memcpy(prev, curr, size);
+        pend = ord;
+    }
 
-        for (i = 0; i < movie.x_dim * movie.y_dim; i++)
-            mask |= 1 << curr[i];
-
-        j = 0;
-        for (i = 0; i < 16; i++)
-            j += (mask >> i) & 1;
-
-        if (j <= 2)
-            color_histo[mask & 0xFFFF] += 80;
-        if (j <= 3)
-            color_histo[mask & 0xFFFF] += 30;
-        if (j <= 4)
-            color_histo[mask & 0xFFFF] += 20;
-        if (j <= 7)
-            color_histo[mask & 0xFFFF] += 10;
-        if (j <= 8)
-            color_histo[mask & 0xFFFF] += 10;
-
-        color_histo[mask & 0xFFFF] += 1;
+    if (pend < 0)
+    {
+        fprintf(stderr, "No frames in %s\n", argv[1]);
+        exit(1);
     }
 
+    /* write the last frame, unless it's a repeat. */
+    curr_gif_time += 5;
+    delay = (curr_gif_time - prev_gif_time) / 3;
+
+    if (!have_last || memcmp(prev, last, movie.x_dim * movie.y_dim))
+        add_gfr(pend, delay);
+
     for (i = 0; i < 65536; i++)
     {
         for (j = 0; j < 16; j++)
@@ -206,102 +517,70 @@ int main(int argc, char *argv[])
 #endif
 
 
-    /* reset the movie */
-    fseek(movie.f, 0, SEEK_SET);
-    memset(movie.vid, 0xFF, movie.x_dim * movie.y_dim);
-
-    /* get to the first frame of the movie */
-    while ((flag = mvi_rd_frame(&movie, prev, bbox)) >= 0)
+    /* -------------------------------------------------------------------- */
+    /*  Split the GIF frames into chunks and encode them.                   */
+    /* -------------------------------------------------------------------- */
+    n_keys = mvi_index(&movie, &keys, &n_frames);
+    if (n_keys < 0)
     {
-        if ((flag & MVI_FR_SAME) == 0)
-            break;
+        fprintf(stderr, "Error indexing %s\n", argv[1]);
+        exit(1);
     }
+    fclose(fi);
 
-    ret = gif_start(&gif, fo, movie.x_dim, movie.y_dim, map_palette, n_cols,1);
-    if (ret < 0)
+    n_chunks = jobs < n_gfr ? jobs : n_gfr;
+    chunk    = CALLOC(chunk_t, n_chunks);
+    if (!chunk)
     {
-        fprintf(stderr, "Error starting GIF file %s\n", argv[2]);
+        fprintf(stderr, "Out of memory\n");
         exit(1);
     }
-    wrote += ret;
-
 
-    printf("Pass 2:  Image compression...\n"); fflush(stdout);
-    while ((flag = mvi_rd_frame(&movie, curr, bbox)) >= 0)
+    for (i = 0; i < n_chunks; i++)
     {
-        curr_gif_time += 5;
-        fr++;
-
-        if ((flag & MVI_FR_SAME) && !early)    { skip++; same++;    continue; }
-        if (curr_gif_time - prev_gif_time <15) { skip++; early = 1; continue; }
-/*      if (curr_gif_time - prev_gif_time <10) { skip++; early = 1; continue; }
-*/      early = 0;
-
-        delay = (curr_gif_time - prev_gif_time) / 3;
-
-        prev_gif_time += 3*delay + 2;
-/*printf("skip = %d, delay = %d, curr_gif_time = %d, prev_gif_time = %d\n", skip, delay, curr_gif_time, prev_gif_time);*/
-
-        for (i = 0; i < movie.x_dim * movie.y_dim; i++)
-            prev[i] = color_map[prev[i]];
-
-        ret = gif_wr_frame_m(&gif, prev, delay, mode);
-        if (ret == 0)
-        {
-            memcpy(prev, curr, movie.x_dim * movie.y_dim);
-            prev_gif_time -= 3*delay + 2;
-            skip++;
-            continue;
-        }
-        if (ret < 0)
-        {
-            fprintf(stderr, "Error writing frame %d of GIF file %s\n",
-                    fr - 1, argv[2]);
-            exit(1);
-        }
-        wrote += ret;
-
-        memcpy(prev, curr, movie.x_dim * movie.y_dim);
-        skip = 0;
-        out_fr++;
-/*if (out_fr == 100) break;*/
+        chunk[i].g0 = (int)((long long)n_gfr *  i      / n_chunks);
+        chunk[i].g1 = (int)((long long)n_gfr * (i + 1) / n_chunks);
     }
 
-    /* write the last frame. */
-    curr_gif_time += 5;
-    delay = (curr_gif_time - prev_gif_time) / 3;
+    printf("Pass 2:  Image compression (%d job%s)...\n", n_chunks,
+           n_chunks == 1 ? "" : "s");
+    fflush(stdout);
 
-    for (i = 0; i < movie.x_dim * movie.y_dim; i++)
-        prev[i] = color_map[prev[i]];
+#ifdef HAS_FORK
+    if (n_chunks > 1)
+        ret = encode_parallel(chunk, n_chunks, fo);
+    else
+#endif
+    {
+        chunk[0].f = fo;
+        ret = encode_chunk(&chunk[0]) < 0 ? -1 : chunk[0].sum.wrote;
+    }
 
-    ret = gif_wr_frame_m(&gif, prev, delay, mode);
     if (ret < 0)
     {
-        fprintf(stderr, "Error writing frame %d of GIF file %s\n",
-                fr - 1, argv[2]);
+        fprintf(stderr, "Error writing GIF file %s\n", argv[2]);
         exit(1);
     }
     wrote += ret;
+    free(chunk);
 
-    ret = gif_finish(&gif);
-    if (ret < 0)
+    /* GIF trailer; gif_finish would write the same. */
+    if (fputc(0x3B, fo) == EOF)
     {
         fprintf(stderr, "Error terminating GIF file %s\n", argv[2]);
         exit(1);
     }
-    wrote += ret;
+    wrote += 1;
     fclose(fo);
 
     printf("Decoded %d source frames (%d dupes, %d dropped)\n", 
             fr, same, fr - out_fr - same);
     printf("Encoded %d unique frames\n", out_fr);
     printf("Encoded %d bytes (%d bytes/source frame, %d bytes/unique frame)\n", 
-            wrote, wrote / fr, wrote / out_fr);
+            wrote, wrote / (fr ? fr : 1), wrote / (out_fr ? out_fr : 1));
     printf("GIF frame type breakdown:\n");
     for (i = 0; i < 6; i++)
         printf("%-65s%10d\n", typedesc[i], gif_best_stat[i]);
 
     return 0;
 }
-
-
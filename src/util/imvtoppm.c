@@ -4,9 +4,12 @@
 #include "gif/gif_enc.h"
 #include "gif/lzw_enc.h"
 
-#ifdef HAS_LINK
+#if defined(HAS_LINK) || defined(HAS_FORK)
 #include <unistd.h>
 #endif
+#ifdef HAS_FORK
+#include <sys/wait.h>
+#endif
 
 
 mvi_t movie;
@@ -52,62 +55,51 @@ uint_8 lbuf[MVI_MAX_X * 2][3];
 uint_8 bbox[8][4];
 
 
-int main(int argc, char *argv[])
+int mode = 0;
+
+/* ======================================================================== */
+/*  EXPAND -- Write PPMs for frames 'key->ord' up to 'end' of 'in_name',    */
+/*            starting from keyframe 'key'.                                 */
+/* ======================================================================== */
+LOCAL int expand(const char *in_name, const char *out_name,
+                 const mvi_key_t *key, int end)
 {
-    FILE *fi, *fo;
+    FILE *fo;
     int fr;
     int i, j, flag, len;
     char *fname, *fprev;
-    int mode = 0;
 
-    if (argc == 4 && argv[1][0] == '-' && argv[1][1] == '\0')
-    {
-        mode = 1;
-        argc--;
-        argv++;
-    }
-
-    if (argc != 3)
-    {
-        fprintf(stderr, "%s [-] input.imv output.gif\n", argv[0]);
-        exit(1);
-    }
-
-    mvi_init(&movie, MVI_MAX_X, MVI_MAX_Y);
-
-    len   = strlen(argv[2]) + 16;
+    len   = strlen(out_name) + 16;
     fname = (char *)malloc(len);
     fprev = (char *)malloc(len);
 
-    fi = fopen(argv[1], "rb");
-    if (!fi)
+    if (!(movie.f = fopen(in_name, "rb")) || mvi_seek(&movie, key) < 0)
     {
         perror("fopen()");
-        fprintf(stderr, "Could not open %s for reading\n", argv[1]);
-        exit(1);
+        fprintf(stderr, "Could not open %s for reading\n", in_name);
+        return -1;
     }
 
-
-    memset(movie.vid, 16, MVI_MAX_X * MVI_MAX_Y);
-    movie.f = fi;
-    fr = 0;
-
-    printf("Expanding IMV to PPM files...\n"); fflush(stdout);
-    while ((flag = mvi_rd_frame(&movie, curr, bbox)) >= 0)
+    for (fr = key->ord; fr < end; fr++)
     {
         char *ftmp;
 
+        if ((flag = mvi_rd_frame(&movie, curr, bbox)) < 0)
+        {
+            fprintf(stderr, "Error decoding frame %d\n", fr);
+            return -1;
+        }
+
         ftmp  = fname;
         fname = fprev;
         fprev = ftmp;
 
-        snprintf(fname, len, "%s_%.05d.ppm", argv[2], fr);
+        snprintf(fname, len, "%s_%.05d.ppm", out_name, fr);
 
 #ifdef HAS_LINK
-        if (fr > 0 && (flag & MVI_FR_SAME) == MVI_FR_SAME)
+        if (fr > key->ord && (flag & MVI_FR_SAME) == MVI_FR_SAME)
         {
             link(fprev, fname);
-            fr++;
             continue;
         }
 #endif
@@ -116,7 +108,7 @@ int main(int argc, char *argv[])
         {
             perror("fopen()");
             fprintf(stderr, "Could not open '%s' for writing.\n", fname);
-            exit(1);
+            return -1;
         }
 
         printf("\r%s ...", fname); fflush(stdout);
@@ -182,10 +174,153 @@ int main(int argc, char *argv[])
         }
 
         fclose(fo);
+    }
+
+    fclose(movie.f);
+    free(fname);
+    free(fprev);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *fi;
+    mvi_key_t *keys;
+    int n_keys, n_frames, n_chunks = 0;
+    int *start, i, k, failed = 0;
+    int jobs = 1;
+
+#if defined(HAS_FORK) && defined(_SC_NPROCESSORS_ONLN)
+    jobs = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    while (argc > 3 && argv[1][0] == '-')
+    {
+        if (argv[1][1] == '\0')
+            mode = 1;
+        else if (argv[1][1] == 'j' && argv[1][2])
+            jobs = atoi(argv[1] + 2);
+        else if (argv[1][1] == 'j' && argc > 4)
+        {
+            jobs = atoi(argv[2]);
+            argc--;
+            argv++;
+        } else
+            break;
 
-        fr++;
+        argc--;
+        argv++;
+    }
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "%s [-] [-j jobs] input.imv output\n", argv[0]);
+        exit(1);
     }
-    
+
+    if (jobs < 1)
+        jobs = 1;
+
+    mvi_init(&movie, MVI_MAX_X, MVI_MAX_Y);
+
+    fi = fopen(argv[1], "rb");
+    if (!fi)
+    {
+        perror("fopen()");
+        fprintf(stderr, "Could not open %s for reading\n", argv[1]);
+        exit(1);
+    }
+
+    movie.f = fi;
+    n_keys  = mvi_index(&movie, &keys, &n_frames);
+    fclose(fi);
+
+    if (n_keys <= 0)
+    {
+        fprintf(stderr, "No frames in %s\n", argv[1]);
+        exit(1);
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Split the movie at keyframes into about 'jobs' equal chunks.        */
+    /*  'start' holds each chunk's first keyframe.                          */
+    /* -------------------------------------------------------------------- */
+    start = CALLOC(int, jobs + 1);
+    if (!start)
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    for (i = k = 0; i < jobs; i++)
+    {
+        int target = (int)((long long)n_frames * i / jobs);
+
+        while (k < n_keys && keys[k].ord < target)
+            k++;
+
+        if (k < n_keys && (n_chunks == 0 || start[n_chunks - 1] != k))
+            start[n_chunks++] = k;
+    }
+    start[n_chunks] = n_keys;
+
+    printf("Expanding IMV to PPM files (%d job%s)...\n", n_chunks,
+           n_chunks == 1 ? "" : "s");
+    fflush(stdout);
+
+#ifdef HAS_FORK
+    if (n_chunks > 1)
+    {
+        pid_t *pid = CALLOC(pid_t, n_chunks);
+        int status;
+
+        for (i = 0; i < n_chunks && pid; i++)
+        {
+            if ((pid[i] = fork()) < 0)
+            {
+                perror("fork()");
+                failed = 1;
+                break;
+            }
+
+            if (pid[i] == 0)
+            {
+                int end = start[i + 1] < n_keys ? keys[start[i + 1]].ord
+                                                : n_frames;
+
+                fflush(stdout);
+                _exit(expand(argv[1], argv[2], &keys[start[i]], end) < 0);
+            }
+        }
+
+        for (k = 0; k < i; k++)
+            if (waitpid(pid[k], &status, 0) < 0 ||
+                !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                failed = 1;
+
+        CONDFREE(pid);
+    } else
+#endif
+    {
+        for (i = 0; i < n_chunks && !failed; i++)
+        {
+            int end = start[i + 1] < n_keys ? keys[start[i + 1]].ord
+                                            : n_frames;
+
+            if (expand(argv[1], argv[2], &keys[start[i]], end) < 0)
+                failed = 1;
+        }
+    }
+
+    free(start);
+    free(keys);
+
+    if (failed)
+    {
+        fprintf(stderr, "\nError expanding %s\n", argv[1]);
+        exit(1);
+    }
+
     printf("\nDone!\n");
 
     return 0;
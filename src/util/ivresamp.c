@@ -0,0 +1,326 @@
+/* ======================================================================== */
+/*  IVRESAMP     -- Render Intellivoice output through both the old         */
+/*                  sliding window and the polyphase resampler.             */
+/*                                                                          */
+/*  Usage:  ivresamp [-r rate] [-t taps] [-w window] [-b] in.wav            */
+/*                   [old.wav new.wav]                                      */
+/*                                                                          */
+/*  'in.wav' is raw SP0256 output at 3579545/358 Hz, such as the files      */
+/*  jzIntv writes with --voicefiles.  The two output files receive the      */
+/*  same stream converted to 'rate' by the sliding window and by the        */
+/*  polyphase resampler, respectively.  With -b, both paths are also        */
+/*  timed over the whole input and the cost per output sample reported.     */
+/* ======================================================================== */
+
+#include "config.h"
+#include "ivoice/resamp.h"
+
+#define IV_CLK  (3579545)
+#define IV_DIV  (358)
+
+/* ======================================================================== */
+/*  READ_WAV     -- Read 16-bit mono samples from a WAV file.  If there's   */
+/*                  no RIFF header, treat the whole file as raw samples.    */
+/* ======================================================================== */
+LOCAL sint_16 *read_wav(const char *fname, int *num_samp)
+{
+    FILE    *f;
+    uint_8  hdr[12], chk[8];
+    uint_32 len = 0;
+    sint_16 *samp;
+    uint_8  *raw;
+    uint_32 i;
+
+    if (!(f = fopen(fname, "rb")))
+    {
+        perror("fopen()");
+        fprintf(stderr, "ivresamp: can't open '%s'\n", fname);
+        exit(1);
+    }
+
+    if (fread(hdr, 1, 12, f) == 12 &&
+        !memcmp(hdr, "RIFF", 4) && !memcmp(hdr + 8, "WAVE", 4))
+    {
+        /* ---------------------------------------------------------------- */
+        /*  Skip chunks until we find the data.  Trust the format.          */
+        /* ---------------------------------------------------------------- */
+        while (fread(chk, 1, 8, f) == 8)
+        {
+            len = chk[4] | (chk[5] << 8) | (chk[6] << 16) | (chk[7] << 24);
+            if (!memcmp(chk, "data", 4))
+                break;
+            fseek(f, (len + 1) & ~1, SEEK_CUR);
+            len = 0;
+        }
+    } else
+    {
+        fseek(f, 0, SEEK_END);
+        len = ftell(f);
+        fseek(f, 0, SEEK_SET);
+    }
+
+    raw  = CALLOC(uint_8, len + 2);
+    samp = CALLOC(sint_16, len / 2 + 1);
+    if (!raw || !samp)
+    {
+        fprintf(stderr, "ivresamp: out of memory\n");
+        exit(1);
+    }
+
+    len = fread(raw, 1, len, f);
+    fclose(f);
+
+    for (i = 0; i < len / 2; i++)
+        samp[i] = (sint_16)(raw[2*i] | (raw[2*i + 1] << 8));
+
+    free(raw);
+    *num_samp = len / 2;
+    return samp;
+}
+
+/* ======================================================================== */
+/*  WRITE_WAV    -- Write 16-bit mono samples to a WAV file.                */
+/* ======================================================================== */
+LOCAL void write_wav(const char *fname, const sint_16 *samp, int num_samp,
+                     int rate)
+{
+    FILE    *f;
+    uint_8  hdr[44];
+    uint_32 dlen = num_samp * 2;
+    int     i;
+
+    memcpy(hdr,      "RIFF\0\0\0\0WAVEfmt \20\0\0\0\1\0\1\0", 24);
+    memcpy(hdr + 36, "data", 4);
+
+#define PUT32(p, v) do { (p)[0] = (v); (p)[1] = (v) >> 8;                   \
+                         (p)[2] = (v) >> 16; (p)[3] = (v) >> 24; } while (0)
+    PUT32(hdr +  4, dlen + 36);
+    PUT32(hdr + 24, (uint_32)rate);
+    PUT32(hdr + 28, (uint_32)rate * 2);
+    PUT32(hdr + 40, dlen);
+#undef PUT32
+    hdr[32] = 2;    hdr[33] = 0;        /* block align                      */
+    hdr[34] = 16;   hdr[35] = 0;        /* bits per sample                  */
+
+    if (!(f = fopen(fname, "wb")))
+    {
+        perror("fopen()");
+        fprintf(stderr, "ivresamp: can't open '%s'\n", fname);
+        exit(1);
+    }
+
+    fwrite(hdr, 1, 44, f);
+    for (i = 0; i < num_samp; i++)
+    {
+        fputc( samp[i]       & 0xFF, f);
+        fputc((samp[i] >> 8) & 0xFF, f);
+    }
+    fclose(f);
+}
+
+/* ======================================================================== */
+/*  RENDER_OLD   -- The sliding window, as ivoice_tk does it with           */
+/*                  --voicetaps=0.                                          */
+/* ======================================================================== */
+LOCAL int render_old(const sint_16 *in, int num_in, sint_16 *out,
+                     int rate, int wind)
+{
+    int  *window = CALLOC(int, wind);
+    int  wind_sum = 0, wind_ptr = 0, sample_frc = 0;
+    int  i, n = 0;
+
+    if (!window)
+    {
+        fprintf(stderr, "ivresamp: out of memory\n");
+        exit(1);
+    }
+
+    for (i = 0; i < num_in; i++)
+    {
+        sint_32 s, ws;
+
+        ws = s = in[i];
+        sample_frc += rate * IV_DIV;
+
+        if (rate < 10000)
+        {
+            wind_sum -= window[wind_ptr  ];
+            wind_sum += window[wind_ptr++] = s;
+            if (wind_ptr >= wind) wind_ptr = 0;
+
+            ws = wind_sum / wind;
+        }
+
+        while (sample_frc > IV_CLK)
+        {
+            sample_frc -= IV_CLK;
+
+            if (rate >= 10000)
+            {
+                wind_sum -= window[wind_ptr  ];
+                wind_sum += window[wind_ptr++] = s;
+                if (wind_ptr >= wind) wind_ptr = 0;
+
+                ws = wind_sum / wind;
+            }
+
+            out[n++] = ws;
+        }
+    }
+
+    free(window);
+    return n;
+}
+
+/* ======================================================================== */
+/*  RENDER_NEW   -- The polyphase resampler, pushed and pulled in blocks    */
+/*                  the way ivoice_tk does it.                              */
+/* ======================================================================== */
+LOCAL int render_new(const sint_16 *in, int num_in, sint_16 *out,
+                     int max_out, resamp_t *rs)
+{
+    int i = 0, n = 0, got;
+
+    resamp_reset(rs);
+
+    do
+    {
+        i += resamp_push(rs, in + i, num_in - i);
+        got = resamp_pull(rs, out + n, max_out - n);
+        n  += got;
+    } while ((got > 0 || i < num_in) && n < max_out);
+
+    return n;
+}
+
+/* ======================================================================== */
+/*  TIME_PATH    -- Run one path enough times to get a stable timing.       */
+/* ======================================================================== */
+LOCAL double time_path(const sint_16 *in, int num_in, sint_16 *out,
+                       int max_out, int rate, int wind, resamp_t *rs,
+                       long *tot_out)
+{
+    clock_t start = clock(), elapsed;
+
+    *tot_out = 0;
+    do
+    {
+        *tot_out += rs ? render_new(in, num_in, out, max_out, rs)
+                       : render_old(in, num_in, out, rate, wind);
+        elapsed = clock() - start;
+    } while (elapsed < CLOCKS_PER_SEC);
+
+    return (double)elapsed / CLOCKS_PER_SEC;
+}
+
+LOCAL void usage(void)
+{
+    fprintf(stderr,
+"usage: ivresamp [-r rate] [-t taps] [-w window] [-b] in.wav [old.wav new.wav]"
+"\n\n"
+"    -r rate     Output sample rate.  Default:  48000\n"
+"    -t taps     Polyphase resampler taps per phase.  Default:  16\n"
+"    -w window   Sliding window size.  Default:  Same as jzIntv\n"
+"    -b          Benchmark both paths\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    int      rate = 48000, taps = 16, wind = -1, bench = 0;
+    int      num_in, max_out, n_old, n_new, i;
+    sint_16  *in, *out_old, *out_new;
+    resamp_t rs;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+        if      (!strcmp(argv[i], "-b"))                bench = 1;
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc) rate = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) taps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc) wind = atoi(argv[++i]);
+        else usage();
+    }
+
+    argc -= i;
+    argv += i;
+
+    if (argc != 1 && argc != 3)
+        usage();
+
+    if (rate < 10000 || rate > 96000)
+    {
+        fprintf(stderr, "ivresamp: rate must be between 10000 and 96000\n");
+        exit(1);
+    }
+
+    /* Same automatic window as ivoice_init. */
+    if (wind == -1)
+        wind = rate / 5000 + 3;
+    if (wind < 1)
+        wind = 1;
+
+    in      = read_wav(argv[0], &num_in);
+    max_out = (int)((double)num_in * rate * IV_DIV / IV_CLK) + 16;
+    out_old = CALLOC(sint_16, max_out);
+    out_new = CALLOC(sint_16, max_out);
+
+    if (!out_old || !out_new ||
+        resamp_init(&rs, IV_CLK, IV_DIV, rate, taps, 256))
+    {
+        fprintf(stderr, "ivresamp: initialization failed\n");
+        exit(1);
+    }
+
+    n_old = render_old(in, num_in, out_old, rate, wind);
+    n_new = render_new(in, num_in, out_new, max_out, &rs);
+
+    printf("%d input samples -> %d (window %d), %d (%d taps x %d phases)\n",
+           num_in, n_old, wind, n_new, rs.taps, rs.phases);
+
+    if (argc == 3)
+    {
+        write_wav(argv[1], out_old, n_old, rate);
+        write_wav(argv[2], out_new, n_new, rate);
+    }
+
+    if (bench && num_in > 0)
+    {
+        double t_old, t_new;
+        long   o_old, o_new;
+
+        t_old = time_path(in, num_in, out_old, max_out, rate, wind, 0,
+                          &o_old);
+        t_new = time_path(in, num_in, out_new, max_out, rate, wind, &rs,
+                          &o_new);
+
+        printf("window:    %7.2f ns/sample  %8.2f Msamples/sec\n",
+               1e9 * t_old / o_old, o_old / t_old / 1e6);
+        printf("polyphase: %7.2f ns/sample  %8.2f Msamples/sec\n",
+               1e9 * t_new / o_new, o_new / t_new / 1e6);
+    }
+
+    resamp_dtor(&rs);
+    free(in);
+    free(out_old);
+    free(out_new);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
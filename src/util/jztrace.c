@@ -0,0 +1,186 @@
+/* ======================================================================== */
+/*  JZTRACE      -- Print part of an instruction trace.                     */
+/*                                                                          */
+/*  Usage:  jztrace [-r record | -c cycle] [-n count] [-s symfile]          */
+/*                  trace.jzt                                               */
+/*                                                                          */
+/*  Reads a trace written by the debugger's 'y' command and prints 'count'  */
+/*  records, starting at the given record number or at the first record     */
+/*  at or after the given cycle.  Each is formatted just as the debugger    */
+/*  prints it while tracing, with the same code:  instructions show the     */
+/*  machine state before they run, and reads and writes show what the     */
+/*  debugger would have shown for them.  Given the program's symbols, the   */
+/*  addresses get their labels too.  With no arguments but the file, it   */
+/*  says how long the trace is.                                             */
+/* ======================================================================== */
+
+#include "config.h"
+#include "plat/plat_lib.h"
+#include "util/symtab.h"
+#include "debug/trace.h"
+#include "debug/trace_fmt.h"
+
+/* ======================================================================== */
+/*  READ_SYMS    -- Read an as1600 symbol file.  Lines look like            */
+/*                  "0000a000 TOPMOUNT"; undefined symbols start with '?'.  */
+/* ======================================================================== */
+LOCAL symtab_t *read_syms(const char *fname)
+{
+    FILE     *f;
+    symtab_t *symtab;
+    char     buf[512], symb[512];
+
+    if (!(f = fopen(fname, "r")))
+    {
+        perror("fopen()");
+        fprintf(stderr, "jztrace: could not open '%s'\n", fname);
+        exit(1);
+    }
+
+    if (!(symtab = symtab_create()))
+    {
+        fprintf(stderr, "jztrace: out of memory\n");
+        exit(1);
+    }
+
+    while (fgets(buf, sizeof(buf), f) != NULL)
+    {
+        uint_32 addr = 0xFFFFFFFF, old_addr;
+
+        symb[0] = 0;
+        if (buf[0] == '?' || sscanf(buf, "%x %s", &addr, symb) != 2 ||
+            addr > 0xFFFF || symb[0] == 0)
+            continue;
+
+        if (symtab_getaddr(symtab, symb, &old_addr) != 0)
+            symtab_defsym(symtab, symb, addr);
+    }
+
+    fclose(f);
+    return symtab;
+}
+
+/* ======================================================================== */
+/*  PRINT_REC    -- Print one record, with its label if it has one.         */
+/* ======================================================================== */
+LOCAL void print_rec(trace_fmt_t *fmt, uint_64 num, const uint_16 *r)
+{
+    char        buf[TRACE_FMT_MAX];
+    const char  *label;
+
+    if ((label = trace_fmt_label(fmt, r)) != NULL)
+        printf("%s:\n", label);
+
+    if (trace_fmt(fmt, r, buf) > 0)
+        printf("%10llu %s", num, buf);
+}
+
+LOCAL void usage(void)
+{
+    fprintf(stderr,
+"usage: jztrace [-r record | -c cycle] [-n count] [-s symfile] trace.jzt\n"
+"\n"
+"    -r record   Start at this record number.  Default:  0\n"
+"    -c cycle    Start at the first record at or after this cycle\n"
+"    -n count    Print this many records.  Default:  100\n"
+"    -s symfile  Label addresses with the symbols in this as1600 .sym file\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    trace_rd_t  *rd;
+    trace_fmt_t fmt;
+    symtab_t    *symtab = NULL;
+    uint_64     start = 0, count = 100, i;
+    uint_16     rec[TRACE_REC_WORDS];
+    int         by_cycle = 0, seek = 0, j;
+
+    for (j = 1; j < argc && argv[j][0] == '-'; j++)
+    {
+        if (j + 1 >= argc)
+            usage();
+
+        if      (!strcmp(argv[j], "-r")) by_cycle = 0;
+        else if (!strcmp(argv[j], "-c")) by_cycle = 1;
+        else if (!strcmp(argv[j], "-n"))
+        {
+            count = strtoull(argv[++j], NULL, 0);
+            continue;
+        }
+        else if (!strcmp(argv[j], "-s"))
+        {
+            if (symtab)
+                symtab_destroy(symtab);
+            symtab = read_syms(argv[++j]);
+            continue;
+        }
+        else usage();
+
+        start = strtoull(argv[++j], NULL, 0);
+        seek  = 1;
+    }
+
+    if (j != argc - 1)
+        usage();
+
+    if (!(rd = trace_open(argv[j])))
+        exit(1);
+
+    if (!seek)
+    {
+        printf("%s:  %llu records\n", argv[j], trace_count(rd));
+        if (argc == 2)
+        {
+            trace_close(rd);
+            return 0;
+        }
+    }
+
+    if ((by_cycle ? trace_seek_cycle(rd, start) : trace_seek(rd, start)))
+    {
+        fprintf(stderr, "jztrace: the trace doesn't reach %s %llu\n",
+                by_cycle ? "cycle" : "record", start);
+        trace_close(rd);
+        exit(1);
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Requestor names come before their first access.  Starting partway */
+    /*  in, the accesses before the first name show "?" as the requestor.   */
+    /* -------------------------------------------------------------------- */
+    trace_fmt_init(&fmt, symtab);
+    fmt.width = 40;
+
+    for (i = 0; i < count; i++)
+    {
+        uint_64 num = trace_tell(rd);
+
+        if (trace_next(rd, rec))
+            break;
+        print_rec(&fmt, num, rec);
+    }
+
+    trace_close(rd);
+    if (symtab)
+        symtab_destroy(symtab);
+    return 0;
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */
@@ -0,0 +1,665 @@
+/* ======================================================================== */
+/*  SND_BENCH    -- Benchmark the audio pipeline in isolation.              */
+/*                                                                          */
+/*  Usage:  snd_bench [-r rate[,rate...]] [-b size[,size...]] [-c count]    */
+/*                    [-s seconds] [-t trace] [-v] [stream...]              */
+/*                                                                          */
+/*  Drives the PSGs, the Intellivoice, the mixer (snd_tick) and the output  */
+/*  callback (snd_fill) with a stream of register writes, with no CPU,      */
+/*  STIC or audio device in the loop.  Each stage is timed separately and   */
+/*  reported per output sample, for every combination of sample rate and    */
+/*  buffer size requested.                                                  */
+/*                                                                          */
+/*  The built-in streams are synthetic:                                     */
+/*                                                                          */
+/*      tone    -- PSG0 plays three-voice arpeggios.                        */
+/*      env     -- PSG0 plays envelope-driven voices, cycling the shapes.   */
+/*      noise   -- PSG0 sweeps the noise period.                            */
+/*      speech  -- The Intellivoice says every allophone other than the     */
+/*                 pauses, over and over.                                   */
+/*      mix     -- Tones on PSG0, envelopes and noise on PSG1, and speech,  */
+/*                 all at once, so the mixer has three sources to mix.      */
+/*                                                                          */
+/*  -t replays a register trace recorded with JZINTV_PSG_TRACE into PSG0,   */
+/*  as the stream "trace".  By default, all of the synthetic streams run.   */
+/*                                                                          */
+/*  The raw LPC-12 filter is also timed on its own, on random frames, at    */
+/*  the SP0256's native 10kHz.                                              */
+/* ======================================================================== */
+
+#include "config.h"
+#include "periph/periph.h"
+#include "snd/snd.h"
+#include "ay8910/ay8910.h"
+#include "ivoice/ivoice.h"
+#include "ivoice/lpc12.h"
+#include "plat/plat_lib.h"
+
+#define CPU_CLK     (894886)            /* CP-1610 cycles per second.       */
+#define FRAME       (14934)             /* CP-1610 cycles per NTSC frame.   */
+#define MAX_RATES   (16)
+
+#define DEV_PSG0    (0)
+#define DEV_PSG1    (1)
+#define DEV_IVOICE  (2)
+
+LOCAL const char *const all_str[] =
+{
+    "tone", "env", "noise", "speech", "mix"
+};
+
+/* ======================================================================== */
+/*  A stream is a time-ordered list of register writes.  For DEV_IVOICE,    */
+/*  an event is a poll of LRQ, which speaks the next allophone if the       */
+/*  SP0256 is ready for it.                                                 */
+/* ======================================================================== */
+typedef struct bench_ev_t
+{
+    uint_64     when;
+    uint_8      dev, addr;
+    uint_16     data;
+} bench_ev_t;
+
+typedef struct bench_str_t
+{
+    const char  *name;
+    bench_ev_t  *ev;
+    int         num_ev, max_ev;
+    uint_64     len;                    /* Total length in CPU cycles.      */
+    int         uses[3];                /* Devices this stream uses.        */
+} bench_str_t;
+
+/* ======================================================================== */
+/*  Per-stage accumulated time, in seconds.                                 */
+/* ======================================================================== */
+enum { ST_PSG, ST_IVOICE, ST_MIX, ST_FILL, ST_COUNT };
+
+LOCAL const char *const stage_name[ST_COUNT] =
+{
+    "psg", "ivoice", "mix", "fill"
+};
+
+typedef struct bench_t
+{
+    snd_t       snd;
+    ay8910_t    psg[2];
+    ivoice_t    ivoice;
+    periph_t    *src[3];
+    int         stage[3];
+    int         num_src;
+    double      t[ST_COUNT];
+    sint_16     *out;
+    int         allo;
+} bench_t;
+
+/* ======================================================================== */
+/*  STR_ADD      -- Append an event to a stream.                            */
+/* ======================================================================== */
+LOCAL void str_add(bench_str_t *s, uint_64 when, int dev, int addr, int data)
+{
+    if (s->num_ev == s->max_ev)
+    {
+        s->max_ev = s->max_ev ? s->max_ev * 2 : 1024;
+        s->ev     = (bench_ev_t *)realloc(s->ev, s->max_ev*sizeof(bench_ev_t));
+        if (!s->ev)
+        {
+            fprintf(stderr, "snd_bench: out of memory\n");
+            exit(1);
+        }
+    }
+
+    s->ev[s->num_ev].when = when;
+    s->ev[s->num_ev].dev  = dev;
+    s->ev[s->num_ev].addr = addr;
+    s->ev[s->num_ev].data = data;
+    s->num_ev++;
+    s->uses[dev] = 1;
+}
+
+/* ======================================================================== */
+/*  GEN_TONE     -- Three-voice arpeggios, a new note every frame.          */
+/* ======================================================================== */
+LOCAL void gen_tone(bench_str_t *s, int dev, uint_64 len)
+{
+    static const int scale[8] = { 428, 381, 339, 320, 285, 254, 226, 214 };
+    uint_64 t;
+    int f, c;
+
+    str_add(s, 0, dev, 8, 0x38);        /* Tone on A, B, C.  Noise off.     */
+    for (c = 0; c < 3; c++)
+        str_add(s, 0, dev, 11 + c, 15 - 2*c);
+
+    for (t = 0, f = 0; t < len; t += FRAME, f++)
+        for (c = 0; c < 3; c++)
+        {
+            int per = scale[(f + 2*c) & 7] >> c;
+
+            str_add(s, t, dev, 0 + c, per & 0xFF);
+            str_add(s, t, dev, 4 + c, per >> 8);
+        }
+}
+
+/* ======================================================================== */
+/*  GEN_ENV      -- Envelope-driven voices, retriggering every 8 frames     */
+/*                  and walking through all of the envelope shapes.         */
+/* ======================================================================== */
+LOCAL void gen_env(bench_str_t *s, int dev, uint_64 len)
+{
+    uint_64 t;
+    int f, c;
+
+    str_add(s, 0, dev, 8, 0x38);
+    for (c = 0; c < 3; c++)
+    {
+        str_add(s, 0, dev, 0 + c, 0x80 + 0x30 * c);
+        str_add(s, 0, dev, 4 + c, 0);
+        str_add(s, 0, dev, 11 + c, 0x30);
+    }
+
+    for (t = 0, f = 0; t < len; t += 8 * FRAME, f++)
+    {
+        int per = 0x40 + 0x30 * (f & 7);
+
+        str_add(s, t, dev, 3,  per & 0xFF);
+        str_add(s, t, dev, 7,  per >> 8);
+        str_add(s, t, dev, 10, 8 + (f & 7));
+    }
+}
+
+/* ======================================================================== */
+/*  GEN_NOISE    -- Noise with its period sweeping by frame.  On its own,   */
+/*                  noise goes to all three channels.  Over another         */
+/*                  stream, it's added to channel C and the tones stay.     */
+/* ======================================================================== */
+LOCAL void gen_noise(bench_str_t *s, int dev, uint_64 len, int over)
+{
+    uint_64 t;
+    int f, c;
+
+    if (over)
+        str_add(s, 0, dev, 8, 0x18);    /* Tone on A, B, C.  Noise on C.    */
+    else
+    {
+        str_add(s, 0, dev, 8, 0x07);    /* Noise on A, B, C.  Tone off.     */
+        for (c = 0; c < 3; c++)
+            str_add(s, 0, dev, 11 + c, 12);
+    }
+
+    for (t = 0, f = 0; t < len; t += FRAME, f++)
+        str_add(s, t, dev, 9, f & 31);
+}
+
+/* ======================================================================== */
+/*  GEN_SPEECH   -- Poll LRQ the way a game would, a few times a frame.     */
+/* ======================================================================== */
+LOCAL void gen_speech(bench_str_t *s, uint_64 len)
+{
+    uint_64 t;
+
+    for (t = 0; t < len; t += FRAME / 4)
+        str_add(s, t, DEV_IVOICE, 0, 0);
+}
+
+/* ======================================================================== */
+/*  SORT_EV      -- Stable sort of events by time.  Streams are built       */
+/*                  device by device, so this interleaves them.  qsort      */
+/*                  isn't stable, so the original order goes in the LSBs.   */
+/* ======================================================================== */
+LOCAL int ev_cmp(const void *a, const void *b)
+{
+    const bench_ev_t *ea = (const bench_ev_t *)a;
+    const bench_ev_t *eb = (const bench_ev_t *)b;
+
+    return ea->when < eb->when ? -1 : ea->when > eb->when;
+}
+
+LOCAL void sort_ev(bench_str_t *s)
+{
+    int i;
+
+    for (i = 0; i < s->num_ev; i++)
+        s->ev[i].when = (s->ev[i].when << 24) | i;
+
+    qsort(s->ev, s->num_ev, sizeof(bench_ev_t), ev_cmp);
+
+    for (i = 0; i < s->num_ev; i++)
+        s->ev[i].when >>= 24;
+}
+
+/* ======================================================================== */
+/*  MAKE_STREAM  -- Build one of the synthetic streams by name.             */
+/* ======================================================================== */
+LOCAL int make_stream(bench_str_t *s, const char *name, uint_64 len)
+{
+    memset(s, 0, sizeof(bench_str_t));
+    s->name = name;
+    s->len  = len;
+
+    if      (!strcmp(name, "tone"))   gen_tone  (s, DEV_PSG0, len);
+    else if (!strcmp(name, "env"))    gen_env   (s, DEV_PSG0, len);
+    else if (!strcmp(name, "noise"))  gen_noise (s, DEV_PSG0, len, 0);
+    else if (!strcmp(name, "speech")) gen_speech(s, len);
+    else if (!strcmp(name, "mix"))
+    {
+        gen_tone  (s, DEV_PSG0, len);
+        gen_env   (s, DEV_PSG1, len);
+        gen_noise (s, DEV_PSG1, len, 1);
+        gen_speech(s, len);
+        sort_ev(s);
+    } else
+        return -1;
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  LOAD_TRACE   -- Read a JZINTV_PSG_TRACE register trace for PSG0.        */
+/*                  Each line is "TTTTTTTTTTTTTTTT: R DD", in hex.          */
+/* ======================================================================== */
+LOCAL int load_trace(bench_str_t *s, const char *fname, uint_64 max_len)
+{
+    FILE *f;
+    char buf[80];
+    unsigned long long when;
+    unsigned addr, data;
+    uint_64 first = 0;
+
+    memset(s, 0, sizeof(bench_str_t));
+    s->name = "trace";
+
+    if (!(f = fopen(fname, "r")))
+    {
+        perror("fopen()");
+        fprintf(stderr, "snd_bench: can't open '%s'\n", fname);
+        return -1;
+    }
+
+    while (fgets(buf, sizeof(buf), f))
+    {
+        if (sscanf(buf, "%llx: %x %x", &when, &addr, &data) != 3)
+            continue;
+
+        if (!s->num_ev)
+            first = when;
+
+        when -= first;
+        if (max_len && when >= max_len)
+            break;
+
+        str_add(s, when, DEV_PSG0, addr & 0xF, data & 0xFF);
+        s->len = when + FRAME;
+    }
+
+    fclose(f);
+
+    if (!s->num_ev)
+    {
+        fprintf(stderr, "snd_bench: no register writes in '%s'\n", fname);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  TIMED_TICK   -- Tick one peripheral, charging the time to a stage.      */
+/* ======================================================================== */
+LOCAL uint_32 timed_tick(bench_t *b, periph_t *p, uint_32 len, int stage)
+{
+    double  start = get_time();
+    uint_32 step  = p->tick(p, len);
+
+    b->t[stage] += get_time() - start;
+    p->now      += step;
+
+    return step;
+}
+
+/* ======================================================================== */
+/*  ADVANCE      -- Bring every stage up to 'until'.  Sources stall when    */
+/*                  they run out of clean buffers, and the mixer waits on   */
+/*                  the slowest source, so go around the sources, the       */
+/*                  mixer and the output until everyone has caught up or    */
+/*                  nobody can make progress.  Sources that tick in big     */
+/*                  steps (the Intellivoice) may be left a little behind.   */
+/* ======================================================================== */
+LOCAL void advance(bench_t *b, uint_64 until)
+{
+    int i, behind, moved;
+
+    do
+    {
+        behind = moved = 0;
+
+        for (i = 0; i < b->num_src; i++)
+        {
+            periph_t *p = b->src[i];
+
+            while (p->now < until)
+            {
+                uint_32 len = until - p->now;
+
+                if (len > p->max_tick)
+                    len = p->max_tick;
+
+                if (!timed_tick(b, p, len, b->stage[i]))
+                    break;
+
+                moved = 1;
+            }
+
+            behind |= p->now < until;
+        }
+
+        while (b->snd.periph.now < until &&
+               timed_tick(b, &b->snd.periph,
+                          until - b->snd.periph.now, ST_MIX))
+            moved = 1;
+
+        while (b->snd.mixbuf.num_dirty)
+        {
+            double start = get_time();
+
+            snd_fill((void *)&b->snd, (uint_8 *)b->out, b->snd.buf_size * 2);
+            b->t[ST_FILL] += get_time() - start;
+            moved = 1;
+        }
+    } while (behind && moved);
+}
+
+/* ======================================================================== */
+/*  RUN_STREAM   -- Play one stream at one rate and buffer size.            */
+/* ======================================================================== */
+LOCAL int run_stream(const bench_str_t *s, int rate, int buf_size,
+                     int buf_cnt)
+{
+    bench_t b;
+    double  total, start;
+    int     i, st;
+    uint_64 samples;
+
+    memset(&b, 0, sizeof(b));
+
+    if (snd_init_null(&b.snd, rate, buf_size, buf_cnt))
+        return -1;
+
+    for (i = DEV_PSG0; i <= DEV_PSG1; i++)
+    {
+        if (!s->uses[i])
+            continue;
+
+        if (ay8910_init(&b.psg[i], i ? 0x0F0 : 0x1F0, &b.snd, rate,
+                        -1, 1, 1.0, 0))
+            return -1;
+
+        b.stage[b.num_src] = ST_PSG;
+        b.src[b.num_src++] = &b.psg[i].periph;
+    }
+
+    if (s->uses[DEV_IVOICE])
+    {
+        if (ivoice_init(&b.ivoice, 0x80, &b.snd, rate, -1, -1, NULL))
+            return -1;
+
+        b.stage[b.num_src] = ST_IVOICE;
+        b.src[b.num_src++] = &b.ivoice.periph;
+    }
+
+    if (!(b.out = CALLOC(sint_16, b.snd.buf_size)))
+    {
+        fprintf(stderr, "snd_bench: out of memory\n");
+        return -1;
+    }
+
+    /* -------------------------------------------------------------------- */
+    /*  Play the stream.                                                    */
+    /* -------------------------------------------------------------------- */
+    start = get_time();
+
+    for (i = 0; i < s->num_ev; i++)
+    {
+        const bench_ev_t *ev = &s->ev[i];
+
+        advance(&b, ev->when);
+
+        if (ev->dev == DEV_IVOICE)
+        {
+            periph_t *p = &b.ivoice.periph;
+
+            if (p->read(p, p, 0, 0) & 0x8000)
+                p->write(p, p, 0, 5 + b.allo++ % 59);
+        } else
+        {
+            periph_t *p = &b.psg[ev->dev].periph;
+
+            p->write(p, NULL, ev->addr, ev->data);
+        }
+    }
+
+    advance(&b, s->len);
+
+    total   = get_time() - start;
+    samples = b.snd.samples;
+
+    /* -------------------------------------------------------------------- */
+    /*  Report.  'other' is the bench loop itself, plus timer overhead.     */
+    /* -------------------------------------------------------------------- */
+    printf("%-7s %6d %5d x%-3d %8.1fms %7.1fx", s->name, rate,
+           b.snd.buf_size, b.snd.buf_cnt,
+           1000.0 * b.snd.buf_size * b.snd.buf_cnt / rate,
+           (double)s->len / CPU_CLK / total);
+
+    for (st = 0; st < ST_COUNT; st++)
+        if (samples && b.t[st] > 0)
+            printf(" %6.1f", 1e9 * b.t[st] / samples);
+        else
+            printf(" %6s", "-");
+
+    printf(" %8.2f\n", samples / total / 1e6);
+
+    /* -------------------------------------------------------------------- */
+    /*  Tear it all down.                                                   */
+    /* -------------------------------------------------------------------- */
+    for (i = 0; i < b.num_src; i++)
+        if (b.src[i]->dtor)
+            b.src[i]->dtor(b.src[i]);
+
+    b.snd.periph.dtor(&b.snd.periph);
+    free(b.out);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  BENCH_LPC12  -- Time the bare LPC-12 filter on random frames.           */
+/* ======================================================================== */
+LOCAL void bench_lpc12(double seconds)
+{
+    static sint_16 scratch[LPC12_SCBUF_SIZE];
+    lpc12_t  f;
+    uint_32  optr = 0;
+    long     samples = 0, target = (long)(seconds * 10000);
+    double   start, elapsed;
+    int      i;
+
+    memset(&f, 0, sizeof(f));
+    f.rng = 1;
+    srand(1);
+
+    start = get_time();
+
+    while (samples < target)
+    {
+        /* ---------------------------------------------------------------- */
+        /*  A new frame:  random coefficients, voiced 3/4 of the time.      */
+        /* ---------------------------------------------------------------- */
+        for (i = 0; i < 16; i++)
+            f.r[i] = rand();
+
+        f.r[0] &= 0x7F;                 /* Keep the amplitude reasonable.   */
+        f.r[1] = (rand() & 3) ? 40 + (rand() & 63) : 0;
+        f.r[14] = f.r[15] = 0;
+        f.interp = 0;
+        lpc12_regdec(&f);
+
+        f.rpt = 1 + (rand() & 7);
+        f.cnt = 0;
+
+        while (f.rpt > 0 || f.cnt > 0)
+            samples += lpc12_update(&f, LPC12_SCBUF_SIZE / 2, scratch, &optr);
+    }
+
+    elapsed = get_time() - start;
+
+    printf("lpc12 filter:  %7.1f ns/sample  %7.2f Msamples/sec  "
+           "(%.0fx realtime at 10kHz)\n\n",
+           1e9 * elapsed / samples, samples / elapsed / 1e6,
+           samples / elapsed / 10000);
+}
+
+/* ======================================================================== */
+/*  PARSE_LIST   -- Parse a comma-separated list of integers.               */
+/* ======================================================================== */
+LOCAL int parse_list(const char *s, int *list, int max)
+{
+    char *end;
+    int n = 0;
+
+    while (*s && n < max)
+    {
+        list[n++] = strtol(s, &end, 0);
+        if (*end != ',')
+            break;
+        s = end + 1;
+    }
+
+    return n;
+}
+
+LOCAL void usage(void)
+{
+    fprintf(stderr,
+"usage: snd_bench [-r rate[,rate...]] [-b size[,size...]] [-c count]\n"
+"                 [-s seconds] [-t trace] [-v] [stream...]\n"
+"\n"
+"    -r rates    Output sample rates.  Default:  22050,44100,48000\n"
+"    -b sizes    Sound buffer sizes.  Default:  512,1024,2048\n"
+"    -c count    Number of sound buffers.  Default:  Same as jzIntv\n"
+"    -s seconds  Emulated time per run.  Default:  20\n"
+"    -t trace    Also replay this JZINTV_PSG_TRACE register trace\n"
+"    -v          Show the devices' own messages\n"
+"\n"
+"    Streams:  tone env noise speech mix.  Default:  all of them\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    int         rate[MAX_RATES] = { 22050, 44100, 48000 }, num_rate = 3;
+    int         size[MAX_RATES] = { 512, 1024, 2048 },     num_size = 3;
+    int         buf_cnt = 0, num_str = 0, verbose = 0, i, r, z;
+    double      seconds = 20.0;
+    const char  *trace  = NULL;
+    bench_str_t str[8];
+    uint_64     len;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+        if (!strcmp(argv[i], "-v"))
+        {
+            verbose = 1;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+            usage();
+
+        if      (!strcmp(argv[i], "-r")) num_rate = parse_list(argv[++i], rate,
+                                                               MAX_RATES);
+        else if (!strcmp(argv[i], "-b")) num_size = parse_list(argv[++i], size,
+                                                               MAX_RATES);
+        else if (!strcmp(argv[i], "-c")) buf_cnt  = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s")) seconds  = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-t")) trace    = argv[++i];
+        else usage();
+    }
+
+    for (r = 0; r < num_rate; r++)
+        if (rate[r] < 10000 || rate[r] > 96000)
+        {
+            fprintf(stderr, "snd_bench: rate must be between 10000 "
+                            "and 96000\n");
+            exit(1);
+        }
+
+    len = (uint_64)(seconds * CPU_CLK);
+
+    /* -------------------------------------------------------------------- */
+    /*  The devices announce themselves every time they're initialized,     */
+    /*  which would bury the results.                                       */
+    /* -------------------------------------------------------------------- */
+    jzp_init(!verbose, stdout, NULL, NULL);
+
+    /* -------------------------------------------------------------------- */
+    /*  Build all the streams up front, so building them isn't timed.       */
+    /* -------------------------------------------------------------------- */
+    if (i == argc)
+    {
+        for (num_str = 0; num_str < 5; num_str++)
+            make_stream(&str[num_str], all_str[num_str], len);
+    } else
+    {
+        for (; i < argc && num_str < 7; i++)
+            if (make_stream(&str[num_str++], argv[i], len))
+            {
+                fprintf(stderr, "snd_bench: unknown stream '%s'\n", argv[i]);
+                usage();
+            }
+    }
+
+    if (trace && !load_trace(&str[num_str], trace, len))
+        num_str++;
+
+    bench_lpc12(seconds);
+
+    printf("Per-stage cost in ns per output sample:\n\n");
+    printf("%-7s %6s %10s %10s %8s", "stream", "rate", "buffers",
+           "latency", "speed");
+    for (i = 0; i < ST_COUNT; i++)
+        printf(" %6s", stage_name[i]);
+    printf(" %8s\n", "Msmp/s");
+
+    for (i = 0; i < num_str; i++)
+        for (r = 0; r < num_rate; r++)
+            for (z = 0; z < num_size; z++)
+                if (run_stream(&str[i], rate[r], size[z], buf_cnt))
+                {
+                    fprintf(stderr, "snd_bench: '%s' failed at %dHz, "
+                                    "buffer size %d\n",
+                                    str[i].name, rate[r], size[z]);
+                    exit(1);
+                }
+
+    for (i = 0; i < num_str; i++)
+        free(str[i].ev);
+
+    return 0;
+}
+
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 1998-2000, Joseph Zbiciak                  */
+/* ======================================================================== */